@@ -10,6 +10,17 @@ typedef enum {
   Action_update_ssbo_renderer_parameters = (1 << 5),
   Action_save_image = (1 << 6),
   Action_exit = (1 << 7),
+  // keeps what it can of the accumulation after a camera move,
+  // Action_restart_rendering takes precedence over it
+  Action_reproject = (1 << 8),
+  // moves the scene's triangles to where its animation has them at
+  // settings.scene_time_s, see AppState_animate_scene
+  Action_animate_scene = (1 << 9),
+  // uploads the scene's triangles after they moved, see
+  // Renderer_update_scene_geometry
+  Action_update_ssbo_geometry = (1 << 10),
+  // measures how good the scene's BVH is, see AppState_analyze_bvh
+  Action_analyze_bvh = (1 << 11),
 } Action;
 
 #endif // ACTION_H_
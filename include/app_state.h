@@ -2,8 +2,14 @@
 #define APP_STATE_H_
 
 #include "action.h"
+#include "checkpoint.h"
+#include "image_saver.h"
 #include "input_handler.h"
+#include "renderer/dynamic_resolution.h"
+#include "renderer.h"
 #include "scene.h"
+#include "scene/bvh/analysis.h"
+#include "scene/file_formats/gltf_animation.h"
 #include "settings.h"
 #include "stats.h"
 #include "window/resolution.h"
@@ -11,9 +17,14 @@
 
 typedef struct {
   Scene scene;
+  // not loaded unless the scene is animated
+  GltfAnimation scene_animation;
+  // of the scene's current BVH, nodes_count is 0 until it gets analyzed
+  BVHAnalysis bvh_analysis;
   Stats stats;
   Settings settings;
   Action pending_actions;
+  DynamicResolution dynamic_resolution;
 } AppState;
 
 inline static AppState AppState_default(void) {
@@ -22,6 +33,7 @@ inline static AppState AppState_default(void) {
       .scene = Scene_default(),
       .stats = Stats_default(),
       .pending_actions = 0,
+      .dynamic_resolution = DynamicResolution_new(),
   };
 }
 
@@ -35,11 +47,50 @@ RenderingState AppState_get_rendering_state(const AppState *app_state);
 
 void AppState_load_scene(AppState *app_state);
 void AppState_build_bvh(AppState *app_state, Arena *tmp_arena);
+// analyzes the scene's BVH, tracing BVH_ANALYSIS_RAYS rays through it, and
+// prints the analysis
+void AppState_analyze_bvh(AppState *app_state);
+// Moves the scene's triangles to where its animation has them at
+// settings.scene_time_s and refits the BVH to them, unless refits made it too
+// slow to traverse, in which case it gets built again with the midpoint split,
+// as that's much faster to build than with SAH.
+void AppState_animate_scene(AppState *app_state, Arena *tmp_arena);
+// advances settings.scene_time_s by the time the last frame took while the
+// animation is playing, starting it over after its last key
+void AppState_play_animation(AppState *app_state);
 
 void AppState_handle_inputs(AppState *app_state, InputHandler *input_handler,
                             const WindowEventsData *events);
 
-void AppState_save_image(AppState *app_state, GLuint fbo,
-                         WindowResolution resolution, Arena *tmp_arena);
+// the parameters to render with, which are the settings' ones except for the
+// resolution while it's reduced by dynamic resolution
+RendererParameters AppState_rendering_params(const AppState *app_state);
+
+// describes how the image was rendered, used for saved images' metadata
+SmallString AppState_str(const AppState *app_state);
+
+// starts saving fbo's image, which happens in the background, see ImageSaver
+void AppState_save_image(AppState *app_state, ImageSaver *image_saver,
+                         GLuint fbo, WindowResolution resolution);
+// saves the renderer's accumulated samples after running them through
+// the denoiser
+void AppState_save_denoised_image(AppState *app_state,
+                                  ImageSaver *image_saver,
+                                  const Renderer *renderer);
+// saves the renderer's averaged samples in the HDR format picked by the saved
+// image path, optionally denoised and with the first hit's albedo, normal and
+// depth as separate layers
+void AppState_save_hdr_image(AppState *app_state, ImageSaver *image_saver,
+                             const Renderer *renderer);
+
+// reads back the renderer's accumulated samples and writes them to
+// settings.checkpoint_path in the background, see CheckpointWriter
+void AppState_save_checkpoint(const AppState *app_state,
+                              CheckpointWriter *checkpoint_writer,
+                              const Renderer *renderer);
+// continues rendering from the checkpoint at settings.checkpoint_path, unless
+// there's none yet, exits if it was rendered with different settings
+// NOTE: must be called after the scene was loaded and the back buffer cleared
+void AppState_resume_from_checkpoint(AppState *app_state, Renderer *renderer);
 
 #endif // APP_STATE_H_
@@ -0,0 +1,64 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "app_state.h"
+#include "scene/bvh/strategies.h"
+#include "settings.h"
+#include "small_string.h"
+#include "stats.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BATCH_JOB_MAX_ARGS 64
+
+// One line of a job file: the arguments of a single render, written the same
+// way as on the command line, e.g.
+//   "scenes/cornell box.glb" --pos 0,1,4 -F 256 -o cornell.png
+// NOTE: arguments with spaces in them can be put in double quotes
+typedef struct {
+  // the arguments one after another, each terminated with a NUL
+  SmallString _args;
+  uint32_t _offsets[BATCH_JOB_MAX_ARGS];
+  uint32_t args_count;
+  // of the job file, for reporting errors
+  uint32_t line_number;
+} BatchJob;
+
+// returns false if the line has an unterminated quote or its arguments
+// don't fit in the job
+bool BatchJob_parse(BatchJob *self, const char *line);
+// points argv at the job's arguments, returns how many there are
+int BatchJob_argv(const BatchJob *self, const char *argv[BATCH_JOB_MAX_ARGS]);
+
+// Renders all of the jobs of a job file one after another in the same
+// process, so that the window, OpenGL context and shaders are set up only
+// once, and so is the scene together with its BVH as long as consecutive
+// jobs share it.
+typedef struct {
+  BatchJob *jobs;
+  uint32_t jobs_count;
+  // the job which starts next, the one after the one being rendered
+  uint32_t next;
+  // the settings from the command line, which each job's arguments are
+  // applied on top of
+  Settings base_settings;
+  // what the currently loaded scene was loaded from and built with
+  SmallString scene_path;
+  BVHStrategy bvh_strat;
+  // whether the current job had to load its scene
+  bool scene_loaded;
+  StatsTimer job_timer;
+} Batch;
+
+// reads the jobs of the file at path, one per line, skipping empty lines and
+// the ones starting with '#'
+// NOTE: exits if any of the jobs is invalid, before anything gets rendered
+Batch Batch_read(const char *path, const Settings *base_settings);
+// applies the next job's settings, loading its scene only if it isn't the
+// one which is already loaded, returns false once there are no more jobs
+bool Batch_start_next_job(Batch *self, AppState *app_state);
+// prints how long the current job took
+void Batch_finish_job(Batch *self, const AppState *app_state);
+void Batch_delete(Batch *self);
+
+#endif // BATCH_H_
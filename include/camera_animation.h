@@ -0,0 +1,73 @@
+#ifndef CAMERA_ANIMATION_H_
+#define CAMERA_ANIMATION_H_
+
+#include "app_state.h"
+#include "scene/camera.h"
+#include "small_string.h"
+#include "stats.h"
+#include "vec3.h"
+#include "yawpitch.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  float time_s;
+  vec3 pos;
+  // yaw in range [0, 2*PI)
+  YawPitch rotation;
+  // 0 keeps the scene camera's one
+  float fov_rad;
+} CameraKeyframe;
+
+// Camera moving through keyframes, in between which it gets linearly
+// interpolated, with yaw going the shorter way around.
+typedef struct {
+  // sorted by their time
+  CameraKeyframe *keyframes;
+  uint32_t keyframes_count;
+} CameraPath;
+
+// reads the camera path from the animation of the camera of a .gltf or .glb
+// file or otherwise from a keyframe file, with a keyframe per line, e.g.
+//   # time pos yaw,pitch [fov]
+//   0 0,1,4 0,0
+//   2.5 4,1,0 90,-10 60
+// NOTE: angles in keyframe files are in degrees, and a keyframe without a fov
+// keeps the one of the keyframe before it
+// NOTE: exits if the file is invalid
+CameraPath CameraPath_read(const char *path);
+// returns false if line isn't a keyframe
+bool CameraKeyframe_parse(CameraKeyframe *self, const char *line);
+float CameraPath_duration(const CameraPath *self);
+// base camera with its position, direction and fov taken from the path,
+// time_s gets clamped to the path's keyframes
+Camera CameraPath_sample(const CameraPath *self, float time_s, Camera base);
+void CameraPath_delete(CameraPath *self);
+
+// Renders a camera path as an image sequence: a frame per 1/fps seconds of
+// the path, each with the same number of samples and saved with its number
+// appended to the output path. The scene, its BVH and the renderer are set up
+// only once and each frame's image gets written on the image saver's thread
+// while the next one renders.
+typedef struct {
+  CameraPath path;
+  float fps;
+  // the frame being rendered
+  uint32_t frame;
+  uint32_t frames_count;
+  // where the frames get saved, before their numbers are appended
+  SmallString output_path;
+  StatsTimer frame_timer;
+} CameraAnimation;
+
+CameraAnimation CameraAnimation_new(const char *path, float fps,
+                                    const char *output_path);
+// sets app_state's camera and output path to the current frame's ones
+// NOTE: needs to be called again after the scene gets loaded, as that
+// replaces the camera with the scene's one
+void CameraAnimation_apply(const CameraAnimation *self, AppState *app_state);
+// moves on to rendering the next frame, returns false once there are no more
+bool CameraAnimation_next_frame(CameraAnimation *self, AppState *app_state);
+void CameraAnimation_delete(CameraAnimation *self);
+
+#endif // CAMERA_ANIMATION_H_
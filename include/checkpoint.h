@@ -0,0 +1,61 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "settings.h"
+#include "small_string.h"
+#include "stats.h"
+#include "utils/thread.h"
+#include "window/resolution.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Everything needed to continue a progressive render where it was left off:
+// the renderer's accumulated sums together with the number of frames they
+// hold and the seed offset their samples were rendered with.
+// NOTE: the buffers are laid out just like the renderer's back buffer, see
+// Renderer_read_accumulation and Renderer_read_aovs
+typedef struct {
+  WindowResolution resolution;
+  uint32_t frame_number, seed_offset;
+  // of the settings the samples were rendered with, see Checkpoint_settings_hash
+  uint64_t settings_hash;
+  // 4, 2, 4 and 4 floats per pixel
+  float *accumulation, *moments, *albedo, *normal;
+} Checkpoint;
+
+Checkpoint Checkpoint_new(WindowResolution resolution);
+void Checkpoint_delete(Checkpoint *self);
+
+// hash of the settings which affect the accumulated samples, a checkpoint
+// rendered with different ones can't be continued
+// NOTE: frames_to_render isn't one of them, so that a finished render can be
+// continued with more frames
+uint64_t Checkpoint_settings_hash(const Settings *settings);
+
+// Writes to a temporary file first, which then gets renamed to path, so that
+// the previous checkpoint at path is never left half overwritten.
+// NOTE: the file holds the values exactly as they are laid out in memory, so
+// it can only be read on a machine with the same endianness
+bool Checkpoint_write(const Checkpoint *self, const char *path);
+// returns false if the file couldn't be read or isn't a checkpoint
+bool Checkpoint_read(Checkpoint *self, const char *path);
+
+// Writes checkpoints on a background thread so that rendering doesn't wait
+// for them to hit the disk.
+typedef struct {
+  WorkQueue *_writer;
+  // started when the last checkpoint was written
+  StatsTimer _since_last_write;
+} CheckpointWriter;
+
+CheckpointWriter CheckpointWriter_new(void);
+// whether interval_s seconds have passed since the last checkpoint
+// (or since the writer was created)
+bool CheckpointWriter_due(const CheckpointWriter *self, double interval_s);
+// NOTE: takes ownership of the checkpoint
+void CheckpointWriter_write(CheckpointWriter *self, Checkpoint checkpoint,
+                            const char *path);
+// waits for the checkpoints which are still being written
+void CheckpointWriter_delete(CheckpointWriter *self);
+
+#endif // CHECKPOINT_H_
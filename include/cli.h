@@ -5,6 +5,11 @@
 #include "app_state.h"
 
 void handle_args(int argc, const char **argv, AppState *app_state); 
+// applies the arguments of a batch job on top of app_state's settings,
+// unlike handle_args starting from argv[0] and without validating them,
+// Action_load_scene in pending_actions tells whether a scene was given
+// NOTE: resets pending_actions
+void handle_job_args(int argc, const char **argv, AppState *app_state);
 
 
 
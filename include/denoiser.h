@@ -0,0 +1,38 @@
+#ifndef DENOISER_H_
+#define DENOISER_H_
+
+#include "window/resolution.h"
+#include <stdint.h>
+
+// number of à-trous iterations, each doubling the filter's footprint
+#define DENOISER_ITERATIONS 5
+
+// Edge-avoiding à-trous wavelet filter run on the CPU over the accumulated
+// samples, guided by the first hit's albedo and normal and by the per-pixel
+// variance of luminance.
+// NOTE: the inputs are laid out just like the renderer's back buffer, see
+// Renderer_read_accumulation and Renderer_read_aovs, so that they can be
+// read straight into them.
+typedef struct {
+  WindowResolution resolution;
+  // sums of samples with their count in alpha, 4 floats per pixel
+  float *accumulation;
+  // sums of luminance and of its square, 2 floats per pixel
+  float *moments;
+  // sums of the first hit's albedo and normal, 4 floats per pixel
+  float *albedo, *normal;
+  // the filtered colors, 3 floats per pixel, valid after Denoiser_run
+  float *color;
+
+  // the variance of the filtered colors' luminance
+  float *_variance;
+  // written by each iteration and then swapped with color and _variance
+  float *_next_color, *_next_variance;
+} Denoiser;
+
+Denoiser Denoiser_new(WindowResolution resolution);
+// filters the accumulated samples, leaving the result in color
+void Denoiser_run(Denoiser *self);
+void Denoiser_delete(Denoiser *self);
+
+#endif // DENOISER_H_
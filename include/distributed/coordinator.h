@@ -0,0 +1,12 @@
+#ifndef DISTRIBUTED_COORDINATOR_H_
+#define DISTRIBUTED_COORDINATOR_H_
+
+#include "app_state.h"
+
+// Splits rendering_params.frames_to_render into jobs, hands them out to
+// workers connecting to settings.distributed_address, merges their results
+// and saves the final image to settings.saved_image_path.
+// NOTE: doesn't need (nor create) an OpenGL context
+int Coordinator_run(AppState *app_state);
+
+#endif // DISTRIBUTED_COORDINATOR_H_
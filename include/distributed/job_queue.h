@@ -0,0 +1,33 @@
+#ifndef DISTRIBUTED_JOB_QUEUE_H_
+#define DISTRIBUTED_JOB_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DISTRIBUTED_MAX_WORKERS 64
+
+typedef struct {
+  uint32_t first_frame, frames_count;
+} DistributedFrameRange;
+
+// Splits frames [0, frames_count) into jobs of at most frames_per_job frames.
+// Jobs that were handed out but never finished (e.g. the worker crashed)
+// can be put back and will be handed out again before any new ones.
+typedef struct {
+  uint32_t next_frame, frames_count, frames_per_job;
+  // NOTE: a worker holds at most one job at a time,
+  // so there can't be more unfinished jobs than workers
+  DistributedFrameRange requeued[DISTRIBUTED_MAX_WORKERS];
+  uint32_t requeued_count;
+} DistributedJobQueue;
+
+DistributedJobQueue DistributedJobQueue_new(uint32_t frames_count,
+                                            uint32_t frames_per_job);
+
+// returns false if there are no more jobs to hand out
+bool DistributedJobQueue_pop(DistributedJobQueue *self,
+                             DistributedFrameRange *job);
+void DistributedJobQueue_requeue(DistributedJobQueue *self,
+                                 DistributedFrameRange job);
+
+#endif // DISTRIBUTED_JOB_QUEUE_H_
@@ -0,0 +1,113 @@
+#ifndef DISTRIBUTED_PROTOCOL_H_
+#define DISTRIBUTED_PROTOCOL_H_
+
+#include "distributed/job_queue.h"
+#include "renderer/parameters.h"
+#include "scene/camera.h"
+#include "small_string.h"
+#include "window/resolution.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Every message is a DistributedMessageHeader followed by payload_size bytes.
+// NOTE: structs are sent exactly as they are laid out in memory, so the
+// coordinator and all of the workers must be running the same build,
+// and so must the clients of a render server.
+#define DISTRIBUTED_MESSAGE_MAGIC 0x44525450 // "PTRD"
+
+typedef enum {
+  // worker -> coordinator, no payload
+  DistributedMessageType_JOB_REQUEST,
+  // coordinator -> worker, DistributedJob
+  DistributedMessageType_JOB,
+  // worker -> coordinator, DistributedJobResult followed by the pixels
+  DistributedMessageType_JOB_RESULT,
+  // coordinator -> worker, no payload, the worker should exit,
+  // also client -> render server, the server should exit
+  DistributedMessageType_DONE,
+  // client -> render server, DistributedRenderRequest
+  DistributedMessageType_RENDER_REQUEST,
+  // render server -> client, DistributedRenderResult followed by the pixels,
+  // the samples rendered so far, sent every progress_interval frames
+  DistributedMessageType_RENDER_PROGRESS,
+  // render server -> client, same as RENDER_PROGRESS with all of the frames
+  DistributedMessageType_RENDER_RESULT,
+  // render server -> client, SmallString saying why it couldn't render
+  DistributedMessageType_RENDER_ERROR,
+} DistributedMessageType;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t type;
+  uint64_t payload_size;
+} DistributedMessageHeader;
+
+// NOTE: same as when rendering in a single process,
+// the camera defined in the scene is used
+typedef struct {
+  SmallString scene_path;
+  RendererParameters rendering_params;
+  // BVHStrategy
+  uint32_t bvh_strat;
+  DistributedFrameRange frames;
+} DistributedJob;
+
+typedef struct {
+  DistributedFrameRange frames;
+  WindowResolution resolution;
+  // followed by resolution.width * resolution.height RGBA floats, holding
+  // the linear sums of the job's samples in rgb and their count in alpha
+} DistributedJobResult;
+
+typedef struct {
+  SmallString scene_path;
+  // BVHStrategy
+  uint32_t bvh_strat;
+  // rendering_params.frames_to_render is the sample budget,
+  // in frames of samples_per_pixel samples each
+  RendererParameters rendering_params;
+  // used unless use_scene_camera is set
+  Camera camera;
+  uint32_t use_scene_camera;
+  // frames rendered in between RENDER_PROGRESS messages, 0 sends only the
+  // RENDER_RESULT
+  uint32_t progress_interval;
+} DistributedRenderRequest;
+
+typedef struct {
+  uint32_t frames_rendered;
+  WindowResolution resolution;
+  // followed by resolution.width * resolution.height RGBA floats, bottom row
+  // first, holding the linear sums of the samples in rgb and their count
+  // in alpha, same as with DistributedJobResult
+} DistributedRenderResult;
+
+// Addresses are either "HOST:PORT" for TCP or a path to a unix domain socket.
+typedef struct {
+  int fd;
+} DistributedConnection;
+
+typedef struct {
+  int fd;
+  // set only when listening on a unix domain socket, so it can be removed
+  SmallString socket_path;
+} DistributedListener;
+
+DistributedListener DistributedListener_new(const char *address);
+bool DistributedListener_accept(const DistributedListener *self,
+                                DistributedConnection *conn);
+void DistributedListener_delete(DistributedListener *self);
+
+// NOTE: retries for a couple of seconds, so that workers can be started
+// at the same time as the coordinator
+DistributedConnection DistributedConnection_connect(const char *address);
+bool DistributedConnection_send(const DistributedConnection *self,
+                                DistributedMessageType type,
+                                const void *payload, uint64_t payload_size);
+bool DistributedConnection_recv_header(const DistributedConnection *self,
+                                       DistributedMessageHeader *header);
+bool DistributedConnection_recv_payload(const DistributedConnection *self,
+                                        void *payload, uint64_t payload_size);
+void DistributedConnection_delete(DistributedConnection *self);
+
+#endif // DISTRIBUTED_PROTOCOL_H_
@@ -0,0 +1,15 @@
+#ifndef DISTRIBUTED_ROLE_H_
+#define DISTRIBUTED_ROLE_H_
+
+typedef enum {
+  // regular, single process rendering
+  DistributedRole_NONE,
+  // hands out frames to workers and merges what they've rendered
+  DistributedRole_COORDINATOR,
+  // renders whatever the coordinator asks for
+  DistributedRole_WORKER,
+  // renders whatever its clients ask for, keeping the scenes loaded
+  DistributedRole_SERVER,
+} DistributedRole;
+
+#endif // DISTRIBUTED_ROLE_H_
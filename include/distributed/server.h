@@ -0,0 +1,21 @@
+#ifndef DISTRIBUTED_SERVER_H_
+#define DISTRIBUTED_SERVER_H_
+
+#include "arena.h"
+#include <stdbool.h>
+
+// number of scenes kept loaded with their BVHs built, loading another one
+// unloads the one which was used the longest time ago
+#define SERVER_MAX_SCENES 8
+
+// Listens on address (a socket path or HOST:PORT) for clients sending
+// DistributedRenderRequests, rendering them one after another and sending
+// back the progress and the final result of each. Scenes stay loaded in
+// between requests, so rendering the same scene again only takes rendering.
+// Clients are served one at a time until one of them sends DONE.
+// When headless it doesn't open a window, see Window_new_headless.
+// NOTE: a scene file which can't be loaded only fails the request asking
+// for it, see validate_gltf_scene
+int Server_run(const char *address, bool headless, Arena *tmp_arena);
+
+#endif // DISTRIBUTED_SERVER_H_
@@ -0,0 +1,11 @@
+#ifndef DISTRIBUTED_WORKER_H_
+#define DISTRIBUTED_WORKER_H_
+
+#include "arena.h"
+#include <stdbool.h>
+
+// Connects to a coordinator and renders jobs until it says that we're done.
+// When headless it doesn't open a window, see Window_new_headless.
+int Worker_run(const char *address, bool headless, Arena *tmp_arena);
+
+#endif // DISTRIBUTED_WORKER_H_
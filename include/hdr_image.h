@@ -0,0 +1,52 @@
+#ifndef HDR_IMAGE_H_
+#define HDR_IMAGE_H_
+
+#include "window/resolution.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HDR_IMAGE_MAX_CHANNELS 16
+#define HDR_IMAGE_MAX_BUFFERS 8
+
+typedef struct {
+  // e.g. "R" or "albedo.R" for a channel of a layer
+  const char *name;
+  // the channel's value for the first pixel, the next pixel's one is stride
+  // floats further, rows are stored bottom row first just like in OpenGL
+  const float *data;
+  uint32_t stride;
+} HdrImageChannel;
+
+// Linear float image made of channels which point into its buffers, so that
+// e.g. the renderer's back buffer can be written without repacking it.
+typedef struct {
+  WindowResolution resolution;
+  HdrImageChannel channels[HDR_IMAGE_MAX_CHANNELS];
+  uint32_t channels_count;
+  // freed by HdrImage_delete
+  float *_buffers[HDR_IMAGE_MAX_BUFFERS];
+  uint32_t _buffers_count;
+} HdrImage;
+
+HdrImage HdrImage_new(WindowResolution resolution);
+// allocates a buffer of floats_per_pixel floats per pixel owned by the image
+float *HdrImage_alloc(HdrImage *self, uint32_t floats_per_pixel);
+// takes ownership of a malloc'ed buffer
+void HdrImage_add_buffer(HdrImage *self, float *buffer);
+// NOTE: name must outlive the image
+void HdrImage_add_channel(HdrImage *self, const char *name, const float *data,
+                          uint32_t stride);
+void HdrImage_delete(HdrImage *self);
+
+// Writes an uncompressed scanline OpenEXR file with all of the channels stored
+// as either halfs or floats and comments as its comments attribute.
+// NOTE: lines are converted one at a time, so the file is never whole in memory
+bool HdrImage_write_exr(const HdrImage *self, const char *path,
+                        const char *comments, bool half);
+// Writes the first 3 channels as the colors of a PFM file.
+bool HdrImage_write_pfm(const HdrImage *self, const char *path);
+
+// rounds to the nearest half, overflowing to infinity
+uint16_t float_to_half(float f);
+
+#endif // HDR_IMAGE_H_
@@ -0,0 +1,78 @@
+#ifndef IMAGE_SAVER_H_
+#define IMAGE_SAVER_H_
+
+#include "glad/gl.h"
+#include "hdr_image.h"
+#include "small_string.h"
+#include "utils/thread.h"
+#include "window/resolution.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// how many images can be read back at once, reading one more waits for the
+// oldest to arrive
+#define IMAGE_SAVER_READBACKS 4
+// how many images can wait to be written before handing over another one
+// waits for the writer to catch up
+#define IMAGE_SAVER_QUEUED_WRITES 4
+
+typedef enum {
+  ImageFormat_PNG,
+  // OpenEXR, with all of the image's channels
+  ImageFormat_EXR,
+  // Portable Float Map, with just the colors
+  ImageFormat_PFM,
+  ImageFormat__COUNT,
+} ImageFormat;
+
+// the formats' file extensions
+static const char *ImageFormat_str[ImageFormat__COUNT] = {".png", ".exr",
+                                                          ".pfm"};
+
+// picks the format by the path's extension, PNG if it isn't any of them
+ImageFormat ImageFormat_from_path(const char *path);
+
+typedef struct {
+  GLuint pbo;
+  size_t pbo_size;
+  // signaled once the pixels are in pbo, NULL when nothing is being read
+  GLsync fence;
+  WindowResolution resolution;
+  SmallString path, description;
+} ImageReadback;
+
+// Saves PNG images without stalling rendering: the pixels get read back into
+// pixel buffer objects asynchronously and are then encoded and written to
+// files on a background thread.
+// NOTE: must be created after the OpenGL context
+typedef struct {
+  ImageReadback _readbacks[IMAGE_SAVER_READBACKS];
+  // the oldest readback, which will be reused next
+  uint32_t _next;
+  WorkQueue *_writer;
+} ImageSaver;
+
+ImageSaver ImageSaver_new(void);
+// starts reading the color attachment 0 of fbo, the image gets written to
+// path with description in its metadata once ImageSaver_update sees it arrive
+void ImageSaver_read(ImageSaver *self, GLuint fbo, WindowResolution resolution,
+                     const char *path, const char *description);
+// writes RGB pixels, stored bottom row first, on the background thread
+// NOTE: takes ownership of the malloc'ed pixels
+void ImageSaver_write(ImageSaver *self, uint8_t *pixels,
+                      WindowResolution resolution, const char *path,
+                      const char *description);
+// writes the HDR image in an HDR format on the background thread, with the
+// EXR's channels stored as halfs if half is set
+// NOTE: takes ownership of the image
+void ImageSaver_write_hdr(ImageSaver *self, HdrImage image, ImageFormat format,
+                          bool half, const char *path,
+                          const char *description);
+// hands the images which were already read back over to the writer,
+// should be called every frame
+void ImageSaver_update(ImageSaver *self);
+// waits for all of the images to be read back and written
+void ImageSaver_delete(ImageSaver *self);
+
+#endif // IMAGE_SAVER_H_
@@ -7,5 +7,9 @@ typedef float Mat4[16];
 
 vec3 Mat4_mul_vec3(const Mat4 mat, const vec3 vec);
 Vec3d Mat4_mul_Vec3d(const Mat4 mat, const Vec3d vec);
+// like Mat4_mul_vec3 but without the translation, e.g. for normals
+vec3 Mat4_mul_dir(const Mat4 mat, const vec3 dir);
+// out = a * b, out can't be either of them
+void Mat4_mul(Mat4 out, const Mat4 a, const Mat4 b);
 
 #endif // MAT4_H_
@@ -3,26 +3,91 @@
 
 #include "arena.h"
 #include "renderer/buffers.h"
+#include "renderer/gpu_timer.h"
 #include "renderer/parameters.h"
 #include "renderer/shaders.h"
 
 typedef struct {
   RendererShaders _shaders;
+  RendererShaders _resolve_shaders;
+  RendererShaders _adaptive_shaders;
+  RendererShaders _reproject_shaders;
+  // NOTE: compiled only once a compute backend gets used,
+  // program is 0 until then
+  RendererShaders _compute_shaders;
   RendererBuffers _buffers;
-  WindowResolution _res;
+  RendererGpuTimer _gpu_timer;
+  RendererParameters _params;
   uint32_t _frame_number;
+  // added to the frame number when seeding the RNG, so that frames rendered
+  // by different processes don't end up with the same samples
+  uint32_t _seed_offset;
+  // the current camera and the one the accumulated samples were rendered with
+  Camera _camera, _accumulated_camera;
 } Renderer;
 
 Renderer Renderer_new(Arena *arena);
+// returns true if any of the shaders were reloaded
+bool Renderer_update_shaders(Renderer *self, Arena *arena);
 
 void Renderer_load_scene(Renderer *self, const Scene *scene);
+// uploads the triangles, the BVH and the lights of the loaded scene after they
+// moved, which is much cheaper than loading it again
+// NOTE: the scene must have as many triangles, BVH nodes and lights as before
+void Renderer_update_scene_geometry(Renderer *self, const Scene *scene);
 void Renderer_set_camera(Renderer *self, Camera cam);
-void Renderer_set_params(Renderer *self, RendererParameters params);
+// NOTE: the arena is used when the compute shader has to be (re)compiled
+// to match the backend and tile size
+void Renderer_set_params(Renderer *self, RendererParameters params,
+                         Arena *arena);
 
+void Renderer_set_seed_offset(Renderer *self, uint32_t seed_offset);
+uint32_t Renderer_get_seed_offset(const Renderer *self);
+
+// adds samples_per_pixel samples to every pixel's accumulated sums,
+// or with adaptive sampling, more of them to the pixels that haven't converged
 void Renderer_render_frame(const Renderer *self, unsigned int frame_number);
+// number of pixels that got any samples when rendering the given frame,
+// only meaningful with adaptive sampling and for one of the last 2 frames
+// NOTE: waits for the frame to finish rendering
+uint32_t Renderer_get_sampled_pixels(const Renderer *self,
+                                     uint32_t frame_number);
+// the frames rendered in between get measured on the GPU as one batch, with
+// the time their draws took and how many rays and samples they traced
+void Renderer_begin_measuring(Renderer *self);
+void Renderer_end_measuring(Renderer *self, uint32_t frames);
+// returns false if no measured batch finished rendering since the last call,
+// without waiting for it
+bool Renderer_poll_measurement(Renderer *self, RendererGpuMeasurement *out);
+// turns the accumulated sums into an sRGB image in the fbo returned by
+// Renderer_get_fbo, so it has to be called before displaying or saving
+void Renderer_resolve(const Renderer *self);
 GLuint Renderer_get_fbo(const Renderer *self);
+// reads back the accumulated linear sums (rgb) and samples counts (alpha)
+// NOTE: rgba must be able to hold 4 floats per pixel of the rendering resolution
+void Renderer_read_accumulation(const Renderer *self, float *rgba);
+// reads back the sums of the samples' luminance and its square (2 floats per
+// pixel) and of the first hits' albedo and normal (4 floats, with the
+// luminance of the light they emit and their depth in alpha), any of them
+// can be NULL to skip it
+void Renderer_read_aovs(const Renderer *self, float *moments, float *albedo,
+                        float *normal);
+
+// the opposites of the two functions above, which replace the accumulated
+// sums, e.g. with the ones of a checkpoint, see Checkpoint
+// NOTE: the sums are kept only until the back buffer gets cleared
+void Renderer_write_accumulation(Renderer *self, const float *rgba);
+void Renderer_write_aovs(Renderer *self, const float *moments,
+                         const float *albedo, const float *normal);
 
+// starts accumulating from scratch, with the seed offset back at 0
 void Renderer_clear_backbuffer(Renderer *self);
+// Instead of clearing the back buffer after the camera moved, moves the
+// samples accumulated so far to where the new camera sees them, dropping the
+// ones of surfaces it didn't see before.
+// NOTE: frames_rendered get added to the seed offset, so that the frames
+// rendered next don't repeat the samples that were kept
+void Renderer_reproject(Renderer *self, uint32_t frames_rendered);
 
 void Renderer_delete(Renderer *self);
 
@@ -0,0 +1,18 @@
+#ifndef RENDERER_BACKEND_H_
+#define RENDERER_BACKEND_H_
+
+typedef enum {
+  // full-screen quad drawn with the fragment shader
+  RendererBackend_FRAGMENT,
+  // a compute shader workgroup per tile of the image
+  RendererBackend_COMPUTE,
+  // a fixed number of compute workgroups taking tiles off an atomic counter
+  // until there are none left
+  RendererBackend_PERSISTENT,
+  RendererBackend__COUNT,
+} RendererBackend;
+
+static const char *RendererBackend_str[RendererBackend__COUNT] = {
+    "Fragment", "Compute", "Persistent"};
+
+#endif // RENDERER_BACKEND_H_
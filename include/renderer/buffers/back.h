@@ -5,12 +5,33 @@
 #include "window/resolution.h"
 
 typedef struct {
+  // linear sums of all the samples in rgb and the number of samples in alpha
   GLuint fbo, fboTex;
+  // second color attachment of fbo, sums of the samples' luminance in r and
+  // of their squares in g, used for estimating the error of each pixel
+  GLuint moments_tex;
+  // further attachments of fbo, sums of the albedo and the normal at the
+  // first hit of every sample, which guide the denoiser, with the sums of
+  // the luminance it emits and of its depth in their alphas
+  GLuint albedo_tex, normal_tex;
+  // copies of fboTex and the 3 textures above from before the camera moved,
+  // for reprojecting them into the new view
+  // NOTE: created on the first reprojection, 0 until then
+  GLuint history_textures[4];
+  WindowResolution history_resolution;
+  // number of samples each pixel gets in the next frame with adaptive sampling
+  GLuint adaptive_fbo, adaptive_tex;
+  // sRGB image resolved from the sums, ready to be displayed or saved
+  GLuint resolve_fbo, resolve_tex;
 } RendererBuffersBack;
 
 RendererBuffersBack RendererBuffersBack_new(void);
 void RendererBuffersBack_resize(RendererBuffersBack *self,
                                 WindowResolution res);
+// copies the textures of fbo to the history ones,
+// which get (re)created if needed to match the resolution
+void RendererBuffersBack_copy_to_history(RendererBuffersBack *self,
+                                         WindowResolution res);
 
 void RendererBuffersBack_delete(RendererBuffersBack *self);
 
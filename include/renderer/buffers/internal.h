@@ -6,6 +6,11 @@
 typedef struct {
   GLuint vao;
   GLuint vbo;
+  // next tile to be taken by a workgroup of the persistent compute shader
+  GLuint tile_counter_ssbo;
+  // number of pixels that got any samples in a frame, for the last 2 frames,
+  // indexed by the frame number's parity (used by adaptive sampling)
+  GLuint sampled_pixels_ssbo;
 } RendererBuffersInternal;
 
 RendererBuffersInternal RendererBuffersInternal_new(void);
@@ -6,11 +6,14 @@
 
 typedef struct {
   GLuint triangles_ssbo, bvh_nodes_ssbo, mats_ssbo, triangles_data_ssbo,
-      camera_ssbo;
+      camera_ssbo, lights_ssbo, light_bvh_nodes_ssbo, triangles_lights_ssbo;
 } RendererBuffersScene;
 
 RendererBuffersScene RendererBuffersScene_new(const Scene *scene);
 void RendererBuffersScene_set_camera(RendererBuffersScene *self, Camera cam);
+// NOTE: the buffers keep their sizes, see Renderer_update_scene_geometry
+void RendererBuffersScene_update_geometry(RendererBuffersScene *self,
+                                          const Scene *scene);
 
 void RendererBuffersScene_delete(RendererBuffersScene *self);
 
@@ -0,0 +1,39 @@
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+#include "window/resolution.h"
+#include <stdbool.h>
+
+// the smallest fraction of the rendering resolution that can be rendered at
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.1f
+// the scale changes only in steps of this size, so that small variations in
+// frame time don't reallocate the back buffer every frame
+#define DYNAMIC_RESOLUTION_SCALE_STEP 0.05f
+// how many frames in a row the camera has to stay still for to go back to the
+// full resolution, so that a camera moving in fits and starts, e.g. with the
+// mouse, doesn't keep switching between the two
+#define DYNAMIC_RESOLUTION_STILL_FRAMES 8
+
+// Renders at a fraction of the rendering resolution while the camera moves,
+// chosen so that frames take about the target time.
+typedef struct {
+  // fraction of the rendering resolution's width and height
+  float scale;
+  // whether the reduced resolution is the one being rendered at
+  bool active;
+  // frames in a row the camera has been still for while active
+  unsigned int still_frames;
+} DynamicResolution;
+
+DynamicResolution DynamicResolution_new(void);
+// Adjusts the scale based on how long the last frame took, returns true if
+// the resolution to render at has changed.
+// NOTE: once the camera stops moving for DYNAMIC_RESOLUTION_STILL_FRAMES it
+// goes back to the full resolution
+bool DynamicResolution_update(DynamicResolution *self, bool camera_moving,
+                              double last_frame_time, double target_frame_time);
+// the resolution to render at, given the full one
+WindowResolution DynamicResolution_apply(const DynamicResolution *self,
+                                         WindowResolution resolution);
+
+#endif // DYNAMIC_RESOLUTION_H_
@@ -0,0 +1,56 @@
+#ifndef RENDERER_GPU_TIMER_H_
+#define RENDERER_GPU_TIMER_H_
+
+#include "glad/gl.h" // GLuint
+#include <stdbool.h>
+#include <stdint.h>
+
+// how many batches of frames can be measured before the first one has to be
+// read back, reading it back then doesn't wait for the GPU
+#define RENDERER_GPU_TIMER_BATCHES 2
+
+// what the GPU did while rendering a batch of frames
+typedef struct {
+  uint64_t time_ns;
+  // traced by the path tracer, both the ones finding the closest hit and the
+  // shadow rays
+  uint64_t rays;
+  // samples taken by all of the pixels together
+  uint64_t samples;
+  uint32_t frames;
+  // of the resolution the frames were rendered at
+  uint32_t pixels;
+} RendererGpuMeasurement;
+
+// Measures batches of frames with GL_TIME_ELAPSED queries around their draws
+// and counters the shaders add the rays and samples they traced to.
+// NOTE: a new batch only reuses the query and counters of the one before the
+// previous one, whose results are only read once the GPU is done with them,
+// so measuring never makes the CPU wait for the GPU
+typedef struct {
+  GLuint _queries[RENDERER_GPU_TIMER_BATCHES];
+  // 64 bit counts of the rays and samples, as their low and high 32 bits
+  GLuint _counters_ssbos[RENDERER_GPU_TIMER_BATCHES];
+  // the batches whose results haven't been read back yet
+  bool _pending[RENDERER_GPU_TIMER_BATCHES];
+  uint32_t _frames[RENDERER_GPU_TIMER_BATCHES];
+  uint32_t _pixels[RENDERER_GPU_TIMER_BATCHES];
+  // the batch being measured or which will be measured next
+  uint32_t _current;
+  // in between RendererGpuTimer_begin and _end, the shaders only count the
+  // rays and samples then
+  bool measuring;
+} RendererGpuTimer;
+
+RendererGpuTimer RendererGpuTimer_new(void);
+// the frames rendered in between get measured as one batch
+void RendererGpuTimer_begin(RendererGpuTimer *self);
+void RendererGpuTimer_end(RendererGpuTimer *self, uint32_t frames,
+                          uint32_t pixels);
+// Reads back the latest batch the GPU is done with, returns false if none got
+// done since the last call.
+bool RendererGpuTimer_poll(RendererGpuTimer *self,
+                           RendererGpuMeasurement *out);
+void RendererGpuTimer_delete(RendererGpuTimer *self);
+
+#endif // RENDERER_GPU_TIMER_H_
@@ -15,6 +15,20 @@ typedef struct {
   // -1 means infinite, NOTE: assuming progressive rendering
   int32_t frames_to_render;
   WindowResolution rendering_resolution;
+  // RendererBackend
+  int32_t backend;
+  // size of a compute workgroup, which renders a tile of that size
+  uint32_t tile_width, tile_height;
+  // number of workgroups dispatched by RendererBackend_PERSISTENT
+  uint32_t persistent_workgroups;
+  // number of bounces after which paths can get terminated by russian
+  // roulette, NOTE: it's disabled if it's not less than max_bounce_count
+  int32_t russian_roulette_depth;
+  // pixels whose estimated relative error drops below this stop getting
+  // samples, with the rest getting more instead, 0 disables adaptive sampling
+  // NOTE: once all pixels converge rendering finishes, even before
+  // frames_to_render frames
+  float adaptive_threshold;
 } RendererParameters;
 
 RendererParameters RendererParameters_default(void);
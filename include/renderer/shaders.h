@@ -4,16 +4,30 @@
 #include "arena.h"
 #include "glad/gl.h"
 #include "utils/file_watcher.h"
+#include <stdint.h>
+
+#define RENDERER_SHADERS_MAX_INCLUDES 8
 
 typedef struct {
   GLuint program;
+  // NOTE: compute programs have no vertex shader,
+  // their compute shader is stored in fragment_shader
+  bool is_compute;
   FileWatcher vertex_shader;
   FileWatcher fragment_shader;
+  // files pasted into the shaders with `#include "path"`,
+  // so that changing them also triggers a reload
+  FileWatcher includes[RENDERER_SHADERS_MAX_INCLUDES];
+  uint32_t includes_count;
+  // pasted right after the #version line of the fragment (or compute) shader
+  char defines[256];
 } RendererShaders;
 
 RendererShaders RendererShaders_new(const char *vertex_shader_path,
                                     const char *fragment_shader_path,
                                     Arena *arena);
+RendererShaders RendererShaders_new_compute(const char *compute_shader_path,
+                                            const char *defines, Arena *arena);
 bool RendererShaders_update(RendererShaders *self, Arena *arena);
 void RendererShaders_force_update(RendererShaders *self, Arena *arena);
 void RendererShaders_delete(RendererShaders *self);
@@ -6,6 +6,8 @@
 #include "scene/bvh.h"
 #include "scene/bvh/strategies.h"
 #include "scene/camera.h"
+#include "scene/light.h"
+#include "scene/light_bvh.h"
 #include "scene/material.h"
 #include "scene/primitive.h"
 #include "scene/triangle.h"
@@ -15,11 +17,23 @@ typedef struct {
   TriangleEx *triangles_data;
   BVHnode *bvh_nodes;
   Material *mats;
+  // emissive triangles, used for sampling the lights directly
+  Light *lights;
+  LightBVHnode *light_bvh_nodes;
+  // index into lights of every triangle or NO_LIGHT
+  uint32_t *triangles_lights;
+  // index every triangle had before the BVH reordered them, so that
+  // animations can find their vertices, NULL unless the scene is animated
+  uint32_t *triangles_sources;
   Camera camera;
 
-  uint32_t triangles_count, bvh_nodes_count, mats_count;
+  uint32_t triangles_count, bvh_nodes_count, mats_count, lights_count,
+      light_bvh_nodes_count;
   uint32_t triangles_capacity, triangles_data_capacity, bvh_nodes_capacity,
-      mats_capacity;
+      mats_capacity, lights_capacity, triangles_lights_capacity;
+  float lights_total_power;
+  // of the BVH right after it got built, see Scene_refit_bvh
+  float bvh_built_cost;
 } Scene;
 
 // NOTE: all structs that are passed as arrays to OpenGL
@@ -35,12 +49,28 @@ OPENGL_CHECK_STD430_COMPLIANCE(Material);
 OPENGL_CHECK_STD430_COMPLIANCE(TriangleEx);
 OPENGL_CHECK_STD430_COMPLIANCE(Camera);
 OPENGL_CHECK_STD430_COMPLIANCE(BVHnode);
+OPENGL_CHECK_STD430_COMPLIANCE(Light);
+OPENGL_CHECK_STD430_COMPLIANCE(LightsHeader);
+OPENGL_CHECK_STD430_COMPLIANCE(LightBVHnode);
 
 inline static Scene Scene_default(void) { return (Scene){0}; }
 
 void Scene_build_bvh(Scene *scene, BVHStrategy find_best_split_fn_strat,
                      Arena *tmp_arena);
 
+// how many times slower to traverse refits can make the BVH before
+// Scene_refit_bvh asks for it to be built again
+#define SCENE_MAX_REFIT_COST_GROWTH 1.5f
+
+// Updates the BVH and the lights to the triangles' new positions after they
+// were moved, without reordering the triangles. Returns false if the refitted
+// BVH got so much slower to traverse that it should be built again instead.
+bool Scene_refit_bvh(Scene *scene, Arena *tmp_arena);
+
+// Finds all the emissive triangles, their hierarchy is only built together
+// with the BVH, as that's when the triangles get their final indices.
+void Scene_build_lights(Scene *scene);
+
 bool Scene_is_empty(const Scene *scene);
 
 void Scene_delete(Scene *self);
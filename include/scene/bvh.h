@@ -38,6 +38,16 @@ void BVH_build(BVHnode *nodes, BVHNodeCount *nodes_offset,
                BVHTriCount tri_offset, BVHTriCount tri_count,
                FindBestSplitFn find_best_split_fn, Arena *arena);
 
+// Updates the bounds of all of the nodes to the triangles' current positions,
+// keeping the tree as it is, which is much faster than building a new one but
+// gets slower to traverse the further the triangles move from where they were.
+// NOTE: the triangles must still be in the order the BVH was built with
+void BVH_refit(BVHnode *nodes, BVHNodeCount nodes_count,
+               const Triangle triangles[]);
+// estimated cost of tracing a ray through the BVH, relative to testing it
+// against a single triangle, see the surface area heuristic
+float BVH_cost(const BVHnode *nodes, BVHNodeCount nodes_count);
+
 #define SWAP(_a, _b, _type)                                                    \
   do {                                                                         \
     _type tmp = _a;                                                            \
@@ -0,0 +1,58 @@
+#ifndef BVH_ANALYSIS_H_
+#define BVH_ANALYSIS_H_
+
+#include "scene/bvh.h"
+#include "scene/triangle.h"
+#include "small_string.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// leaves deeper than this are counted in the last depth
+#define BVH_ANALYSIS_MAX_DEPTH 64
+// leaves with more triangles than this are counted in the last size
+#define BVH_ANALYSIS_MAX_LEAF_SIZE 16
+// how many rays BVH_analyze traces by default
+#define BVH_ANALYSIS_RAYS 16384
+
+// Quality metrics of a built BVH, for comparing the strategies it can be
+// built with, see BVH_analyze.
+typedef struct {
+  BVHNodeCount nodes_count, leaves_count;
+  // reachable from the root, any others are wasted
+  BVHNodeCount reached_nodes;
+  BVHTriCount triangles_count;
+  // see BVH_cost
+  float sah_cost;
+  uint32_t max_depth;
+  float mean_leaf_depth;
+  // how many leaves are at each depth
+  uint32_t leaves_per_depth[BVH_ANALYSIS_MAX_DEPTH];
+  // how many leaves hold each number of triangles
+  uint32_t leaves_per_size[BVH_ANALYSIS_MAX_LEAF_SIZE + 1];
+  // nodes whose bounds don't contain anything
+  BVHNodeCount empty_nodes;
+  // nodes whose bounds have no surface area, e.g. of a single triangle seen
+  // edge-on, which rays can only ever graze
+  BVHNodeCount degenerate_nodes;
+  // surface area of the intersection of the children's bounds relative to
+  // their parent's, on average over all of the branches, the closer to 0 the
+  // fewer rays have to visit both of them
+  float sibling_overlap;
+  // of the nodes and the triangles, as they're uploaded to the GPU
+  size_t nodes_bytes, triangles_bytes;
+
+  // of rays starting at random points of random triangles in random
+  // directions, like the bounces of paths do, 0 if none were traced
+  uint32_t rays_count;
+  float nodes_per_ray, triangles_per_ray;
+} BVHAnalysis;
+
+// Walks the whole BVH and traces rays_count rays through it.
+// NOTE: the rays are always the same ones for the same triangles
+BVHAnalysis BVH_analyze(const BVHnode *nodes, BVHNodeCount nodes_count,
+                        const Triangle *triangles, BVHTriCount triangles_count,
+                        uint32_t rays_count);
+
+SmallString BVHAnalysis_str(const BVHAnalysis *self);
+
+#endif // BVH_ANALYSIS_H_
@@ -0,0 +1,55 @@
+#ifndef TRAVERSAL_H_
+#define TRAVERSAL_H_
+
+#include "scene/bvh.h"
+#include "scene/triangle.h"
+#include "vec3.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: as the nearer child gets popped right after being pushed, the stack
+// grows by at most one node per level of the tree
+#define BVH_TRAVERSAL_STACK_SIZE 64
+
+typedef struct {
+  vec3 origin, dir;
+  // 1 / dir
+  vec3 inv_dir;
+} Ray;
+
+Ray Ray_new(vec3 origin, vec3 dir);
+
+typedef struct {
+  bool did_hit;
+  float dst;
+  // index into the (BVH ordered) triangles array
+  BVHTriCount triangle;
+} BVHHit;
+
+// work done while traversing, used to judge the quality of a BVH
+typedef struct {
+  uint64_t nodes_visited;
+  uint64_t triangles_tested;
+} BVHTraversalStats;
+
+// returns the distance at which the ray enters the node's bounds
+// (negative if it starts inside of them) or INFINITY if it misses them
+float BVHnode_intersect(const BVHnode *node, const Ray *ray);
+// returns true and sets dst if the ray hits the triangle
+bool Triangle_intersect(const Triangle *t, const Ray *ray, float *dst);
+
+// Finds the closest triangle hit by the ray, visiting the nearer child first
+// and skipping nodes that are farther away than the closest hit found so far.
+// Same as FindRayCollision in shaders/pathtracer.glsl.
+// NOTE: stats can be NULL, otherwise the work done gets added to it
+BVHHit BVH_intersect(const BVHnode *nodes, const Triangle *triangles,
+                     const Ray *ray, BVHTraversalStats *stats);
+
+// Checks whether the ray hits anything closer than max_dst, returning as soon
+// as any such hit is found, so the order of visiting the nodes doesn't matter.
+// Same as IsOccluded in shaders/pathtracer.glsl.
+// NOTE: stats can be NULL, otherwise the work done gets added to it
+bool BVH_is_occluded(const BVHnode *nodes, const Triangle *triangles,
+                     const Ray *ray, float max_dst, BVHTraversalStats *stats);
+
+#endif // TRAVERSAL_H_
@@ -1,8 +1,25 @@
 #ifndef GLTF_H_
 #define GLTF_H_
 
+#include "camera_animation.h"
 #include "scene.h"
+#include "scene/file_formats/gltf_animation.h"
+#include "small_string.h"
+#include <stdbool.h>
 
 void load_gltf_scene(Scene *scene, const char *filename);
+// Checks the file for everything that would make load_gltf_scene exit,
+// returns false and why in error if it can't be loaded.
+// NOTE: parses the whole file, but doesn't load the scene
+bool validate_gltf_scene(const char *filename, SmallString *error);
+// like load_gltf_scene, also reading the scene's animation, which is left
+// unloaded if the scene doesn't have any, see GltfAnimation
+void load_gltf_animated_scene(Scene *scene, GltfAnimation *animation,
+                              const char *filename);
+// reads the camera path of the first animation which moves the scene's camera,
+// keyframed at the times of all of its keys which move it
+// NOTE: only the camera's transform can be animated, not its fov, and its roll
+// gets ignored just like when loading the scene
+CameraPath load_gltf_camera_path(const char *filename);
 
 #endif // GLTF_H_
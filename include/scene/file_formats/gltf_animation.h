@@ -0,0 +1,71 @@
+#ifndef GLTF_ANIMATION_H_
+#define GLTF_ANIMATION_H_
+
+#include "cgltf.h"
+#include "mat4.h"
+#include "scene.h"
+#include "vec3.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// a primitive of a mesh instance, with the vertices its triangles use
+typedef struct {
+  const cgltf_node *node;
+  const cgltf_primitive *prim;
+  uint32_t first_vertex, vertices_count;
+  // transform of the node, skinned ones get transformed by the matrices of
+  // their joints in GltfAnimation's joint_matrices instead
+  Mat4 world;
+  uint32_t first_joint_matrix;
+  // morph target weights at the current time, in GltfAnimation's weights
+  uint32_t first_weight, targets_count;
+  const cgltf_animation_channel *weights_channel;
+  // where the morph targets' offsets of its vertices start, see GltfAnimation
+  uint32_t first_offset;
+} GltfAnimatedPrimitive;
+
+// Plays the first animation of a glTF file on the triangles of its scene:
+// moves its nodes, poses its skins and blends its morph targets.
+// NOTE: the file stays loaded as the animation needs its nodes
+typedef struct {
+  cgltf_data *_data;
+  const cgltf_animation *_animation;
+  // the times of the animation's first and last keys
+  float start_s, end_s;
+
+  GltfAnimatedPrimitive *_primitives;
+  uint32_t _primitives_count;
+  Mat4 *_joint_matrices;
+  float *_weights;
+
+  // of all of the primitives' vertices one after another, in their meshes'
+  // space before being animated
+  vec3 *_positions, *_normals;
+  // the same, animated and in world space
+  vec3 *_animated_positions, *_animated_normals;
+  // (only with skins) 4 joints with their weights for every vertex
+  uint32_t *_joints;
+  float *_joint_weights;
+  // (only with morph targets) position and normal offsets of each primitive's
+  // vertices, all of them for its first target, then for the second one, ...
+  vec3 *_position_offsets, *_normal_offsets;
+  uint32_t vertices_count;
+
+  // indices of the vertices of every triangle of the scene, in the order the
+  // triangles were loaded in
+  uint32_t *_triangles_vertices;
+} GltfAnimation;
+
+// Reads the animation of the scene which was loaded from data, returns false
+// if it doesn't have any animation which moves its triangles.
+// NOTE: takes ownership of data if it returns true
+bool GltfAnimation_new(GltfAnimation *self, cgltf_data *data, const char *path,
+                       Scene *scene);
+bool GltfAnimation_is_loaded(const GltfAnimation *self);
+// moves the scene's triangles to where they are at time_s, which gets clamped
+// to the animation's keys
+// NOTE: the BVH has to be refit or built again afterwards
+void GltfAnimation_apply(GltfAnimation *self, Scene *scene, float time_s);
+void GltfAnimation_delete(GltfAnimation *self);
+
+#endif // GLTF_ANIMATION_H_
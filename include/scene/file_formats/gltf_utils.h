@@ -22,6 +22,17 @@ typedef void(HandleNodeFn)(const char *path, const cgltf_data *data,
 void traverse_nodes(const char *path, const cgltf_data *data, Scene *scene,
                     HandleNodeFn handle_node_fn);
 
+// position and direction of the camera of node, as the scene would have it
+void gltf_camera_transform(const cgltf_node *node, vec3 *pos, vec3 *dir);
+
+// most components gltf_sample_animation can sample
+#define GLTF_MAX_SAMPLED_COMPONENTS 64
+
+// samples the channel's value at time_s, which has components floats, e.g. 4
+// for rotations, time_s gets clamped to the range of the channel's keys
+void gltf_sample_animation(const cgltf_animation_channel *channel,
+                           float time_s, float *out, cgltf_size components);
+
 HandleNodeFn count_mesh_instances;
 HandleNodeFn handle_node;
 
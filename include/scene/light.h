@@ -0,0 +1,27 @@
+#ifndef SCENE_LIGHT_H_
+#define SCENE_LIGHT_H_
+
+#include <stdint.h>
+
+// light index of the triangles which don't emit any light
+#define NO_LIGHT (uint32_t)-1
+
+// an emissive triangle, which gets sampled using the light BVH
+typedef struct {
+  // index into the (BVH ordered) triangles array
+  uint32_t triangle;
+  // luminance of the emitted light times the area of the triangle
+  float power;
+  // path from the root of the light BVH to this light's leaf,
+  // the i-th bit being set if the second child was taken at depth i
+  uint64_t bit_trail;
+} Light;
+
+// put at the start of the lights SSBO, right before the lights themselves
+typedef struct {
+  uint32_t count;
+  float total_power;
+  uint64_t _;
+} LightsHeader;
+
+#endif // SCENE_LIGHT_H_
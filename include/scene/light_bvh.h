@@ -0,0 +1,46 @@
+#ifndef LIGHT_BVH_H_
+#define LIGHT_BVH_H_
+
+#include "arena.h"
+#include "scene/light.h"
+#include "scene/triangle.h"
+#include "vec3.h"
+#include <stdint.h>
+
+// a light's bit trail has a bit for every level above it
+#define LIGHT_BVH_MAX_DEPTH 64
+
+// Same as BVHnode but for the lights: if count > 0 it's a leaf with the light
+// at index first, otherwise its children are at first and first + 1.
+// NOTE: the lights are two-sided, so they emit on both sides of their normals
+typedef struct {
+  vec3 bound_min, bound_max;
+  // normals of all the lights in the node are within the cone around axis
+  // with a half angle of theta_o
+  vec3 axis;
+  // total power of the lights in the node
+  float power;
+  float cos_theta_o;
+  uint32_t first, count;
+} LightBVHnode;
+
+// Builds a hierarchy with a leaf per light, splitting the nodes by the
+// surface area orientation heuristic, and sets the lights' bit trails.
+// NOTE: nodes should have space for 2 * lights_count - 1 nodes
+void LightBVH_build(LightBVHnode *nodes, uint32_t *nodes_count, Light *lights,
+                    uint32_t lights_count, const Triangle *triangles,
+                    Arena *arena);
+
+// Estimates how much light from the node can reach a surface at point, with
+// the normal facing the side which receives light. Can be 0, but never if
+// any of the node's lights could actually light the point.
+// Same as LightImportance in shaders/pathtracer.glsl.
+float LightBVHnode_importance(const LightBVHnode *node, vec3 point,
+                              vec3 normal);
+
+// probability of picking the light when sampling the light BVH at point,
+// by following the light's bit trail
+float LightBVH_pmf(const LightBVHnode *nodes, const Light *light, vec3 point,
+                   vec3 normal);
+
+#endif // LIGHT_BVH_H_
@@ -1,6 +1,7 @@
 #ifndef SETTINGS_H_
 #define SETTINGS_H_
 
+#include "distributed/role.h"
 #include "renderer/parameters.h"
 #include "scene/bvh/strategies.h"
 #include "scene/camera.h"
@@ -12,10 +13,54 @@ typedef struct {
   RendererParameters rendering_params;
   SmallString scene_path;
   BVHStrategy BVH_build_strat;
+  // analyze every BVH after it gets built, see AppState_analyze_bvh
+  bool bvh_report;
   SmallString saved_image_path;
   WindowScalingMode scaling_mode;
+  DistributedRole distributed_role;
+  // where the coordinator listens or where a worker connects to
+  SmallString distributed_address;
+  int32_t frames_per_job;
   bool gui_enabled, hot_reload_enabled, save_after_rendering,
       exit_after_rendering, movement_enabled;
+  // run the saved images through the denoiser, see AppState_save_denoised_image
+  bool denoise_enabled;
+  // with HDR images, also save the first hit's albedo, normal and depth and
+  // store EXR's channels as halfs instead of floats
+  bool aovs_enabled, exr_half;
+  // reproject the accumulated samples after camera moves instead of
+  // starting over, see Renderer_reproject
+  bool reprojection_enabled;
+  // frame time to aim for by rendering at a lower resolution while the camera
+  // moves, 0 disables it, see DynamicResolution
+  float dynamic_resolution_target_ms;
+  // how often to display the rendered image, rendering as many frames as fit
+  // in between, 0 displays every frame
+  float display_interval_ms;
+  // when disabled nothing gets displayed until rendering finishes
+  bool display_enabled;
+  // render without a window or any display server, see Window_new_headless
+  bool headless;
+  // where to periodically save the accumulated samples, so that a render can
+  // be continued after the process dies, empty disables it, see Checkpoint
+  SmallString checkpoint_path;
+  float checkpoint_interval_s;
+  // continue from the checkpoint at checkpoint_path if there is one
+  bool resume;
+  // file with the jobs to render one after another, see Batch
+  SmallString jobs_path;
+  // camera path to render as an image sequence, see CameraAnimation
+  SmallString camera_path;
+  float animation_fps;
+  // time of the scene's animation to render, see GltfAnimation
+  float scene_time_s;
+  // advance scene_time_s in real time, looping the animation
+  bool animation_playing;
+  // where to write a Chrome trace of the timed scopes on exit, see
+  // Timer_start_trace
+  SmallString trace_path;
+  // print the count and the times of each timed scope on exit, see Timer_str
+  bool print_timings;
 } Settings;
 
 inline static Settings Settings_default(void) {
@@ -29,7 +74,29 @@ inline static Settings Settings_default(void) {
       .save_after_rendering = false,
       .exit_after_rendering = false,
       .movement_enabled = true,
+      .denoise_enabled = false,
+      .aovs_enabled = false,
+      .exr_half = false,
+      .reprojection_enabled = false,
+      .dynamic_resolution_target_ms = 0,
+      .display_interval_ms = 0,
+      .display_enabled = true,
+      .headless = false,
+      .checkpoint_path = SmallString_new(""),
+      .checkpoint_interval_s = 300,
+      .resume = false,
+      .jobs_path = SmallString_new(""),
+      .camera_path = SmallString_new(""),
+      .animation_fps = 24,
+      .scene_time_s = 0,
+      .animation_playing = false,
+      .trace_path = SmallString_new(""),
+      .print_timings = false,
       .BVH_build_strat = BVHStrategy_Midpoint,
+      .bvh_report = false,
+      .distributed_role = DistributedRole_NONE,
+      .distributed_address = SmallString_new(""),
+      .frames_per_job = 16,
   };
 }
 
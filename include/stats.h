@@ -7,6 +7,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// NOTE: in seconds of Timer_now_ns, so it works without GLFW and on any thread
 typedef struct {
   double total_time;
   double _start_time, _end_time;
@@ -22,9 +23,24 @@ typedef struct {
   StatsTimer last_frame_rendering;
   StatsTimer scene_load;
   StatsTimer bvh_build;
+  // of the last animated frame, deforming its triangles and then refitting
+  // or rebuilding the BVH, see AppState_animate_scene
+  StatsTimer animation, bvh_update;
   // when doing progressive rendering means the number of frames that were
   // already taken into account
   uint32_t frame_number;
+  // pixels that got any samples in the last frame, with adaptive sampling
+  // once it reaches 0 the whole image has converged
+  uint32_t sampled_pixels;
+  // how many frames get rendered before the next one is displayed, adapted
+  // to the display interval, see AppState_render_and_display_frame
+  uint32_t frames_per_display;
+  // measured on the GPU for the latest frames it finished rendering, 0 until
+  // the first ones did, see RendererGpuTimer
+  double gpu_frame_time;
+  double rays_per_s;
+  // how long adding a sample to every pixel took, on average
+  double sample_time;
 } Stats;
 
 Stats Stats_default(void);
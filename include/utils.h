@@ -11,7 +11,15 @@ char *File_read(const char *filename, Arena *arena);
 
 bool FilePath_exists(const char *path);
 const char *FilePath_get_file_name(const char *path);
-void Image_add_metadata(const char *image_path, const char *description);
+// writes path with number appended to its file name, before its extension,
+// e.g. "out/frame.png" and 7 give "out/frame_0007.png", returns false if it
+// doesn't fit in out
+bool FilePath_with_number(char *out, size_t out_size, const char *path,
+                          uint32_t number);
+// writes RGB pixels, stored bottom row first, as a PNG file with description
+// embedded in it as an iTXt chunk
+bool Image_write_png(const char *path, const uint8_t *rgb, uint32_t width,
+                     uint32_t height, const char *description);
 
 // ARRAYS OF STRINGS
 void StringArray_join(char *out_str, const char *arr[], size_t arr_len,
@@ -32,4 +40,7 @@ enum StringArray_find_closest_match_err {
 // NUMERIC
 uint32_t next_power_of_2(uint32_t x);
 
+// COLORS
+float linear_to_srgb(float c);
+
 #endif // UTILS_H_
@@ -0,0 +1,30 @@
+#ifndef THREAD_H_
+#define THREAD_H_
+
+#include <stdint.h>
+
+// processes the items in [begin, end)
+typedef void ParallelForFn(void *ctx, uint32_t begin, uint32_t end);
+
+// number of threads the CPU can run at once, at least 1
+uint32_t Thread_cpu_count(void);
+
+// Splits [0, count) into consecutive ranges, one per thread, calls fn on
+// each of them and waits for all to finish.
+// NOTE: fn must be safe to run concurrently for different ranges
+void Thread_parallel_for(uint32_t count, ParallelForFn *fn, void *ctx);
+
+typedef void WorkFn(void *ctx);
+
+// A single background thread running the work pushed to it in order.
+// NOTE: opaque as it holds the platform's threading primitives
+typedef struct WorkQueue WorkQueue;
+
+// capacity is how much work can wait to be run before WorkQueue_push blocks
+WorkQueue *WorkQueue_new(uint32_t capacity);
+// queues fn to be called with ctx on the background thread
+void WorkQueue_push(WorkQueue *self, WorkFn *fn, void *ctx);
+// waits for all of the queued work to finish and stops the thread
+void WorkQueue_delete(WorkQueue *self);
+
+#endif // THREAD_H_
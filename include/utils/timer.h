@@ -0,0 +1,67 @@
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include "small_string.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Nanoseconds from a monotonic clock, unlike glfwGetTime it doesn't need GLFW
+// to be initialized and can be called from any thread.
+uint64_t Timer_now_ns(void);
+
+// distinct scopes that can be timed, the same name nested in different scopes
+// counting as different ones
+#define TIMER_MAX_SCOPES 64
+// how deep scopes can be nested on a single thread
+#define TIMER_MAX_DEPTH 16
+// the percentiles are of this many of the latest durations of each scope
+#define TIMER_SCOPE_SAMPLES 256
+// with the NUL
+#define TIMER_MAX_NAME_LEN 64
+
+// Times everything until the matching Timer_end on the same thread. Scopes
+// begun in between are nested in it, and are aggregated separately from the
+// ones with the same name nested elsewhere, e.g. "scene load/parse".
+// NOTE: name has to outlive the timer, e.g. be a string literal
+// NOTE: scopes begun on other threads, e.g. Thread_parallel_for's, aren't
+// nested in the scope of the thread which started them
+void Timer_begin(const char *name);
+void Timer_end(void);
+
+typedef struct {
+  // with the names of the scopes it's nested in before it, separated by '/'
+  char name[TIMER_MAX_NAME_LEN];
+  // 0 for the scopes which aren't nested in any other
+  uint32_t depth;
+  uint64_t count;
+  uint64_t min_ns, mean_ns, p50_ns, p99_ns;
+} TimerScopeStats;
+
+// Writes the stats of up to max_count scopes timed so far on any thread, each
+// one followed by the ones nested in it, and returns how many it wrote.
+uint32_t Timer_get_stats(TimerScopeStats *out, uint32_t max_count);
+// forgets all of the scopes, the ones being timed while it's called included
+void Timer_reset(void);
+// Lists the scopes' stats as a tree, for the GUI and stdout.
+// NOTE: as many of them as fit, the rest only get counted
+SmallString Timer_str(void);
+
+// at most this many distinct tracks, any threads beyond it share the last one
+#define TIMER_MAX_TRACKS 64
+// with the NUL
+#define TIMER_MAX_TRACK_NAME_LEN 32
+// the trace stops recording past this many scopes
+#define TIMER_MAX_TRACE_EVENTS (1 << 22)
+
+// Starts recording every scope timed from now on with when and on which track
+// it happened, to be written by Timer_write_trace.
+void Timer_start_trace(void);
+// Writes the recorded scopes as a Chrome trace, which can be opened in
+// chrome://tracing or https://ui.perfetto.dev, returns false if it couldn't.
+bool Timer_write_trace(const char *path);
+// Puts the calling thread's scopes on the trace's track with that name, so
+// that threads doing the same work, one after another, share a track.
+// NOTE: otherwise every thread gets a track of its own
+void Timer_set_thread_track(const char *name);
+
+#endif // TIMER_H_
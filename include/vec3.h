@@ -22,6 +22,7 @@ vec3 vec3_mult(vec3 v, float c);
 vec3 vec3_norm(vec3 v);
 vec3 vec3_cross(vec3 a, vec3 b);
 
+float vec3_dot(vec3 a, vec3 b);
 float vec3_mag(vec3 v);
 
 // 0 - x, 1 - y, 2 - z
@@ -10,6 +10,8 @@
 
 typedef struct {
   GLFWwindow *glfw_window;
+  // created with Window_new_headless, it has no default framebuffer
+  bool headless;
 } Window;
 
 typedef struct {
@@ -18,6 +20,9 @@ typedef struct {
 } GLFWUserData;
 
 Window Window_new(const char *window_title, int width, int height);
+// an offscreen OpenGL context which doesn't need a display server, meant for
+// rendering straight to framebuffers
+Window Window_new_headless(void);
 
 WindowEventsData Window_poll_events(Window *self);
 
@@ -0,0 +1,76 @@
+#version 460
+
+// Decides how many samples each pixel gets in the next frame, for adaptive
+// sampling, so that the ones which have converged don't get any.
+
+#include "pathtracer.glsl"
+
+// same as the renderer's back buffer, linear sums of all samples so far
+// in rgb and their count in alpha
+uniform sampler2D accumulationTexture;
+// sums of the samples' luminance and of its squares
+uniform sampler2D momentsTexture;
+
+layout(location = 0) out float SamplesCount;
+
+layout(std430, binding = 11) coherent buffer sampledPixelsBuffer {
+    // number of pixels that got any samples in a frame,
+    // indexed by the frame number's parity and zeroed before it gets rendered
+    uint sampledPixels[2];
+};
+
+// pixels need at least this many samples for their error estimate to be
+// trusted, otherwise ones that just haven't hit a light yet would stop early
+const float MIN_SAMPLES = 64.0;
+// the most samples an unconverged pixel can get per frame,
+// as a multiple of params.samples_per_pixel
+const float MAX_BOOST = 16.0;
+// darker pixels are held to an absolute error of threshold * this instead,
+// as their relative error can stay high even when nobody can see the noise
+const float MIN_LUMINANCE = 0.01;
+// A pixel counts as converged only once all pixels within this radius do.
+// NOTE: a single pixel's estimate is too noisy on its own, those which just
+// haven't found a rare bright path yet would look converged and stop being
+// sampled, leaving the image darker than it should be.
+const int NEIGHBOURHOOD_RADIUS = 1;
+
+// estimated standard deviation of the pixel's mean relative to the mean
+float RelativeError(ivec2 pixel) {
+    float samplesCount = texelFetch(accumulationTexture, pixel, 0).a;
+    if (samplesCount < MIN_SAMPLES)
+        return INFINITY;
+
+    vec2 moments = texelFetch(momentsTexture, pixel, 0).rg;
+    float mean = moments.x / samplesCount;
+    // unbiased estimate of the samples' variance,
+    // which divided by their count is the variance of the mean
+    float variance = max(moments.y / samplesCount - mean * mean, 0.0) *
+            samplesCount / (samplesCount - 1.0);
+    return sqrt(variance / samplesCount) / max(mean, MIN_LUMINANCE);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 lastPixel = ivec2(params.width, params.height) - 1;
+
+    float error = 0.0;
+    for (int y = -NEIGHBOURHOOD_RADIUS; y <= NEIGHBOURHOOD_RADIUS; ++y)
+        for (int x = -NEIGHBOURHOOD_RADIUS; x <= NEIGHBOURHOOD_RADIUS; ++x)
+            error = max(error, RelativeError(clamp(pixel + ivec2(x, y), ivec2(0), lastPixel)));
+
+    if (error < params.adaptive_threshold) {
+        SamplesCount = 0.0;
+        return;
+    }
+
+    // samples not taken by the converged pixels go to the rest,
+    // judging by how many of them got sampled in the previous frame
+    float boost = 1.0;
+    uint previouslySampled = sampledPixels[uint(frame_number + 1) & 1u];
+    if (frame_number > 0 && previouslySampled > 0u)
+        boost = clamp(float(params.width * params.height) / float(previouslySampled),
+                1.0, MAX_BOOST);
+
+    atomicAdd(sampledPixels[uint(frame_number) & 1u], 1u);
+    SamplesCount = floor(float(params.samples_per_pixel) * boost);
+}
@@ -0,0 +1,855 @@
+// Path tracing shared by the fragment (renderer.glsl) and compute
+// (renderer_compute.glsl) shaders, pasted into them with #include.
+// The fragment shader defines FRAGMENT_SHADER before including it.
+// NOTE: adaptive.glsl includes it too, just for the parameters, and so does
+// reproject.glsl, for tracing the camera rays.
+
+// NOTE: only used where supported, see AddToCounters
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+#extension GL_KHR_shader_subgroup_ballot : enable
+
+uniform int frame_number;
+uniform uint seed_offset;
+// whether the rays and samples are being counted, see AddToCounters
+uniform bool measuring;
+
+const float EPSILON = 0.00001;
+const float INFINITY = 1.0e30;
+const float PI = 3.141592653589793;
+const float TWOPI = 6.283185307179586;
+const float INV_PI = 0.3183098861837907;
+
+// #define CULLING
+
+#define STACK_SIZE 40
+#define MAX_ITERATIONS 200
+
+struct Parameters {
+    vec3 env_color;
+    int max_bounce_count;
+    int samples_per_pixel;
+    float diverge_strength;
+    int _frames_to_render;
+    uint width, height;
+    int _backend;
+    uint _tile_width, _tile_height;
+    uint _persistent_workgroups;
+    int russian_roulette_depth;
+    float adaptive_threshold;
+};
+
+struct Camera {
+    vec4 pos;
+    vec4 dir;
+    vec4 up;
+    float yfov;
+};
+
+struct Ray {
+    vec3 origin;
+    vec3 dir;
+    vec3 inv_dir; // 1 / dir
+};
+
+// NOTE: these are just `vec3`s but because they come from a buffer-backed
+// blocks which have layouts that pad them to 16 bytes turning `vec3`s in to `vec4`s
+struct Triangle {
+    vec4 a, b, c;
+    vec4 _na, _nb, _nc;
+};
+
+// NOTE: same as above
+struct BVHnode {
+    vec4 boundsMin, boundsMax;
+    uint first, count;
+    int _, _1; // padding so that this struct's size is a multiple of 16 bytes
+};
+
+struct Material {
+    vec4 base_color_factor;
+    vec3 emissive_factor;
+    uint base_color_texture;
+    uint metallic_texture;
+    float metallic_factor;
+    uint roughness_texture;
+    float roughness_factor;
+    uint emissive_texture;
+    int _, _1, _2;
+};
+
+struct TriangleEx {
+    // index of the material in materialsBuffer
+    uint mat;
+};
+
+struct Light {
+    // index of the emissive triangle in trianglesBuffer
+    uint triangle;
+    float power;
+    // path from the root of the light BVH, bit i (of the 64) being set if
+    // the second child was taken at depth i
+    uvec2 bitTrail;
+};
+
+// NOTE: same as BVHnode, but first is the index of the light in leaves
+struct LightBVHnode {
+    vec4 boundsMin, boundsMax;
+    // the normals of all the lights in the node are within theta_o of axis
+    vec4 axis;
+    float power;
+    float cosThetaO;
+    uint first, count;
+};
+
+layout(std430, binding = 1) readonly buffer trianglesBuffer {
+    Triangle triangles[];
+};
+layout(std430, binding = 2) readonly buffer bvhNodesBuffer {
+    BVHnode nodes[];
+};
+layout(std430, binding = 3) readonly buffer materialsBuffer {
+    Material mats[];
+};
+layout(std430, binding = 4) readonly buffer primitivesBuffer {
+    TriangleEx triangles_data[];
+};
+layout(std430, binding = 5) readonly buffer cameraBuffer {
+    Camera camera;
+};
+layout(std430, binding = 6) readonly buffer rendererParametersBuffer {
+    Parameters params;
+};
+layout(std430, binding = 8) readonly buffer lightsBuffer {
+    uint lightsCount;
+    float lightsTotalPower;
+    int _l, _l1;
+    Light lights[];
+};
+layout(std430, binding = 9) readonly buffer lightBVHnodesBuffer {
+    LightBVHnode lightNodes[];
+};
+layout(std430, binding = 10) readonly buffer triangleLightsBuffer {
+    // index of the light of each triangle, NO_LIGHT if it isn't emissive
+    uint triangleLights[];
+};
+const uint NO_LIGHT = 0xFFFFFFFFu;
+
+// rays traced and samples taken while the renderer measures a batch of
+// frames, see RendererGpuTimer, as 64 bit counts split into 32 bit halves
+layout(std430, binding = 12) coherent buffer raysCounterBuffer {
+    // rays' low and high bits, then the samples' ones
+    uint counters[4];
+};
+// rays traced by this invocation since they were last added to the counter,
+// which happens once per pixel
+uint invocationRays = 0u;
+
+void AddToCounter(uint low, uint value) {
+    uint previous = atomicAdd(counters[low], value);
+    // the low bits wrapped around
+    if (previous > 0xFFFFFFFFu - value)
+        atomicAdd(counters[low + 1u], 1u);
+}
+
+// Adds the pixel's rays and samples to the counters, if measuring. Where
+// subgroup operations are supported they're summed over the subgroup first,
+// so that only one of its invocations does the atomics.
+void AddToCounters(uint samplesCount) {
+    // NOTE: the persistent compute shader renders many pixels per invocation
+    uint rays = invocationRays;
+    invocationRays = 0u;
+    if (!measuring)
+        return;
+#if defined(GL_KHR_shader_subgroup_basic) && defined(GL_KHR_shader_subgroup_arithmetic) && \
+    defined(GL_KHR_shader_subgroup_ballot)
+    // NOTE: helper invocations take part in subgroup operations but their
+    // atomics don't do anything, so they add nothing and can't be the one
+    bool helper = false;
+#ifdef FRAGMENT_SHADER
+    helper = gl_HelperInvocation;
+#endif
+    uint subgroupRays = subgroupAdd(helper ? 0u : rays);
+    uint subgroupSamples = subgroupAdd(helper ? 0u : samplesCount);
+    uint first = subgroupBallotFindLSB(subgroupBallot(!helper));
+    if (first == gl_SubgroupInvocationID) {
+        AddToCounter(0u, subgroupRays);
+        AddToCounter(2u, subgroupSamples);
+    }
+#else
+    AddToCounter(0u, rays);
+    AddToCounter(2u, samplesCount);
+#endif
+}
+
+struct HitInfo {
+    bool didHit;
+    float dst;
+    uint triangle;
+    vec3 hitPoint;
+    vec3 normal;
+    Material mat;
+};
+
+// RNG
+// https://github.com/imneme/pcg-c/blob/83252d9c23df9c82ecb42210afed61a7b42402d7/include/pcg_variants.h#L504
+// https://github.com/imneme/pcg-c/blob/83252d9c23df9c82ecb42210afed61a7b42402d7/include/pcg_variants.h#L182
+uint pcg32_step(inout uint state) {
+    uint old_state = state;
+    state = state * 747796405u + 2891336453u;
+    uint word = ((old_state >> ((old_state >> 28u) + 4u)) ^ old_state) * 277803737u;
+    return (word >> 22) ^ word;
+}
+
+// https://www.pcg-random.org/using-pcg-c-basic.html#generating-doubles
+float RandomFloat(inout uint state) {
+    return ldexp(pcg32_step(state), -32);
+}
+
+vec3 RandomUnitVector(inout uint state) {
+    float z = RandomFloat(state) * 2.0f - 1.0f;
+    float a = RandomFloat(state) * TWOPI;
+    float r = sqrt(1.0f - z * z);
+    float x = r * cos(a);
+    float y = r * sin(a);
+    return vec3(x, y, z);
+}
+
+vec2 RandomPointInCircle(inout uint state) {
+    float angle = RandomFloat(state) * TWOPI;
+    vec2 pointOnCircle = vec2(cos(angle), sin(angle));
+    return pointOnCircle * sqrt(RandomFloat(state));
+}
+
+// using Möller-Trumbore intersection algorithm
+// https://www.youtube.com/watch?v=fK1RPmF_zjQ
+// https://cadxfem.org/inf/Fast%20MinimumStorage%20RayTriangle%20Intersection.pdf
+// Point T(u,v) = (1-u-v)A + uB + vC, where (u, v) are barycentric coordinates
+// and A, B, C are positions of vertices of the triangle,
+// is inside a triangle if u >= 0, v >= 0 and u + v <= 1.
+// u and v can be thought of as closeness to either vertex of a triangle.
+// A ray has an equation R(t) = O + tD, where O is origin,
+// D is direction and t is distance traveled in that direction.
+// If we assume that a ray hits the triangle we can then equate both formulas:
+// R(t) = T(u,v)
+// O + tD = (1-u-v)A + uB + vC (only t, u and v are unknowns)
+//
+// Rearanging gives:
+// A - uA -vA + uB + vC - tD = O
+// - tD + u(B - A) + v(C - A) = O - A
+// [-D, B-A, C-A]x[t, u, v] = O - A
+// renaming: E1 := B - A, E2 := C - A, T := O - A, gives:
+// [-D, E1, E2]x[t, u, v] = T
+//
+// We can apply cramer's rule, which in case of:
+// [a1 b1 c1][x] = [d1]
+// [a2 b2 c2][y] = [d2]
+// [a3 b3 c3][z] = [d3],
+// allows us to find that:
+//     | d1 b1 c1 |   | a1 b1 c1 |
+// x = | d2 b2 c2 | / | a2 b2 c2 |
+//     | d3 b3 c3 |   | a3 b3 c3 |
+//
+//     | a1 d1 c1 |   | a1 b1 c1 |
+// y = | a2 d2 c2 | / | a2 b2 c2 |
+//     | a3 d3 c3 |   | a3 b3 c3 |
+//
+//     | a1 b1 d1 |   | a1 b1 c1 |
+// z = | a2 b2 d2 | / | a2 b2 c2 |
+//     | a3 b3 d3 |   | a3 b3 c3 |.
+//
+// Applying this to our situation, we get:
+// t = | T E1 E2 | / | -D E1 E2 |
+// u = | -D T E2 | / | -D E1 E2 |
+// v = | -D E1 T | / | -D E1 E2 |.
+// Keep in mind that those equations for t, u and v above are actually
+// on 3x3 matrix as each element is actually a vec3.
+// We can think of a value of a 3x3 determinant as a signed area of a parallelogram
+// defined by 3 vectors. The area of a (vector described) parallelogram is a . (b x c),
+// where b x c is a cross product of the 2 base vectors, which results in a vertical
+// vector with the magnitude of the area of the base and dot product simply multiplies
+// the height with the area of a base (which is a vector with the same direction as a)
+// and as they have the same direction and therefore the angle between them is zero,
+// just their magnitudes get multiplied and we get a scalar.
+//
+// So the first determinants for each of the unknowns can be found as:
+// t = T . (E1 x E2)
+// u = -D . (T x E2)
+// v = -D . (E1 x T).
+// As "the scalar triple product is unchanged under a circular shift" (https://en.wikipedia.org/wiki/Triple_product)
+// we can change the equation for t to instead be:
+// t = (T x E1) . E2
+// We can also use the fact that "Swapping any two of the three operands negates the triple product", and get:
+// v = D . (T x E1)
+//
+// For the determinant common among the three equations, we will have:
+// det = E1 . (D x E2)
+// and that's it!
+HitInfo RayTriangleIntersection(Ray ray, Triangle tri) {
+    HitInfo hitInfo;
+    hitInfo.didHit = false;
+    vec3 D = ray.dir;
+    vec3 e1 = (tri.b - tri.a).xyz;
+    vec3 e2 = (tri.c - tri.a).xyz;
+    vec3 De2 = cross(D, e2);
+    float det = dot(e1, De2);
+
+    #ifdef CULLING
+    // if the determinant is negative, then the direction from which ray hits
+    // the triangle is opposite of the triangle's normal
+    bool condition = det < -EPSILON;
+    #else
+    // if determinant is zero then the ray is coming in parallel to the triangle
+    bool condition = abs(det) < EPSILON;
+    #endif
+
+    if (condition) {
+        // the vectors -D, e1 and e2 are not linearly independent,
+        // meaning ray is coming in parallel to the triangle
+        return hitInfo;
+    }
+
+    float inv_det = 1.0 / det;
+
+    vec3 T = ray.origin - tri.a.xyz;
+    vec3 Te1 = cross(T, e1);
+
+    float u = dot(T, De2) * inv_det;
+
+    // the barycentric coordinate u is too far, for the point of intersection
+    // to be inside the triangle
+    if ((u < 0 && abs(u) > EPSILON) || (u > 1 && abs(u - 1.0) > EPSILON)) return hitInfo;
+
+    float v = dot(D, Te1) * inv_det;
+
+    // the barycentric coordinate v is too far, for the point of intersection
+    // to be inside the triangle or both u and v are too far from centre
+    if ((v < 0 && abs(v) > EPSILON) || (u + v > 1 && abs(u + v - 1.0) > EPSILON)) return hitInfo;
+
+    // finally, if we got here, it means that we did actually hit the triangle
+    float t = dot(Te1, e2) * inv_det;
+    if (t > EPSILON) {
+        hitInfo.didHit = true;
+        hitInfo.hitPoint = ray.origin + ray.dir * t;
+        if (det > EPSILON)
+            hitInfo.normal = normalize(cross(e1, e2));
+        else
+            hitInfo.normal = normalize(cross(e2, e1));
+        hitInfo.dst = t;
+    }
+
+    return hitInfo;
+}
+
+// using slab method
+// Imagine that we put two parallel planes per each axis, such that
+// distance between those planes will be that of the bounding box.
+// We look through each of those planes and calculate the distance to
+// intersection with both planes on every axis individually.
+// To calculate whether a ray hits a plane and if so what's the distance
+// we have to consider each plane to be defined in terms of any point on it
+// and a normal vector to the plane, so we get this as an equation for a plane:
+// P . N + d = 0, where
+// P is any point on that plane,
+// N is the normal vector of the plane,
+// d is the plane's offset from origin.
+//
+// Let's assume that P is the point of intersection of the ray with the plane.
+// The ray equation is P = O + t * D, where
+// P is the destination point,
+// O is the ray's origin point,
+// t is the distance travelled by the ray to P,
+// D is the ray's direction.
+// We can transform the ray equation to instead be:
+// t = (P - O) / D,
+// which tells us that if we know the point of intersection we can easily
+// calculate the distance to that point.
+// if there is no intersection we will end up with infinities which
+// funnily enough get automagically handled
+// Returns the distance at which the ray enters the box (negative if it
+// starts inside of it) or INFINITY if it misses the box.
+float RayBVHnodeIntersection(Ray ray, BVHnode bb) {
+    float tx1 = (bb.boundsMin.x - ray.origin.x) * ray.inv_dir.x, tx2 = (bb.boundsMax.x - ray.origin.x) * ray.inv_dir.x;
+    float tmin = min(tx1, tx2), tmax = max(tx1, tx2);
+    float ty1 = (bb.boundsMin.y - ray.origin.y) * ray.inv_dir.y, ty2 = (bb.boundsMax.y - ray.origin.y) * ray.inv_dir.y;
+    tmin = max(tmin, min(ty1, ty2)), tmax = min(tmax, max(ty1, ty2));
+    float tz1 = (bb.boundsMin.z - ray.origin.z) * ray.inv_dir.z, tz2 = (bb.boundsMax.z - ray.origin.z) * ray.inv_dir.z;
+    tmin = max(tmin, min(tz1, tz2)), tmax = min(tmax, max(tz1, tz2));
+    return (tmax >= tmin && tmax > 0) ? tmin : INFINITY;
+}
+
+HitInfo FindRayCollision(Ray ray) {
+    ++invocationRays;
+    HitInfo closestHit;
+    closestHit.didHit = false;
+    closestHit.dst = INFINITY;
+
+    // nodes to visit along with the distances at which the ray enters them,
+    // so that the ones behind the closest hit found so far can be skipped
+    uint stack[STACK_SIZE], stack_ptr = 0;
+    float stackDst[STACK_SIZE];
+
+    float rootDst = RayBVHnodeIntersection(ray, nodes[0]);
+    if (rootDst == INFINITY) return closestHit;
+    stackDst[stack_ptr] = rootDst;
+    stack[stack_ptr++] = 0;
+
+    int max_iterations = MAX_ITERATIONS;
+    while (stack_ptr > 0 && max_iterations-- > 0) {
+        --stack_ptr;
+        if (stackDst[stack_ptr] >= closestHit.dst) continue;
+        BVHnode node = nodes[stack[stack_ptr]];
+
+        // if node is a leaf
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; ++i) {
+                uint t_index = node.first + i;
+                Triangle t = triangles[t_index];
+                HitInfo hit = RayTriangleIntersection(ray, t);
+                if (hit.didHit && hit.dst < closestHit.dst) {
+                    closestHit = hit;
+                    closestHit.triangle = t_index;
+                    closestHit.mat = mats[triangles_data[t_index].mat];
+                }
+            }
+        } else {
+            uint nearChild = node.first + 0, farChild = node.first + 1;
+            float nearDst = RayBVHnodeIntersection(ray, nodes[nearChild]);
+            float farDst = RayBVHnodeIntersection(ray, nodes[farChild]);
+            if (farDst < nearDst) {
+                uint tmp = nearChild; nearChild = farChild; farChild = tmp;
+                float tmpDst = nearDst; nearDst = farDst; farDst = tmpDst;
+            }
+
+            // the nearer child will be checked first, so must push the farther one first
+            if (farDst < closestHit.dst) {
+                stackDst[stack_ptr] = farDst;
+                stack[stack_ptr++] = farChild;
+            }
+            if (nearDst < closestHit.dst) {
+                stackDst[stack_ptr] = nearDst;
+                stack[stack_ptr++] = nearChild;
+            }
+        }
+    }
+
+    return closestHit;
+}
+
+// Returns true if the ray hits anything closer than maxDst. As it returns on
+// the first such hit, unlike FindRayCollision, it doesn't have to find the
+// closest one nor care about the order in which the nodes are visited.
+bool IsOccluded(Ray ray, float maxDst) {
+    ++invocationRays;
+    uint stack[STACK_SIZE], stack_ptr = 0;
+    stack[stack_ptr++] = 0;
+
+    int max_iterations = MAX_ITERATIONS;
+    while (stack_ptr > 0 && max_iterations-- > 0) {
+        BVHnode node = nodes[stack[--stack_ptr]];
+        if (RayBVHnodeIntersection(ray, node) >= maxDst) continue;
+
+        // if node is a leaf
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; ++i) {
+                HitInfo hit = RayTriangleIntersection(ray, triangles[node.first + i]);
+                if (hit.didHit && hit.dst < maxDst) return true;
+            }
+        } else {
+            stack[stack_ptr++] = node.first + 0;
+            stack[stack_ptr++] = node.first + 1;
+        }
+    }
+    return false;
+}
+
+vec3 SampleCosineWeighedHeimsphere(vec3 normal, inout uint rngState) {
+    return normalize(normal + RandomUnitVector(rngState));
+}
+
+vec3 ReflectDir(vec3 dir, vec3 normal) {
+    return dir - 2 * dot(dir, normal) * normal;
+}
+
+// L_o(x, \omega_o) &= L_e(x, \omega_o) + L_r(x, \omega_o)
+// L_r(x, \omega_o) &= \int_{\Omega} f(x, \omega_i, \omega_o) L_i(x, \omega_i)\cos{\theta_i} d\omega_i
+
+// Uniform Lambertian reflection sampling
+// vec3 EvalLambertian(vec3 normal, vec3 outDir, Material mat) {
+//     return mat.base_color_factor.rgb * dot(normal, outDir) / PI;
+// }
+// vec3 SampleUniformHiemsphere(vec3 normal, inout uint rngState) {
+//     vec3 r = RandomUnitVector(rngState);
+//     return dot(normal, r) > 0.0 ? r : -r;
+// }
+// float PdfUniformHemisphere(vec3 inDir, vec3 normal, vec3 outDir) {
+//     return 1.0 / (2.0 * PI);
+// }
+// vec3 UniformSampleLambertian(Ray ray, HitInfo hitInfo, out vec3 dir, inout uint rngState) {
+//     dir = SampleUniformHiemsphere(hitInfo.normal, rngState);
+//     // (albedo * cos phi / pi) / (1.0 / (2.0 * pi)) = 2.0 * albedo * cos phi
+//     // return EvalLambertian(hitInfo.normal, dir, hitInfo.mat) / PdfUniformHemisphere(ray.dir, hitInfo.normal, dir);
+//     return 2.0 * hitInfo.mat.base_color_factor.rgb * dot(hitInfo.normal, dir);
+// }
+
+// pdf of sampling omega_o with SampleCosineWeighedHeimsphere
+float PdfCosineWeighedHemisphere(vec3 normal, vec3 omega_o) {
+    // NOTE: never 0, as that's reserved for the directions which
+    // can't be sampled in any other way (see SampleBRDF)
+    return max(dot(normal, omega_o) * INV_PI, EPSILON);
+}
+
+// AKA diffuse_brdf
+vec3 ImportanceSampleLambertian(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, out float pdf, inout uint rngState) {
+    omega_o = SampleCosineWeighedHeimsphere(hitInfo.normal, rngState);
+    pdf = PdfCosineWeighedHemisphere(hitInfo.normal, omega_o);
+    return hitInfo.mat.base_color_factor.rgb;
+}
+
+// AKA specular_brdf
+vec3 SpecularReflection(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, out float pdf, inout uint rngState) {
+    omega_o = ReflectDir(omega_i, hitInfo.normal);
+    pdf = 0.0;
+    return hitInfo.mat.base_color_factor.rgb;
+}
+
+vec3 SampleMetalicBRDF(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, out float pdf, inout uint rngState) {
+    return SpecularReflection(omega_i, hitInfo, omega_o, pdf, rngState);
+}
+
+vec3 SampleDielectricBRDF(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, out float pdf, inout uint rngState) {
+    return ImportanceSampleLambertian(omega_i, hitInfo, omega_o, pdf, rngState);
+}
+
+// Returns the weight of the sampled direction (brdf * cos / pdf). pdf is the
+// solid angle pdf of sampling omega_o, or 0 for perfectly specular
+// reflections, whose direction can't be picked by sampling the lights.
+vec3 SampleBRDF(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, out float pdf, inout uint rngState) {
+    vec3 brdfWeight;
+    float p;
+    if (RandomFloat(rngState) < hitInfo.mat.metallic_factor) {
+        brdfWeight = SampleMetalicBRDF(omega_i, hitInfo, omega_o, pdf, rngState);
+        p = hitInfo.mat.metallic_factor;
+    } else {
+        brdfWeight = SampleDielectricBRDF(omega_i, hitInfo, omega_o, pdf, rngState);
+        p = 1 - hitInfo.mat.metallic_factor;
+    }
+
+    return brdfWeight / max(p, 0.1);
+}
+
+// Le(x, omega_o)
+vec3 GetLightEmitted(HitInfo hitInfo, vec3 V) {
+    return hitInfo.mat.emissive_factor;
+}
+
+// Multiple importance sampling weight of a sample taken with the strategy
+// of pdf f, when g is the pdf of the other strategy.
+// https://pbr-book.org/4ed/Monte_Carlo_Integration/Improving_Efficiency#MultipleImportanceSampling
+float PowerHeuristic(float f, float g) {
+    return (f * f) / (f * f + g * g);
+}
+
+// Solid angle pdf of SampleLight picking a point on the triangle t, which
+// is dst away, at an angle whose cosine to the triangle's normal is cosLight,
+// given the probability pmf of picking that triangle.
+float LightPdf(float pmf, Triangle t, float dst, float cosLight) {
+    float area = 0.5 * length(cross((t.b - t.a).xyz, (t.c - t.a).xyz));
+    return pmf / area * dst * dst / cosLight;
+}
+
+// cos(max(0, a - b)) given the sines and cosines of a and b
+float CosSubClamped(float sinA, float cosA, float sinB, float cosB) {
+    return cosA > cosB ? 1.0 : cosA * cosB + sinA * sinB;
+}
+float SinSubClamped(float sinA, float cosA, float sinB, float cosB) {
+    return cosA > cosB ? 0.0 : sinA * cosB - cosA * sinB;
+}
+
+// Estimates how much light from the node could reach the point, whose
+// surface faces the normal. See LightBVHnode_importance in src/scene/light_bvh.c
+// https://pbr-book.org/4ed/Light_Sources/Light_Sampling#BVHLightSampling
+float LightImportance(LightBVHnode node, vec3 point, vec3 normal) {
+    vec3 center = (node.boundsMin.xyz + node.boundsMax.xyz) * 0.5;
+    vec3 toPoint = point - center;
+    float dst2 = dot(toPoint, toPoint);
+    float radius = length(node.boundsMax.xyz - node.boundsMin.xyz) * 0.5;
+    vec3 wi = toPoint / sqrt(dst2);
+
+    // the lights are two-sided, so the point can be on either side of them
+    float cosThetaW = abs(dot(node.axis.xyz, wi));
+    float sinThetaW = sqrt(max(1.0 - cosThetaW * cosThetaW, 0.0));
+
+    // the angle the node's bounding sphere takes up when seen from the point
+    float cosThetaB = dst2 > radius * radius ? sqrt(max(1.0 - radius * radius / dst2, 0.0)) : -1.0;
+    float sinThetaB = sqrt(max(1.0 - cosThetaB * cosThetaB, 0.0));
+
+    float sinThetaO = sqrt(max(1.0 - node.cosThetaO * node.cosThetaO, 0.0));
+    float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, node.cosThetaO);
+    float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, node.cosThetaO);
+    float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+    // the lights emit over the hemispheres around their normals
+    if (cosThetaP <= 0.0) return 0.0;
+
+    float cosThetaI = -dot(normal, wi);
+    float sinThetaI = sqrt(max(1.0 - cosThetaI * cosThetaI, 0.0));
+    float cosThetaPI = CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+
+    return max(node.power * cosThetaP * cosThetaPI / max(dst2, radius), 0.0);
+}
+
+// Walks down the light BVH, picking the children proportionally to their
+// importance. Returns NO_LIGHT if none of the lights can light the point.
+uint PickLight(vec3 point, vec3 normal, out float pmf, inout uint rngState) {
+    uint nodeIndex = 0;
+    pmf = 1.0;
+    if (LightImportance(lightNodes[0], point, normal) == 0.0) return NO_LIGHT;
+
+    while (lightNodes[nodeIndex].count == 0) {
+        uint first = lightNodes[nodeIndex].first;
+        float importance0 = LightImportance(lightNodes[first], point, normal);
+        float importance1 = LightImportance(lightNodes[first + 1], point, normal);
+        if (importance0 + importance1 == 0.0) return NO_LIGHT;
+
+        float p0 = importance0 / (importance0 + importance1);
+        if (RandomFloat(rngState) < p0) {
+            nodeIndex = first;
+            pmf *= p0;
+        } else {
+            nodeIndex = first + 1;
+            pmf *= 1.0 - p0;
+        }
+    }
+    return lightNodes[nodeIndex].first;
+}
+
+// probability of PickLight picking the light, found by following its bit trail
+float LightPmf(uint lightIndex, vec3 point, vec3 normal) {
+    uvec2 bitTrail = lights[lightIndex].bitTrail;
+    uint nodeIndex = 0;
+    float pmf = 1.0;
+    // same as in PickLight, which never picks a light then
+    if (LightImportance(lightNodes[0], point, normal) == 0.0) return 0.0;
+
+    for (uint depth = 0; lightNodes[nodeIndex].count == 0; ++depth) {
+        uint first = lightNodes[nodeIndex].first;
+        float importance0 = LightImportance(lightNodes[first], point, normal);
+        float importance1 = LightImportance(lightNodes[first + 1], point, normal);
+        if (importance0 + importance1 == 0.0) return 0.0;
+
+        uint child = depth < 32 ? (bitTrail.x >> depth) & 1u : (bitTrail.y >> (depth - 32)) & 1u;
+        pmf *= (child == 0 ? importance0 : importance1) / (importance0 + importance1);
+        nodeIndex = first + child;
+    }
+    return pmf;
+}
+
+// Next event estimation: picks a point on one of the lights and, if it isn't
+// occluded, returns the light coming from it times the MIS weight and
+// brdf * cos / pdf, but without the albedo, which the caller multiplies by.
+// NOTE: requires lightsCount > 0
+vec3 SampleLight(HitInfo hitInfo, inout uint rngState) {
+    float pmf;
+    uint lightIndex = PickLight(hitInfo.hitPoint, hitInfo.normal, pmf, rngState);
+    if (lightIndex == NO_LIGHT) return vec3(0.0);
+    uint t_index = lights[lightIndex].triangle;
+    Triangle t = triangles[t_index];
+
+    // uniformly distributed point on the triangle
+    float su = sqrt(RandomFloat(rngState));
+    float b1 = 1.0 - su, b2 = RandomFloat(rngState) * su;
+    vec3 lightPoint = t.a.xyz + b1 * (t.b - t.a).xyz + b2 * (t.c - t.a).xyz;
+
+    vec3 toLight = lightPoint - hitInfo.hitPoint;
+    float dst = length(toLight);
+    toLight /= dst;
+
+    float cosSurface = dot(hitInfo.normal, toLight);
+    vec3 lightNormal = normalize(cross((t.b - t.a).xyz, (t.c - t.a).xyz));
+    float cosLight = abs(dot(lightNormal, toLight));
+    if (cosSurface <= 0.0 || cosLight < EPSILON) return vec3(0.0);
+
+    Ray shadowRay;
+    shadowRay.origin = hitInfo.hitPoint;
+    shadowRay.dir = toLight;
+    shadowRay.inv_dir = 1.0 / toLight;
+    // so that the light itself doesn't count as an occluder
+    if (IsOccluded(shadowRay, dst * (1.0 - 1e-3))) return vec3(0.0);
+
+    vec3 emitted = mats[triangles_data[t_index].mat].emissive_factor;
+    float lightPdf = LightPdf(pmf, t, dst, cosLight);
+    float brdfPdf = PdfCosineWeighedHemisphere(hitInfo.normal, toLight);
+    // the lambertian brdf * cos is albedo * cosSurface / PI, which equals
+    // albedo * brdfPdf
+    return emitted * brdfPdf / lightPdf * PowerHeuristic(lightPdf, brdfPdf);
+}
+
+// NOTE: same weights as luminance in src/scene.c
+float Luminance(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// what the camera ray hit first, which guides the denoiser and reprojection
+struct FirstHit {
+    vec3 albedo;
+    // luminance of the light it emits
+    float emission;
+    vec3 normal;
+    // distance from the ray's origin
+    float depth;
+};
+
+// firstHit gets the environment's color and zeros if the ray hit nothing
+vec3 PathTrace(Ray ray, inout uint rngState, out FirstHit firstHit) {
+    vec3 throughput = vec3(1.0, 1.0, 1.0);
+    // Lo(x, omega_o)
+    vec3 radiance = vec3(0.0, 0.0, 0.0);
+    // pdf with which the ray's direction was sampled, 0 if it couldn't
+    // have been found by sampling the lights (camera rays and specular
+    // reflections), in which case all of the emitted light it finds counts
+    float brdfPdf = 0.0;
+    // the surface the ray was reflected from, which the light sampling
+    // pdf depends on
+    HitInfo prevHit;
+    firstHit = FirstHit(params.env_color.rgb, 0.0, vec3(0.0), 0.0);
+
+    for (int i = 0; i < params.max_bounce_count; ++i) {
+        HitInfo hitInfo = FindRayCollision(ray);
+        if (hitInfo.didHit) {
+            if (i == 0) {
+                firstHit = FirstHit(hitInfo.mat.base_color_factor.rgb,
+                                    Luminance(GetLightEmitted(hitInfo, -ray.dir)),
+                                    hitInfo.normal,
+                                    distance(hitInfo.hitPoint, ray.origin));
+            }
+            vec3 emitted = GetLightEmitted(hitInfo, -ray.dir);
+            uint lightIndex = triangleLights[hitInfo.triangle];
+            if (brdfPdf > 0.0 && lightIndex != NO_LIGHT) {
+                float pmf = LightPmf(lightIndex, prevHit.hitPoint, prevHit.normal);
+                float lightPdf = LightPdf(pmf, triangles[hitInfo.triangle], hitInfo.dst, abs(dot(hitInfo.normal, ray.dir)));
+                emitted *= PowerHeuristic(brdfPdf, lightPdf);
+            }
+            radiance += emitted * throughput;
+
+            vec3 outDir;
+            vec3 reflectedLight = SampleBRDF(ray.dir, hitInfo, outDir, brdfPdf, rngState);
+
+            // NOTE: the light sampled here is one bounce further, so on the
+            // last bounce it's skipped the same way as the brdf sample is
+            if (brdfPdf > 0.0 && lightsCount > 0 && i + 1 < params.max_bounce_count)
+                radiance += SampleLight(hitInfo, rngState) * reflectedLight * throughput;
+
+            throughput *= reflectedLight;
+            prevHit = hitInfo;
+
+            // Russian roulette: paths which can't carry much more light get
+            // terminated with probability 1 - survival, the ones that survive
+            // get divided by survival to make up for the terminated ones
+            if (i + 1 >= params.russian_roulette_depth) {
+                float survival = min(max(throughput.r, max(throughput.g, throughput.b)), 1.0);
+                if (RandomFloat(rngState) >= survival) break;
+                throughput /= survival;
+            }
+
+            // bounce
+            ray.origin = hitInfo.hitPoint;
+            ray.dir = outDir;
+            ray.inv_dir = 1.0 / ray.dir;
+        } else {
+            // get color from environment
+            radiance += params.env_color.rgb * throughput;
+            break;
+        }
+    }
+    return radiance;
+}
+
+struct CameraViewport {
+    vec3 right, up;
+    float halfWidth, halfHeight;
+};
+
+CameraViewport GetCameraViewport(Camera camera, float aspectRatio) {
+    CameraViewport cameraViewport;
+    cameraViewport.right = cross(camera.dir.xyz, camera.up.xyz);
+    cameraViewport.up = cross(cameraViewport.right, camera.dir.xyz);
+
+    cameraViewport.halfHeight = tan(camera.yfov / 2.0);
+    cameraViewport.halfWidth = cameraViewport.halfHeight * aspectRatio;
+
+    return cameraViewport;
+}
+
+// uv must be in range [-1,1]
+Ray RayGenPerspectiveCamera(Camera camera, CameraViewport viewport, vec2 uv) {
+    Ray ray;
+    ray.origin = camera.pos.xyz;
+    ray.dir = camera.dir.xyz +
+            viewport.halfWidth * viewport.right * uv.x +
+            viewport.halfHeight * viewport.up * uv.y;
+    ray.inv_dir = 1.0 / ray.dir;
+    return ray;
+}
+
+Ray JitterRay(Ray ray, CameraViewport viewport, inout uint rngState) {
+    Ray jittered;
+    jittered.origin = ray.origin;
+    vec2 jitter = RandomPointInCircle(rngState) * params.diverge_strength;
+    jittered.dir = ray.dir + viewport.right * jitter.x + viewport.up * jitter.y;
+    jittered.inv_dir = 1.0 / jittered.dir;
+    return jittered;
+}
+
+// number of samples each pixel gets in this frame, rendered by adaptive.glsl
+// NOTE: used only with adaptive sampling, otherwise all get samples_per_pixel
+uniform sampler2D adaptiveSamplesTexture;
+
+int PixelSamplesCount(ivec2 pixel) {
+    if (params.adaptive_threshold <= 0.0)
+        return params.samples_per_pixel;
+    return int(texelFetch(adaptiveSamplesTexture, pixel, 0).r);
+}
+
+// sums of the samples RenderPixel took
+struct PixelSamples {
+    vec3 light;
+    // of the light's luminance and of its square
+    vec2 moments;
+    // of everything in FirstHit
+    FirstHit firstHit;
+};
+
+// returns the sums of samplesCount samples of the pixel at pixelCoord,
+// which are window coordinates same as gl_FragCoord.xy
+PixelSamples RenderPixel(vec2 pixelCoord, int samplesCount) {
+    vec2 resolution = vec2(params.width, params.height);
+
+    uint pixelIndex = uint(pixelCoord.x) + uint(pixelCoord.y) * uint(params.width);
+    uint rngState = pixelIndex;
+    rngState = pcg32_step(rngState) ^ (uint(frame_number) + seed_offset);
+    rngState = pcg32_step(rngState);
+
+    // pixelCoord stores the pixel coordinates [0.5, resolution-0.5]
+    vec2 uv = pixelCoord / resolution.xy; // normalized coordinates [0, 1]
+    uv = 2.0 * uv - 1.0; // normalized coordinates [-1, 1]
+
+    float aspectRatio = resolution.x / resolution.y;
+    CameraViewport viewport = GetCameraViewport(camera, aspectRatio);
+
+    Ray ray = RayGenPerspectiveCamera(camera, viewport, uv);
+
+    PixelSamples samples = PixelSamples(vec3(0.0), vec2(0.0), FirstHit(vec3(0.0), 0.0, vec3(0.0), 0.0));
+    for (int i = 0; i < samplesCount; ++i) {
+        FirstHit firstHit;
+        vec3 incomingLight = PathTrace(JitterRay(ray, viewport, rngState), rngState, firstHit);
+        float luminance = Luminance(incomingLight);
+        samples.light += incomingLight;
+        samples.moments += vec2(luminance, luminance * luminance);
+        samples.firstHit.albedo += firstHit.albedo;
+        samples.firstHit.emission += firstHit.emission;
+        samples.firstHit.normal += firstHit.normal;
+        samples.firstHit.depth += firstHit.depth;
+    }
+    AddToCounters(uint(samplesCount));
+    return samples;
+}
@@ -1,510 +1,33 @@
 #version 460
 
-uniform int frame_number;
-uniform sampler2D backBufferTexture;
-
-const float EPSILON = 0.00001;
-const float INFINITY = 1.0e30;
-const float PI = 3.141592653589793;
-const float TWOPI = 6.283185307179586;
-const float INV_PI = 0.3183098861837907;
-
-out vec4 FragColor;
-
-// #define CULLING
-
-#define STACK_SIZE 40
-#define MAX_ITERATIONS 200
-
-struct Parameters {
-    vec3 env_color;
-    int max_bounce_count;
-    int samples_per_pixel;
-    float diverge_strength;
-    int _frames_to_render;
-    uint width, height;
-};
-
-struct Camera {
-    vec4 pos;
-    vec4 dir;
-    vec4 up;
-    float yfov;
-};
-
-struct Ray {
-    vec3 origin;
-    vec3 dir;
-    vec3 inv_dir; // 1 / dir
-};
-
-// NOTE: these are just `vec3`s but because they come from a buffer-backed
-// blocks which have layouts that pad them to 16 bytes turning `vec3`s in to `vec4`s
-struct Triangle {
-    vec4 a, b, c;
-    vec4 _na, _nb, _nc;
-};
-
-// NOTE: same as above
-struct BVHnode {
-    vec4 boundsMin, boundsMax;
-    uint first, count;
-    int _, _1; // padding so that this struct's size is a multiple of 16 bytes
-};
-
-struct Material {
-    vec4 base_color_factor;
-    vec3 emissive_factor;
-    uint base_color_texture;
-    uint metallic_texture;
-    float metallic_factor;
-    uint roughness_texture;
-    float roughness_factor;
-    uint emissive_texture;
-    int _, _1, _2;
-};
-
-struct TriangleEx {
-    // index of the material in materialsBuffer
-    uint mat;
-};
-
-layout(std430, binding = 1) readonly buffer trianglesBuffer {
-    Triangle triangles[];
-};
-layout(std430, binding = 2) readonly buffer bvhNodesBuffer {
-    BVHnode nodes[];
-};
-layout(std430, binding = 3) readonly buffer materialsBuffer {
-    Material mats[];
-};
-layout(std430, binding = 4) readonly buffer primitivesBuffer {
-    TriangleEx triangles_data[];
-};
-layout(std430, binding = 5) readonly buffer cameraBuffer {
-    Camera camera;
-};
-layout(std430, binding = 6) readonly buffer rendererParametersBuffer {
-    Parameters params;
-};
-
-struct HitInfo {
-    bool didHit;
-    float dst;
-    vec3 hitPoint;
-    vec3 normal;
-    Material mat;
-};
-
-// RNG
-// https://github.com/imneme/pcg-c/blob/83252d9c23df9c82ecb42210afed61a7b42402d7/include/pcg_variants.h#L504
-// https://github.com/imneme/pcg-c/blob/83252d9c23df9c82ecb42210afed61a7b42402d7/include/pcg_variants.h#L182
-uint pcg32_step(inout uint state) {
-    uint old_state = state;
-    state = state * 747796405u + 2891336453u;
-    uint word = ((old_state >> ((old_state >> 28u) + 4u)) ^ old_state) * 277803737u;
-    return (word >> 22) ^ word;
-}
-
-// https://www.pcg-random.org/using-pcg-c-basic.html#generating-doubles
-float RandomFloat(inout uint state) {
-    return ldexp(pcg32_step(state), -32);
-}
-
-vec3 RandomUnitVector(inout uint state) {
-    float z = RandomFloat(state) * 2.0f - 1.0f;
-    float a = RandomFloat(state) * TWOPI;
-    float r = sqrt(1.0f - z * z);
-    float x = r * cos(a);
-    float y = r * sin(a);
-    return vec3(x, y, z);
-}
-
-vec2 RandomPointInCircle(inout uint state) {
-    float angle = RandomFloat(state) * TWOPI;
-    vec2 pointOnCircle = vec2(cos(angle), sin(angle));
-    return pointOnCircle * sqrt(RandomFloat(state));
-}
-
-// sRGB
-vec3 LessThan(vec3 f, float value) {
-    return vec3((f.x < value) ? 1.0f : 0.0f,
-        (f.y < value) ? 1.0f : 0.0f,
-        (f.z < value) ? 1.0f : 0.0f);
-}
-
-vec3 LinearToSRGB(vec3 rgb) {
-    rgb = clamp(rgb, 0.0f, 1.0f);
-
-    return mix(
-        pow(rgb, vec3(1.0f / 2.4f)) * 1.055f - 0.055f,
-        rgb * 12.92f,
-        LessThan(rgb, 0.0031308f)
-    );
-}
-
-vec3 SRGBToLinear(vec3 rgb) {
-    rgb = clamp(rgb, 0.0f, 1.0f);
-
-    return mix(
-        pow(((rgb + 0.055f) / 1.055f), vec3(2.4f)),
-        rgb / 12.92f,
-        LessThan(rgb, 0.04045f)
-    );
-}
-
-// using Möller-Trumbore intersection algorithm
-// https://www.youtube.com/watch?v=fK1RPmF_zjQ
-// https://cadxfem.org/inf/Fast%20MinimumStorage%20RayTriangle%20Intersection.pdf
-// Point T(u,v) = (1-u-v)A + uB + vC, where (u, v) are barycentric coordinates
-// and A, B, C are positions of vertices of the triangle,
-// is inside a triangle if u >= 0, v >= 0 and u + v <= 1.
-// u and v can be thought of as closeness to either vertex of a triangle.
-// A ray has an equation R(t) = O + tD, where O is origin,
-// D is direction and t is distance traveled in that direction.
-// If we assume that a ray hits the triangle we can then equate both formulas:
-// R(t) = T(u,v)
-// O + tD = (1-u-v)A + uB + vC (only t, u and v are unknowns)
-//
-// Rearanging gives:
-// A - uA -vA + uB + vC - tD = O
-// - tD + u(B - A) + v(C - A) = O - A
-// [-D, B-A, C-A]x[t, u, v] = O - A
-// renaming: E1 := B - A, E2 := C - A, T := O - A, gives:
-// [-D, E1, E2]x[t, u, v] = T
-//
-// We can apply cramer's rule, which in case of:
-// [a1 b1 c1][x] = [d1]
-// [a2 b2 c2][y] = [d2]
-// [a3 b3 c3][z] = [d3],
-// allows us to find that:
-//     | d1 b1 c1 |   | a1 b1 c1 |
-// x = | d2 b2 c2 | / | a2 b2 c2 |
-//     | d3 b3 c3 |   | a3 b3 c3 |
-//
-//     | a1 d1 c1 |   | a1 b1 c1 |
-// y = | a2 d2 c2 | / | a2 b2 c2 |
-//     | a3 d3 c3 |   | a3 b3 c3 |
-//
-//     | a1 b1 d1 |   | a1 b1 c1 |
-// z = | a2 b2 d2 | / | a2 b2 c2 |
-//     | a3 b3 d3 |   | a3 b3 c3 |.
-//
-// Applying this to our situation, we get:
-// t = | T E1 E2 | / | -D E1 E2 |
-// u = | -D T E2 | / | -D E1 E2 |
-// v = | -D E1 T | / | -D E1 E2 |.
-// Keep in mind that those equations for t, u and v above are actually
-// on 3x3 matrix as each element is actually a vec3.
-// We can think of a value of a 3x3 determinant as a signed area of a parallelogram
-// defined by 3 vectors. The area of a (vector described) parallelogram is a . (b x c),
-// where b x c is a cross product of the 2 base vectors, which results in a vertical
-// vector with the magnitude of the area of the base and dot product simply multiplies
-// the height with the area of a base (which is a vector with the same direction as a)
-// and as they have the same direction and therefore the angle between them is zero,
-// just their magnitudes get multiplied and we get a scalar.
-//
-// So the first determinants for each of the unknowns can be found as:
-// t = T . (E1 x E2)
-// u = -D . (T x E2)
-// v = -D . (E1 x T).
-// As "the scalar triple product is unchanged under a circular shift" (https://en.wikipedia.org/wiki/Triple_product)
-// we can change the equation for t to instead be:
-// t = (T x E1) . E2
-// We can also use the fact that "Swapping any two of the three operands negates the triple product", and get:
-// v = D . (T x E1)
-//
-// For the determinant common among the three equations, we will have:
-// det = E1 . (D x E2)
-// and that's it!
-HitInfo RayTriangleIntersection(Ray ray, Triangle tri) {
-    HitInfo hitInfo;
-    hitInfo.didHit = false;
-    vec3 D = ray.dir;
-    vec3 e1 = (tri.b - tri.a).xyz;
-    vec3 e2 = (tri.c - tri.a).xyz;
-    vec3 De2 = cross(D, e2);
-    float det = dot(e1, De2);
-
-    #ifdef CULLING
-    // if the determinant is negative, then the direction from which ray hits
-    // the triangle is opposite of the triangle's normal
-    bool condition = det < -EPSILON;
-    #else
-    // if determinant is zero then the ray is coming in parallel to the triangle
-    bool condition = abs(det) < EPSILON;
-    #endif
-
-    if (condition) {
-        // the vectors -D, e1 and e2 are not linearly independent,
-        // meaning ray is coming in parallel to the triangle
-        return hitInfo;
-    }
-
-    float inv_det = 1.0 / det;
-
-    vec3 T = ray.origin - tri.a.xyz;
-    vec3 Te1 = cross(T, e1);
-
-    float u = dot(T, De2) * inv_det;
-
-    // the barycentric coordinate u is too far, for the point of intersection
-    // to be inside the triangle
-    if ((u < 0 && abs(u) > EPSILON) || (u > 1 && abs(u - 1.0) > EPSILON)) return hitInfo;
-
-    float v = dot(D, Te1) * inv_det;
-
-    // the barycentric coordinate v is too far, for the point of intersection
-    // to be inside the triangle or both u and v are too far from centre
-    if ((v < 0 && abs(v) > EPSILON) || (u + v > 1 && abs(u + v - 1.0) > EPSILON)) return hitInfo;
-
-    // finally, if we got here, it means that we did actually hit the triangle
-    float t = dot(Te1, e2) * inv_det;
-    if (t > EPSILON) {
-        hitInfo.didHit = true;
-        hitInfo.hitPoint = ray.origin + ray.dir * t;
-        if (det > EPSILON)
-            hitInfo.normal = normalize(cross(e1, e2));
-        else
-            hitInfo.normal = normalize(cross(e2, e1));
-        hitInfo.dst = t;
-    }
-
-    return hitInfo;
-}
-
-// using slab method
-// Imagine that we put two parallel planes per each axis, such that
-// distance between those planes will be that of the bounding box.
-// We look through each of those planes and calculate the distance to
-// intersection with both planes on every axis individually.
-// To calculate whether a ray hits a plane and if so what's the distance
-// we have to consider each plane to be defined in terms of any point on it
-// and a normal vector to the plane, so we get this as an equation for a plane:
-// P . N + d = 0, where
-// P is any point on that plane,
-// N is the normal vector of the plane,
-// d is the plane's offset from origin.
-//
-// Let's assume that P is the point of intersection of the ray with the plane.
-// The ray equation is P = O + t * D, where
-// P is the destination point,
-// O is the ray's origin point,
-// t is the distance travelled by the ray to P,
-// D is the ray's direction.
-// We can transform the ray equation to instead be:
-// t = (P - O) / D,
-// which tells us that if we know the point of intersection we can easily
-// calculate the distance to that point.
-// if there is no intersection we will end up with infinities which
-// funnily enough get automagically handled
-bool RayBVHnodeIntersection(Ray ray, BVHnode bb) {
-    float tx1 = (bb.boundsMin.x - ray.origin.x) * ray.inv_dir.x, tx2 = (bb.boundsMax.x - ray.origin.x) * ray.inv_dir.x;
-    float tmin = min(tx1, tx2), tmax = max(tx1, tx2);
-    float ty1 = (bb.boundsMin.y - ray.origin.y) * ray.inv_dir.y, ty2 = (bb.boundsMax.y - ray.origin.y) * ray.inv_dir.y;
-    tmin = max(tmin, min(ty1, ty2)), tmax = min(tmax, max(ty1, ty2));
-    float tz1 = (bb.boundsMin.z - ray.origin.z) * ray.inv_dir.z, tz2 = (bb.boundsMax.z - ray.origin.z) * ray.inv_dir.z;
-    tmin = max(tmin, min(tz1, tz2)), tmax = min(tmax, max(tz1, tz2));
-    return tmax >= tmin && tmax > 0;
-}
+#define FRAGMENT_SHADER
+#include "pathtracer.glsl"
 
-HitInfo FindRayCollision(Ray ray) {
-    HitInfo closestHit;
-    closestHit.didHit = false;
-    closestHit.dst = INFINITY;
-
-    uint stack[STACK_SIZE], stack_ptr = 0;
-    stack[stack_ptr++] = 0;
-    int max_iterations = MAX_ITERATIONS;
-    while (stack_ptr > 0 && max_iterations-- > 0) {
-        BVHnode node = nodes[stack[--stack_ptr]];
-
-        if (!RayBVHnodeIntersection(ray, node))
-        {
-            if (stack_ptr == 0) return closestHit;
-            else continue;
-        }
-        // if node is a leaf
-        if (node.count > 0) {
-            for (int i = 0; i < node.count; ++i) {
-                uint t_index = node.first + i;
-                Triangle t = triangles[t_index];
-                HitInfo hit = RayTriangleIntersection(ray, t);
-                if (hit.didHit && hit.dst < closestHit.dst) {
-                    closestHit = hit;
-                    closestHit.mat = mats[triangles_data[t_index].mat];
-                }
-            }
-        } else {
-            // left will be checked first, so must push the right one first
-            stack[stack_ptr++] = node.first + 1;
-            stack[stack_ptr++] = node.first + 0;
-        }
-    }
-
-    return closestHit;
-}
-
-vec3 SampleCosineWeighedHeimsphere(vec3 normal, inout uint rngState) {
-    return normalize(normal + RandomUnitVector(rngState));
-}
-
-vec3 ReflectDir(vec3 dir, vec3 normal) {
-    return dir - 2 * dot(dir, normal) * normal;
-}
-
-// L_o(x, \omega_o) &= L_e(x, \omega_o) + L_r(x, \omega_o)
-// L_r(x, \omega_o) &= \int_{\Omega} f(x, \omega_i, \omega_o) L_i(x, \omega_i)\cos{\theta_i} d\omega_i
-
-// Uniform Lambertian reflection sampling
-// vec3 EvalLambertian(vec3 normal, vec3 outDir, Material mat) {
-//     return mat.base_color_factor.rgb * dot(normal, outDir) / PI;
-// }
-// vec3 SampleUniformHiemsphere(vec3 normal, inout uint rngState) {
-//     vec3 r = RandomUnitVector(rngState);
-//     return dot(normal, r) > 0.0 ? r : -r;
-// }
-// float PdfUniformHemisphere(vec3 inDir, vec3 normal, vec3 outDir) {
-//     return 1.0 / (2.0 * PI);
-// }
-// vec3 UniformSampleLambertian(Ray ray, HitInfo hitInfo, out vec3 dir, inout uint rngState) {
-//     dir = SampleUniformHiemsphere(hitInfo.normal, rngState);
-//     // (albedo * cos phi / pi) / (1.0 / (2.0 * pi)) = 2.0 * albedo * cos phi
-//     // return EvalLambertian(hitInfo.normal, dir, hitInfo.mat) / PdfUniformHemisphere(ray.dir, hitInfo.normal, dir);
-//     return 2.0 * hitInfo.mat.base_color_factor.rgb * dot(hitInfo.normal, dir);
-// }
-
-// AKA diffuse_brdf
-vec3 ImportanceSampleLambertian(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, inout uint rngState) {
-    omega_o = SampleCosineWeighedHeimsphere(hitInfo.normal, rngState);
-    return hitInfo.mat.base_color_factor.rgb;
-}
-
-// AKA specular_brdf
-vec3 SpecularReflection(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, inout uint rngState) {
-    omega_o = ReflectDir(omega_i, hitInfo.normal);
-    return hitInfo.mat.base_color_factor.rgb;
-}
-
-vec3 SampleMetalicBRDF(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, inout uint rngState) {
-    return SpecularReflection(omega_i, hitInfo, omega_o, rngState);
-}
-
-vec3 SampleDielectricBRDF(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, inout uint rngState) {
-    return ImportanceSampleLambertian(omega_i, hitInfo, omega_o, rngState);
-}
-
-vec3 SampleBRDF(vec3 omega_i, HitInfo hitInfo, out vec3 omega_o, inout uint rngState) {
-    vec3 brdfWeight;
-    float p;
-    if (RandomFloat(rngState) < hitInfo.mat.metallic_factor) {
-        brdfWeight = SampleMetalicBRDF(omega_i, hitInfo, omega_o, rngState);
-        p = hitInfo.mat.metallic_factor;
-    } else {
-        brdfWeight = SampleDielectricBRDF(omega_i, hitInfo, omega_o, rngState);
-        p = 1 - hitInfo.mat.metallic_factor;
-    }
-
-    return brdfWeight / max(p, 0.1);
-}
-
-// Le(x, omega_o)
-vec3 GetLightEmitted(HitInfo hitInfo, vec3 V) {
-    return hitInfo.mat.emissive_factor;
-}
-
-vec3 PathTrace(Ray ray, inout uint rngState) {
-    vec3 throughput = vec3(1.0, 1.0, 1.0);
-    // Lo(x, omega_o)
-    vec3 radiance = vec3(0.0, 0.0, 0.0);
-
-    for (int i = 0; i < params.max_bounce_count; ++i) {
-        HitInfo hitInfo = FindRayCollision(ray);
-        if (hitInfo.didHit) {
-            vec3 outDir;
-            vec3 reflectedLight = SampleBRDF(ray.dir, hitInfo, outDir, rngState);
-
-            radiance += GetLightEmitted(hitInfo, -ray.dir) * throughput;
-            throughput *= reflectedLight;
-
-            // bounce
-            ray.origin = hitInfo.hitPoint;
-            ray.dir = outDir;
-            ray.inv_dir = 1.0 / ray.dir;
-        } else {
-            // get color from environment
-            radiance += params.env_color.rgb * throughput;
-            break;
-        }
-    }
-    return radiance;
-}
-
-struct CameraViewport {
-    vec3 right, up;
-    float halfWidth, halfHeight;
-};
-
-CameraViewport GetCameraViewport(Camera camera, float aspectRatio) {
-    CameraViewport cameraViewport;
-    cameraViewport.right = cross(camera.dir.xyz, camera.up.xyz);
-    cameraViewport.up = cross(cameraViewport.right, camera.dir.xyz);
-
-    cameraViewport.halfHeight = tan(camera.yfov / 2.0);
-    cameraViewport.halfWidth = cameraViewport.halfHeight * aspectRatio;
-
-    return cameraViewport;
-}
-
-// uv must be in range [-1,1]
-Ray RayGenPerspectiveCamera(Camera camera, CameraViewport viewport, vec2 uv) {
-    Ray ray;
-    ray.origin = camera.pos.xyz;
-    ray.dir = camera.dir.xyz +
-            viewport.halfWidth * viewport.right * uv.x +
-            viewport.halfHeight * viewport.up * uv.y;
-    ray.inv_dir = 1.0 / ray.dir;
-    return ray;
-}
+uniform sampler2D backBufferTexture;
+uniform sampler2D momentsTexture;
+uniform sampler2D albedoTexture;
+uniform sampler2D normalTexture;
 
-Ray JitterRay(Ray ray, CameraViewport viewport, inout uint rngState) {
-    Ray jittered;
-    jittered.origin = ray.origin;
-    vec2 jitter = RandomPointInCircle(rngState) * params.diverge_strength;
-    jittered.dir = ray.dir + viewport.right * jitter.x + viewport.up * jitter.y;
-    jittered.inv_dir = 1.0 / jittered.dir;
-    return jittered;
-}
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out vec2 MomentsOut;
+layout(location = 2) out vec4 AlbedoOut;
+layout(location = 3) out vec4 NormalOut;
 
 void main() {
-    vec2 resolution = vec2(params.width, params.height);
-
-    uint pixelIndex = uint(gl_FragCoord.x) + uint(gl_FragCoord.y) * uint(params.width);
-    uint rngState = pixelIndex;
-    rngState = pcg32_step(rngState) ^ uint(frame_number);
-    rngState = pcg32_step(rngState);
-
-    // gl_FragCoord stores the pixel coordinates [0.5, resolution-0.5]
-    vec2 uv = gl_FragCoord.xy / resolution.xy; // normalized coordinates [0, 1]
-    uv = 2.0 * uv - 1.0; // normalized coordinates [-1, 1]
-
-    float aspectRatio = resolution.x / resolution.y;
-    CameraViewport viewport = GetCameraViewport(camera, aspectRatio);
-
-    Ray ray = RayGenPerspectiveCamera(camera, viewport, uv);
-
-    vec3 totalIncomingLight = vec3(0.0, 0.0, 0.0);
-    for (int i = 0; i < params.samples_per_pixel; ++i) {
-        totalIncomingLight += PathTrace(JitterRay(ray, viewport, rngState), rngState);
-    }
-    totalIncomingLight /= float(params.samples_per_pixel);
-
-    if (frame_number > 0) {
-        vec3 lastFrameColor = texture(backBufferTexture, gl_FragCoord.xy / resolution.xy).rgb;
-        float weight = 1.0 / float(frame_number + 1);
-        totalIncomingLight = SRGBToLinear(lastFrameColor) * (1.0 - weight) + totalIncomingLight * weight;
-    }
-    totalIncomingLight = LinearToSRGB(totalIncomingLight);
-
-    FragColor = vec4(totalIncomingLight, 1.0);
+    int samplesCount = PixelSamplesCount(ivec2(gl_FragCoord.xy));
+    // leaves all the accumulated sums as they were
+    if (samplesCount == 0)
+        discard;
+
+    PixelSamples samples = RenderPixel(gl_FragCoord.xy, samplesCount);
+
+    // the back buffer holds linear sums of all samples so far in rgb
+    // and their count in alpha, averaging happens only in resolve.glsl
+    // NOTE: reading only the texel this invocation writes to is what makes
+    // sampling the textures we're rendering to safe
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    FragColor = texelFetch(backBufferTexture, pixel, 0) + vec4(samples.light, float(samplesCount));
+    MomentsOut = texelFetch(momentsTexture, pixel, 0).rg + samples.moments;
+    AlbedoOut = texelFetch(albedoTexture, pixel, 0) + vec4(samples.firstHit.albedo, samples.firstHit.emission);
+    NormalOut = texelFetch(normalTexture, pixel, 0) + vec4(samples.firstHit.normal, samples.firstHit.depth);
 }
@@ -0,0 +1,88 @@
+#version 460
+
+// NOTE: first, as its #extension directives have to come before anything else
+#include "pathtracer.glsl"
+
+// NOTE: TILE_WIDTH, TILE_HEIGHT and optionally PERSISTENT
+// are defined by the renderer when compiling this shader
+layout(local_size_x = TILE_WIDTH, local_size_y = TILE_HEIGHT) in;
+
+// same as the back buffer of the fragment shader, linear sums of all
+// samples so far in rgb and their count in alpha
+layout(rgba32f, binding = 0) uniform image2D accumulationImage;
+// sums of the samples' luminance and of its squares
+layout(rg32f, binding = 1) uniform image2D momentsImage;
+// sums of everything in FirstHit, albedo with emission and normal with depth
+layout(rgba32f, binding = 2) uniform image2D albedoImage;
+layout(rgba32f, binding = 3) uniform image2D normalImage;
+
+void AccumulatePixel(uvec2 pixel) {
+    // tiles on the right and top edges can stick out of the image
+    if (pixel.x >= params.width || pixel.y >= params.height)
+        return;
+
+    int samplesCount = PixelSamplesCount(ivec2(pixel));
+    if (samplesCount == 0)
+        return;
+
+    // + 0.5 to get the same coordinates as gl_FragCoord has
+    PixelSamples samples = RenderPixel(vec2(pixel) + 0.5, samplesCount);
+
+    // NOTE: each invocation touches only its own pixel, so no synchronization
+    // is needed between the loads and the stores
+    ivec2 p = ivec2(pixel);
+    imageStore(accumulationImage, p,
+               imageLoad(accumulationImage, p) + vec4(samples.light, float(samplesCount)));
+    imageStore(momentsImage, p, imageLoad(momentsImage, p) + vec4(samples.moments, 0.0, 0.0));
+    imageStore(albedoImage, p, imageLoad(albedoImage, p) + vec4(samples.firstHit.albedo, samples.firstHit.emission));
+    imageStore(normalImage, p, imageLoad(normalImage, p) + vec4(samples.firstHit.normal, samples.firstHit.depth));
+}
+
+#ifdef PERSISTENT
+// index of the next tile to be rendered, zeroed before every dispatch
+layout(std430, binding = 7) coherent buffer tileCounterBuffer {
+    uint next_tile;
+};
+
+// the tile of the current iteration and of the previous one, which the
+// slowest invocations might still be reading
+shared uint tile_slots[2];
+
+// NOTE: the tile is the same for the whole workgroup,
+// so the control flow stays uniform as barrier() requires
+uint NextTile(uint iteration) {
+    uint slot = iteration & 1u;
+    if (gl_LocalInvocationIndex == 0)
+        tile_slots[slot] = atomicAdd(next_tile, 1);
+    // a slot only gets written again two iterations later, once everyone got
+    // past the barrier of the next one, and so has read it already
+    memoryBarrierShared();
+    barrier();
+    return tile_slots[slot];
+}
+
+// NOTE: llvmpipe (Mesa's software driver) stops an outermost loop after 65535
+// iterations of it and of all the loops inside it combined. Here that's the
+// loop over the tiles, which traces every path of them, so when testing
+// there, dispatch enough workgroups for each to render a single tile and keep
+// the paths short, otherwise pixels lose samples.
+void main() {
+    uvec2 tiles = (uvec2(params.width, params.height) + gl_WorkGroupSize.xy - 1) / gl_WorkGroupSize.xy;
+    uint tiles_count = tiles.x * tiles.y;
+
+    // NOTE: NextTile gets called from a single place, as llvmpipe hands the
+    // wrong tile to some invocations when a barrier() is both before the loop
+    // and in it
+    for (uint iteration = 0;; ++iteration) {
+        uint current_tile = NextTile(iteration);
+        if (current_tile >= tiles_count)
+            break;
+        uvec2 tile_origin = uvec2(current_tile % tiles.x, current_tile / tiles.x) * gl_WorkGroupSize.xy;
+        AccumulatePixel(tile_origin + gl_LocalInvocationID.xy);
+    }
+}
+#else
+void main() {
+    AccumulatePixel(gl_GlobalInvocationID.xy);
+}
+#endif
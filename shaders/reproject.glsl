@@ -0,0 +1,126 @@
+#version 460
+
+// Moves the samples accumulated with the previous camera to where the current
+// one sees them, so that small camera moves don't have to start from scratch.
+// Pixels showing what the previous camera couldn't see start from zero.
+
+#include "pathtracer.glsl"
+
+// the back buffer's textures from before the camera moved, see renderer.glsl
+uniform sampler2D historyTexture;
+uniform sampler2D historyMomentsTexture;
+// with the sums of the first hit's emission and depth in alpha, see FirstHit
+uniform sampler2D historyAlbedoTexture;
+uniform sampler2D historyNormalTexture;
+// the camera the history was accumulated with
+uniform Camera previousCamera;
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out vec2 MomentsOut;
+layout(location = 2) out vec4 AlbedoOut;
+layout(location = 3) out vec4 NormalOut;
+
+// the most the previous depth and emission can differ from the expected ones,
+// relative to them, the most any channel of the albedo can differ and the
+// least cosine between the normals, for a surface to count as the same one
+// the previous camera saw there
+const float MAX_DEPTH_DIFFERENCE = 0.05;
+const float MAX_EMISSION_DIFFERENCE = 0.05;
+const float MAX_ALBEDO_DIFFERENCE = 0.1;
+const float MIN_NORMAL_COSINE = 0.9;
+
+// window coordinates at which the previous camera sees what's in direction
+// dir from it, false if that's behind it
+bool ProjectToPrevious(vec3 dir, vec2 resolution, out vec2 pixelCoord) {
+    vec3 forward = previousCamera.dir.xyz;
+    float distanceAlong = dot(dir, forward);
+    if (distanceAlong <= 0.0)
+        return false;
+
+    // inverse of RayGenPerspectiveCamera, dir gets scaled to end on the same
+    // plane the directions it generates do
+    CameraViewport viewport = GetCameraViewport(previousCamera, resolution.x / resolution.y);
+    vec3 onPlane = dir * dot(forward, forward) / distanceAlong - forward;
+    vec2 uv = vec2(
+            dot(onPlane, viewport.right) / (viewport.halfWidth * dot(viewport.right, viewport.right)),
+            dot(onPlane, viewport.up) / (viewport.halfHeight * dot(viewport.up, viewport.up)));
+    pixelCoord = (uv * 0.5 + 0.5) * resolution;
+    return true;
+}
+
+// whether the previous camera saw the same surface in the pixel
+bool IsSameSurface(ivec2 pixel, Ray ray, HitInfo hitInfo) {
+    if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, ivec2(params.width, params.height))))
+        return false;
+
+    float samplesCount = texelFetch(historyTexture, pixel, 0).a;
+    if (samplesCount <= 0.0)
+        return false;
+
+    // NOTE: a pixel showing a mix of surfaces (or of some surface and the
+    // environment) won't match any of them, so it can't be reused
+    vec4 normalDepth = texelFetch(historyNormalTexture, pixel, 0) / samplesCount;
+    if (!hitInfo.didHit)
+        return normalDepth == vec4(0.0);
+    if (dot(normalDepth.xyz, normalDepth.xyz) == 0.0)
+        return false;
+
+    // without checking the emission, the edges of lights would get smeared
+    // onto whatever is next to them, as long as it's on the same plane
+    vec4 albedoEmission = texelFetch(historyAlbedoTexture, pixel, 0) / samplesCount;
+    float expectedEmission = Luminance(GetLightEmitted(hitInfo, -ray.dir));
+    vec3 albedoDifference = abs(albedoEmission.rgb - hitInfo.mat.base_color_factor.rgb);
+
+    float expectedDepth = distance(hitInfo.hitPoint, previousCamera.pos.xyz);
+    return abs(normalDepth.w - expectedDepth) <= MAX_DEPTH_DIFFERENCE * expectedDepth &&
+        dot(normalize(normalDepth.xyz), hitInfo.normal) >= MIN_NORMAL_COSINE &&
+        abs(albedoEmission.a - expectedEmission) <= MAX_EMISSION_DIFFERENCE * expectedEmission &&
+        all(lessThanEqual(albedoDifference, vec3(MAX_ALBEDO_DIFFERENCE)));
+}
+
+void main() {
+    vec2 resolution = vec2(params.width, params.height);
+    vec2 uv = gl_FragCoord.xy / resolution * 2.0 - 1.0;
+    CameraViewport viewport = GetCameraViewport(camera, resolution.x / resolution.y);
+    Ray ray = RayGenPerspectiveCamera(camera, viewport, uv);
+    HitInfo hitInfo = FindRayCollision(ray);
+
+    FragColor = vec4(0.0);
+    MomentsOut = vec2(0.0);
+    AlbedoOut = vec4(0.0);
+    NormalOut = vec4(0.0);
+
+    // the environment is infinitely far away, so only the direction matters
+    vec3 dir = hitInfo.didHit ? hitInfo.hitPoint - previousCamera.pos.xyz : ray.dir;
+    vec2 pixelCoord;
+    if (!ProjectToPrevious(dir, resolution, pixelCoord))
+        return;
+
+    // bilinear filtering of the 4 nearest pixels, skipping the ones which saw
+    // something else, as the nearest one alone would drift over many moves
+    vec2 p = pixelCoord - 0.5;
+    ivec2 base = ivec2(floor(p));
+    vec2 f = p - vec2(base);
+    float weights = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec2 axisWeights = mix(1.0 - f, f, vec2(offset));
+        float weight = axisWeights.x * axisWeights.y;
+        ivec2 pixel = base + offset;
+        if (weight <= 0.0 || !IsSameSurface(pixel, ray, hitInfo))
+            continue;
+
+        FragColor += weight * texelFetch(historyTexture, pixel, 0);
+        MomentsOut += weight * texelFetch(historyMomentsTexture, pixel, 0).rg;
+        AlbedoOut += weight * texelFetch(historyAlbedoTexture, pixel, 0);
+        NormalOut += weight * texelFetch(historyNormalTexture, pixel, 0);
+        weights += weight;
+    }
+
+    if (weights > 0.0) {
+        FragColor /= weights;
+        MomentsOut /= weights;
+        AlbedoOut /= weights;
+        NormalOut /= weights;
+    }
+}
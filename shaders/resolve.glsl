@@ -0,0 +1,30 @@
+#version 460
+
+// linear sums of the samples in rgb and their count in alpha
+uniform sampler2D accumulationTexture;
+
+out vec4 FragColor;
+
+// sRGB
+vec3 LessThan(vec3 f, float value) {
+    return vec3((f.x < value) ? 1.0f : 0.0f,
+        (f.y < value) ? 1.0f : 0.0f,
+        (f.z < value) ? 1.0f : 0.0f);
+}
+
+vec3 LinearToSRGB(vec3 rgb) {
+    rgb = clamp(rgb, 0.0f, 1.0f);
+
+    return mix(
+        pow(rgb, vec3(1.0f / 2.4f)) * 1.055f - 0.055f,
+        rgb * 12.92f,
+        LessThan(rgb, 0.0031308f)
+    );
+}
+
+void main() {
+    vec4 accumulated = texelFetch(accumulationTexture, ivec2(gl_FragCoord.xy), 0);
+    vec3 color = accumulated.rgb / max(accumulated.a, 1.0);
+
+    FragColor = vec4(LinearToSRGB(color), 1.0);
+}
@@ -3,24 +3,41 @@
 #include "action.h"
 #include "app_state.h"
 #include "arena.h"
+#include "asserts.h"
+#include "checkpoint.h"
+#include "denoiser.h"
 #include "input_handler.h"
 #include "opengl/gl_call.h"
+#include "renderer.h"
 #include "renderer/parameters.h"
 #include "scene.h"
 #include "scene/file_formats/gltf.h"
 #include "small_string.h"
 #include "stats.h"
-#include "stb_image_write.h"
 #include "utils.h"
+#include "utils/timer.h"
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 void AppState_load_scene(AppState *app_state) {
+  GltfAnimation_delete(&app_state->scene_animation);
   StatsTimer_start(&app_state->stats.scene_load);
-  load_gltf_scene(&app_state->scene, app_state->settings.scene_path.str);
+  Timer_begin("scene load");
+  load_gltf_animated_scene(&app_state->scene, &app_state->scene_animation,
+                           app_state->settings.scene_path.str);
+  Timer_end();
   StatsTimer_stop(&app_state->stats.scene_load);
   app_state->pending_actions |= Action_update_ssbo_scene;
   app_state->pending_actions |= Action_build_bvh;
 
+  const GltfAnimation *animation = &app_state->scene_animation;
+  if (GltfAnimation_is_loaded(animation)) {
+    printf("Loaded an animation of %u vertices from %gs to %gs\n",
+           animation->vertices_count, animation->start_s, animation->end_s);
+    app_state->pending_actions |= Action_animate_scene;
+  }
+
   // set the camera to the one defined in the scene
   app_state->settings.cam = app_state->scene.camera;
   app_state->pending_actions |= Action_update_ssbo_camera;
@@ -28,14 +45,76 @@ void AppState_load_scene(AppState *app_state) {
 
 void AppState_build_bvh(AppState *app_state, Arena *tmp_arena) {
   StatsTimer_start(&app_state->stats.bvh_build);
+  Timer_begin("bvh build");
   Scene_build_bvh(&app_state->scene, app_state->settings.BVH_build_strat,
                   tmp_arena);
+  Timer_end();
   StatsTimer_stop(&app_state->stats.bvh_build);
 
   printf("Building BVH using the strategy '%s' took: %s\n",
          BVHStrategy_str[app_state->settings.BVH_build_strat],
          Stats_fmt_time(app_state->stats.bvh_build.total_time).str);
   app_state->pending_actions |= Action_update_ssbo_scene;
+
+  app_state->bvh_analysis = (BVHAnalysis){0};
+  if (app_state->settings.bvh_report)
+    app_state->pending_actions |= Action_analyze_bvh;
+}
+
+void AppState_analyze_bvh(AppState *app_state) {
+  const Scene *scene = &app_state->scene;
+  Timer_begin("bvh analysis");
+  app_state->bvh_analysis =
+      BVH_analyze(scene->bvh_nodes, scene->bvh_nodes_count, scene->triangles,
+                  scene->triangles_count, BVH_ANALYSIS_RAYS);
+  Timer_end();
+  printf("BVH analysis:\n%s", BVHAnalysis_str(&app_state->bvh_analysis).str);
+}
+
+void AppState_animate_scene(AppState *app_state, Arena *tmp_arena) {
+  if (!GltfAnimation_is_loaded(&app_state->scene_animation))
+    return;
+  Stats *stats = &app_state->stats;
+  StatsTimer_start(&stats->animation);
+  Timer_begin("animation");
+  GltfAnimation_apply(&app_state->scene_animation, &app_state->scene,
+                      app_state->settings.scene_time_s);
+  Timer_end();
+  StatsTimer_stop(&stats->animation);
+  app_state->pending_actions |= Action_restart_rendering;
+
+  // NOTE: a BVH which is about to be built doesn't need to be updated
+  if (Action_build_bvh & app_state->pending_actions)
+    return;
+  StatsTimer_start(&stats->bvh_update);
+  Timer_begin("bvh update");
+  const bool refitted = Scene_refit_bvh(&app_state->scene, tmp_arena);
+  if (!refitted)
+    Scene_build_bvh(&app_state->scene, BVHStrategy_Midpoint, tmp_arena);
+  Timer_end();
+  StatsTimer_stop(&stats->bvh_update);
+  // NOTE: the bounds changed, so the analysis would have to be done again
+  app_state->bvh_analysis = (BVHAnalysis){0};
+  // NOTE: a rebuilt BVH can have a different number of nodes
+  app_state->pending_actions |=
+      refitted ? Action_update_ssbo_geometry : Action_update_ssbo_scene;
+}
+
+void AppState_play_animation(AppState *app_state) {
+  const GltfAnimation *animation = &app_state->scene_animation;
+  if (!app_state->settings.animation_playing ||
+      !GltfAnimation_is_loaded(animation))
+    return;
+  float *time_s = &app_state->settings.scene_time_s;
+  *time_s += app_state->stats.last_frame_rendering.total_time;
+  const float duration_s = animation->end_s - animation->start_s;
+  if (*time_s > animation->end_s)
+    *time_s = animation->start_s +
+              (duration_s > 0 ? fmodf(*time_s - animation->start_s, duration_s)
+                              : 0);
+  else if (*time_s < animation->start_s)
+    *time_s = animation->start_s;
+  app_state->pending_actions |= Action_animate_scene;
 }
 
 void AppState_handle_inputs(AppState *app_state, InputHandler *input_handler,
@@ -43,6 +122,8 @@ void AppState_handle_inputs(AppState *app_state, InputHandler *input_handler,
   InputHandlerAction input_handler_action =
       InputHandler_update(input_handler, events);
   double dt = app_state->stats.last_frame_rendering.total_time;
+  const bool camera_moved =
+      input_handler_action.type == InputHandlerActionType_CameraMoved;
   switch (input_handler_action.type) {
   case InputHandlerActionType_CameraMoved:
     Camera_transform(&app_state->settings.cam, input_handler_action.CameraMoved,
@@ -52,9 +133,23 @@ void AppState_handle_inputs(AppState *app_state, InputHandler *input_handler,
   case InputHandlerActionType_Nothing:
     break;
   }
+
+  // NOTE: when it gets disabled, it still has to go back to full resolution
+  const double target_ms = app_state->settings.dynamic_resolution_target_ms;
+  if (DynamicResolution_update(&app_state->dynamic_resolution,
+                               camera_moved && target_ms > 0, dt,
+                               target_ms / 1000.0))
+    app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
 }
 
-static SmallString AppState_str(const AppState *app_state) {
+RendererParameters AppState_rendering_params(const AppState *app_state) {
+  RendererParameters params = app_state->settings.rendering_params;
+  params.rendering_resolution = DynamicResolution_apply(
+      &app_state->dynamic_resolution, params.rendering_resolution);
+  return params;
+}
+
+SmallString AppState_str(const AppState *app_state) {
   SmallString res = {0};
 
   snprintf(res.str, sizeof(res.str), "RendererParameters:\n%s\nStats:\n%s\n",
@@ -64,32 +159,194 @@ static SmallString AppState_str(const AppState *app_state) {
   return res;
 }
 
-const int BYTES_PER_PIXEL = 3;
-void AppState_save_image(AppState *app_state, GLuint fbo,
-                         WindowResolution resolution, Arena *tmp_arena) {
-  GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo));
-  GL_CALL(glReadBuffer(GL_COLOR_ATTACHMENT0));
-  GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+void AppState_save_image(AppState *app_state, ImageSaver *image_saver,
+                         GLuint fbo, WindowResolution resolution) {
+  ImageSaver_read(image_saver, fbo, resolution,
+                  app_state->settings.saved_image_path.str,
+                  AppState_str(app_state).str);
+}
+
+void AppState_save_denoised_image(AppState *app_state,
+                                  ImageSaver *image_saver,
+                                  const Renderer *renderer) {
+  const WindowResolution resolution =
+      AppState_rendering_params(app_state).rendering_resolution;
+  StatsTimer timer = StatsTimer_new();
+  StatsTimer_start(&timer);
+
+  Denoiser denoiser = Denoiser_new(resolution);
+  Renderer_read_accumulation(renderer, denoiser.accumulation);
+  Renderer_read_aovs(renderer, denoiser.moments, denoiser.albedo,
+                     denoiser.normal);
+  Denoiser_run(&denoiser);
 
-  ArenaMark am = Arena_mark(tmp_arena);
-  void *pixels = Arena_alloc(tmp_arena, resolution.width * resolution.height *
-                                            BYTES_PER_PIXEL);
+  // RGB, see ImageSaver_write
+  const uint32_t bytes_count = resolution.width * resolution.height * 3;
+  uint8_t *pixels = malloc(bytes_count);
+  ASSERTQ_CUSTOM(pixels != NULL, "Failed to allocate the denoised image");
+  for (uint32_t i = 0; i < bytes_count; ++i)
+    pixels[i] = (uint8_t)(linear_to_srgb(denoiser.color[i]) * 255.0f + 0.5f);
+  Denoiser_delete(&denoiser);
 
-  GL_CALL(glReadPixels(0, 0, resolution.width, resolution.height, GL_RGB,
-                       GL_UNSIGNED_BYTE, pixels));
+  StatsTimer_stop(&timer);
+  printf("Denoising took: %s\n", Stats_fmt_time(timer.total_time).str);
 
-  const int stride = resolution.width * 3;
-  stbi_flip_vertically_on_write(true);
-  if (stbi_write_png(app_state->settings.saved_image_path.str, resolution.width,
-                     resolution.height, 3, pixels, stride)) {
-    printf("Sucessfully saved image to '%s'\n",
-           app_state->settings.saved_image_path.str);
+  ImageSaver_write(image_saver, pixels, resolution,
+                   app_state->settings.saved_image_path.str,
+                   AppState_str(app_state).str);
+}
+
+// turns the sums of samples into their averages, with the counts in
+// accumulation's alpha
+// NOTE: when averaging accumulation itself only its rgb should be
+static void average_samples(float *sums, uint32_t channels,
+                            const float *accumulation, uint32_t pixels_count) {
+  for (uint32_t i = 0; i < pixels_count; ++i) {
+    const float count = accumulation[i * 4 + 3];
+    for (uint32_t c = 0; c < channels; ++c)
+      sums[i * 4 + c] = count > 0 ? sums[i * 4 + c] / count : 0;
   }
-  GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+}
 
-  Image_add_metadata(app_state->settings.saved_image_path.str,
-                     AppState_str(app_state).str);
-  Arena_rewind(am);
+static void normalize_normals(float *normals, uint32_t pixels_count) {
+  for (uint32_t i = 0; i < pixels_count; ++i) {
+    float *n = &normals[i * 4];
+    const float len2 = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+    const float inv_len = len2 > 0 ? 1.0f / sqrtf(len2) : 0.0f;
+    for (int c = 0; c < 3; ++c)
+      n[c] *= inv_len;
+  }
+}
+
+void AppState_save_hdr_image(AppState *app_state, ImageSaver *image_saver,
+                             const Renderer *renderer) {
+  const Settings *settings = &app_state->settings;
+  const WindowResolution resolution =
+      AppState_rendering_params(app_state).rendering_resolution;
+  const uint32_t pixels_count = resolution.width * resolution.height;
+  HdrImage image = HdrImage_new(resolution);
+  float *accumulation, *color, *albedo = NULL, *normal = NULL;
+  uint32_t color_stride;
+
+  if (settings->denoise_enabled) {
+    Denoiser denoiser = Denoiser_new(resolution);
+    Renderer_read_accumulation(renderer, denoiser.accumulation);
+    Renderer_read_aovs(renderer, denoiser.moments, denoiser.albedo,
+                       denoiser.normal);
+    Denoiser_run(&denoiser);
+
+    // the image takes over the buffers it needs, the rest gets freed
+    accumulation = denoiser.accumulation;
+    color = denoiser.color;
+    color_stride = 3;
+    HdrImage_add_buffer(&image, accumulation);
+    HdrImage_add_buffer(&image, color);
+    denoiser.accumulation = denoiser.color = NULL;
+    if (settings->aovs_enabled) {
+      albedo = denoiser.albedo;
+      normal = denoiser.normal;
+      HdrImage_add_buffer(&image, albedo);
+      HdrImage_add_buffer(&image, normal);
+      denoiser.albedo = denoiser.normal = NULL;
+    }
+    Denoiser_delete(&denoiser);
+  } else {
+    accumulation = color = HdrImage_alloc(&image, 4);
+    color_stride = 4;
+    Renderer_read_accumulation(renderer, accumulation);
+    if (settings->aovs_enabled) {
+      albedo = HdrImage_alloc(&image, 4);
+      normal = HdrImage_alloc(&image, 4);
+      Renderer_read_aovs(renderer, NULL, albedo, normal);
+    }
+  }
+
+  if (settings->aovs_enabled) {
+    average_samples(albedo, 4, accumulation, pixels_count);
+    average_samples(normal, 4, accumulation, pixels_count);
+    normalize_normals(normal, pixels_count);
+  }
+  if (color == accumulation)
+    average_samples(accumulation, 3, accumulation, pixels_count);
+
+  HdrImage_add_channel(&image, "R", color, color_stride);
+  HdrImage_add_channel(&image, "G", color + 1, color_stride);
+  HdrImage_add_channel(&image, "B", color + 2, color_stride);
+  if (settings->aovs_enabled) {
+    HdrImage_add_channel(&image, "albedo.R", albedo, 4);
+    HdrImage_add_channel(&image, "albedo.G", albedo + 1, 4);
+    HdrImage_add_channel(&image, "albedo.B", albedo + 2, 4);
+    HdrImage_add_channel(&image, "normal.X", normal, 4);
+    HdrImage_add_channel(&image, "normal.Y", normal + 1, 4);
+    HdrImage_add_channel(&image, "normal.Z", normal + 2, 4);
+    HdrImage_add_channel(&image, "Z", normal + 3, 4);
+  }
+
+  ImageSaver_write_hdr(image_saver, image,
+                       ImageFormat_from_path(settings->saved_image_path.str),
+                       settings->exr_half, settings->saved_image_path.str,
+                       AppState_str(app_state).str);
+}
+
+void AppState_save_checkpoint(const AppState *app_state,
+                              CheckpointWriter *checkpoint_writer,
+                              const Renderer *renderer) {
+  const WindowResolution resolution =
+      AppState_rendering_params(app_state).rendering_resolution;
+  // NOTE: the samples rendered at a reduced resolution are about to be
+  // thrown away anyway
+  if (!WindowResolution_eq(
+          resolution, app_state->settings.rendering_params.rendering_resolution))
+    return;
+
+  // NOTE: reading back waits for the GPU, but unlike writing the file it
+  // takes just a moment
+  Checkpoint checkpoint = Checkpoint_new(resolution);
+  checkpoint.frame_number = app_state->stats.frame_number;
+  checkpoint.seed_offset = Renderer_get_seed_offset(renderer);
+  checkpoint.settings_hash = Checkpoint_settings_hash(&app_state->settings);
+  Renderer_read_accumulation(renderer, checkpoint.accumulation);
+  Renderer_read_aovs(renderer, checkpoint.moments, checkpoint.albedo,
+                     checkpoint.normal);
+  CheckpointWriter_write(checkpoint_writer, checkpoint,
+                         app_state->settings.checkpoint_path.str);
+}
+
+void AppState_resume_from_checkpoint(AppState *app_state, Renderer *renderer) {
+  const char *path = app_state->settings.checkpoint_path.str;
+  if (!FilePath_exists(path)) {
+    printf("No checkpoint at '%s', starting from the beginning\n", path);
+    return;
+  }
+
+  Checkpoint checkpoint;
+  if (!Checkpoint_read(&checkpoint, path))
+    ERROR_FMT("Failed to read the checkpoint '%s'", path);
+  // NOTE: rendering anything else and then overwriting the checkpoint with it
+  // would lose all of the work it holds
+  if (checkpoint.settings_hash !=
+          Checkpoint_settings_hash(&app_state->settings) ||
+      !WindowResolution_eq(checkpoint.resolution,
+                           AppState_rendering_params(app_state)
+                               .rendering_resolution))
+    ERROR_FMT("The checkpoint '%s' was rendered with different settings or "
+              "a different scene",
+              path);
+
+  Renderer_write_accumulation(renderer, checkpoint.accumulation);
+  Renderer_write_aovs(renderer, checkpoint.moments, checkpoint.albedo,
+                      checkpoint.normal);
+  Renderer_set_seed_offset(renderer, checkpoint.seed_offset);
+  app_state->stats.frame_number = checkpoint.frame_number;
+  // NOTE: which pixels converged is only known after rendering another frame,
+  // until then adaptive sampling shouldn't consider the render finished
+  app_state->stats.sampled_pixels =
+      checkpoint.resolution.width * checkpoint.resolution.height;
+  // the time spent before the checkpoint isn't known, so it counts from now
+  StatsTimer_start(&app_state->stats.rendering);
+  printf("Resuming from the checkpoint '%s' at frame %u\n", path,
+         checkpoint.frame_number);
+  Checkpoint_delete(&checkpoint);
 }
 
 RenderingState AppState_get_rendering_state(const AppState *app_state) {
@@ -103,5 +360,12 @@ RenderingState AppState_get_rendering_state(const AppState *app_state) {
     return RenderingState_FINISHED;
   }
 
+  // with adaptive sampling there's nothing left to do once all pixels converge
+  if (app_state->settings.rendering_params.adaptive_threshold > 0 &&
+      app_state->stats.frame_number > 0 &&
+      app_state->stats.sampled_pixels == 0) {
+    return RenderingState_FINISHED;
+  }
+
   return RenderingState_RENDERING;
 }
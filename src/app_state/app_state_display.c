@@ -1,33 +1,143 @@
 #include "app_state_display.h"
 #include "opengl/gl_call.h"
+#include "utils/timer.h"
 #include "window.h"
 
+// how long to render for in between polling events when nothing is displayed,
+// short enough for the window to still respond
+#define NO_DISPLAY_INTERVAL_S 0.25
+#define MAX_FRAMES_PER_DISPLAY 1024
+
+static double display_interval(const AppState *app_state) {
+  if (!app_state->settings.display_enabled)
+    return NO_DISPLAY_INTERVAL_S;
+  return app_state->settings.display_interval_ms / 1000.0;
+}
+
+// renders frames_per_display frames or however many are left to render,
+// returns how many it rendered
+static uint32_t render_frames(AppState *app_state, Renderer *renderer) {
+  uint32_t frames = app_state->stats.frames_per_display;
+  const int32_t frames_to_render =
+      app_state->settings.rendering_params.frames_to_render;
+  if (frames_to_render >= 0 &&
+      (uint32_t)frames_to_render - app_state->stats.frame_number < frames)
+    frames = (uint32_t)frames_to_render - app_state->stats.frame_number;
+
+  Renderer_begin_measuring(renderer);
+  for (uint32_t i = 0; i < frames; ++i) {
+    Renderer_render_frame(renderer, app_state->stats.frame_number);
+    app_state->stats.frame_number++;
+  }
+  Renderer_end_measuring(renderer, frames);
+  // NOTE: reading it back waits for the GPU, so only the last frame's is
+  if (app_state->settings.rendering_params.adaptive_threshold > 0)
+    app_state->stats.sampled_pixels =
+        Renderer_get_sampled_pixels(renderer, app_state->stats.frame_number - 1);
+  return frames;
+}
+
+// updates the stats measured on the GPU once it's done with a measured batch
+// of frames, which is usually the one that was just waited for
+static void update_gpu_stats(AppState *app_state, Renderer *renderer) {
+  RendererGpuMeasurement measurement;
+  if (!Renderer_poll_measurement(renderer, &measurement) ||
+      measurement.frames == 0 || measurement.time_ns == 0)
+    return;
+
+  Stats *stats = &app_state->stats;
+  const double time = measurement.time_ns * 1e-9;
+  stats->gpu_frame_time = time / measurement.frames;
+  stats->rays_per_s = measurement.rays / time;
+  // NOTE: with adaptive sampling, the samples of the pixels that still get
+  // them are spread over the whole image
+  stats->sample_time =
+      measurement.samples > 0
+          ? time * measurement.pixels / (double)measurement.samples
+          : 0;
+}
+
+// picks how many frames to render before displaying the next one so that it
+// happens about every display interval, given how long the last ones took
+static void update_frames_per_display(AppState *app_state,
+                                      uint32_t frames_rendered) {
+  Stats *stats = &app_state->stats;
+  const double interval = display_interval(app_state);
+  const double frame_time =
+      stats->last_frame_rendering.total_time / frames_rendered;
+  if (interval <= 0 || frames_rendered == 0 || frame_time <= 0) {
+    stats->frames_per_display = 1;
+    return;
+  }
+
+  // NOTE: growing at most twice as large at a time, as frames could have
+  // gotten slower in the meantime (e.g. with a bigger resolution) and
+  // overshooting would make the window unresponsive for a while
+  double frames = interval / frame_time;
+  if (frames > 2.0 * stats->frames_per_display)
+    frames = 2.0 * stats->frames_per_display;
+  if (frames > MAX_FRAMES_PER_DISPLAY)
+    frames = MAX_FRAMES_PER_DISPLAY;
+  stats->frames_per_display = frames < 1 ? 1 : (uint32_t)frames;
+}
+
 // NOTE: renders everything that has to be rendered to the screen
 void AppState_render_and_display_frame(AppState *app_state, Renderer *renderer,
                                        GUIOverlay *gui, Window *window) {
+  Timer_begin("frame");
   RenderingState render_state = AppState_get_rendering_state(app_state);
-  GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+  uint32_t frames_rendered = 0;
+  // with display disabled the image is still displayed once it's finished,
+  // a headless window has nowhere to display it in
+  const bool display_image =
+      !window->headless &&
+      (render_state == RenderingState_FINISHED ||
+       (render_state == RenderingState_RENDERING &&
+        app_state->settings.display_enabled));
+  const bool swap =
+      display_image || (!window->headless && app_state->settings.gui_enabled);
+  if (swap)
+    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 
   if (render_state == RenderingState_RENDERING) {
     if (app_state->stats.frame_number == 0) {
       StatsTimer_start(&app_state->stats.rendering);
     }
     StatsTimer_start(&app_state->stats.last_frame_rendering);
-    Renderer_render_frame(renderer, app_state->stats.frame_number++);
+    Timer_begin("render");
+    frames_rendered = render_frames(app_state, renderer);
+    Timer_end();
   }
-  if (render_state == RenderingState_RENDERING ||
-      render_state == RenderingState_FINISHED) {
+  if (display_image) {
+    Timer_begin("display");
+    Renderer_resolve(renderer);
     Window_display_framebuffer(
         Renderer_get_fbo(renderer),
-        app_state->settings.rendering_params.rendering_resolution,
+        AppState_rendering_params(app_state).rendering_resolution,
         Window_get_framebuffer_size(window), app_state->settings.scaling_mode);
+    Timer_end();
   }
 
   GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-  if (app_state->settings.gui_enabled)
+  if (app_state->settings.gui_enabled) {
+    Timer_begin("gui");
     GUIOverlay_render_frame(gui);
+    Timer_end();
+  }
 
-  Window_swap_buffers(window);
+  // NOTE: the GPU's work only gets waited for here, so the scopes above only
+  // time how long it took to submit it
+  Timer_begin("gpu wait");
+  if (swap)
+    Window_swap_buffers(window);
+  else
+    GL_CALL(glFinish());
+  Timer_end();
   // NOTE: only at this point can we expect the frame to actually be rendered
   StatsTimer_stop(&app_state->stats.last_frame_rendering);
+  update_gpu_stats(app_state, renderer);
+
+  if (render_state == RenderingState_RENDERING)
+    update_frames_per_display(app_state, frames_rendered);
+  Timer_end();
 }
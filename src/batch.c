@@ -0,0 +1,177 @@
+#include "batch.h"
+#include "action.h"
+#include "asserts.h"
+#include "cli.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool BatchJob_parse(BatchJob *self, const char *line) {
+  *self = (BatchJob){0};
+  uint32_t len = 0;
+  const char *c = line;
+  while (true) {
+    while (isspace((unsigned char)*c))
+      ++c;
+    if (*c == '\0')
+      return true;
+    if (self->args_count == BATCH_JOB_MAX_ARGS)
+      return false;
+
+    self->_offsets[self->args_count++] = len;
+    const bool quoted = *c == '"';
+    if (quoted)
+      ++c;
+    while (*c != '\0' && (quoted ? *c != '"' : !isspace((unsigned char)*c))) {
+      // leaving space for the NUL
+      if (len + 1 >= sizeof(self->_args.str))
+        return false;
+      self->_args.str[len++] = *c++;
+    }
+    if (quoted) {
+      if (*c != '"')
+        return false;
+      ++c;
+    }
+    self->_args.str[len++] = '\0';
+  }
+}
+
+int BatchJob_argv(const BatchJob *self, const char *argv[BATCH_JOB_MAX_ARGS]) {
+  for (uint32_t i = 0; i < self->args_count; ++i)
+    argv[i] = self->_args.str + self->_offsets[i];
+  return self->args_count;
+}
+
+// sets app_state's settings to the ones of the job, with the camera being the
+// loaded scene's one unless the job sets it
+static void apply_job(const Batch *self, AppState *app_state,
+                      const BatchJob *job) {
+  const char *argv[BATCH_JOB_MAX_ARGS];
+  const int argc = BatchJob_argv(job, argv);
+  app_state->settings = self->base_settings;
+  app_state->settings.cam = app_state->scene.camera;
+  handle_job_args(argc, argv, app_state);
+  // every job's image gets saved, after which the next one starts
+  app_state->settings.save_after_rendering = true;
+  app_state->settings.exit_after_rendering = false;
+}
+
+// exits if the job's arguments are invalid or it wouldn't ever finish
+static void validate_job(const Batch *self, const BatchJob *job,
+                         const char *path) {
+  AppState app_state = AppState_default();
+  apply_job(self, &app_state, job);
+  if (!(app_state.pending_actions & Action_load_scene))
+    ERROR_FMT("%s:%u: A job requires a scene to be specified.\n", path,
+              job->line_number);
+  if (app_state.settings.rendering_params.frames_to_render <= 0)
+    ERROR_FMT("%s:%u: A job requires --frames-to-render to be a positive "
+              "value.\n",
+              path, job->line_number);
+  // NOTE: all of the jobs would end up sharing the same one
+  if (!SmallString_is_empty(&app_state.settings.checkpoint_path))
+    ERROR_FMT("%s:%u: Jobs can't be checkpointed.\n", path,
+              job->line_number);
+}
+
+// NOTE: with its newline and the NUL, so that its arguments fit in BatchJob
+#define MAX_LINE_LEN sizeof(SmallString)
+
+Batch Batch_read(const char *path, const Settings *base_settings) {
+  Batch self = {
+      .base_settings = *base_settings,
+      .scene_path = SmallString_new(""),
+      .bvh_strat = BVHStrategy__COUNT,
+  };
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    ERROR_FMT("Failed to open the job file '%s'", path);
+
+  char line[MAX_LINE_LEN];
+  uint32_t capacity = 0;
+  for (uint32_t line_number = 1; fgets(line, sizeof(line), f) != NULL;
+       ++line_number) {
+    const size_t len = strlen(line);
+    if (len == sizeof(line) - 1 && line[len - 1] != '\n')
+      ERROR_FMT("%s:%u: The line is too long", path, line_number);
+
+    const char *start = line;
+    while (isspace((unsigned char)*start))
+      ++start;
+    if (*start == '\0' || *start == '#')
+      continue;
+
+    if (self.jobs_count == capacity) {
+      capacity = capacity == 0 ? 16 : capacity * 2;
+      self.jobs = realloc(self.jobs, sizeof(BatchJob) * capacity);
+      ASSERTQ_CUSTOM(self.jobs != NULL, "Failed to allocate the jobs");
+    }
+    BatchJob *job = &self.jobs[self.jobs_count++];
+    if (!BatchJob_parse(job, start))
+      ERROR_FMT("%s:%u: Too many arguments or an unterminated quote", path,
+                line_number);
+    job->line_number = line_number;
+    validate_job(&self, job, path);
+  }
+  fclose(f);
+
+  printf("Read %u jobs from '%s'\n", self.jobs_count, path);
+  return self;
+}
+
+bool Batch_start_next_job(Batch *self, AppState *app_state) {
+  if (self->next == self->jobs_count)
+    return false;
+
+  StatsTimer_start(&self->job_timer);
+  const BatchJob *job = &self->jobs[self->next++];
+  apply_job(self, app_state, job);
+  app_state->pending_actions = 0;
+
+  const Settings *settings = &app_state->settings;
+  self->scene_loaded =
+      strcmp(self->scene_path.str, settings->scene_path.str) != 0 ||
+      self->bvh_strat != settings->BVH_build_strat;
+  if (self->scene_loaded) {
+    AppState_load_scene(app_state);
+    self->scene_path = settings->scene_path;
+    self->bvh_strat = settings->BVH_build_strat;
+    // NOTE: loading the scene replaced the camera with the scene's one,
+    // which the job's arguments can override
+    const Action pending_actions = app_state->pending_actions;
+    apply_job(self, app_state, job);
+    app_state->pending_actions = pending_actions;
+  }
+
+  // NOTE: jobs can render an animated scene at different times
+  app_state->pending_actions |= Action_update_ssbo_camera |
+                                Action_update_ssbo_renderer_parameters |
+                                Action_animate_scene | Action_restart_rendering;
+  printf("Starting job %u/%u: '%s'\n", self->next, self->jobs_count,
+         settings->saved_image_path.str);
+  return true;
+}
+
+void Batch_finish_job(Batch *self, const AppState *app_state) {
+  StatsTimer_stop(&self->job_timer);
+  const Stats *stats = &app_state->stats;
+  if (self->scene_loaded)
+    printf("Job %u/%u took %s: scene load %s, bvh build %s, rendering %s\n",
+           self->next, self->jobs_count,
+           Stats_fmt_time(self->job_timer.total_time).str,
+           Stats_fmt_time(stats->scene_load.total_time).str,
+           Stats_fmt_time(stats->bvh_build.total_time).str,
+           Stats_fmt_time(stats->rendering.total_time).str);
+  else
+    printf("Job %u/%u took %s: reused the scene, rendering %s\n", self->next,
+           self->jobs_count, Stats_fmt_time(self->job_timer.total_time).str,
+           Stats_fmt_time(stats->rendering.total_time).str);
+}
+
+void Batch_delete(Batch *self) {
+  free(self->jobs);
+  self->jobs = NULL;
+  self->jobs_count = 0;
+}
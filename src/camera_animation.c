@@ -0,0 +1,208 @@
+#include "camera_animation.h"
+#include "action.h"
+#include "asserts.h"
+#include "rad_deg.h"
+#include "scene/file_formats/gltf.h"
+#include "utils.h"
+#include "vec3d.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool CameraKeyframe_parse(CameraKeyframe *self, const char *line) {
+  float time_s, x, y, z;
+  double yaw_deg, pitch_deg;
+  int len = 0;
+  if (sscanf(line, "%g %g,%g,%g %lf,%lf%n", &time_s, &x, &y, &z, &yaw_deg,
+             &pitch_deg, &len) != 6)
+    return false;
+
+  const char *rest = line + len;
+  float fov_deg = 0;
+  if (sscanf(rest, "%g%n", &fov_deg, &len) == 1) {
+    if (fov_deg < CAMERA_FOV_MIN_DEG || fov_deg > CAMERA_FOV_MAX_DEG)
+      return false;
+    rest += len;
+  }
+  while (isspace((unsigned char)*rest))
+    ++rest;
+  if (*rest != '\0')
+    return false;
+  if (pitch_deg < CAMERA_PITCH_MIN_DEG || pitch_deg > CAMERA_PITCH_MAX_DEG)
+    return false;
+
+  double yaw_rad = fmod(deg_to_rad(yaw_deg), 2 * M_PI);
+  if (yaw_rad < 0)
+    yaw_rad += 2 * M_PI;
+  *self = (CameraKeyframe){
+      .time_s = time_s,
+      .pos = vec3_new(x, y, z),
+      .rotation = YawPitch_new(yaw_rad, deg_to_rad(pitch_deg)),
+      .fov_rad = deg_to_rad(fov_deg),
+  };
+  return true;
+}
+
+// NOTE: with its newline and the NUL
+#define MAX_LINE_LEN 256
+
+static CameraPath read_keyframe_file(const char *path) {
+  CameraPath self = {0};
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    ERROR_FMT("Failed to open the camera path '%s'", path);
+
+  char line[MAX_LINE_LEN];
+  uint32_t capacity = 0;
+  for (uint32_t line_number = 1; fgets(line, sizeof(line), f) != NULL;
+       ++line_number) {
+    const size_t len = strlen(line);
+    if (len == sizeof(line) - 1 && line[len - 1] != '\n')
+      ERROR_FMT("%s:%u: The line is too long", path, line_number);
+
+    const char *start = line;
+    while (isspace((unsigned char)*start))
+      ++start;
+    if (*start == '\0' || *start == '#')
+      continue;
+
+    if (self.keyframes_count == capacity) {
+      capacity = capacity == 0 ? 16 : capacity * 2;
+      self.keyframes =
+          realloc(self.keyframes, sizeof(CameraKeyframe) * capacity);
+      ASSERTQ_CUSTOM(self.keyframes != NULL, "Failed to allocate the keyframes");
+    }
+    CameraKeyframe *keyframe = &self.keyframes[self.keyframes_count];
+    if (!CameraKeyframe_parse(keyframe, start))
+      ERROR_FMT("%s:%u: Expected 'time x,y,z yaw,pitch [fov]' with pitch in "
+                "[%g, %g] and fov in [%g, %g]",
+                path, line_number, CAMERA_PITCH_MIN_DEG, CAMERA_PITCH_MAX_DEG,
+                CAMERA_FOV_MIN_DEG, CAMERA_FOV_MAX_DEG);
+
+    if (self.keyframes_count > 0) {
+      const CameraKeyframe *prev = keyframe - 1;
+      if (keyframe->time_s <= prev->time_s)
+        ERROR_FMT("%s:%u: Keyframes' times have to be increasing", path,
+                  line_number);
+      if (keyframe->fov_rad == 0)
+        keyframe->fov_rad = prev->fov_rad;
+    }
+    self.keyframes_count++;
+  }
+  fclose(f);
+  return self;
+}
+
+static bool is_gltf(const char *path) {
+  const char *ext = strrchr(FilePath_get_file_name(path), '.');
+  return ext && (strcmp(ext, ".gltf") == 0 || strcmp(ext, ".glb") == 0);
+}
+
+CameraPath CameraPath_read(const char *path) {
+  CameraPath self =
+      is_gltf(path) ? load_gltf_camera_path(path) : read_keyframe_file(path);
+  if (self.keyframes_count == 0)
+    ERROR_FMT("No keyframes in '%s'", path);
+  return self;
+}
+
+float CameraPath_duration(const CameraPath *self) {
+  return self->keyframes[self->keyframes_count - 1].time_s -
+         self->keyframes[0].time_s;
+}
+
+Camera CameraPath_sample(const CameraPath *self, float time_s, Camera base) {
+  // the keyframes in between which time_s is
+  uint32_t next = 0;
+  while (next < self->keyframes_count &&
+         self->keyframes[next].time_s <= time_s)
+    ++next;
+  const CameraKeyframe *a = &self->keyframes[next == 0 ? 0 : next - 1];
+  const CameraKeyframe *b =
+      &self->keyframes[next == self->keyframes_count ? next - 1 : next];
+  const float t = a == b ? 0 : (time_s - a->time_s) / (b->time_s - a->time_s);
+
+  double yaw_diff = b->rotation.yaw_rad - a->rotation.yaw_rad;
+  if (yaw_diff > M_PI)
+    yaw_diff -= 2 * M_PI;
+  else if (yaw_diff < -M_PI)
+    yaw_diff += 2 * M_PI;
+  double yaw = fmod(a->rotation.yaw_rad + yaw_diff * t, 2 * M_PI);
+  if (yaw < 0)
+    yaw += 2 * M_PI;
+  const double pitch =
+      a->rotation.pitch_rad + (b->rotation.pitch_rad - a->rotation.pitch_rad) * t;
+
+  const float fov_a = a->fov_rad != 0 ? a->fov_rad : base.fov_rad;
+  const float fov_b = b->fov_rad != 0 ? b->fov_rad : base.fov_rad;
+
+  base.pos = vec3_add(a->pos, vec3_mult(vec3_sub(b->pos, a->pos), t));
+  base.dir = Vec3d_to_vec3(YawPitch_to_dir(YawPitch_new(yaw, pitch)));
+  base.fov_rad = fov_a + (fov_b - fov_a) * t;
+  return base;
+}
+
+void CameraPath_delete(CameraPath *self) {
+  free(self->keyframes);
+  self->keyframes = NULL;
+  self->keyframes_count = 0;
+}
+
+CameraAnimation CameraAnimation_new(const char *path, float fps,
+                                    const char *output_path) {
+  ASSERTQ_CUSTOM(fps > 0, "fps has to be positive");
+  CameraAnimation self = {
+      .path = CameraPath_read(path),
+      .fps = fps,
+      .output_path = SmallString_new(output_path),
+      .frame_timer = StatsTimer_new(),
+  };
+  // NOTE: a frame that's only off by rounding errors shouldn't get dropped
+  self.frames_count =
+      (uint32_t)floor(CameraPath_duration(&self.path) * fps + 1e-3) + 1;
+  printf("Read %u keyframes from '%s', rendering %u frames at %g fps\n",
+         self.path.keyframes_count, path, self.frames_count, fps);
+  StatsTimer_start(&self.frame_timer);
+  return self;
+}
+
+void CameraAnimation_apply(const CameraAnimation *self, AppState *app_state) {
+  const float time_s = self->path.keyframes[0].time_s + self->frame / self->fps;
+  Settings *settings = &app_state->settings;
+  settings->cam = CameraPath_sample(&self->path, time_s, app_state->scene.camera);
+  if (!FilePath_with_number(settings->saved_image_path.str,
+                            sizeof(settings->saved_image_path.str),
+                            self->output_path.str, self->frame))
+    ERROR_FMT("The path of frame %u of '%s' is too long", self->frame,
+              self->output_path.str);
+  // every frame's image gets saved, after which the next one starts
+  settings->save_after_rendering = true;
+  settings->exit_after_rendering = false;
+  app_state->pending_actions |= Action_update_ssbo_camera;
+  // the scene's own animation plays along with the camera's one
+  if (GltfAnimation_is_loaded(&app_state->scene_animation)) {
+    settings->scene_time_s = time_s;
+    app_state->pending_actions |= Action_animate_scene;
+  }
+}
+
+bool CameraAnimation_next_frame(CameraAnimation *self, AppState *app_state) {
+  StatsTimer_stop(&self->frame_timer);
+  printf("Frame %u/%u took %s\n", self->frame + 1, self->frames_count,
+         Stats_fmt_time(self->frame_timer.total_time).str);
+  if (++self->frame == self->frames_count)
+    return false;
+
+  StatsTimer_start(&self->frame_timer);
+  CameraAnimation_apply(self, app_state);
+  // NOTE: even with reprojection enabled, as each frame gets the same number
+  // of its own samples
+  app_state->pending_actions |= Action_restart_rendering;
+  return true;
+}
+
+void CameraAnimation_delete(CameraAnimation *self) {
+  CameraPath_delete(&self->path);
+}
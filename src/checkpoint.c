@@ -0,0 +1,215 @@
+#include "checkpoint.h"
+#include "asserts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECKPOINT_MAGIC 0x4b435450 // "PTCK"
+#define CHECKPOINT_VERSION 1
+// how many checkpoints can wait to be written while another one is,
+// more of them would only get replaced by newer ones right away
+#define CHECKPOINT_QUEUED_WRITES 1
+
+typedef struct {
+  uint32_t magic, version;
+  uint32_t width, height;
+  uint32_t frame_number, seed_offset;
+  uint64_t settings_hash;
+} CheckpointHeader;
+
+// the checkpoint's buffers in the order they're stored in,
+// with the number of floats per pixel of each
+#define CHECKPOINT_BUFFERS_COUNT 4
+static const uint32_t buffer_floats[CHECKPOINT_BUFFERS_COUNT] = {4, 2, 4, 4};
+static float **buffer(Checkpoint *self, int i) {
+  float **buffers[CHECKPOINT_BUFFERS_COUNT] = {
+      &self->accumulation, &self->moments, &self->albedo, &self->normal};
+  return buffers[i];
+}
+
+static size_t buffer_len(const Checkpoint *self, int i) {
+  return (size_t)buffer_floats[i] * self->resolution.width *
+         self->resolution.height;
+}
+
+Checkpoint Checkpoint_new(WindowResolution resolution) {
+  Checkpoint self = {.resolution = resolution};
+  for (int i = 0; i < CHECKPOINT_BUFFERS_COUNT; ++i) {
+    *buffer(&self, i) = malloc(sizeof(float) * buffer_len(&self, i));
+    ASSERTQ_CUSTOM(*buffer(&self, i) != NULL,
+                   "Failed to allocate a checkpoint's buffers");
+  }
+  return self;
+}
+
+void Checkpoint_delete(Checkpoint *self) {
+  for (int i = 0; i < CHECKPOINT_BUFFERS_COUNT; ++i) {
+    free(*buffer(self, i));
+    *buffer(self, i) = NULL;
+  }
+}
+
+// FNV-1a
+#define HASH_OFFSET_BASIS 0xcbf29ce484222325ull
+#define HASH_PRIME 0x100000001b3ull
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len) {
+  const uint8_t *bytes = data;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= bytes[i];
+    hash *= HASH_PRIME;
+  }
+  return hash;
+}
+#define HASH(_hash, _value) hash_bytes(_hash, &(_value), sizeof(_value))
+
+static uint64_t hash_vec3(uint64_t hash, vec3 v) {
+  hash = HASH(hash, v.x);
+  hash = HASH(hash, v.y);
+  return HASH(hash, v.z);
+}
+
+uint64_t Checkpoint_settings_hash(const Settings *settings) {
+  uint64_t hash = HASH_OFFSET_BASIS;
+  hash = hash_bytes(hash, settings->scene_path.str,
+                    strlen(settings->scene_path.str));
+
+  // NOTE: hashing the fields one by one, as padding could be anything
+  const Camera *cam = &settings->cam;
+  hash = hash_vec3(hash, cam->pos);
+  hash = hash_vec3(hash, cam->dir);
+  hash = hash_vec3(hash, cam->up);
+  hash = HASH(hash, cam->fov_rad);
+
+  const RendererParameters *params = &settings->rendering_params;
+  hash = HASH(hash, params->env_color);
+  hash = HASH(hash, params->max_bounce_count);
+  hash = HASH(hash, params->samples_per_pixel);
+  hash = HASH(hash, params->diverge_strength);
+  hash = HASH(hash, params->rendering_resolution.width);
+  hash = HASH(hash, params->rendering_resolution.height);
+  hash = HASH(hash, params->russian_roulette_depth);
+  return HASH(hash, params->adaptive_threshold);
+}
+
+static bool write_file(const Checkpoint *self, FILE *f) {
+  const CheckpointHeader header = {
+      .magic = CHECKPOINT_MAGIC,
+      .version = CHECKPOINT_VERSION,
+      .width = self->resolution.width,
+      .height = self->resolution.height,
+      .frame_number = self->frame_number,
+      .seed_offset = self->seed_offset,
+      .settings_hash = self->settings_hash,
+  };
+  if (fwrite(&header, sizeof(header), 1, f) != 1)
+    return false;
+  const float *buffers[CHECKPOINT_BUFFERS_COUNT] = {
+      self->accumulation, self->moments, self->albedo, self->normal};
+  for (int i = 0; i < CHECKPOINT_BUFFERS_COUNT; ++i) {
+    const size_t len = buffer_len(self, i);
+    if (fwrite(buffers[i], sizeof(float), len, f) != len)
+      return false;
+  }
+  return true;
+}
+
+bool Checkpoint_write(const Checkpoint *self, const char *path) {
+  SmallString tmp_path;
+  if (snprintf(tmp_path.str, sizeof(tmp_path.str), "%s.tmp", path) >=
+      (int)sizeof(tmp_path.str))
+    return false;
+
+  FILE *f = fopen(tmp_path.str, "wb");
+  if (f == NULL)
+    return false;
+  const bool written = write_file(self, f);
+  if (fclose(f) != 0 || !written) {
+    remove(tmp_path.str);
+    return false;
+  }
+
+#ifdef _WIN32
+  // NOTE: rename doesn't replace existing files on Windows, so there is
+  // a moment without any checkpoint, though never with a broken one
+  remove(path);
+#endif
+  if (rename(tmp_path.str, path) != 0) {
+    remove(tmp_path.str);
+    return false;
+  }
+  return true;
+}
+
+bool Checkpoint_read(Checkpoint *self, const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return false;
+
+  CheckpointHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      header.magic != CHECKPOINT_MAGIC ||
+      header.version != CHECKPOINT_VERSION) {
+    fclose(f);
+    return false;
+  }
+
+  *self = Checkpoint_new(WindowResolution_new(header.width, header.height));
+  self->frame_number = header.frame_number;
+  self->seed_offset = header.seed_offset;
+  self->settings_hash = header.settings_hash;
+  bool ok = true;
+  for (int i = 0; i < CHECKPOINT_BUFFERS_COUNT && ok; ++i) {
+    const size_t len = buffer_len(self, i);
+    ok = fread(*buffer(self, i), sizeof(float), len, f) == len;
+  }
+  fclose(f);
+
+  if (!ok)
+    Checkpoint_delete(self);
+  return ok;
+}
+
+typedef struct {
+  Checkpoint checkpoint;
+  SmallString path;
+} CheckpointWrite;
+
+// NOTE: runs on the writer's thread
+static void write_checkpoint(void *ctx) {
+  CheckpointWrite *write = ctx;
+  if (Checkpoint_write(&write->checkpoint, write->path.str))
+    printf("Saved checkpoint of %u frames to '%s'\n",
+           write->checkpoint.frame_number, write->path.str);
+  else
+    fprintf(stderr, "Failed to save checkpoint to '%s'\n", write->path.str);
+
+  Checkpoint_delete(&write->checkpoint);
+  free(write);
+}
+
+CheckpointWriter CheckpointWriter_new(void) {
+  CheckpointWriter self = {
+      ._writer = WorkQueue_new(CHECKPOINT_QUEUED_WRITES),
+  };
+  StatsTimer_start(&self._since_last_write);
+  return self;
+}
+
+bool CheckpointWriter_due(const CheckpointWriter *self, double interval_s) {
+  return StatsTimer_elapsed(&self->_since_last_write) >= interval_s;
+}
+
+void CheckpointWriter_write(CheckpointWriter *self, Checkpoint checkpoint,
+                            const char *path) {
+  CheckpointWrite *write = malloc(sizeof(*write));
+  ASSERTQ_CUSTOM(write != NULL, "Failed to allocate a checkpoint write");
+  write->checkpoint = checkpoint;
+  write->path = SmallString_new(path);
+  // NOTE: waits if the previous checkpoint is still being written
+  WorkQueue_push(self->_writer, write_checkpoint, write);
+  StatsTimer_start(&self->_since_last_write);
+}
+
+void CheckpointWriter_delete(CheckpointWriter *self) {
+  WorkQueue_delete(self->_writer);
+}
@@ -2,6 +2,7 @@
 #include "action.h"
 #include "app_state.h"
 #include "asserts.h"
+#include "renderer/backend.h"
 #include "scene/bvh/strategies.h"
 #include "utils.h"
 #include "vec3.h"
@@ -172,6 +173,12 @@ SetOptionFn scene_bvh_type_set;
 GetDescFn scene_bvh_type_desc_fn;
 GetValueStrFn scene_bvh_type_value_str;
 
+#define scene_bvh_report_short NULL
+#define scene_bvh_report_long "--analyze-bvh"
+#define scene_bvh_report_desc "Print the SAH cost, depth and leaf size histograms, overlap and traversal work per ray of every built BVH"
+GetHelpLineFn scene_bvh_report_help_line;
+SetOptionFn scene_bvh_report_set;
+
 // === CAMERA ===
 #define camera_position_short NULL
 #define camera_position_long "--pos"
@@ -208,6 +215,19 @@ GetHelpLineFn camera_sensitivity_help_line;
 SetOptionFn camera_sensitivity_set;
 GetValueStrFn camera_sensitivity_value_str;
 
+#define camera_reprojection_short NULL
+#define camera_reprojection_long "--reprojection"
+#define camera_reprojection_desc "Keep the samples that are still visible after the camera moves instead of starting over"
+GetHelpLineFn camera_reprojection_help_line;
+SetOptionFn camera_reprojection_set;
+
+#define camera_dynamic_resolution_short NULL
+#define camera_dynamic_resolution_long "--dynamic-resolution"
+#define camera_dynamic_resolution_desc "Frame time in ms to aim for by lowering the resolution while the camera moves, 0 disables it"
+GetHelpLineFn camera_dynamic_resolution_help_line;
+SetOptionFn camera_dynamic_resolution_set;
+GetValueStrFn camera_dynamic_resolution_value_str;
+
 // === RENDERING ===
 #define rendering_env_color_short NULL
 #define rendering_env_color_long "--env-color"
@@ -223,6 +243,13 @@ GetHelpLineFn rendering_max_bounce_count_help_line;
 SetOptionFn rendering_max_bounce_count_set;
 GetValueStrFn rendering_max_bounce_count_value_str;
 
+#define rendering_russian_roulette_depth_short NULL
+#define rendering_russian_roulette_depth_long "--russian-roulette-depth"
+#define rendering_russian_roulette_depth_desc "Bounces after which paths can be terminated by russian roulette"
+GetHelpLineFn rendering_russian_roulette_depth_help_line;
+SetOptionFn rendering_russian_roulette_depth_set;
+GetValueStrFn rendering_russian_roulette_depth_value_str;
+
 #define rendering_samples_per_pixel_short "-spp"
 #define rendering_samples_per_pixel_long "--samples-per-pixel"
 #define rendering_samples_per_pixel_desc "Samples per pixel"
@@ -244,6 +271,13 @@ GetHelpLineFn rendering_frames_to_render_help_line;
 SetOptionFn rendering_frames_to_render_set;
 GetValueStrFn rendering_frames_to_render_value_str;
 
+#define rendering_adaptive_threshold_short NULL
+#define rendering_adaptive_threshold_long "--adaptive-threshold"
+#define rendering_adaptive_threshold_desc "Relative error at which pixels stop being sampled and rendering can finish, 0 disables it"
+GetHelpLineFn rendering_adaptive_threshold_help_line;
+SetOptionFn rendering_adaptive_threshold_set;
+GetValueStrFn rendering_adaptive_threshold_value_str;
+
 #define rendering_resolution_short "-R"
 #define rendering_resolution_long "--resolution"
 #define rendering_resolution_desc "Rendering resolution"
@@ -251,6 +285,53 @@ GetHelpLineFn rendering_resolution_help_line;
 SetOptionFn rendering_resolution_set;
 GetValueStrFn rendering_resolution_value_str;
 
+#define rendering_backend_short NULL
+#define rendering_backend_long "--backend"
+GetDescFn rendering_backend_desc_fn;
+GetHelpLineFn rendering_backend_help_line;
+SetOptionFn rendering_backend_set;
+GetValueStrFn rendering_backend_value_str;
+
+#define rendering_tile_size_short NULL
+#define rendering_tile_size_long "--tile-size"
+#define rendering_tile_size_desc "Compute workgroup size, a tile of this size gets rendered by each workgroup"
+GetHelpLineFn rendering_tile_size_help_line;
+SetOptionFn rendering_tile_size_set;
+GetValueStrFn rendering_tile_size_value_str;
+
+#define rendering_persistent_workgroups_short NULL
+#define rendering_persistent_workgroups_long "--persistent-workgroups"
+#define rendering_persistent_workgroups_desc "Number of workgroups dispatched by the Persistent backend"
+GetHelpLineFn rendering_persistent_workgroups_help_line;
+SetOptionFn rendering_persistent_workgroups_set;
+GetValueStrFn rendering_persistent_workgroups_value_str;
+
+// === DISTRIBUTED ===
+#define distributed_coordinator_short NULL
+#define distributed_coordinator_long "--coordinator"
+#define distributed_coordinator_desc "Hand out frames to workers connecting to ADDRESS (socket path or HOST:PORT) and merge their results"
+GetHelpLineFn distributed_coordinator_help_line;
+SetOptionFn distributed_coordinator_set;
+
+#define distributed_worker_short NULL
+#define distributed_worker_long "--worker"
+#define distributed_worker_desc "Render frames for a coordinator at ADDRESS (socket path or HOST:PORT)"
+GetHelpLineFn distributed_worker_help_line;
+SetOptionFn distributed_worker_set;
+
+#define distributed_serve_short NULL
+#define distributed_serve_long "--serve"
+#define distributed_serve_desc "Render requests of clients connecting to ADDRESS (socket path or HOST:PORT), keeping their scenes loaded"
+GetHelpLineFn distributed_serve_help_line;
+SetOptionFn distributed_serve_set;
+
+#define distributed_frames_per_job_short NULL
+#define distributed_frames_per_job_long "--frames-per-job"
+#define distributed_frames_per_job_desc "Number of frames the coordinator hands out to a worker at once"
+GetHelpLineFn distributed_frames_per_job_help_line;
+SetOptionFn distributed_frames_per_job_set;
+GetValueStrFn distributed_frames_per_job_value_str;
+
 // === MISC ===
 #define misc_scaling_short NULL
 #define misc_scaling_long "--scaling"
@@ -280,6 +361,27 @@ GetHelpLineFn misc_no_gui_help_line;
 SetOptionFn misc_no_gui_set;
 GetValueStrFn misc_no_gui_value_str;
 
+#define misc_no_display_short NULL
+#define misc_no_display_long "--no-display"
+#define misc_no_display_desc "Don't display anything until rendering finishes"
+GetHelpLineFn misc_no_display_help_line;
+SetOptionFn misc_no_display_set;
+GetValueStrFn misc_no_display_value_str;
+
+#define misc_display_interval_short NULL
+#define misc_display_interval_long "--display-interval"
+#define misc_display_interval_desc "Milliseconds in between displayed frames, rendering as many as fit in between, 0 displays every frame"
+GetHelpLineFn misc_display_interval_help_line;
+SetOptionFn misc_display_interval_set;
+GetValueStrFn misc_display_interval_value_str;
+
+#define misc_headless_short NULL
+#define misc_headless_long "--headless"
+#define misc_headless_desc "Render offscreen without a window or display server, implies --no-gui --no-movement --no-display -X --save-after-rendering"
+GetHelpLineFn misc_headless_help_line;
+SetOptionFn misc_headless_set;
+GetValueStrFn misc_headless_value_str;
+
 #define misc_save_on_frame_short NULL
 #define misc_save_on_frame_long "--save-after-rendering"
 #define misc_save_on_frame_desc "Automatically save rendered image to PNG"
@@ -289,18 +391,100 @@ GetValueStrFn misc_save_on_frame_value_str;
 
 #define misc_just_render_short "-J"
 #define misc_just_render_long "--just-render"
-#define misc_just_render_desc "Alias for --no-gui --no-hot-reload --no-movement --save-after-rendering --exit-after-rendering"
+#define misc_just_render_desc "Alias for --no-gui --no-hot-reload --no-movement --no-display --save-after-rendering --exit-after-rendering"
 GetHelpLineFn misc_just_render_help_line;
 SetOptionFn misc_just_render_set;
 GetValueStrFn misc_just_render_value_str;
 
 #define misc_output_path_short "-o"
 #define misc_output_path_long "--out"
-#define misc_output_path_desc "Output image path"
+#define misc_output_path_desc "Output image path, .exr and .pfm save HDR images"
 GetHelpLineFn misc_output_path_help_line;
 SetOptionFn misc_output_path_set;
 GetValueStrFn misc_output_path_value_str;
 
+#define misc_denoise_short "-D"
+#define misc_denoise_long "--denoise"
+#define misc_denoise_desc "Denoise the image on the CPU before saving it"
+GetHelpLineFn misc_denoise_help_line;
+SetOptionFn misc_denoise_set;
+
+#define misc_aovs_short NULL
+#define misc_aovs_long "--aovs"
+#define misc_aovs_desc "Also save the first hit's albedo, normal and depth as layers of EXR images"
+GetHelpLineFn misc_aovs_help_line;
+SetOptionFn misc_aovs_set;
+GetValueStrFn misc_aovs_value_str;
+
+#define misc_exr_half_short NULL
+#define misc_exr_half_long "--exr-half"
+#define misc_exr_half_desc "Store EXR images' channels as 16 bit halfs instead of 32 bit floats"
+GetHelpLineFn misc_exr_half_help_line;
+SetOptionFn misc_exr_half_set;
+GetValueStrFn misc_exr_half_value_str;
+
+#define misc_checkpoint_short NULL
+#define misc_checkpoint_long "--checkpoint-path"
+#define misc_checkpoint_desc "Periodically save the rendering progress to this file, see --resume"
+GetHelpLineFn misc_checkpoint_help_line;
+SetOptionFn misc_checkpoint_set;
+GetValueStrFn misc_checkpoint_value_str;
+
+#define misc_checkpoint_interval_short NULL
+#define misc_checkpoint_interval_long "--checkpoint-interval"
+#define misc_checkpoint_interval_desc "Seconds in between checkpoints"
+GetHelpLineFn misc_checkpoint_interval_help_line;
+SetOptionFn misc_checkpoint_interval_set;
+GetValueStrFn misc_checkpoint_interval_value_str;
+
+#define misc_resume_short NULL
+#define misc_resume_long "--resume"
+#define misc_resume_desc "Continue rendering from the --checkpoint-path file if it exists"
+GetHelpLineFn misc_resume_help_line;
+SetOptionFn misc_resume_set;
+GetValueStrFn misc_resume_value_str;
+
+#define misc_jobs_short NULL
+#define misc_jobs_long "--jobs"
+#define misc_jobs_desc "Render every line of this file, each with the same arguments as on the command line, in one process"
+GetHelpLineFn misc_jobs_help_line;
+SetOptionFn misc_jobs_set;
+GetValueStrFn misc_jobs_value_str;
+
+#define misc_camera_path_short NULL
+#define misc_camera_path_long "--camera-path"
+#define misc_camera_path_desc "Render this keyframe file's or glTF file's camera animation, saving frames with their numbers appended to --out"
+GetHelpLineFn misc_camera_path_help_line;
+SetOptionFn misc_camera_path_set;
+GetValueStrFn misc_camera_path_value_str;
+
+#define misc_fps_short NULL
+#define misc_fps_long "--fps"
+#define misc_fps_desc "Frames per second of the camera animation, each rendered with --frames-to-render samples per pixel"
+GetHelpLineFn misc_fps_help_line;
+SetOptionFn misc_fps_set;
+GetValueStrFn misc_fps_value_str;
+
+#define misc_time_short NULL
+#define misc_time_long "--time"
+#define misc_time_desc "Time in seconds at which to render the scene's glTF animation, with --camera-path it follows the camera's"
+GetHelpLineFn misc_time_help_line;
+SetOptionFn misc_time_set;
+GetValueStrFn misc_time_value_str;
+
+#define misc_trace_short NULL
+#define misc_trace_long "--trace"
+#define misc_trace_desc "Write a Chrome trace (chrome://tracing, ui.perfetto.dev) of loading, building and rendering here on exit"
+GetHelpLineFn misc_trace_help_line;
+SetOptionFn misc_trace_set;
+GetValueStrFn misc_trace_value_str;
+
+#define misc_print_timings_short NULL
+#define misc_print_timings_long "--print-timings"
+#define misc_print_timings_desc "Print the count, min, mean, p50 and p99 of the loading, building and rendering times on exit"
+GetHelpLineFn misc_print_timings_help_line;
+SetOptionFn misc_print_timings_set;
+
 #define misc_exit_after_rendering_short "-X"
 #define misc_exit_after_rendering_long "--exit-after-rendering"
 #define misc_exit_after_rendering_desc "Exit application after rendering is finished"
@@ -317,10 +501,10 @@ GetValueStrFn help_value_str;
 
 // NOTE: maybe a bit wasteful for each option to contain a prefix but makes it much easier for a human to comprehend what's going on
 // removing it wouldn't even allow for other prefixes on different platform as they would look like /very-long-option which ig is awkward
-const char *options_short[] = {scene_bvh_type_short, camera_position_short, camera_rotation_short, camera_fov_short, camera_movement_speed_short, camera_sensitivity_short, rendering_env_color_short, rendering_max_bounce_count_short, rendering_samples_per_pixel_short, rendering_diverge_strength_short, rendering_frames_to_render_short, rendering_resolution_short, misc_scaling_short, misc_no_movement_short, misc_no_hot_reload_short, misc_no_gui_short, misc_save_on_frame_short, misc_just_render_short, misc_output_path_short, misc_exit_after_rendering_short, help_short};
-const char *options_long[] = {scene_bvh_type_long, camera_position_long, camera_rotation_long, camera_fov_long, camera_movement_speed_long, camera_sensitivity_long, rendering_env_color_long, rendering_max_bounce_count_long, rendering_samples_per_pixel_long, rendering_diverge_strength_long, rendering_frames_to_render_long, rendering_resolution_long, misc_scaling_long, misc_no_movement_long, misc_no_hot_reload_long, misc_no_gui_long, misc_save_on_frame_long, misc_just_render_long, misc_output_path_long, misc_exit_after_rendering_long, help_long};
-GetHelpLineFn *options_help_line[] = {scene_bvh_type_help_line, camera_position_help_line, camera_rotation_help_line, camera_fov_help_line, camera_movement_speed_help_line, camera_sensitivity_help_line, rendering_env_color_help_line, rendering_max_bounce_count_help_line, rendering_samples_per_pixel_help_line, rendering_diverge_strength_help_line, rendering_frames_to_render_help_line, rendering_resolution_help_line, misc_scaling_help_line, misc_no_movement_help_line, misc_no_hot_reload_help_line, misc_no_gui_help_line, misc_save_on_frame_help_line, misc_just_render_help_line, misc_output_path_help_line, misc_exit_after_rendering_help_line, help_help_line};
-SetOptionFn *options_set[] = {scene_bvh_type_set, camera_position_set, camera_rotation_set, camera_fov_set, camera_movement_speed_set, camera_sensitivity_set, rendering_env_color_set, rendering_max_bounce_count_set, rendering_samples_per_pixel_set, rendering_diverge_strength_set, rendering_frames_to_render_set, rendering_resolution_set, misc_scaling_set, misc_no_movement_set, misc_no_hot_reload_set, misc_no_gui_set, misc_save_on_frame_set, misc_just_render_set, misc_output_path_set, misc_exit_after_rendering_set, help_set};
+const char *options_short[] = {scene_bvh_type_short, scene_bvh_report_short, camera_position_short, camera_rotation_short, camera_fov_short, camera_movement_speed_short, camera_sensitivity_short, camera_reprojection_short, camera_dynamic_resolution_short, rendering_env_color_short, rendering_max_bounce_count_short, rendering_russian_roulette_depth_short, rendering_samples_per_pixel_short, rendering_diverge_strength_short, rendering_frames_to_render_short, rendering_adaptive_threshold_short, rendering_resolution_short, rendering_backend_short, rendering_tile_size_short, rendering_persistent_workgroups_short, distributed_coordinator_short, distributed_worker_short, distributed_serve_short, distributed_frames_per_job_short, misc_scaling_short, misc_no_movement_short, misc_no_hot_reload_short, misc_no_gui_short, misc_no_display_short, misc_display_interval_short, misc_headless_short, misc_save_on_frame_short, misc_just_render_short, misc_output_path_short, misc_denoise_short, misc_aovs_short, misc_exr_half_short, misc_checkpoint_short, misc_checkpoint_interval_short, misc_resume_short, misc_jobs_short, misc_camera_path_short, misc_fps_short, misc_time_short, misc_trace_short, misc_print_timings_short, misc_exit_after_rendering_short, help_short};
+const char *options_long[] = {scene_bvh_type_long, scene_bvh_report_long, camera_position_long, camera_rotation_long, camera_fov_long, camera_movement_speed_long, camera_sensitivity_long, camera_reprojection_long, camera_dynamic_resolution_long, rendering_env_color_long, rendering_max_bounce_count_long, rendering_russian_roulette_depth_long, rendering_samples_per_pixel_long, rendering_diverge_strength_long, rendering_frames_to_render_long, rendering_adaptive_threshold_long, rendering_resolution_long, rendering_backend_long, rendering_tile_size_long, rendering_persistent_workgroups_long, distributed_coordinator_long, distributed_worker_long, distributed_serve_long, distributed_frames_per_job_long, misc_scaling_long, misc_no_movement_long, misc_no_hot_reload_long, misc_no_gui_long, misc_no_display_long, misc_display_interval_long, misc_headless_long, misc_save_on_frame_long, misc_just_render_long, misc_output_path_long, misc_denoise_long, misc_aovs_long, misc_exr_half_long, misc_checkpoint_long, misc_checkpoint_interval_long, misc_resume_long, misc_jobs_long, misc_camera_path_long, misc_fps_long, misc_time_long, misc_trace_long, misc_print_timings_long, misc_exit_after_rendering_long, help_long};
+GetHelpLineFn *options_help_line[] = {scene_bvh_type_help_line, scene_bvh_report_help_line, camera_position_help_line, camera_rotation_help_line, camera_fov_help_line, camera_movement_speed_help_line, camera_sensitivity_help_line, camera_reprojection_help_line, camera_dynamic_resolution_help_line, rendering_env_color_help_line, rendering_max_bounce_count_help_line, rendering_russian_roulette_depth_help_line, rendering_samples_per_pixel_help_line, rendering_diverge_strength_help_line, rendering_frames_to_render_help_line, rendering_adaptive_threshold_help_line, rendering_resolution_help_line, rendering_backend_help_line, rendering_tile_size_help_line, rendering_persistent_workgroups_help_line, distributed_coordinator_help_line, distributed_worker_help_line, distributed_serve_help_line, distributed_frames_per_job_help_line, misc_scaling_help_line, misc_no_movement_help_line, misc_no_hot_reload_help_line, misc_no_gui_help_line, misc_no_display_help_line, misc_display_interval_help_line, misc_headless_help_line, misc_save_on_frame_help_line, misc_just_render_help_line, misc_output_path_help_line, misc_denoise_help_line, misc_aovs_help_line, misc_exr_half_help_line, misc_checkpoint_help_line, misc_checkpoint_interval_help_line, misc_resume_help_line, misc_jobs_help_line, misc_camera_path_help_line, misc_fps_help_line, misc_time_help_line, misc_trace_help_line, misc_print_timings_help_line, misc_exit_after_rendering_help_line, help_help_line};
+SetOptionFn *options_set[] = {scene_bvh_type_set, scene_bvh_report_set, camera_position_set, camera_rotation_set, camera_fov_set, camera_movement_speed_set, camera_sensitivity_set, camera_reprojection_set, camera_dynamic_resolution_set, rendering_env_color_set, rendering_max_bounce_count_set, rendering_russian_roulette_depth_set, rendering_samples_per_pixel_set, rendering_diverge_strength_set, rendering_frames_to_render_set, rendering_adaptive_threshold_set, rendering_resolution_set, rendering_backend_set, rendering_tile_size_set, rendering_persistent_workgroups_set, distributed_coordinator_set, distributed_worker_set, distributed_serve_set, distributed_frames_per_job_set, misc_scaling_set, misc_no_movement_set, misc_no_hot_reload_set, misc_no_gui_set, misc_no_display_set, misc_display_interval_set, misc_headless_set, misc_save_on_frame_set, misc_just_render_set, misc_output_path_set, misc_denoise_set, misc_aovs_set, misc_exr_half_set, misc_checkpoint_set, misc_checkpoint_interval_set, misc_resume_set, misc_jobs_set, misc_camera_path_set, misc_fps_set, misc_time_set, misc_trace_set, misc_print_timings_set, misc_exit_after_rendering_set, help_set};
 
 #define count(_arr) (sizeof(_arr) / sizeof(*_arr))
 #define options_count count(options_short)
@@ -359,6 +543,18 @@ void scene_bvh_type_set(AppState *app_state, int argc, const char **argv, int *i
   app_state->settings.BVH_build_strat = bvh_type_res;
 }
 
+HelpLine scene_bvh_report_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = scene_bvh_report_short, .long_name = scene_bvh_report_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, scene_bvh_report_desc, sizeof(help_line.description));
+  return help_line;
+}
+void scene_bvh_report_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.bvh_report = true;
+}
+
 // TODO: SIMPLIFY some of the implementations
 
 // NOTE: formatting has to be done on per setting basis and not delegated to sth like vec3_str to ensure that the user can understand
@@ -431,6 +627,31 @@ void camera_sensitivity_set(AppState *app_state, int argc, const char **argv, in
   app_state->settings.cam.sensitivity = get_value_float(argc, argv, iargv);
 }
 
+HelpLine camera_reprojection_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = camera_reprojection_short, .long_name = camera_reprojection_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, camera_reprojection_desc, sizeof(help_line.description));
+  return help_line;
+}
+void camera_reprojection_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.reprojection_enabled = true;
+}
+
+void camera_dynamic_resolution_value_str(char *buf, const AppState *app_state){
+  sprintf(buf, "%.6g", app_state->settings.dynamic_resolution_target_ms);
+}
+HelpLine camera_dynamic_resolution_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = camera_dynamic_resolution_short, .long_name = camera_dynamic_resolution_long};
+  strncpy(help_line.description, camera_dynamic_resolution_desc, sizeof(help_line.description));
+  camera_dynamic_resolution_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void camera_dynamic_resolution_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.dynamic_resolution_target_ms = get_value_float(argc, argv, iargv);
+}
+
 // === RENDERING ===
 void rendering_env_color_value_str(char *buf, const AppState *app_state){
   format_vec3(buf, vec3_from_float3(app_state->settings.rendering_params.env_color));
@@ -463,6 +684,20 @@ void rendering_max_bounce_count_set(AppState *app_state, int argc, const char **
   app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
 }
 
+void rendering_russian_roulette_depth_value_str(char *buf, const AppState *app_state){
+  format_int(buf, app_state->settings.rendering_params.russian_roulette_depth);
+}
+HelpLine rendering_russian_roulette_depth_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = rendering_russian_roulette_depth_short, .long_name = rendering_russian_roulette_depth_long};
+  strncpy(help_line.description, rendering_russian_roulette_depth_desc, sizeof(help_line.description));
+  rendering_russian_roulette_depth_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void rendering_russian_roulette_depth_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.rendering_params.russian_roulette_depth = get_value_int(argc, argv, iargv);
+  app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
+}
+
 void rendering_samples_per_pixel_value_str(char *buf, const AppState *app_state){
   format_int(buf, app_state->settings.rendering_params.samples_per_pixel);
 }
@@ -507,6 +742,20 @@ void rendering_frames_to_render_set(AppState *app_state, int argc, const char **
   app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
 }
 
+void rendering_adaptive_threshold_value_str(char *buf, const AppState *app_state){
+  sprintf(buf, "%.6g", app_state->settings.rendering_params.adaptive_threshold);
+}
+HelpLine rendering_adaptive_threshold_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = rendering_adaptive_threshold_short, .long_name = rendering_adaptive_threshold_long};
+  strncpy(help_line.description, rendering_adaptive_threshold_desc, sizeof(help_line.description));
+  rendering_adaptive_threshold_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void rendering_adaptive_threshold_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.rendering_params.adaptive_threshold = get_value_float(argc, argv, iargv);
+  app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
+}
+
 void rendering_resolution_value_str(char *buf, const AppState *app_state){
   format_WindowResolution(buf, app_state->settings.rendering_params.rendering_resolution);
 }
@@ -521,6 +770,130 @@ void rendering_resolution_set(AppState *app_state, int argc, const char **argv,
   app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
 }
 
+void rendering_backend_desc_fn(char *buf) {
+  const char desc[] = "How the frames should be rendered, choose from: ";
+  memcpy(buf, desc, sizeof(desc));
+  StringArray_join(buf + sizeof(desc) - 1, RendererBackend_str, RendererBackend__COUNT, ", ");
+}
+void rendering_backend_value_str(char *buf, const AppState *app_state) {
+  strcpy(buf, RendererBackend_str[app_state->settings.rendering_params.backend]);
+}
+HelpLine rendering_backend_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = rendering_backend_short, .long_name = rendering_backend_long};
+  rendering_backend_value_str(help_line.default_value, app_state);
+  rendering_backend_desc_fn(help_line.description);
+  return help_line;
+}
+void rendering_backend_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *arg = argv[*iargv];
+  const char *val = get_value_for_option(argc, argv, iargv);
+
+  const int backend_res = StringArray_find_closest_match(val, strlen(val), RendererBackend_str, RendererBackend__COUNT);
+  if (backend_res == StringArray_find_closest_match_none)
+    ERROR_FMT("Invalid value '%s' for option %s", val, arg);
+  else if (backend_res == StringArray_find_closest_match_ambiguous)
+    ERROR_FMT("Ambiguous value '%s' for option %s", val, arg);
+
+  app_state->settings.rendering_params.backend = backend_res;
+  app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
+}
+
+void rendering_tile_size_value_str(char *buf, const AppState *app_state){
+  const RendererParameters *params = &app_state->settings.rendering_params;
+  format_WindowResolution(buf, WindowResolution_new(params->tile_width, params->tile_height));
+}
+HelpLine rendering_tile_size_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = rendering_tile_size_short, .long_name = rendering_tile_size_long};
+  strncpy(help_line.description, rendering_tile_size_desc, sizeof(help_line.description));
+  rendering_tile_size_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void rendering_tile_size_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  // NOTE: has the same WIDTHxHEIGHT format as a resolution
+  const WindowResolution tile_size = get_value_WindowResolution(argc, argv, iargv);
+  app_state->settings.rendering_params.tile_width = tile_size.width;
+  app_state->settings.rendering_params.tile_height = tile_size.height;
+  app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
+}
+
+void rendering_persistent_workgroups_value_str(char *buf, const AppState *app_state){
+  format_int(buf, app_state->settings.rendering_params.persistent_workgroups);
+}
+HelpLine rendering_persistent_workgroups_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = rendering_persistent_workgroups_short, .long_name = rendering_persistent_workgroups_long};
+  strncpy(help_line.description, rendering_persistent_workgroups_desc, sizeof(help_line.description));
+  rendering_persistent_workgroups_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void rendering_persistent_workgroups_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *arg = argv[*iargv];
+  const int workgroups = get_value_int(argc, argv, iargv);
+  if (workgroups <= 0)
+    ERROR_FMT("Option %s requires a positive value", arg);
+  app_state->settings.rendering_params.persistent_workgroups = workgroups;
+  app_state->pending_actions |= Action_update_ssbo_renderer_parameters;
+}
+
+// === DISTRIBUTED ===
+static void set_distributed_role(AppState *app_state, DistributedRole role, int argc, const char **argv, int *iargv) {
+  const char *arg = argv[*iargv];
+  const char *val = get_value_for_option(argc, argv, iargv);
+  if (app_state->settings.distributed_role != DistributedRole_NONE)
+    ERROR_FMT("Option %s can't be combined with --coordinator, --worker or --serve", arg);
+
+  app_state->settings.distributed_role = role;
+  app_state->settings.distributed_address = SmallString_new(val);
+}
+
+HelpLine distributed_coordinator_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = distributed_coordinator_short, .long_name = distributed_coordinator_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, distributed_coordinator_desc, sizeof(help_line.description));
+  return help_line;
+}
+void distributed_coordinator_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  set_distributed_role(app_state, DistributedRole_COORDINATOR, argc, argv, iargv);
+}
+
+HelpLine distributed_worker_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = distributed_worker_short, .long_name = distributed_worker_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, distributed_worker_desc, sizeof(help_line.description));
+  return help_line;
+}
+void distributed_worker_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  set_distributed_role(app_state, DistributedRole_WORKER, argc, argv, iargv);
+}
+
+HelpLine distributed_serve_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = distributed_serve_short, .long_name = distributed_serve_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, distributed_serve_desc, sizeof(help_line.description));
+  return help_line;
+}
+void distributed_serve_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  set_distributed_role(app_state, DistributedRole_SERVER, argc, argv, iargv);
+}
+
+void distributed_frames_per_job_value_str(char *buf, const AppState *app_state) {
+  format_int(buf, app_state->settings.frames_per_job);
+}
+HelpLine distributed_frames_per_job_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = distributed_frames_per_job_short, .long_name = distributed_frames_per_job_long};
+  strncpy(help_line.description, distributed_frames_per_job_desc, sizeof(help_line.description));
+  distributed_frames_per_job_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void distributed_frames_per_job_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *arg = argv[*iargv];
+  app_state->settings.frames_per_job = get_value_int(argc, argv, iargv);
+  if (app_state->settings.frames_per_job <= 0)
+    ERROR_FMT("Option %s requires a positive value", arg);
+}
+
 // === MISC ===
 // TODO: do we want a gui scale setting to be available from the CLI too?
 void misc_scaling_desc_fn(char *buf) {
@@ -581,6 +954,49 @@ void misc_no_gui_set(AppState *app_state, int argc, const char **argv, int *iarg
   app_state->settings.gui_enabled = false;
 }
 
+HelpLine misc_no_display_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_no_display_short, .long_name = misc_no_display_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_no_display_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_no_display_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.display_enabled = false;
+}
+
+void misc_display_interval_value_str(char *buf, const AppState *app_state){
+  sprintf(buf, "%.6g", app_state->settings.display_interval_ms);
+}
+HelpLine misc_display_interval_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_display_interval_short, .long_name = misc_display_interval_long};
+  strncpy(help_line.description, misc_display_interval_desc, sizeof(help_line.description));
+  misc_display_interval_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void misc_display_interval_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.display_interval_ms = get_value_float(argc, argv, iargv);
+}
+
+HelpLine misc_headless_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_headless_short, .long_name = misc_headless_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_headless_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_headless_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.headless = true;
+  app_state->settings.gui_enabled = false;
+  app_state->settings.movement_enabled = false;
+  app_state->settings.display_enabled = false;
+  // NOTE: nothing could close the application or save the image otherwise
+  app_state->settings.save_after_rendering = true;
+  app_state->settings.exit_after_rendering = true;
+}
+
 HelpLine misc_save_on_frame_help_line(const AppState *app_state) {
   UNUSED(app_state);
   HelpLine help_line = {.short_name = misc_save_on_frame_short, .long_name = misc_save_on_frame_long};
@@ -605,6 +1021,7 @@ void misc_just_render_set(AppState *app_state, int argc, const char **argv, int
   app_state->settings.gui_enabled = false;
   app_state->settings.hot_reload_enabled = false;
   app_state->settings.movement_enabled = false;
+  app_state->settings.display_enabled = false;
   app_state->settings.save_after_rendering = true;
   app_state->settings.exit_after_rendering = true;
 }
@@ -621,6 +1038,149 @@ void misc_output_path_set(AppState *app_state, int argc, const char **argv, int
   strncpy(app_state->settings.saved_image_path.str, val, sizeof(app_state->settings.saved_image_path.str));
 }
 
+HelpLine misc_denoise_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_denoise_short, .long_name = misc_denoise_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_denoise_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_denoise_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.denoise_enabled = true;
+}
+
+HelpLine misc_aovs_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_aovs_short, .long_name = misc_aovs_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_aovs_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_aovs_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.aovs_enabled = true;
+}
+
+HelpLine misc_exr_half_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_exr_half_short, .long_name = misc_exr_half_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_exr_half_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_exr_half_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.exr_half = true;
+}
+
+HelpLine misc_checkpoint_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_checkpoint_short, .long_name = misc_checkpoint_long};
+  strncpy(help_line.default_value, app_state->settings.checkpoint_path.str, sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_checkpoint_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_checkpoint_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *val = get_value_for_option(argc, argv, iargv);
+  strncpy(app_state->settings.checkpoint_path.str, val, sizeof(app_state->settings.checkpoint_path.str));
+}
+
+void misc_checkpoint_interval_value_str(char *buf, const AppState *app_state){
+  sprintf(buf, "%.6g", app_state->settings.checkpoint_interval_s);
+}
+HelpLine misc_checkpoint_interval_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_checkpoint_interval_short, .long_name = misc_checkpoint_interval_long};
+  strncpy(help_line.description, misc_checkpoint_interval_desc, sizeof(help_line.description));
+  misc_checkpoint_interval_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void misc_checkpoint_interval_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.checkpoint_interval_s = get_value_float(argc, argv, iargv);
+}
+
+HelpLine misc_resume_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_resume_short, .long_name = misc_resume_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_resume_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_resume_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.resume = true;
+}
+
+HelpLine misc_jobs_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_jobs_short, .long_name = misc_jobs_long};
+  strncpy(help_line.default_value, app_state->settings.jobs_path.str, sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_jobs_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_jobs_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *val = get_value_for_option(argc, argv, iargv);
+  strncpy(app_state->settings.jobs_path.str, val, sizeof(app_state->settings.jobs_path.str));
+}
+
+HelpLine misc_camera_path_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_camera_path_short, .long_name = misc_camera_path_long};
+  strncpy(help_line.default_value, app_state->settings.camera_path.str, sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_camera_path_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_camera_path_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *val = get_value_for_option(argc, argv, iargv);
+  strncpy(app_state->settings.camera_path.str, val, sizeof(app_state->settings.camera_path.str));
+}
+
+void misc_fps_value_str(char *buf, const AppState *app_state){
+  format_float(buf, app_state->settings.animation_fps);
+}
+HelpLine misc_fps_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_fps_short, .long_name = misc_fps_long};
+  strncpy(help_line.description, misc_fps_desc, sizeof(help_line.description));
+  misc_fps_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void misc_fps_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.animation_fps = get_value_float(argc, argv, iargv);
+}
+
+void misc_time_value_str(char *buf, const AppState *app_state){
+  format_float(buf, app_state->settings.scene_time_s);
+}
+HelpLine misc_time_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_time_short, .long_name = misc_time_long};
+  strncpy(help_line.description, misc_time_desc, sizeof(help_line.description));
+  misc_time_value_str(help_line.default_value, app_state);
+  return help_line;
+}
+void misc_time_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  app_state->settings.scene_time_s = get_value_float(argc, argv, iargv);
+}
+
+HelpLine misc_trace_help_line(const AppState *app_state) {
+  HelpLine help_line = {.short_name = misc_trace_short, .long_name = misc_trace_long};
+  strncpy(help_line.default_value, app_state->settings.trace_path.str, sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_trace_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_trace_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  const char *val = get_value_for_option(argc, argv, iargv);
+  strncpy(app_state->settings.trace_path.str, val, sizeof(app_state->settings.trace_path.str));
+}
+
+HelpLine misc_print_timings_help_line(const AppState *app_state) {
+  UNUSED(app_state);
+  HelpLine help_line = {.short_name = misc_print_timings_short, .long_name = misc_print_timings_long};
+  strncpy(help_line.default_value, "", sizeof(help_line.default_value));
+  strncpy(help_line.description, misc_print_timings_desc, sizeof(help_line.description));
+  return help_line;
+}
+void misc_print_timings_set(AppState *app_state, int argc, const char **argv, int *iargv) {
+  UNUSED(argc, argv, iargv);
+  app_state->settings.print_timings = true;
+}
+
 HelpLine misc_exit_after_rendering_help_line(const AppState *app_state) {
   UNUSED(app_state);
   HelpLine help_line = {.short_name = misc_exit_after_rendering_short, .long_name = misc_exit_after_rendering_long};
@@ -700,6 +1260,21 @@ static void parse_arg(int argc, const char **argv, int *i, AppState *app_state)
   }
 }
 
+void handle_job_args(int argc, const char **argv, AppState *app_state) {
+  app_state->pending_actions = 0;
+  for (int i = 0; i < argc; ++i) {
+    parse_arg(argc, argv, &i, app_state);
+  }
+}
+
+// whether none of --pos, --rot and --fov changed the camera
+static bool camera_is_default(const Camera *cam) {
+  const Camera default_cam = Camera_default();
+  return vec3_eq(cam->pos, default_cam.pos, 0) &&
+         vec3_eq(cam->dir, default_cam.dir, 0) &&
+         cam->fov_rad == default_cam.fov_rad;
+}
+
 // NOTE: assuming app_state contains its default state
 void handle_args(int argc, const char **argv, AppState *app_state) {
   if (argc <= 1)
@@ -709,6 +1284,62 @@ void handle_args(int argc, const char **argv, AppState *app_state) {
     parse_arg(argc, argv, &i, app_state);
   }
 
+  switch (app_state->settings.distributed_role) {
+  case DistributedRole_NONE:
+    break;
+  case DistributedRole_WORKER:
+    // everything else will be provided by the coordinator
+    return;
+  case DistributedRole_SERVER:
+    // and here by the clients
+    return;
+  case DistributedRole_COORDINATOR:
+    if (SmallString_is_empty(&app_state->settings.scene_path))
+      ERROR("Coordinator requires a scene to be specified.\n");
+    if (app_state->settings.rendering_params.frames_to_render <= 0)
+      ERROR("Coordinator requires --frames-to-render to be a positive value.\n");
+    // NOTE: the workers render with the camera defined in the scene
+    if (!camera_is_default(&app_state->settings.cam))
+      ERROR("--pos, --rot and --fov can't be used together with --coordinator.\n");
+    // the workers render a still scene, each of its frames the same way
+    if (app_state->settings.scene_time_s != 0)
+      ERROR("--time can't be used together with --coordinator.\n");
+    if (app_state->settings.rendering_params.adaptive_threshold > 0)
+      ERROR("--adaptive-threshold can't be used together with --coordinator.\n");
+    if (!SmallString_is_empty(&app_state->settings.camera_path))
+      ERROR("--camera-path can't be used together with --coordinator.\n");
+    // and the coordinator only has the colors of the samples
+    if (app_state->settings.denoise_enabled || app_state->settings.aovs_enabled)
+      ERROR("--denoise and --aovs can't be used together with --coordinator.\n");
+    return;
+  }
+
+  if (!SmallString_is_empty(&app_state->settings.jobs_path)) {
+    if (!SmallString_is_empty(&app_state->settings.scene_path))
+      ERROR("Scenes are given by the jobs, not together with --jobs.\n");
+    if (!SmallString_is_empty(&app_state->settings.camera_path))
+      ERROR("--camera-path can't be used together with --jobs.\n");
+    // the rest of the settings only get validated together with the jobs
+    return;
+  }
+
+  if (app_state->settings.resume &&
+      SmallString_is_empty(&app_state->settings.checkpoint_path)) {
+    ERROR("--resume requires --checkpoint-path to be specified.\n");
+  }
+
+  if (!SmallString_is_empty(&app_state->settings.camera_path)) {
+    if (SmallString_is_empty(&app_state->settings.scene_path))
+      ERROR("--camera-path requires a scene to be specified.\n");
+    if (app_state->settings.rendering_params.frames_to_render <= 0)
+      ERROR("--camera-path requires --frames-to-render to be a positive value.\n");
+    if (app_state->settings.animation_fps <= 0)
+      ERROR("--fps has to be a positive value.\n");
+    // NOTE: all of the frames would end up sharing the same one
+    if (!SmallString_is_empty(&app_state->settings.checkpoint_path))
+      ERROR("Camera animations can't be checkpointed.\n");
+  }
+
   if (!app_state->settings.gui_enabled &&
       SmallString_is_empty(&app_state->settings.scene_path)) {
     ERROR("GUI was disabled, yet no scene was specified.\n");
@@ -0,0 +1,185 @@
+#include "denoiser.h"
+#include "asserts.h"
+#include "utils/thread.h"
+#include "utils/timer.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// how quickly the weights fall off with differences in normals, albedo and
+// luminance, the last one being relative to the luminance's standard deviation
+#define NORMAL_POWER 128.0f
+#define ALBEDO_SIGMA 0.1f
+#define LUMINANCE_SIGMA 4.0f
+#define LUMINANCE_EPSILON 1e-4f
+
+// B3 spline, applied separately along both axes
+static const float kernel[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4,
+                                1.0f / 16};
+
+static float *alloc_floats(const Denoiser *self, uint32_t per_pixel) {
+  float *floats = malloc(sizeof(float) * per_pixel * self->resolution.width *
+                         self->resolution.height);
+  ASSERTQ_CUSTOM(floats != NULL, "Failed to allocate the denoiser's buffers");
+  return floats;
+}
+
+Denoiser Denoiser_new(WindowResolution resolution) {
+  Denoiser self = {.resolution = resolution};
+  self.accumulation = alloc_floats(&self, 4);
+  self.moments = alloc_floats(&self, 2);
+  self.albedo = alloc_floats(&self, 4);
+  self.normal = alloc_floats(&self, 4);
+  self.color = alloc_floats(&self, 3);
+  self._variance = alloc_floats(&self, 1);
+  self._next_color = alloc_floats(&self, 3);
+  self._next_variance = alloc_floats(&self, 1);
+  return self;
+}
+
+void Denoiser_delete(Denoiser *self) {
+  free(self->accumulation);
+  free(self->moments);
+  free(self->albedo);
+  free(self->normal);
+  free(self->color);
+  free(self->_variance);
+  free(self->_next_color);
+  free(self->_next_variance);
+}
+
+static float luminance(const float *rgb) {
+  return rgb[0] * 0.2126f + rgb[1] * 0.7152f + rgb[2] * 0.0722f;
+}
+
+static float samples_count(const Denoiser *self, uint32_t pixel) {
+  const float n = self->accumulation[pixel * 4 + 3];
+  return n > 0 ? n : 1;
+}
+
+// the averages of the first hit's albedo and normal, the latter normalized
+// or left at 0 if nothing was hit
+static void pixel_guides(const Denoiser *self, uint32_t pixel, float albedo[3],
+                         float normal[3]) {
+  const float n = samples_count(self, pixel);
+  float len2 = 0;
+  for (int c = 0; c < 3; ++c) {
+    albedo[c] = self->albedo[pixel * 4 + c] / n;
+    normal[c] = self->normal[pixel * 4 + c] / n;
+    len2 += normal[c] * normal[c];
+  }
+  const float inv_len = len2 > 1e-8f ? 1.0f / sqrtf(len2) : 0.0f;
+  for (int c = 0; c < 3; ++c)
+    normal[c] *= inv_len;
+}
+
+static void init_rows(void *ctx, uint32_t begin, uint32_t end) {
+  Denoiser *self = ctx;
+  for (uint32_t pixel = begin * self->resolution.width;
+       pixel < end * self->resolution.width; ++pixel) {
+    const float n = samples_count(self, pixel);
+    for (int c = 0; c < 3; ++c)
+      self->color[pixel * 3 + c] = self->accumulation[pixel * 4 + c] / n;
+
+    // variance of the mean, not of a single sample
+    const float mean = self->moments[pixel * 2] / n;
+    const float mean2 = self->moments[pixel * 2 + 1] / n;
+    const float variance = (mean2 - mean * mean) / n;
+    self->_variance[pixel] = variance > 0 ? variance : 0;
+  }
+}
+
+typedef struct {
+  Denoiser *self;
+  int step;
+} IterationCtx;
+
+static float normal_weight(const float *a, const float *b) {
+  const bool a_hit = a[0] != 0 || a[1] != 0 || a[2] != 0;
+  const bool b_hit = b[0] != 0 || b[1] != 0 || b[2] != 0;
+  if (!a_hit || !b_hit)
+    return a_hit == b_hit;
+
+  const float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  return d > 0 ? powf(d, NORMAL_POWER) : 0;
+}
+
+static float albedo_weight(const float *a, const float *b) {
+  float dist2 = 0;
+  for (int c = 0; c < 3; ++c)
+    dist2 += (a[c] - b[c]) * (a[c] - b[c]);
+  return expf(-dist2 / (ALBEDO_SIGMA * ALBEDO_SIGMA));
+}
+
+static void iteration_rows(void *ctx_, uint32_t begin, uint32_t end) {
+  const IterationCtx *ctx = ctx_;
+  Denoiser *self = ctx->self;
+  const int width = self->resolution.width, height = self->resolution.height;
+  Timer_begin("denoise rows");
+
+  for (int y = begin; y < (int)end; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const uint32_t p = y * width + x;
+      float p_albedo[3], p_normal[3];
+      pixel_guides(self, p, p_albedo, p_normal);
+      const float p_lum = luminance(&self->color[p * 3]);
+
+      float sum[3] = {0}, weights = 0, variance = 0;
+      for (int j = -2; j <= 2; ++j) {
+        const int qy = y + j * ctx->step;
+        if (qy < 0 || qy >= height)
+          continue;
+        for (int i = -2; i <= 2; ++i) {
+          const int qx = x + i * ctx->step;
+          if (qx < 0 || qx >= width)
+            continue;
+
+          const uint32_t q = qy * width + qx;
+          float q_albedo[3], q_normal[3];
+          pixel_guides(self, q, q_albedo, q_normal);
+          const float *q_color = &self->color[q * 3];
+          // NOTE: symmetric, so that a noisy pixel doesn't lose its energy
+          // to its neighbours without getting any back from them
+          const float lum_sigma =
+              LUMINANCE_SIGMA * sqrtf(fmaxf(self->_variance[p],
+                                            self->_variance[q])) +
+              LUMINANCE_EPSILON;
+
+          const float w = kernel[i + 2] * kernel[j + 2] *
+                          normal_weight(p_normal, q_normal) *
+                          albedo_weight(p_albedo, q_albedo) *
+                          expf(-fabsf(p_lum - luminance(q_color)) / lum_sigma);
+          for (int c = 0; c < 3; ++c)
+            sum[c] += w * q_color[c];
+          weights += w;
+          variance += w * w * self->_variance[q];
+        }
+      }
+
+      // NOTE: the pixel itself always has a positive weight
+      for (int c = 0; c < 3; ++c)
+        self->_next_color[p * 3 + c] = sum[c] / weights;
+      self->_next_variance[p] = variance / (weights * weights);
+    }
+  }
+  Timer_end();
+}
+
+void Denoiser_run(Denoiser *self) {
+  Timer_begin("denoise");
+  const uint32_t rows = self->resolution.height;
+  Thread_parallel_for(rows, init_rows, self);
+
+  for (int i = 0; i < DENOISER_ITERATIONS; ++i) {
+    IterationCtx ctx = {.self = self, .step = 1 << i};
+    Thread_parallel_for(rows, iteration_rows, &ctx);
+
+    float *tmp = self->color;
+    self->color = self->_next_color;
+    self->_next_color = tmp;
+    tmp = self->_variance;
+    self->_variance = self->_next_variance;
+    self->_next_variance = tmp;
+  }
+  Timer_end();
+}
@@ -0,0 +1,258 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "distributed/coordinator.h"
+#include "asserts.h"
+#include "distributed/job_queue.h"
+#include "distributed/protocol.h"
+#include "hdr_image.h"
+#include "image_saver.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+
+int Coordinator_run(AppState *app_state) {
+  UNUSED(app_state);
+  ERROR("Distributed rendering is not supported on Windows yet");
+}
+
+#else
+
+#include <poll.h>
+
+typedef struct {
+  DistributedConnection conn;
+  // frames_count == 0 when the worker isn't rendering anything
+  DistributedFrameRange job;
+  // asked for a job when there weren't any left, but some still might
+  // get requeued if another worker disconnects
+  bool waiting;
+} CoordinatorWorker;
+
+typedef struct {
+  DistributedListener listener;
+  DistributedJobQueue queue;
+  DistributedJob job_template;
+  CoordinatorWorker workers[DISTRIBUTED_MAX_WORKERS];
+  uint32_t workers_count;
+  // linear sums of all samples returned by the workers in rgb
+  // and their count in alpha, same as the renderer's back buffer
+  float *accumulated;
+  uint32_t frames_done;
+} Coordinator;
+
+static void Coordinator_disconnect(Coordinator *self, uint32_t worker_idx) {
+  CoordinatorWorker *worker = &self->workers[worker_idx];
+  if (worker->job.frames_count > 0) {
+    fprintf(stderr,
+            YELLOW("WARNING:") " Worker disconnected before finishing frames "
+                               "%u-%u, they will be rendered again\n",
+            worker->job.first_frame,
+            worker->job.first_frame + worker->job.frames_count - 1);
+    DistributedJobQueue_requeue(&self->queue, worker->job);
+  }
+  DistributedConnection_delete(&worker->conn);
+  self->workers[worker_idx] = self->workers[--self->workers_count];
+}
+
+// returns false if the worker disconnected
+static bool Coordinator_assign_job(Coordinator *self, CoordinatorWorker *worker) {
+  if (!DistributedJobQueue_pop(&self->queue, &worker->job)) {
+    worker->waiting = true;
+    return true;
+  }
+  worker->waiting = false;
+
+  DistributedJob job = self->job_template;
+  job.frames = worker->job;
+  return DistributedConnection_send(&worker->conn, DistributedMessageType_JOB,
+                                    &job, sizeof(job));
+}
+
+// returns false if the result was invalid or the worker disconnected
+static bool Coordinator_merge_result(Coordinator *self,
+                                     CoordinatorWorker *worker,
+                                     uint64_t payload_size, float *pixels) {
+  const WindowResolution res =
+      self->job_template.rendering_params.rendering_resolution;
+  const size_t pixels_count = 4 * (size_t)res.width * res.height;
+
+  DistributedJobResult result;
+  if (payload_size != sizeof(result) + sizeof(float) * pixels_count ||
+      !DistributedConnection_recv_payload(&worker->conn, &result,
+                                          sizeof(result)) ||
+      !DistributedConnection_recv_payload(&worker->conn, pixels,
+                                          sizeof(float) * pixels_count))
+    return false;
+
+  if (result.frames.first_frame != worker->job.first_frame ||
+      result.frames.frames_count != worker->job.frames_count)
+    return false;
+
+  // NOTE: as the workers return sums and not averages, each sample has the
+  // same weight no matter how many frames the job had
+  for (size_t i = 0; i < pixels_count; ++i)
+    self->accumulated[i] += pixels[i];
+
+  self->frames_done += result.frames.frames_count;
+  worker->job.frames_count = 0;
+  printf("Merged frames %u-%u (%u/%u)\n", result.frames.first_frame,
+         result.frames.first_frame + result.frames.frames_count - 1,
+         self->frames_done, self->queue.frames_count);
+  return true;
+}
+
+// returns false if the worker should be disconnected
+static bool Coordinator_handle_message(Coordinator *self,
+                                       CoordinatorWorker *worker,
+                                       float *pixels) {
+  DistributedMessageHeader header;
+  if (!DistributedConnection_recv_header(&worker->conn, &header))
+    return false;
+
+  switch (header.type) {
+  case DistributedMessageType_JOB_REQUEST:
+    return header.payload_size == 0 && Coordinator_assign_job(self, worker);
+  case DistributedMessageType_JOB_RESULT:
+    return Coordinator_merge_result(self, worker, header.payload_size, pixels);
+  default:
+    fprintf(stderr, YELLOW("WARNING:") " Unexpected message from a worker\n");
+    return false;
+  }
+}
+
+// writes the averages of the samples in the format picked by the path's
+// extension, the same way a single process saves them
+static void Coordinator_save_image(Coordinator *self, AppState *app_state) {
+  const WindowResolution res =
+      self->job_template.rendering_params.rendering_resolution;
+  const size_t pixels_count = (size_t)res.width * res.height;
+  const char *path = app_state->settings.saved_image_path.str;
+  const ImageFormat format = ImageFormat_from_path(path);
+
+  if (format != ImageFormat_PNG) {
+    // NOTE: averaged in place, the sums aren't needed anymore
+    for (size_t i = 0; i < pixels_count; ++i) {
+      float *sums = &self->accumulated[4 * i];
+      for (int c = 0; c < 3; ++c)
+        sums[c] = sums[3] > 0 ? sums[c] / sums[3] : 0;
+    }
+    HdrImage image = HdrImage_new(res);
+    HdrImage_add_channel(&image, "R", self->accumulated, 4);
+    HdrImage_add_channel(&image, "G", self->accumulated + 1, 4);
+    HdrImage_add_channel(&image, "B", self->accumulated + 2, 4);
+    const bool ok =
+        format == ImageFormat_EXR
+            ? HdrImage_write_exr(&image, path, AppState_str(app_state).str,
+                                 app_state->settings.exr_half)
+            : HdrImage_write_pfm(&image, path);
+    if (ok)
+      printf("Sucessfully saved image to '%s'\n", path);
+    else
+      fprintf(stderr, "Failed to save image to '%s'\n", path);
+    HdrImage_delete(&image);
+    return;
+  }
+
+  uint8_t *bytes = malloc(3 * pixels_count);
+  ASSERTQ_CUSTOM(bytes != NULL, "Failed to allocate the final image");
+  for (size_t i = 0; i < pixels_count; ++i) {
+    const float *sums = &self->accumulated[4 * i];
+    const float samples_count = sums[3] > 1 ? sums[3] : 1;
+    for (int c = 0; c < 3; ++c)
+      bytes[3 * i + c] = linear_to_srgb(sums[c] / samples_count) * 255.0f + 0.5f;
+  }
+
+  // NOTE: same as with glReadPixels, the first row is the bottom one
+  if (Image_write_png(path, bytes, res.width, res.height,
+                      AppState_str(app_state).str))
+    printf("Sucessfully saved image to '%s'\n", path);
+  free(bytes);
+}
+
+int Coordinator_run(AppState *app_state) {
+  const Settings *settings = &app_state->settings;
+  const WindowResolution res = settings->rendering_params.rendering_resolution;
+  const size_t values_count = 4 * (size_t)res.width * res.height;
+
+  Coordinator self = {
+      .listener = DistributedListener_new(settings->distributed_address.str),
+      .queue = DistributedJobQueue_new(
+          settings->rendering_params.frames_to_render,
+          settings->frames_per_job),
+      .job_template = {.scene_path = settings->scene_path,
+                       .rendering_params = settings->rendering_params,
+                       .bvh_strat = settings->BVH_build_strat},
+      .accumulated = calloc(values_count, sizeof(float)),
+  };
+  // a single job result is received at a time
+  float *pixels = malloc(values_count * sizeof(float));
+  ASSERTQ_CUSTOM(self.accumulated != NULL && pixels != NULL,
+                 "Failed to allocate buffers for merging results");
+
+  printf("Waiting for workers on '%s'...\n", settings->distributed_address.str);
+  StatsTimer_start(&app_state->stats.rendering);
+
+  while (self.frames_done < self.queue.frames_count) {
+    struct pollfd fds[DISTRIBUTED_MAX_WORKERS + 1];
+    fds[0] = (struct pollfd){.fd = self.listener.fd, .events = POLLIN};
+    for (uint32_t i = 0; i < self.workers_count; ++i)
+      fds[i + 1] = (struct pollfd){.fd = self.workers[i].conn.fd, .events = POLLIN};
+
+    if (poll(fds, self.workers_count + 1, -1) < 0) {
+      perror("poll");
+      break;
+    }
+
+    // NOTE: going backwards as disconnecting moves the last worker
+    // into the place of the disconnected one
+    for (uint32_t i = self.workers_count; i-- > 0;) {
+      if (fds[i + 1].revents == 0)
+        continue;
+      if (!Coordinator_handle_message(&self, &self.workers[i], pixels))
+        Coordinator_disconnect(&self, i);
+    }
+
+    // jobs of the workers that disconnected can be taken by the waiting ones
+    for (uint32_t i = self.workers_count; i-- > 0;) {
+      if (self.workers[i].waiting && self.queue.requeued_count > 0 &&
+          !Coordinator_assign_job(&self, &self.workers[i]))
+        Coordinator_disconnect(&self, i);
+    }
+
+    if (fds[0].revents & POLLIN) {
+      CoordinatorWorker worker = {0};
+      if (!DistributedListener_accept(&self.listener, &worker.conn))
+        perror("accept");
+      else if (self.workers_count == DISTRIBUTED_MAX_WORKERS)
+        DistributedConnection_delete(&worker.conn);
+      else
+        self.workers[self.workers_count++] = worker;
+    }
+  }
+
+  for (uint32_t i = 0; i < self.workers_count; ++i) {
+    DistributedConnection_send(&self.workers[i].conn,
+                               DistributedMessageType_DONE, NULL, 0);
+    DistributedConnection_delete(&self.workers[i].conn);
+  }
+  DistributedListener_delete(&self.listener);
+
+  app_state->stats.frame_number = self.frames_done;
+  StatsTimer_stop(&app_state->stats.rendering);
+  printf("Rendered %d frames in %s.\n", self.frames_done,
+         Stats_fmt_time(app_state->stats.rendering.total_time).str);
+
+  if (self.frames_done == self.queue.frames_count)
+    Coordinator_save_image(&self, app_state);
+
+  free(pixels);
+  free(self.accumulated);
+  return self.frames_done == self.queue.frames_count ? EXIT_SUCCESS
+                                                     : EXIT_FAILURE;
+}
+
+#endif // _WIN32
@@ -0,0 +1,33 @@
+#include "distributed/job_queue.h"
+#include "asserts.h"
+
+DistributedJobQueue DistributedJobQueue_new(uint32_t frames_count,
+                                            uint32_t frames_per_job) {
+  ASSERTQ_CUSTOM(frames_per_job > 0, "Jobs must contain at least one frame");
+  return (DistributedJobQueue){.frames_count = frames_count,
+                               .frames_per_job = frames_per_job};
+}
+
+bool DistributedJobQueue_pop(DistributedJobQueue *self,
+                             DistributedFrameRange *job) {
+  if (self->requeued_count > 0) {
+    *job = self->requeued[--self->requeued_count];
+    return true;
+  }
+  if (self->next_frame >= self->frames_count)
+    return false;
+
+  const uint32_t frames_left = self->frames_count - self->next_frame;
+  job->first_frame = self->next_frame;
+  job->frames_count =
+      frames_left < self->frames_per_job ? frames_left : self->frames_per_job;
+  self->next_frame += job->frames_count;
+  return true;
+}
+
+void DistributedJobQueue_requeue(DistributedJobQueue *self,
+                                 DistributedFrameRange job) {
+  ASSERTQ_CUSTOM(self->requeued_count < DISTRIBUTED_MAX_WORKERS,
+                 "More unfinished jobs than there can be workers");
+  self->requeued[self->requeued_count++] = job;
+}
@@ -0,0 +1,257 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "distributed/protocol.h"
+#include "asserts.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CONNECT_RETRIES 50
+#define CONNECT_RETRY_DELAY_MS 100
+
+#ifdef _WIN32
+
+DistributedListener DistributedListener_new(const char *address) {
+  UNUSED(address);
+  ERROR("Distributed rendering is not supported on Windows yet");
+}
+bool DistributedListener_accept(const DistributedListener *self,
+                                DistributedConnection *conn) {
+  UNUSED(self, conn);
+  UNREACHABLE();
+}
+void DistributedListener_delete(DistributedListener *self) { UNUSED(self); }
+
+DistributedConnection DistributedConnection_connect(const char *address) {
+  UNUSED(address);
+  ERROR("Distributed rendering is not supported on Windows yet");
+}
+bool DistributedConnection_send(const DistributedConnection *self,
+                                DistributedMessageType type,
+                                const void *payload, uint64_t payload_size) {
+  UNUSED(self, &type, payload, &payload_size);
+  UNREACHABLE();
+}
+bool DistributedConnection_recv_header(const DistributedConnection *self,
+                                       DistributedMessageHeader *header) {
+  UNUSED(self, header);
+  UNREACHABLE();
+}
+bool DistributedConnection_recv_payload(const DistributedConnection *self,
+                                        void *payload, uint64_t payload_size) {
+  UNUSED(self, payload, &payload_size);
+  UNREACHABLE();
+}
+void DistributedConnection_delete(DistributedConnection *self) { UNUSED(self); }
+
+#else
+
+#include <netdb.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  bool is_tcp;
+  char host[256];
+  char port[16];
+} ParsedAddress;
+
+// "HOST:PORT" and ":PORT" are TCP addresses, anything else is a socket path
+static ParsedAddress parse_address(const char *address) {
+  ParsedAddress parsed = {0};
+  const char *colon = strrchr(address, ':');
+  if (colon == NULL || colon[1] == '\0' ||
+      strspn(colon + 1, "0123456789") != strlen(colon + 1) ||
+      strlen(colon + 1) >= sizeof(parsed.port))
+    return parsed;
+
+  const size_t host_len = colon - address;
+  if (host_len >= sizeof(parsed.host))
+    ERROR_FMT("Host name in '%s' is too long", address);
+
+  parsed.is_tcp = true;
+  memcpy(parsed.host, address, host_len);
+  strcpy(parsed.port, colon + 1);
+  return parsed;
+}
+
+static struct sockaddr_un unix_socket_address(const char *path) {
+  struct sockaddr_un addr = {0};
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+    ERROR_FMT("Socket path '%s' is too long", path);
+  strcpy(addr.sun_path, path);
+  return addr;
+}
+
+// returns -1 on failure
+static int open_tcp_socket(const ParsedAddress *address, bool listening) {
+  struct addrinfo hints = {0};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+  // NOTE: connecting to ":PORT" means connecting to localhost
+  const char *host = address->host[0] != '\0' ? address->host : NULL;
+
+  struct addrinfo *infos;
+  int res = getaddrinfo(host, address->port, &hints, &infos);
+  if (res != 0) {
+    fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(res));
+    return -1;
+  }
+
+  int fd = -1;
+  for (struct addrinfo *info = infos; info != NULL; info = info->ai_next) {
+    fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (fd == -1)
+      continue;
+
+    if (listening) {
+      int reuse = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+      if (bind(fd, info->ai_addr, info->ai_addrlen) == 0)
+        break;
+    } else if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(infos);
+  return fd;
+}
+
+DistributedListener DistributedListener_new(const char *address) {
+  // a worker disconnecting mid-write shouldn't kill the coordinator
+  signal(SIGPIPE, SIG_IGN);
+
+  DistributedListener self = {.fd = -1};
+  ParsedAddress parsed = parse_address(address);
+
+  if (parsed.is_tcp) {
+    self.fd = open_tcp_socket(&parsed, true);
+  } else {
+    struct sockaddr_un addr = unix_socket_address(address);
+    // the socket file could've been left behind by an earlier run
+    unlink(address);
+    self.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (self.fd != -1 &&
+        bind(self.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      close(self.fd);
+      self.fd = -1;
+    }
+    self.socket_path = SmallString_new(address);
+  }
+
+  if (self.fd == -1 || listen(self.fd, DISTRIBUTED_MAX_WORKERS) != 0) {
+    perror("listen");
+    ERROR_FMT("Failed to listen on '%s'", address);
+  }
+  return self;
+}
+
+bool DistributedListener_accept(const DistributedListener *self,
+                                DistributedConnection *conn) {
+  conn->fd = accept(self->fd, NULL, NULL);
+  return conn->fd != -1;
+}
+
+void DistributedListener_delete(DistributedListener *self) {
+  close(self->fd);
+  if (!SmallString_is_empty(&self->socket_path))
+    unlink(self->socket_path.str);
+  self->fd = -1;
+}
+
+DistributedConnection DistributedConnection_connect(const char *address) {
+  signal(SIGPIPE, SIG_IGN);
+
+  DistributedConnection self = {.fd = -1};
+  ParsedAddress parsed = parse_address(address);
+
+  for (int attempt = 0; attempt < CONNECT_RETRIES; ++attempt) {
+    if (parsed.is_tcp) {
+      self.fd = open_tcp_socket(&parsed, false);
+    } else {
+      struct sockaddr_un addr = unix_socket_address(address);
+      self.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (self.fd != -1 &&
+          connect(self.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(self.fd);
+        self.fd = -1;
+      }
+    }
+    if (self.fd != -1)
+      return self;
+
+    struct timespec delay = {.tv_nsec = CONNECT_RETRY_DELAY_MS * 1000000L};
+    nanosleep(&delay, NULL);
+  }
+
+  ERROR_FMT("Failed to connect to a coordinator at '%s'", address);
+}
+
+static bool write_all(int fd, const void *data, uint64_t size) {
+  const uint8_t *bytes = data;
+  while (size > 0) {
+    ssize_t written = write(fd, bytes, size);
+    if (written <= 0)
+      return false;
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+static bool read_all(int fd, void *data, uint64_t size) {
+  uint8_t *bytes = data;
+  while (size > 0) {
+    ssize_t got = read(fd, bytes, size);
+    if (got <= 0)
+      return false;
+    bytes += got;
+    size -= got;
+  }
+  return true;
+}
+
+bool DistributedConnection_send(const DistributedConnection *self,
+                                DistributedMessageType type,
+                                const void *payload, uint64_t payload_size) {
+  DistributedMessageHeader header = {.magic = DISTRIBUTED_MESSAGE_MAGIC,
+                                     .type = type,
+                                     .payload_size = payload_size};
+  return write_all(self->fd, &header, sizeof(header)) &&
+         write_all(self->fd, payload, payload_size);
+}
+
+bool DistributedConnection_recv_header(const DistributedConnection *self,
+                                       DistributedMessageHeader *header) {
+  if (!read_all(self->fd, header, sizeof(*header)))
+    return false;
+
+  if (header->magic != DISTRIBUTED_MESSAGE_MAGIC) {
+    fprintf(stderr, YELLOW("WARNING:") " Received a malformed message\n");
+    return false;
+  }
+  return true;
+}
+
+bool DistributedConnection_recv_payload(const DistributedConnection *self,
+                                        void *payload, uint64_t payload_size) {
+  return read_all(self->fd, payload, payload_size);
+}
+
+void DistributedConnection_delete(DistributedConnection *self) {
+  if (self->fd != -1)
+    close(self->fd);
+  self->fd = -1;
+}
+
+#endif // _WIN32
@@ -0,0 +1,263 @@
+#include "distributed/server.h"
+#include "asserts.h"
+#include "distributed/protocol.h"
+#include "renderer.h"
+#include "renderer/backend.h"
+#include "scene.h"
+#include "scene/file_formats/gltf.h"
+#include "stats.h"
+#include "utils.h"
+#include "window.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERVER_WINDOW_TITLE "Path Tracing Renderer (server)"
+#define SERVER_WINDOW_WIDTH 320
+#define SERVER_WINDOW_HEIGHT 240
+// largest width or height a request can ask for, the back buffers and the
+// result at this size already take a few hundred MB each
+#define SERVER_MAX_RESOLUTION 4096
+
+typedef struct {
+  Scene scene;
+  // what the scene was loaded from and built with
+  SmallString path;
+  BVHStrategy bvh_strat;
+  // number of the last request which used it
+  uint64_t last_used;
+} ServerScene;
+
+typedef struct {
+  ServerScene scenes[SERVER_MAX_SCENES];
+  uint32_t scenes_count;
+  // the scene which the renderer has, SERVER_MAX_SCENES before there's any
+  uint32_t uploaded_scene;
+  uint64_t requests_count;
+  // DistributedRenderResult followed by the pixels, reused between requests
+  uint8_t *result;
+  size_t result_capacity;
+} Server;
+
+// returns why the request can't be rendered or NULL if it can
+static const char *validate_request(const DistributedRenderRequest *request) {
+  const RendererParameters *params = &request->rendering_params;
+  const WindowResolution res = params->rendering_resolution;
+  if (memchr(request->scene_path.str, '\0', sizeof(request->scene_path.str)) ==
+      NULL)
+    return "The scene path isn't terminated";
+  if (!FilePath_exists(request->scene_path.str))
+    return "The scene doesn't exist";
+  if (request->bvh_strat >= BVHStrategy__COUNT)
+    return "Invalid BVH strategy";
+  if (params->backend < 0 || params->backend >= RendererBackend__COUNT)
+    return "Invalid backend";
+  if (params->frames_to_render <= 0)
+    return "frames_to_render has to be positive";
+  if (params->samples_per_pixel <= 0)
+    return "samples_per_pixel has to be positive";
+  if (res.width == 0 || res.height == 0 || res.width > SERVER_MAX_RESOLUTION ||
+      res.height > SERVER_MAX_RESOLUTION)
+    return "Invalid resolution";
+  return NULL;
+}
+
+// loads the request's scene into the renderer, unless it already has it,
+// loading it from the file and building its BVH only if it isn't loaded yet,
+// returns NULL and why in error if the file can't be loaded
+static const Scene *Server_prepare_scene(Server *self, Renderer *renderer,
+                                         const DistributedRenderRequest *request,
+                                         SmallString *error, Arena *tmp_arena) {
+  uint32_t idx = 0;
+  while (idx < self->scenes_count &&
+         (strcmp(self->scenes[idx].path.str, request->scene_path.str) != 0 ||
+          self->scenes[idx].bvh_strat != request->bvh_strat))
+    ++idx;
+
+  if (idx == self->scenes_count) {
+    // NOTE: load_gltf_scene would exit the whole server
+    if (!validate_gltf_scene(request->scene_path.str, error))
+      return NULL;
+
+    if (self->scenes_count < SERVER_MAX_SCENES) {
+      self->scenes[self->scenes_count++].scene = Scene_default();
+    } else {
+      // NOTE: loading into the unloaded scene reuses its allocations
+      idx = 0;
+      for (uint32_t i = 1; i < self->scenes_count; ++i)
+        if (self->scenes[i].last_used < self->scenes[idx].last_used)
+          idx = i;
+      printf("Unloading '%s'\n", self->scenes[idx].path.str);
+    }
+
+    ServerScene *scene = &self->scenes[idx];
+    StatsTimer timer = StatsTimer_new();
+    StatsTimer_start(&timer);
+    load_gltf_scene(&scene->scene, request->scene_path.str);
+    Scene_build_bvh(&scene->scene, request->bvh_strat, tmp_arena);
+    StatsTimer_stop(&timer);
+    printf("Loaded '%s' and built its BVH in %s\n", request->scene_path.str,
+           Stats_fmt_time(timer.total_time).str);
+
+    scene->path = request->scene_path;
+    scene->bvh_strat = request->bvh_strat;
+    if (self->uploaded_scene == idx)
+      self->uploaded_scene = SERVER_MAX_SCENES;
+  }
+
+  if (self->uploaded_scene != idx) {
+    Renderer_load_scene(renderer, &self->scenes[idx].scene);
+    self->uploaded_scene = idx;
+  }
+  self->scenes[idx].last_used = self->requests_count;
+  return &self->scenes[idx].scene;
+}
+
+// returns NULL if there isn't enough memory for it
+static DistributedRenderResult *Server_result(Server *self,
+                                              WindowResolution res) {
+  const size_t size = sizeof(DistributedRenderResult) +
+                      sizeof(float) * 4 * res.width * res.height;
+  if (size > self->result_capacity) {
+    free(self->result);
+    self->result = malloc(size);
+    self->result_capacity = self->result != NULL ? size : 0;
+  }
+  return (DistributedRenderResult *)self->result;
+}
+
+// sends the samples accumulated in the first frames_rendered frames,
+// returns false if the client disconnected
+// NOTE: Server_result must have succeeded for res
+static bool Server_send_result(Server *self, const DistributedConnection *conn,
+                               const Renderer *renderer,
+                               DistributedMessageType type,
+                               uint32_t frames_rendered, WindowResolution res) {
+  DistributedRenderResult *result = Server_result(self, res);
+  result->frames_rendered = frames_rendered;
+  result->resolution = res;
+  Renderer_read_accumulation(renderer, (float *)(result + 1));
+  return DistributedConnection_send(
+      conn, type, result,
+      sizeof(*result) + sizeof(float) * 4 * res.width * res.height);
+}
+
+// returns false if the client disconnected
+static bool Server_render(Server *self, const DistributedConnection *conn,
+                          Renderer *renderer,
+                          const DistributedRenderRequest *request,
+                          Arena *tmp_arena) {
+  const char *error = validate_request(request);
+  if (error != NULL) {
+    fprintf(stderr, "Rejected a request: %s\n", error);
+    const SmallString message = SmallString_new(error);
+    return DistributedConnection_send(conn, DistributedMessageType_RENDER_ERROR,
+                                      &message, sizeof(message));
+  }
+  // NOTE: allocated before rendering, so as not to render for nothing
+  if (Server_result(self, request->rendering_params.rendering_resolution) ==
+      NULL) {
+    fprintf(stderr, "Rejected a request: Not enough memory for the result\n");
+    const SmallString message =
+        SmallString_new("Not enough memory for the result");
+    return DistributedConnection_send(conn, DistributedMessageType_RENDER_ERROR,
+                                      &message, sizeof(message));
+  }
+
+  StatsTimer timer = StatsTimer_new();
+  StatsTimer_start(&timer);
+  self->requests_count++;
+  SmallString scene_error = {0};
+  const Scene *scene =
+      Server_prepare_scene(self, renderer, request, &scene_error, tmp_arena);
+  if (scene == NULL) {
+    fprintf(stderr, "Rejected a request: %s\n", scene_error.str);
+    return DistributedConnection_send(conn, DistributedMessageType_RENDER_ERROR,
+                                      &scene_error, sizeof(scene_error));
+  }
+
+  const RendererParameters *params = &request->rendering_params;
+  Renderer_set_camera(renderer,
+                      request->use_scene_camera ? scene->camera
+                                                : request->camera);
+  Renderer_set_params(renderer, *params, tmp_arena);
+  Renderer_clear_backbuffer(renderer);
+
+  const uint32_t frames = params->frames_to_render;
+  for (uint32_t i = 0; i < frames; ++i) {
+    Renderer_render_frame(renderer, i);
+    if (request->progress_interval > 0 && i + 1 < frames &&
+        (i + 1) % request->progress_interval == 0 &&
+        !Server_send_result(self, conn, renderer,
+                            DistributedMessageType_RENDER_PROGRESS, i + 1,
+                            params->rendering_resolution))
+      return false;
+  }
+  const bool sent =
+      Server_send_result(self, conn, renderer,
+                         DistributedMessageType_RENDER_RESULT, frames,
+                         params->rendering_resolution);
+
+  StatsTimer_stop(&timer);
+  printf("Rendered %u frames of '%s' in %s\n", frames,
+         request->scene_path.str, Stats_fmt_time(timer.total_time).str);
+  return sent;
+}
+
+// serves the client's requests until it disconnects,
+// returns true if it asked the server to exit
+static bool Server_serve_client(Server *self, const DistributedConnection *conn,
+                                Renderer *renderer, Arena *tmp_arena) {
+  DistributedMessageHeader header;
+  while (DistributedConnection_recv_header(conn, &header)) {
+    switch (header.type) {
+    case DistributedMessageType_RENDER_REQUEST: {
+      DistributedRenderRequest request;
+      if (header.payload_size != sizeof(request) ||
+          !DistributedConnection_recv_payload(conn, &request, sizeof(request))) {
+        fprintf(stderr, "Received an invalid request, disconnecting\n");
+        return false;
+      }
+      if (!Server_render(self, conn, renderer, &request, tmp_arena))
+        return false;
+      break;
+    }
+    case DistributedMessageType_DONE:
+      return true;
+    default:
+      fprintf(stderr, YELLOW("WARNING:") " Unexpected message from a client\n");
+      return false;
+    }
+  }
+  return false;
+}
+
+int Server_run(const char *address, bool headless, Arena *tmp_arena) {
+  DistributedListener listener = DistributedListener_new(address);
+  Window window = headless ? Window_new_headless()
+                           : Window_new(SERVER_WINDOW_TITLE, SERVER_WINDOW_WIDTH,
+                                        SERVER_WINDOW_HEIGHT);
+  Renderer renderer = Renderer_new(tmp_arena);
+  Server self = {.uploaded_scene = SERVER_MAX_SCENES};
+  printf("Waiting for render requests on '%s'...\n", address);
+
+  bool done = false;
+  while (!done) {
+    DistributedConnection conn;
+    if (!DistributedListener_accept(&listener, &conn)) {
+      perror("accept");
+      continue;
+    }
+    done = Server_serve_client(&self, &conn, &renderer, tmp_arena);
+    DistributedConnection_delete(&conn);
+  }
+  printf("Asked to exit, exiting.\n");
+
+  free(self.result);
+  for (uint32_t i = 0; i < self.scenes_count; ++i)
+    Scene_delete(&self.scenes[i].scene);
+  DistributedListener_delete(&listener);
+  Renderer_delete(&renderer);
+  Window_delete(&window);
+  return 0;
+}
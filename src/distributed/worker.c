@@ -0,0 +1,127 @@
+#include "distributed/worker.h"
+#include "asserts.h"
+#include "distributed/protocol.h"
+#include "renderer.h"
+#include "scene.h"
+#include "scene/file_formats/gltf.h"
+#include "stats.h"
+#include "window.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORKER_WINDOW_TITLE "Path Tracing Renderer (worker)"
+#define WORKER_WINDOW_WIDTH 320
+#define WORKER_WINDOW_HEIGHT 240
+
+typedef struct {
+  Scene scene;
+  // what the currently loaded scene was loaded from and built with
+  SmallString scene_path;
+  BVHStrategy bvh_strat;
+  // DistributedJobResult followed by the pixels, reused between jobs
+  uint8_t *result;
+  size_t result_capacity;
+} WorkerState;
+
+// NOTE: consecutive jobs will almost always be for the same scene,
+// so it's loaded and its BVH built only when that changes
+static void WorkerState_prepare_scene(WorkerState *self, Renderer *renderer,
+                                      const DistributedJob *job,
+                                      Arena *tmp_arena) {
+  if (strcmp(self->scene_path.str, job->scene_path.str) == 0 &&
+      self->bvh_strat == job->bvh_strat)
+    return;
+
+  load_gltf_scene(&self->scene, job->scene_path.str);
+  Scene_build_bvh(&self->scene, job->bvh_strat, tmp_arena);
+  Renderer_load_scene(renderer, &self->scene);
+  Renderer_set_camera(renderer, self->scene.camera);
+
+  self->scene_path = job->scene_path;
+  self->bvh_strat = job->bvh_strat;
+}
+
+static DistributedJobResult *WorkerState_result(WorkerState *self,
+                                                WindowResolution res) {
+  const size_t size =
+      sizeof(DistributedJobResult) + sizeof(float) * 4 * res.width * res.height;
+  if (size > self->result_capacity) {
+    free(self->result);
+    self->result = malloc(size);
+    ASSERTQ_CUSTOM(self->result != NULL, "Failed to allocate a job result");
+    self->result_capacity = size;
+  }
+  return (DistributedJobResult *)self->result;
+}
+
+// renders the job and stores its accumulated samples in result
+static void render_job(Renderer *renderer, const DistributedJob *job,
+                       DistributedJobResult *result, Arena *tmp_arena) {
+  Renderer_set_params(renderer, job->rendering_params, tmp_arena);
+  Renderer_clear_backbuffer(renderer);
+  Renderer_set_seed_offset(renderer, job->frames.first_frame);
+
+  for (uint32_t i = 0; i < job->frames.frames_count; ++i)
+    Renderer_render_frame(renderer, i);
+
+  Renderer_read_accumulation(renderer, (float *)(result + 1));
+
+  result->frames = job->frames;
+  result->resolution = job->rendering_params.rendering_resolution;
+}
+
+int Worker_run(const char *address, bool headless, Arena *tmp_arena) {
+  DistributedConnection conn = DistributedConnection_connect(address);
+  printf("Connected to a coordinator at '%s'\n", address);
+
+  Window window = headless ? Window_new_headless()
+                           : Window_new(WORKER_WINDOW_TITLE, WORKER_WINDOW_WIDTH,
+                                        WORKER_WINDOW_HEIGHT);
+  Renderer renderer = Renderer_new(tmp_arena);
+  WorkerState state = {.scene = Scene_default(), .bvh_strat = BVHStrategy__COUNT};
+
+  while (DistributedConnection_send(&conn, DistributedMessageType_JOB_REQUEST,
+                                    NULL, 0)) {
+    DistributedMessageHeader header;
+    if (!DistributedConnection_recv_header(&conn, &header) ||
+        header.type == DistributedMessageType_DONE)
+      break;
+
+    DistributedJob job;
+    if (header.type != DistributedMessageType_JOB ||
+        header.payload_size != sizeof(job) ||
+        !DistributedConnection_recv_payload(&conn, &job, sizeof(job))) {
+      fprintf(stderr, "Received an invalid job, disconnecting\n");
+      break;
+    }
+
+    StatsTimer job_timer = StatsTimer_new();
+    StatsTimer_start(&job_timer);
+
+    WorkerState_prepare_scene(&state, &renderer, &job, tmp_arena);
+    DistributedJobResult *result =
+        WorkerState_result(&state, job.rendering_params.rendering_resolution);
+    render_job(&renderer, &job, result, tmp_arena);
+
+    StatsTimer_stop(&job_timer);
+    printf("Rendered frames %u-%u in %s\n", job.frames.first_frame,
+           job.frames.first_frame + job.frames.frames_count - 1,
+           Stats_fmt_time(job_timer.total_time).str);
+
+    const WindowResolution res = job.rendering_params.rendering_resolution;
+    const uint64_t result_size = sizeof(DistributedJobResult) +
+                                 sizeof(float) * 4 * res.width * res.height;
+    if (!DistributedConnection_send(
+            &conn, DistributedMessageType_JOB_RESULT, result, result_size))
+      break;
+  }
+  printf("Coordinator is done, exiting.\n");
+
+  free(state.result);
+  Scene_delete(&state.scene);
+  DistributedConnection_delete(&conn);
+  Renderer_delete(&renderer);
+  Window_delete(&window);
+  return 0;
+}
@@ -1,13 +1,16 @@
 #include "gui/settings.h"
 #include "action.h"
 #include "asserts.h"
+#include "image_saver.h"
 #include "rad_deg.h"
+#include "renderer/backend.h"
 #include "scene/bvh/strategies.h"
 #include "scene/camera.h"
 #include "small_string.h"
 #include "stats.h"
 #include "utils.h"
 #include "utils/file_dialog.h"
+#include "utils/timer.h"
 #include "window/scaling.h"
 #include "yawpitch.h"
 
@@ -23,6 +26,7 @@ static inline void scene(AppState *state);
 static inline void camera(AppState *state);
 static inline void rendering(AppState *state);
 static inline void misc(GUIOverlay *gui, AppState *state);
+static inline void profiling(AppState *state);
 
 void GuiSettings_draw(GUIOverlay *gui, AppState *state) {
   igBegin("Settings", NULL, 0);
@@ -41,6 +45,9 @@ void GuiSettings_draw(GUIOverlay *gui, AppState *state) {
                                        ImGuiTreeNodeFlags_DefaultOpen)) {
     misc(gui, state);
   }
+  if (igCollapsingHeader_TreeNodeFlags("Profiling", 0)) {
+    profiling(state);
+  }
 
   igEnd();
 }
@@ -49,18 +56,24 @@ static void tooltip(const char *desc);
 
 static inline void scene_path(AppState *state);
 static inline void scene_bvh_type(AppState *state);
+static inline void scene_animation(AppState *state);
+static inline void scene_bvh_analysis(AppState *state);
 static inline void scene_stats(AppState *state);
 static inline void scene(AppState *state) {
   scene_path(state);
   scene_bvh_type(state);
+  scene_animation(state);
 
   scene_stats(state);
+  scene_bvh_analysis(state);
 }
 
 static inline void camera_position(AppState *state);
 static inline void camera_rotation(AppState *state);
 static inline void camera_fov(AppState *state);
 static inline void camera_speed(AppState *state);
+static inline void camera_reprojection(AppState *state);
+static inline void camera_dynamic_resolution(AppState *state);
 static inline void camera(AppState *state) {
   igTextWrapped("To move the camera using keyboard (WASD keys) and mouse: "
                 "Hold the left mouse button over the rendered scene "
@@ -69,24 +82,32 @@ static inline void camera(AppState *state) {
   camera_rotation(state);
   camera_fov(state);
   camera_speed(state);
+  camera_reprojection(state);
+  camera_dynamic_resolution(state);
 }
 
 static inline bool rendering_env_color(AppState *state);
 static inline bool rendering_max_bounce_count(AppState *state);
+static inline bool rendering_russian_roulette_depth(AppState *state);
 static inline bool rendering_samples_per_pixel(AppState *state);
 static inline bool rendering_diverge_strength(AppState *state);
 static inline bool rendering_frames_to_render(AppState *state);
+static inline bool rendering_adaptive_threshold(AppState *state);
 static inline bool rendering_resolution(AppState *state);
+static inline bool rendering_backend(AppState *state);
 static inline void rendering_stats(AppState *state);
 static inline void rendering(AppState *state) {
   bool rendering_param_changed = false;
 
   rendering_param_changed |= rendering_env_color(state);
   rendering_param_changed |= rendering_max_bounce_count(state);
+  rendering_param_changed |= rendering_russian_roulette_depth(state);
   rendering_param_changed |= rendering_samples_per_pixel(state);
   rendering_param_changed |= rendering_diverge_strength(state);
   rendering_param_changed |= rendering_frames_to_render(state);
+  rendering_param_changed |= rendering_adaptive_threshold(state);
   rendering_param_changed |= rendering_resolution(state);
+  rendering_param_changed |= rendering_backend(state);
 
   if (rendering_param_changed) {
     state->pending_actions |= Action_update_ssbo_renderer_parameters;
@@ -96,10 +117,12 @@ static inline void rendering(AppState *state) {
 
 static inline void misc_ui_scale(GUIOverlay *gui);
 static inline void misc_scaling(AppState *state);
+static inline void misc_display_interval(AppState *state);
 static inline void misc_saved_image_path(AppState *state);
 static inline void misc(GUIOverlay *gui, AppState *state) {
   misc_ui_scale(gui);
   misc_scaling(state);
+  misc_display_interval(state);
   misc_saved_image_path(state);
 
 #ifndef NDEBUG
@@ -149,6 +172,31 @@ static inline void scene_bvh_type(AppState *state) {
   }
 }
 
+static inline void scene_animation(AppState *state) {
+  const GltfAnimation *animation = &state->scene_animation;
+  if (!GltfAnimation_is_loaded(animation))
+    return;
+  igCheckbox("Play animation", &state->settings.animation_playing);
+  if (igSliderFloat("Animation time", &state->settings.scene_time_s,
+                    animation->start_s, animation->end_s, "%.2fs", 0))
+    state->pending_actions |= Action_animate_scene;
+}
+
+static inline void scene_bvh_analysis(AppState *state) {
+  if (Scene_is_empty(&state->scene))
+    return;
+  const ImVec2 button_size = {.x = 0, .y = 0};
+  if (igButton("Analyze BVH", button_size))
+    state->pending_actions |= Action_analyze_bvh;
+  tooltip("Measure how good the BVH is: its SAH cost, how deep its leaves are "
+          "and how many triangles they hold, how much siblings overlap and "
+          "how much work random rays take to trace through it.");
+  igSameLine(0.0f, -1.0f);
+  igCheckbox("After every build", &state->settings.bvh_report);
+  if (state->bvh_analysis.nodes_count > 0)
+    igTextUnformatted(BVHAnalysis_str(&state->bvh_analysis).str, NULL);
+}
+
 static inline void scene_stats(AppState *state) {
   // if scene is loaded
   if (!SmallString_is_empty(&state->settings.scene_path)) {
@@ -161,6 +209,12 @@ static inline void scene_stats(AppState *state) {
            Stats_fmt_time(state->stats.scene_load.total_time).str);
     igText("BVH build time: %s",
            Stats_fmt_time(state->stats.bvh_build.total_time).str);
+    if (GltfAnimation_is_loaded(&state->scene_animation)) {
+      igText("Animation update time: %s",
+             Stats_fmt_time(state->stats.animation.total_time).str);
+      igText("BVH update time: %s",
+             Stats_fmt_time(state->stats.bvh_update.total_time).str);
+    }
   }
 }
 
@@ -217,6 +271,22 @@ static inline void camera_speed(AppState *state) {
                 "%.4f", ImGuiSliderFlags_Logarithmic);
 }
 
+static inline void camera_reprojection(AppState *state) {
+  igCheckbox("Reproject on moves", &state->settings.reprojection_enabled);
+  tooltip("Keep the samples of surfaces that are still visible after the "
+          "camera moves instead of starting over.");
+}
+
+static inline void camera_dynamic_resolution(AppState *state) {
+  igSliderFloat("Target frame time (ms)",
+                &state->settings.dynamic_resolution_target_ms, 0, 100, "%.0f",
+                0);
+  tooltip("While the camera moves, render at a lower resolution chosen so "
+          "that frames take about this long, 0 disables it.");
+  if (state->dynamic_resolution.active)
+    igText("Resolution scale: %.2f", state->dynamic_resolution.scale);
+}
+
 // === RENDERING ===
 static inline bool rendering_env_color(AppState *state) {
   return igColorEdit3("Environment color",
@@ -231,6 +301,16 @@ static inline bool rendering_max_bounce_count(AppState *state) {
   return changed;
 }
 
+static inline bool rendering_russian_roulette_depth(AppState *state) {
+  bool changed = igInputInt(
+      "Russian Roulette Depth",
+      &state->settings.rendering_params.russian_roulette_depth, 1, 1, 0);
+  tooltip("Number of bounces after which rays carrying little light get "
+          "randomly terminated, with the surviving ones carrying more to make "
+          "up for it. Not less than Max Bounce Count disables it.");
+  return changed;
+}
+
 static inline bool rendering_samples_per_pixel(AppState *state) {
   bool changed =
       igInputInt("Samples Per Pixel",
@@ -260,6 +340,16 @@ static inline bool rendering_frames_to_render(AppState *state) {
   return changed;
 }
 
+static inline bool rendering_adaptive_threshold(AppState *state) {
+  bool changed = igSliderFloat(
+      "Adaptive threshold", &state->settings.rendering_params.adaptive_threshold,
+      0.0, 0.5, "%5.4f", ImGuiSliderFlags_Logarithmic);
+  tooltip("Pixels whose estimated relative error drops below this value stop "
+          "getting samples, which go to the noisier ones instead. Rendering "
+          "finishes once all pixels get there. 0 disables adaptive sampling.");
+  return changed;
+}
+
 static inline bool rendering_resolution(AppState *state) {
   int res[2] = {state->settings.rendering_params.rendering_resolution.width,
                 state->settings.rendering_params.rendering_resolution.height};
@@ -273,6 +363,37 @@ static inline bool rendering_resolution(AppState *state) {
   return changed;
 }
 
+static inline bool rendering_backend(AppState *state) {
+  RendererParameters *params = &state->settings.rendering_params;
+  bool changed = igCombo_Str_arr("Backend", &params->backend,
+                                 RendererBackend_str, RendererBackend__COUNT, 5);
+  tooltip("Fragment draws a full-screen quad, Compute dispatches a workgroup "
+          "per tile of the image and Persistent dispatches a fixed number of "
+          "workgroups which keep taking tiles until all are rendered.");
+  if (params->backend == RendererBackend_FRAGMENT)
+    return changed;
+
+  int tile_size[2] = {params->tile_width, params->tile_height};
+  if (igInputInt2("Tile size", tile_size, 0) && tile_size[0] > 0 &&
+      tile_size[1] > 0) {
+    params->tile_width = tile_size[0];
+    params->tile_height = tile_size[1];
+    changed = true;
+  }
+  tooltip("Size of a compute workgroup, each renders a tile of this size.");
+
+  if (params->backend == RendererBackend_PERSISTENT) {
+    int workgroups = params->persistent_workgroups;
+    if (igInputInt("Workgroups", &workgroups, 1, 16, 0) && workgroups > 0) {
+      params->persistent_workgroups = workgroups;
+      changed = true;
+    }
+    tooltip("How many workgroups should be dispatched, ideally just enough "
+            "to keep the whole GPU busy.");
+  }
+  return changed;
+}
+
 static inline void rendering_stats(AppState *state) {
   igText("Rendering last frame took: %s",
          Stats_fmt_time(state->stats.last_frame_rendering.total_time).str);
@@ -290,7 +411,21 @@ static inline void rendering_stats(AppState *state) {
            Stats_fmt_time(state->stats.rendering.total_time).str);
     break;
   }
+  if (state->stats.gpu_frame_time > 0) {
+    igText("GPU time per frame: %s",
+           Stats_fmt_time(state->stats.gpu_frame_time).str);
+    tooltip("Measured around the frames' draws only, unlike the time above "
+            "which includes displaying them and the GUI.");
+    igText("Mrays/s: %.2f", state->stats.rays_per_s * 1e-6);
+    igText("Time per sample: %s",
+           Stats_fmt_time(state->stats.sample_time).str);
+    tooltip("How long adding a sample to every pixel takes on the GPU.");
+  }
   igText("Rendered frames: %d", state->stats.frame_number);
+  if (state->settings.display_interval_ms > 0)
+    igText("Frames per display: %u", state->stats.frames_per_display);
+  if (state->settings.rendering_params.adaptive_threshold > 0)
+    igText("Pixels still sampled: %u", state->stats.sampled_pixels);
 }
 
 // === MISC ===
@@ -305,15 +440,40 @@ static inline void misc_scaling(AppState *state) {
   tooltip("Method to use for displaying the rendered image when the window "
           "size is different from the Rendering Resolution");
 }
+static inline void misc_display_interval(AppState *state) {
+  igSliderFloat("Display interval (ms)", &state->settings.display_interval_ms,
+                0, 1000, "%.0f", 0);
+  tooltip("Render as many frames as fit in this time before displaying the "
+          "next one, 0 displays every frame.");
+}
 static inline void misc_saved_image_path(AppState *state) {
   igInputText("Saved image path", state->settings.saved_image_path.str,
               sizeof(state->settings.saved_image_path), 0, NULL, NULL);
+  igCheckbox("Denoise", &state->settings.denoise_enabled);
+  tooltip("Run the saved image through an edge-avoiding filter on the CPU, "
+          "guided by the first hit's albedo and normal");
+  if (ImageFormat_from_path(state->settings.saved_image_path.str) ==
+      ImageFormat_EXR) {
+    igCheckbox("Save AOVs", &state->settings.aovs_enabled);
+    tooltip("Also save the first hit's albedo, normal and depth as layers.");
+    igCheckbox("Half floats", &state->settings.exr_half);
+    tooltip("Store the channels as 16 bit halfs instead of 32 bit floats.");
+  }
   ImVec2 button_size = {.x = 0, .y = 0};
   if (igButton("Save image", button_size)) {
     state->pending_actions |= Action_save_image;
   }
 }
 
+// === PROFILING ===
+static inline void profiling(AppState *state) {
+  const ImVec2 button_size = {.x = 0, .y = 0};
+  if (igButton("Reset timed scopes", button_size))
+    Timer_reset();
+  igTextUnformatted(Stats_str(&state->stats).str, NULL);
+  igTextUnformatted(Timer_str().str, NULL);
+}
+
 static void tooltip(const char *desc) {
   igSameLine(0.0f, -1.0f);
   igTextDisabled("(?)");
@@ -324,3 +484,4 @@ static void tooltip(const char *desc) {
     igEndTooltip();
   }
 }
+
@@ -0,0 +1,245 @@
+#include "hdr_image.h"
+#include "asserts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+HdrImage HdrImage_new(WindowResolution resolution) {
+  return (HdrImage){.resolution = resolution};
+}
+
+float *HdrImage_alloc(HdrImage *self, uint32_t floats_per_pixel) {
+  float *buffer = malloc(sizeof(float) * floats_per_pixel *
+                         self->resolution.width * self->resolution.height);
+  ASSERTQ_CUSTOM(buffer != NULL, "Failed to allocate an HDR image's buffer");
+  HdrImage_add_buffer(self, buffer);
+  return buffer;
+}
+
+void HdrImage_add_buffer(HdrImage *self, float *buffer) {
+  ASSERTQ_CUSTOM(self->_buffers_count < HDR_IMAGE_MAX_BUFFERS,
+                 "Too many buffers for an HDR image");
+  self->_buffers[self->_buffers_count++] = buffer;
+}
+
+void HdrImage_add_channel(HdrImage *self, const char *name, const float *data,
+                          uint32_t stride) {
+  ASSERTQ_CUSTOM(self->channels_count < HDR_IMAGE_MAX_CHANNELS,
+                 "Too many channels for an HDR image");
+  self->channels[self->channels_count++] =
+      (HdrImageChannel){.name = name, .data = data, .stride = stride};
+}
+
+void HdrImage_delete(HdrImage *self) {
+  for (uint32_t i = 0; i < self->_buffers_count; ++i)
+    free(self->_buffers[i]);
+  self->_buffers_count = 0;
+  self->channels_count = 0;
+}
+
+uint16_t float_to_half(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  const uint16_t sign = (x >> 16) & 0x8000;
+  const uint32_t abs = x & 0x7fffffff;
+
+  // infinity or NaN, which has to stay one
+  if (abs >= 0x7f800000)
+    return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+  // would round to a bigger number than 65504, the biggest half
+  if (abs >= 0x477ff000)
+    return sign | 0x7c00;
+
+  uint32_t half, rest, halfway;
+  if (abs >= 0x38800000) {
+    // normal, rebias the exponent and drop 13 bits of the mantissa
+    half = ((abs >> 23) - 127 + 15) << 10 | (abs & 0x7fffff) >> 13;
+    rest = abs & 0x1fff;
+    halfway = 0x1000;
+  } else {
+    // subnormal, anything less than half of the smallest one rounds to 0
+    if (abs <= 0x33000000)
+      return sign;
+    const uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+    const uint32_t shift = 126 - (abs >> 23);
+    half = mantissa >> shift;
+    rest = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  }
+  // to nearest, ties to even, carrying over into the exponent is fine
+  if (rest > halfway || (rest == halfway && (half & 1)))
+    half++;
+  return sign | half;
+}
+
+// NOTE: both formats are little endian
+static uint8_t *put_u32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i)
+    out[i] = value >> (8 * i);
+  return out + 4;
+}
+
+static uint8_t *put_float(uint8_t *out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return put_u32(out, bits);
+}
+
+static uint8_t *put_half(uint8_t *out, float value) {
+  const uint16_t bits = float_to_half(value);
+  out[0] = bits & 0xff;
+  out[1] = bits >> 8;
+  return out + 2;
+}
+
+static bool write_u32(FILE *f, uint32_t value) {
+  uint8_t bytes[4];
+  put_u32(bytes, value);
+  return fwrite(bytes, sizeof(bytes), 1, f) == 1;
+}
+
+static bool write_u64(FILE *f, uint64_t value) {
+  return write_u32(f, value & 0xffffffff) && write_u32(f, value >> 32);
+}
+
+static bool write_str(FILE *f, const char *str) {
+  return fwrite(str, strlen(str) + 1, 1, f) == 1;
+}
+
+static bool write_attribute(FILE *f, const char *name, const char *type,
+                            uint32_t size) {
+  return write_str(f, name) && write_str(f, type) && write_u32(f, size);
+}
+
+static float channel_value(const HdrImageChannel *channel, uint32_t pixel) {
+  return channel->data[(size_t)pixel * channel->stride];
+}
+
+#define EXR_PIXEL_TYPE_HALF 1
+#define EXR_PIXEL_TYPE_FLOAT 2
+
+// NOTE: channels have to be listed and stored sorted by their names
+static void sorted_channels(const HdrImage *self,
+                            uint32_t order[HDR_IMAGE_MAX_CHANNELS]) {
+  for (uint32_t i = 0; i < self->channels_count; ++i) {
+    uint32_t j = i;
+    for (; j > 0 && strcmp(self->channels[order[j - 1]].name,
+                           self->channels[i].name) > 0;
+         --j)
+      order[j] = order[j - 1];
+    order[j] = i;
+  }
+}
+
+static bool write_exr_header(const HdrImage *self, FILE *f,
+                             const uint32_t *order, const char *comments,
+                             bool half) {
+  const WindowResolution res = self->resolution;
+  // magic number and version 2 of a single part scanline file
+  const uint8_t magic[8] = {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0};
+  bool ok = fwrite(magic, sizeof(magic), 1, f) == 1;
+
+  uint32_t chlist_size = 1;
+  for (uint32_t i = 0; i < self->channels_count; ++i)
+    chlist_size += strlen(self->channels[i].name) + 1 + 16;
+  ok = ok && write_attribute(f, "channels", "chlist", chlist_size);
+  for (uint32_t i = 0; i < self->channels_count && ok; ++i) {
+    // pixel type, pLinear and reserved bytes and then x and y sampling
+    uint8_t info[16] = {0}, *p = info;
+    p = put_u32(p, half ? EXR_PIXEL_TYPE_HALF : EXR_PIXEL_TYPE_FLOAT);
+    p = put_u32(p, 0);
+    p = put_u32(p, 1);
+    put_u32(p, 1);
+    ok = write_str(f, self->channels[order[i]].name) &&
+         fwrite(info, sizeof(info), 1, f) == 1;
+  }
+  ok = ok && fputc(0, f) != EOF;
+
+  // no compression
+  ok = ok && write_attribute(f, "compression", "compression", 1) &&
+       fputc(0, f) != EOF;
+  const char *windows[] = {"dataWindow", "displayWindow"};
+  for (int i = 0; i < 2; ++i)
+    ok = ok && write_attribute(f, windows[i], "box2i", 16) && write_u32(f, 0) &&
+         write_u32(f, 0) && write_u32(f, res.width - 1) &&
+         write_u32(f, res.height - 1);
+  // increasing y, so top row first
+  ok = ok && write_attribute(f, "lineOrder", "lineOrder", 1) &&
+       fputc(0, f) != EOF;
+  uint8_t one[4];
+  put_float(one, 1.0f);
+  ok = ok && write_attribute(f, "pixelAspectRatio", "float", 4) &&
+       fwrite(one, sizeof(one), 1, f) == 1;
+  ok = ok && write_attribute(f, "screenWindowCenter", "v2f", 8) &&
+       write_u32(f, 0) && write_u32(f, 0);
+  ok = ok && write_attribute(f, "screenWindowWidth", "float", 4) &&
+       fwrite(one, sizeof(one), 1, f) == 1;
+  if (comments != NULL && comments[0] != 0)
+    ok = ok && write_attribute(f, "comments", "string", strlen(comments)) &&
+         fwrite(comments, strlen(comments), 1, f) == 1;
+  return ok && fputc(0, f) != EOF;
+}
+
+bool HdrImage_write_exr(const HdrImage *self, const char *path,
+                        const char *comments, bool half) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+
+  const WindowResolution res = self->resolution;
+  uint32_t order[HDR_IMAGE_MAX_CHANNELS];
+  sorted_channels(self, order);
+  bool ok = write_exr_header(self, f, order, comments, half);
+
+  const uint32_t line_size =
+      res.width * self->channels_count * (half ? 2 : 4);
+  // the offset table is followed by lines, each with its y and size first
+  const uint64_t first_line = ftell(f) + (uint64_t)res.height * 8;
+  for (uint32_t y = 0; y < res.height && ok; ++y)
+    ok = write_u64(f, first_line + (uint64_t)y * (8 + line_size));
+
+  uint8_t *line = malloc(8 + line_size);
+  ASSERTQ_CUSTOM(line != NULL, "Failed to allocate an EXR line");
+  for (uint32_t y = 0; y < res.height && ok; ++y) {
+    uint8_t *p = put_u32(line, y);
+    p = put_u32(p, line_size);
+    const uint32_t row = res.height - 1 - y;
+    for (uint32_t c = 0; c < self->channels_count; ++c) {
+      const HdrImageChannel *channel = &self->channels[order[c]];
+      for (uint32_t x = 0; x < res.width; ++x) {
+        const float value = channel_value(channel, row * res.width + x);
+        p = half ? put_half(p, value) : put_float(p, value);
+      }
+    }
+    ok = fwrite(line, 8 + line_size, 1, f) == 1;
+  }
+  free(line);
+
+  return fclose(f) == 0 && ok;
+}
+
+bool HdrImage_write_pfm(const HdrImage *self, const char *path) {
+  ASSERTQ_CUSTOM(self->channels_count >= 3, "PFM needs 3 channels");
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+
+  const WindowResolution res = self->resolution;
+  // a negative scale means little endian
+  bool ok = fprintf(f, "PF\n%u %u\n-1.0\n", res.width, res.height) > 0;
+
+  const uint32_t line_size = res.width * 3 * sizeof(float);
+  uint8_t *line = malloc(line_size);
+  ASSERTQ_CUSTOM(line != NULL, "Failed to allocate a PFM line");
+  // NOTE: bottom row first, just like the channels
+  for (uint32_t y = 0; y < res.height && ok; ++y) {
+    uint8_t *p = line;
+    for (uint32_t x = 0; x < res.width; ++x)
+      for (uint32_t c = 0; c < 3; ++c)
+        p = put_float(p, channel_value(&self->channels[c], y * res.width + x));
+    ok = fwrite(line, line_size, 1, f) == 1;
+  }
+  free(line);
+
+  return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,202 @@
+#include "image_saver.h"
+#include "asserts.h"
+#include "opengl/gl_call.h"
+#include "utils.h"
+#include "utils/timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BYTES_PER_PIXEL 3
+
+typedef struct {
+  SmallString path, description;
+  WindowResolution resolution;
+  uint8_t *pixels;
+} ImageWrite;
+
+// NOTE: runs on the writer's thread
+static void write_image(void *ctx) {
+  ImageWrite *image = ctx;
+  Timer_set_thread_track("image saver");
+  Timer_begin("save image");
+  if (Image_write_png(image->path.str, image->pixels, image->resolution.width,
+                      image->resolution.height, image->description.str))
+    printf("Sucessfully saved image to '%s'\n", image->path.str);
+  else
+    fprintf(stderr, "Failed to save image to '%s'\n", image->path.str);
+  Timer_end();
+
+  free(image->pixels);
+  free(image);
+}
+
+typedef struct {
+  SmallString path, description;
+  HdrImage image;
+  ImageFormat format;
+  bool half;
+} HdrImageWrite;
+
+// NOTE: runs on the writer's thread
+static void write_hdr_image(void *ctx) {
+  HdrImageWrite *write = ctx;
+  Timer_set_thread_track("image saver");
+  Timer_begin("save image");
+  bool ok = false;
+  switch (write->format) {
+  case ImageFormat_EXR:
+    ok = HdrImage_write_exr(&write->image, write->path.str,
+                            write->description.str, write->half);
+    break;
+  case ImageFormat_PFM:
+    ok = HdrImage_write_pfm(&write->image, write->path.str);
+    break;
+  case ImageFormat_PNG:
+  case ImageFormat__COUNT:
+    UNREACHABLE();
+  }
+  if (ok)
+    printf("Sucessfully saved image to '%s'\n", write->path.str);
+  else
+    fprintf(stderr, "Failed to save image to '%s'\n", write->path.str);
+  Timer_end();
+
+  HdrImage_delete(&write->image);
+  free(write);
+}
+
+ImageFormat ImageFormat_from_path(const char *path) {
+  const char *extension = strrchr(path, '.');
+  if (extension == NULL)
+    return ImageFormat_PNG;
+  for (int i = 0; i < ImageFormat__COUNT; ++i)
+    if (strcmp(extension, ImageFormat_str[i]) == 0)
+      return i;
+  return ImageFormat_PNG;
+}
+
+ImageSaver ImageSaver_new(void) {
+  ImageSaver self = {0};
+  for (uint32_t i = 0; i < IMAGE_SAVER_READBACKS; ++i)
+    GL_CALL(glCreateBuffers(1, &self._readbacks[i].pbo));
+  self._writer = WorkQueue_new(IMAGE_SAVER_QUEUED_WRITES);
+  return self;
+}
+
+void ImageSaver_write(ImageSaver *self, uint8_t *pixels,
+                      WindowResolution resolution, const char *path,
+                      const char *description) {
+  ImageWrite *image = malloc(sizeof(ImageWrite));
+  ASSERTQ_CUSTOM(image != NULL, "Failed to allocate an image to write");
+  *image = (ImageWrite){
+      .path = SmallString_new(path),
+      .description = SmallString_new(description),
+      .resolution = resolution,
+      .pixels = pixels,
+  };
+  WorkQueue_push(self->_writer, write_image, image);
+}
+
+void ImageSaver_write_hdr(ImageSaver *self, HdrImage image, ImageFormat format,
+                          bool half, const char *path,
+                          const char *description) {
+  HdrImageWrite *write = malloc(sizeof(HdrImageWrite));
+  ASSERTQ_CUSTOM(write != NULL, "Failed to allocate an image to write");
+  *write = (HdrImageWrite){
+      .path = SmallString_new(path),
+      .description = SmallString_new(description),
+      .image = image,
+      .format = format,
+      .half = half,
+  };
+  WorkQueue_push(self->_writer, write_hdr_image, write);
+}
+
+// hands the readback's pixels over to the writer, unless they haven't
+// arrived yet and it shouldn't wait for them, returns whether it did
+static bool finish_readback(ImageSaver *self, ImageReadback *readback,
+                            bool wait) {
+  GLenum status;
+  do {
+    GL_CALL(status = glClientWaitSync(readback->fence,
+                                      wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                      wait ? 1000000000 : 0));
+  } while (wait && status == GL_TIMEOUT_EXPIRED);
+  if (status == GL_TIMEOUT_EXPIRED)
+    return false;
+  if (status == GL_WAIT_FAILED)
+    ERROR("Failed to wait for an image to be read back");
+  Timer_begin("image readback");
+
+  const size_t size = (size_t)readback->resolution.width *
+                      readback->resolution.height * BYTES_PER_PIXEL;
+  uint8_t *pixels = malloc(size);
+  ASSERTQ_CUSTOM(pixels != NULL, "Failed to allocate an image's pixels");
+  const void *mapped;
+  GL_CALL(mapped = glMapNamedBufferRange(readback->pbo, 0, size,
+                                         GL_MAP_READ_BIT));
+  memcpy(pixels, mapped, size);
+  GL_CALL(glUnmapNamedBuffer(readback->pbo));
+
+  GL_CALL(glDeleteSync(readback->fence));
+  readback->fence = NULL;
+  Timer_end();
+  ImageSaver_write(self, pixels, readback->resolution, readback->path.str,
+                   readback->description.str);
+  return true;
+}
+
+void ImageSaver_read(ImageSaver *self, GLuint fbo, WindowResolution resolution,
+                     const char *path, const char *description) {
+  ImageReadback *readback = &self->_readbacks[self->_next];
+  self->_next = (self->_next + 1) % IMAGE_SAVER_READBACKS;
+  if (readback->fence != NULL)
+    finish_readback(self, readback, true);
+
+  const size_t size =
+      (size_t)resolution.width * resolution.height * BYTES_PER_PIXEL;
+  if (size > readback->pbo_size) {
+    GL_CALL(glNamedBufferData(readback->pbo, size, NULL, GL_STREAM_READ));
+    readback->pbo_size = size;
+  }
+
+  GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo));
+  GL_CALL(glReadBuffer(GL_COLOR_ATTACHMENT0));
+  GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+  GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo));
+  // NOTE: with a pixel pack buffer bound this only queues the copy
+  GL_CALL(glReadPixels(0, 0, resolution.width, resolution.height, GL_RGB,
+                       GL_UNSIGNED_BYTE, NULL));
+  GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+
+  GL_CALL(readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+  // the fence could otherwise never get to the GPU when only polled
+  GL_CALL(glFlush());
+  readback->resolution = resolution;
+  readback->path = SmallString_new(path);
+  readback->description = SmallString_new(description);
+}
+
+void ImageSaver_update(ImageSaver *self) {
+  // oldest first, so that images get written in the order they were read
+  for (uint32_t i = 0; i < IMAGE_SAVER_READBACKS; ++i) {
+    ImageReadback *readback =
+        &self->_readbacks[(self->_next + i) % IMAGE_SAVER_READBACKS];
+    if (readback->fence != NULL && !finish_readback(self, readback, false))
+      break;
+  }
+}
+
+void ImageSaver_delete(ImageSaver *self) {
+  for (uint32_t i = 0; i < IMAGE_SAVER_READBACKS; ++i) {
+    ImageReadback *readback =
+        &self->_readbacks[(self->_next + i) % IMAGE_SAVER_READBACKS];
+    if (readback->fence != NULL)
+      finish_readback(self, readback, true);
+    GL_CALL(glDeleteBuffers(1, &readback->pbo));
+  }
+  WorkQueue_delete(self->_writer);
+}
@@ -3,11 +3,19 @@
 #include "action.h"
 #include "app_state.h"
 #include "app_state_display.h"
+#include "asserts.h"
+#include "batch.h"
+#include "camera_animation.h"
 #include "cli.h"
+#include "distributed/coordinator.h"
+#include "distributed/server.h"
+#include "distributed/worker.h"
 #include "input_handler.h"
 #include "stats.h"
+#include "utils/timer.h"
 
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #define DESIRED_WIDTH 1280
@@ -19,6 +27,12 @@ static void delete_tmp_arena(void) {
   Arena_delete(&tmp_arena);
 }
 
+static SmallString trace_path;
+static void write_trace(void) {
+  if (!Timer_write_trace(trace_path.str))
+    fprintf(stderr, "Failed to write the trace to '%s'\n", trace_path.str);
+}
+
 int main(const int argc, const char **argv) {
   // pre-allocate 16MB of memory for any operations that may need it
   tmp_arena = Arena_new(16 * 1024 * 1024);
@@ -27,12 +41,63 @@ int main(const int argc, const char **argv) {
   AppState app_state = AppState_default();
   handle_args(argc, argv, &app_state);
 
-  Window window = Window_new(WINDOW_TITLE, DESIRED_WIDTH, DESIRED_HEIGHT);
-  GUIOverlay gui = GUIOverlay_new(&window);
+  // NOTE: written on any exit, the ones because of an error included
+  if (!SmallString_is_empty(&app_state.settings.trace_path)) {
+    trace_path = app_state.settings.trace_path;
+    Timer_start_trace();
+    Timer_set_thread_track("main");
+    atexit(write_trace);
+  }
+
+  switch (app_state.settings.distributed_role) {
+  case DistributedRole_COORDINATOR:
+    return Coordinator_run(&app_state);
+  case DistributedRole_WORKER:
+    return Worker_run(app_state.settings.distributed_address.str,
+                      app_state.settings.headless, &tmp_arena);
+  case DistributedRole_SERVER:
+    return Server_run(app_state.settings.distributed_address.str,
+                      app_state.settings.headless, &tmp_arena);
+  case DistributedRole_NONE:
+    break;
+  }
+
+  Window window = app_state.settings.headless
+                      ? Window_new_headless()
+                      : Window_new(WINDOW_TITLE, DESIRED_WIDTH, DESIRED_HEIGHT);
+  // NOTE: without a window there's nothing to show the GUI in or take inputs
+  // from, --headless disables both of them
+  GUIOverlay gui =
+      window.headless ? (GUIOverlay){0} : GUIOverlay_new(&window);
   Renderer renderer = Renderer_new(&tmp_arena);
-  InputHandler input_handler = InputHandler_new(&window);
+  InputHandler input_handler =
+      window.headless ? (InputHandler){0} : InputHandler_new(&window);
+  ImageSaver image_saver = ImageSaver_new();
+  CheckpointWriter checkpoint_writer = CheckpointWriter_new();
+  const bool checkpointing =
+      !SmallString_is_empty(&app_state.settings.checkpoint_path);
 
-  Renderer_set_params(&renderer, app_state.settings.rendering_params);
+  Renderer_set_params(&renderer, app_state.settings.rendering_params,
+                      &tmp_arena);
+
+  // NOTE: jobs get validated before anything is rendered
+  const bool batch_mode = !SmallString_is_empty(&app_state.settings.jobs_path);
+  Batch batch = {0};
+  if (batch_mode) {
+    batch = Batch_read(app_state.settings.jobs_path.str, &app_state.settings);
+    if (!Batch_start_next_job(&batch, &app_state))
+      ERROR_FMT("No jobs in '%s'", app_state.settings.jobs_path.str);
+  }
+
+  // NOTE: after everything else got created, which the first frame's time
+  // shouldn't include
+  const bool animation_mode =
+      !SmallString_is_empty(&app_state.settings.camera_path);
+  CameraAnimation animation = {0};
+  if (animation_mode)
+    animation = CameraAnimation_new(app_state.settings.camera_path.str,
+                                    app_state.settings.animation_fps,
+                                    app_state.settings.saved_image_path.str);
 
   while (!glfwWindowShouldClose(window.glfw_window)) {
     // NOTE: must poll every frame for the OS to know that this application is working
@@ -40,66 +105,118 @@ int main(const int argc, const char **argv) {
 
     // === Settings ===
     if (app_state.settings.hot_reload_enabled) {
-      if (RendererShaders_update(&renderer._shaders, &tmp_arena))
+      if (Renderer_update_shaders(&renderer, &tmp_arena))
         app_state.pending_actions |= Action_restart_rendering;
     }
 
-    if (app_state.settings.movement_enabled)
+    if (app_state.settings.movement_enabled && !window.headless)
       AppState_handle_inputs(&app_state, &input_handler, &events);
 
     if (app_state.settings.gui_enabled)
       GUIOverlay_update_state(&gui, &app_state);
 
+    AppState_play_animation(&app_state);
+
     // === pre-render Actions ===
-    if (Action_load_scene & app_state.pending_actions)
+    if (Action_load_scene & app_state.pending_actions) {
       AppState_load_scene(&app_state);
+      // NOTE: loading the scene replaced the camera with the scene's one
+      if (animation_mode)
+        CameraAnimation_apply(&animation, &app_state);
+    }
+
+    if (Action_animate_scene & app_state.pending_actions)
+      AppState_animate_scene(&app_state, &tmp_arena);
 
     if (Action_build_bvh & app_state.pending_actions)
       AppState_build_bvh(&app_state, &tmp_arena);
 
+    if (Action_analyze_bvh & app_state.pending_actions)
+      AppState_analyze_bvh(&app_state);
+
     if (Action_update_ssbo_scene & app_state.pending_actions) {
       Renderer_load_scene(&renderer, &app_state.scene);
       app_state.pending_actions |= Action_restart_rendering;
+    } else if (Action_update_ssbo_geometry & app_state.pending_actions) {
+      Renderer_update_scene_geometry(&renderer, &app_state.scene);
+      app_state.pending_actions |= Action_restart_rendering;
     }
 
     if (Action_update_ssbo_camera & app_state.pending_actions) {
       Renderer_set_camera(&renderer, app_state.settings.cam);
-      app_state.pending_actions |= Action_restart_rendering;
+      app_state.pending_actions |= app_state.settings.reprojection_enabled
+                                       ? Action_reproject
+                                       : Action_restart_rendering;
     }
 
     if (Action_update_ssbo_renderer_parameters & app_state.pending_actions) {
-      Renderer_set_params(&renderer, app_state.settings.rendering_params);
+      Renderer_set_params(&renderer, AppState_rendering_params(&app_state),
+                          &tmp_arena);
       app_state.pending_actions |= Action_restart_rendering;
     }
 
     if (Action_restart_rendering & app_state.pending_actions) {
       Renderer_clear_backbuffer(&renderer);
       Stats_reset_rendering(&app_state.stats);
+    } else if (Action_reproject & app_state.pending_actions) {
+      Renderer_reproject(&renderer, app_state.stats.frame_number);
+      Stats_reset_rendering(&app_state.stats);
+    }
+
+    // NOTE: only once there's a scene to render,
+    // later restarts should start from the beginning
+    if (app_state.settings.resume &&
+        AppState_get_rendering_state(&app_state) !=
+            RenderingState_NOT_RENDERING) {
+      AppState_resume_from_checkpoint(&app_state, &renderer);
+      app_state.settings.resume = false;
     }
 
     // === Rendering ===
     AppState_render_and_display_frame(&app_state, &renderer, &gui, &window);
 
     // === post-render Actions ===
+    bool job_finished = false, animation_frame_finished = false;
     // if just finished rendering
     if (AppState_get_rendering_state(&app_state) == RenderingState_FINISHED && app_state.stats.rendering.total_time == 0) {
       StatsTimer_stop(&app_state.stats.rendering);
-      printf("Rendered %d frames in %s.\n",
-             app_state.settings.rendering_params.frames_to_render,
+      printf("Rendered %u frames in %s.\n", app_state.stats.frame_number,
              Stats_fmt_time(app_state.stats.rendering.total_time).str);
 
       if (app_state.settings.save_after_rendering)
         app_state.pending_actions |= Action_save_image;
 
+      // so that the render can still be continued with more frames
+      if (checkpointing)
+        AppState_save_checkpoint(&app_state, &checkpoint_writer, &renderer);
+
       if (app_state.settings.exit_after_rendering)
         app_state.pending_actions |= Action_exit;
+
+      job_finished = batch_mode;
+      animation_frame_finished = animation_mode;
     }
 
     if (Action_save_image & app_state.pending_actions) {
-      AppState_save_image(
-          &app_state, Renderer_get_fbo(&renderer),
-          app_state.settings.rendering_params.rendering_resolution, &tmp_arena);
+      if (ImageFormat_from_path(app_state.settings.saved_image_path.str) !=
+          ImageFormat_PNG) {
+        AppState_save_hdr_image(&app_state, &image_saver, &renderer);
+      } else if (app_state.settings.denoise_enabled) {
+        AppState_save_denoised_image(&app_state, &image_saver, &renderer);
+      } else {
+        Renderer_resolve(&renderer);
+        AppState_save_image(
+            &app_state, &image_saver, Renderer_get_fbo(&renderer),
+            AppState_rendering_params(&app_state).rendering_resolution);
+      }
     }
+    ImageSaver_update(&image_saver);
+
+    if (checkpointing &&
+        AppState_get_rendering_state(&app_state) == RenderingState_RENDERING &&
+        CheckpointWriter_due(&checkpoint_writer,
+                             app_state.settings.checkpoint_interval_s))
+      AppState_save_checkpoint(&app_state, &checkpoint_writer, &renderer);
 
     if (Action_exit & app_state.pending_actions) {
       break;
@@ -107,10 +224,40 @@ int main(const int argc, const char **argv) {
 
     // reset pending_actions for the next frame
     app_state.pending_actions = 0;
+
+    // NOTE: the finished job's image was already read back above,
+    // so the next one can start changing the settings
+    if (job_finished) {
+      Batch_finish_job(&batch, &app_state);
+      if (!Batch_start_next_job(&batch, &app_state))
+        break;
+    }
+    // NOTE: the finished frame gets written while the next one renders
+    if (animation_frame_finished &&
+        !CameraAnimation_next_frame(&animation, &app_state))
+      break;
   }
 
+  // the samples rendered since the last checkpoint shouldn't be lost
+  // when closing the window in the middle of rendering
+  if (checkpointing &&
+      AppState_get_rendering_state(&app_state) == RenderingState_RENDERING &&
+      app_state.stats.frame_number > 0)
+    AppState_save_checkpoint(&app_state, &checkpoint_writer, &renderer);
+
+  // the timed scopes of the whole run, nothing if none were timed
+  if (app_state.settings.print_timings)
+    printf("%s", Timer_str().str);
+
+  Batch_delete(&batch);
+  CameraAnimation_delete(&animation);
+  GltfAnimation_delete(&app_state.scene_animation);
+  // NOTE: waits for the images and checkpoints which are still being saved
+  ImageSaver_delete(&image_saver);
+  CheckpointWriter_delete(&checkpoint_writer);
   Renderer_delete(&renderer);
-  GUIOverlay_delete(&gui);
+  if (!window.headless)
+    GUIOverlay_delete(&gui);
   Window_delete(&window);
 
   return 0;
@@ -18,3 +18,23 @@ Vec3d Mat4_mul_Vec3d(const Mat4 mat, const Vec3d vec) {
 
   return v;
 }
+
+vec3 Mat4_mul_dir(const Mat4 mat, const vec3 dir) {
+  vec3 v = {0};
+  v.x = mat[0] * dir.x + mat[4] * dir.y + mat[8] * dir.z;
+  v.y = mat[1] * dir.x + mat[5] * dir.y + mat[9] * dir.z;
+  v.z = mat[2] * dir.x + mat[6] * dir.y + mat[10] * dir.z;
+
+  return v;
+}
+
+void Mat4_mul(Mat4 out, const Mat4 a, const Mat4 b) {
+  for (int col = 0; col < 4; ++col) {
+    for (int row = 0; row < 4; ++row) {
+      float sum = 0;
+      for (int i = 0; i < 4; ++i)
+        sum += a[i * 4 + row] * b[col * 4 + i];
+      out[col * 4 + row] = sum;
+    }
+  }
+}
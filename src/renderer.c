@@ -1,6 +1,8 @@
 #include "renderer.h"
 #include "arena.h"
+#include "asserts.h"
 #include "opengl/gl_call.h"
+#include "renderer/backend.h"
 #include "renderer/buffers/back.h"
 #include "renderer/buffers/parameters_buffer.h"
 #include "renderer/buffers_scene.h"
@@ -11,9 +13,14 @@
 #include <GLFW/glfw3.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #define VERTEX_SHADER_PATH "shaders/vertex.glsl"
 #define FRAGMENT_SHADER_PATH "shaders/renderer.glsl"
+#define RESOLVE_SHADER_PATH "shaders/resolve.glsl"
+#define ADAPTIVE_SHADER_PATH "shaders/adaptive.glsl"
+#define REPROJECT_SHADER_PATH "shaders/reproject.glsl"
+#define COMPUTE_SHADER_PATH "shaders/renderer_compute.glsl"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -22,55 +29,370 @@
 Renderer Renderer_new(Arena *arena) {
   Renderer self = {._shaders = RendererShaders_new(VERTEX_SHADER_PATH,
                                                    FRAGMENT_SHADER_PATH, arena),
+                   ._resolve_shaders = RendererShaders_new(
+                       VERTEX_SHADER_PATH, RESOLVE_SHADER_PATH, arena),
+                   ._adaptive_shaders = RendererShaders_new(
+                       VERTEX_SHADER_PATH, ADAPTIVE_SHADER_PATH, arena),
+                   ._reproject_shaders = RendererShaders_new(
+                       VERTEX_SHADER_PATH, REPROJECT_SHADER_PATH, arena),
                    ._buffers = RendererBuffers_new(),
-                   ._res = WindowResolution_new(0, 0)};
+                   ._gpu_timer = RendererGpuTimer_new(),
+                   ._params = RendererParameters_default()};
 
   return self;
 }
 
+bool Renderer_update_shaders(Renderer *self, Arena *arena) {
+  // NOTE: all have to be checked, so no short-circuiting
+  bool updated = RendererShaders_update(&self->_shaders, arena);
+  updated |= RendererShaders_update(&self->_resolve_shaders, arena);
+  updated |= RendererShaders_update(&self->_adaptive_shaders, arena);
+  updated |= RendererShaders_update(&self->_reproject_shaders, arena);
+  if (self->_compute_shaders.program != 0)
+    updated |= RendererShaders_update(&self->_compute_shaders, arena);
+  return updated;
+}
+
 void Renderer_load_scene(Renderer *self, const Scene *scene) {
   RendererBuffers_set_scene(&self->_buffers, scene);
   printf("Loaded triangles: %d\n", scene->triangles_count);
   printf("Created nodes: %d\n", scene->bvh_nodes_count);
 }
 
+void Renderer_update_scene_geometry(Renderer *self, const Scene *scene) {
+  RendererBuffersScene_update_geometry(&self->_buffers.scene, scene);
+}
+
 void Renderer_set_camera(Renderer *self, Camera cam) {
   RendererBuffersScene_set_camera(&self->_buffers.scene, cam);
+  self->_camera = cam;
+}
+
+static bool compute_tile_size_supported(uint32_t tile_width,
+                                        uint32_t tile_height) {
+  GLint max_width, max_height, max_invocations;
+  GL_CALL(glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &max_width));
+  GL_CALL(glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &max_height));
+  GL_CALL(glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &max_invocations));
+
+  return tile_width > 0 && tile_height > 0 &&
+         tile_width <= (uint32_t)max_width &&
+         tile_height <= (uint32_t)max_height &&
+         tile_width * tile_height <= (uint32_t)max_invocations;
+}
+
+// (re)compiles the compute shader if it doesn't match the parameters
+static void Renderer_prepare_compute_shaders(Renderer *self, Arena *arena) {
+  char defines[sizeof(self->_compute_shaders.defines)];
+  snprintf(defines, sizeof(defines),
+           "#define TILE_WIDTH %u\n#define TILE_HEIGHT %u\n%s",
+           self->_params.tile_width, self->_params.tile_height,
+           self->_params.backend == RendererBackend_PERSISTENT
+               ? "#define PERSISTENT\n"
+               : "");
+
+  if (self->_compute_shaders.program != 0) {
+    if (strcmp(self->_compute_shaders.defines, defines) == 0)
+      return;
+    RendererShaders_delete(&self->_compute_shaders);
+  }
+  self->_compute_shaders =
+      RendererShaders_new_compute(COMPUTE_SHADER_PATH, defines, arena);
 }
 
-void Renderer_set_params(Renderer *self, RendererParameters params) {
-  self->_res = params.rendering_resolution;
+void Renderer_set_params(Renderer *self, RendererParameters params,
+                         Arena *arena) {
+  self->_params = params;
   // update OpenGL's window coordinates
-  GL_CALL(glViewport(0, 0, self->_res.width, self->_res.height));
+  GL_CALL(glViewport(0, 0, params.rendering_resolution.width,
+                     params.rendering_resolution.height));
   RendererParametersBuffer_set(&self->_buffers.parameters, &params);
+
+  if (params.backend == RendererBackend_FRAGMENT)
+    return;
+
+  if (!compute_tile_size_supported(params.tile_width, params.tile_height)) {
+    fprintf(stderr,
+            YELLOW("WARNING:") " Tile size %ux%u isn't supported by the GPU, "
+                               "rendering with the fragment shader instead\n",
+            params.tile_width, params.tile_height);
+    self->_params.backend = RendererBackend_FRAGMENT;
+    return;
+  }
+  Renderer_prepare_compute_shaders(self, arena);
+}
+
+static void bind_texture(GLuint program, const char *name, GLint unit,
+                         GLuint texture) {
+  GL_CALL(glActiveTexture(GL_TEXTURE0 + unit));
+  GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+  GL_CALL(glUniform1i(glGetUniformLocation(program, name), unit));
+  GL_CALL(glActiveTexture(GL_TEXTURE0));
 }
 
 void Renderer_clear_backbuffer(Renderer *self) {
-  RendererBuffersBack_resize(&self->_buffers.back, self->_res);
+  RendererBuffersBack_resize(&self->_buffers.back,
+                             self->_params.rendering_resolution);
+  self->_accumulated_camera = self->_camera;
+  // NOTE: reprojecting keeps advancing it
+  self->_seed_offset = 0;
+}
+
+static void set_camera_uniforms(GLuint program, const char *name,
+                                const Camera *cam) {
+  char uniform[64];
+  snprintf(uniform, sizeof(uniform), "%s.pos", name);
+  GL_CALL(glUniform4f(glGetUniformLocation(program, uniform), cam->pos.x,
+                      cam->pos.y, cam->pos.z, 0));
+  snprintf(uniform, sizeof(uniform), "%s.dir", name);
+  GL_CALL(glUniform4f(glGetUniformLocation(program, uniform), cam->dir.x,
+                      cam->dir.y, cam->dir.z, 0));
+  snprintf(uniform, sizeof(uniform), "%s.up", name);
+  GL_CALL(glUniform4f(glGetUniformLocation(program, uniform), cam->up.x,
+                      cam->up.y, cam->up.z, 0));
+  snprintf(uniform, sizeof(uniform), "%s.yfov", name);
+  GL_CALL(glUniform1f(glGetUniformLocation(program, uniform), cam->fov_rad));
+}
+
+void Renderer_reproject(Renderer *self, uint32_t frames_rendered) {
+  RendererBuffersBack *back = &self->_buffers.back;
+  RendererBuffersBack_copy_to_history(back, self->_params.rendering_resolution);
+
+  const GLuint program = self->_reproject_shaders.program;
+  GL_CALL(glUseProgram(program));
+  set_camera_uniforms(program, "previousCamera", &self->_accumulated_camera);
+  GL_CALL(glBindVertexArray(self->_buffers.internal.vao));
+
+  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, back->fbo));
+  bind_texture(program, "historyTexture", 0, back->history_textures[0]);
+  bind_texture(program, "historyMomentsTexture", 1, back->history_textures[1]);
+  bind_texture(program, "historyAlbedoTexture", 2, back->history_textures[2]);
+  bind_texture(program, "historyNormalTexture", 3, back->history_textures[3]);
+  GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+  // the next frame reads the texels that were just written
+  GL_CALL(glTextureBarrier());
+
+  self->_accumulated_camera = self->_camera;
+  self->_seed_offset += frames_rendered;
 }
 
 GLuint Renderer_get_fbo(const Renderer *self) {
-  return self->_buffers.back.fbo;
+  return self->_buffers.back.resolve_fbo;
 }
 
-void Renderer_render_frame(const Renderer *self, uint32_t frame_number) {
+// reads back the floats of the given attachment of the back buffer's fbo
+static void read_back_buffer(const Renderer *self, GLenum attachment,
+                             GLenum format, float *out) {
+  GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, self->_buffers.back.fbo));
+  GL_CALL(glReadBuffer(attachment));
+  GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+  const WindowResolution res = self->_params.rendering_resolution;
+  GL_CALL(glReadPixels(0, 0, res.width, res.height, format, GL_FLOAT, out));
+  GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+}
+
+void Renderer_read_accumulation(const Renderer *self, float *rgba) {
+  read_back_buffer(self, GL_COLOR_ATTACHMENT0, GL_RGBA, rgba);
+}
+
+void Renderer_read_aovs(const Renderer *self, float *moments, float *albedo,
+                        float *normal) {
+  if (moments != NULL)
+    read_back_buffer(self, GL_COLOR_ATTACHMENT1, GL_RG, moments);
+  if (albedo != NULL)
+    read_back_buffer(self, GL_COLOR_ATTACHMENT2, GL_RGBA, albedo);
+  if (normal != NULL)
+    read_back_buffer(self, GL_COLOR_ATTACHMENT3, GL_RGBA, normal);
+}
+
+// uploads the floats of the given texture of the back buffer's fbo
+static void write_back_buffer(const Renderer *self, GLuint texture,
+                              GLenum format, const float *in) {
+  GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+  const WindowResolution res = self->_params.rendering_resolution;
+  GL_CALL(glTextureSubImage2D(texture, 0, 0, 0, res.width, res.height, format,
+                              GL_FLOAT, in));
+}
+
+void Renderer_write_accumulation(Renderer *self, const float *rgba) {
+  write_back_buffer(self, self->_buffers.back.fboTex, GL_RGBA, rgba);
+}
+
+void Renderer_write_aovs(Renderer *self, const float *moments,
+                         const float *albedo, const float *normal) {
+  const RendererBuffersBack *back = &self->_buffers.back;
+  write_back_buffer(self, back->moments_tex, GL_RG, moments);
+  write_back_buffer(self, back->albedo_tex, GL_RGBA, albedo);
+  write_back_buffer(self, back->normal_tex, GL_RGBA, normal);
+}
+
+void Renderer_set_seed_offset(Renderer *self, uint32_t seed_offset) {
+  self->_seed_offset = seed_offset;
+}
+
+uint32_t Renderer_get_seed_offset(const Renderer *self) {
+  return self->_seed_offset;
+}
+
+static void render_frame_fragment(const Renderer *self,
+                                  uint32_t frame_number) {
   // setup the program and bind the vao associated with the quad
   // and the vbo holding the vertices of the quad
   GL_CALL(glUseProgram(self->_shaders.program));
   GL_CALL(
       glUniform1i(glGetUniformLocation(self->_shaders.program, "frame_number"),
                   frame_number));
+  GL_CALL(
+      glUniform1ui(glGetUniformLocation(self->_shaders.program, "seed_offset"),
+                   self->_seed_offset));
+  GL_CALL(
+      glUniform1i(glGetUniformLocation(self->_shaders.program, "measuring"),
+                  self->_gpu_timer.measuring));
   GL_CALL(glBindVertexArray(self->_buffers.internal.vao));
 
   GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, self->_buffers.back.fbo));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, self->_buffers.back.fboTex));
+  const RendererBuffersBack *back = &self->_buffers.back;
+  bind_texture(self->_shaders.program, "backBufferTexture", 0, back->fboTex);
+  bind_texture(self->_shaders.program, "momentsTexture", 1, back->moments_tex);
+  bind_texture(self->_shaders.program, "adaptiveSamplesTexture", 2,
+               back->adaptive_tex);
+  bind_texture(self->_shaders.program, "albedoTexture", 3, back->albedo_tex);
+  bind_texture(self->_shaders.program, "normalTexture", 4, back->normal_tex);
+  GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+
+  // NOTE: the shader reads the same texel of the texture it writes to, which
+  // is well defined only with a barrier between consecutive draws
+  GL_CALL(glTextureBarrier());
+}
+
+static void render_frame_compute(const Renderer *self, uint32_t frame_number) {
+  const GLuint program = self->_compute_shaders.program;
+  const RendererParameters *params = &self->_params;
+
+  GL_CALL(glUseProgram(program));
+  GL_CALL(glUniform1i(glGetUniformLocation(program, "frame_number"),
+                      frame_number));
+  GL_CALL(glUniform1ui(glGetUniformLocation(program, "seed_offset"),
+                       self->_seed_offset));
+  GL_CALL(glUniform1i(glGetUniformLocation(program, "measuring"),
+                      self->_gpu_timer.measuring));
+  GL_CALL(glBindImageTexture(0, self->_buffers.back.fboTex, 0, GL_FALSE, 0,
+                             GL_READ_WRITE, GL_RGBA32F));
+  GL_CALL(glBindImageTexture(1, self->_buffers.back.moments_tex, 0, GL_FALSE, 0,
+                             GL_READ_WRITE, GL_RG32F));
+  GL_CALL(glBindImageTexture(2, self->_buffers.back.albedo_tex, 0, GL_FALSE, 0,
+                             GL_READ_WRITE, GL_RGBA32F));
+  GL_CALL(glBindImageTexture(3, self->_buffers.back.normal_tex, 0, GL_FALSE, 0,
+                             GL_READ_WRITE, GL_RGBA32F));
+  bind_texture(program, "adaptiveSamplesTexture", 0,
+               self->_buffers.back.adaptive_tex);
+
+  if (params->backend == RendererBackend_PERSISTENT) {
+    // the workgroups keep taking tiles until the counter goes past the last one
+    GL_CALL(glClearNamedBufferData(self->_buffers.internal.tile_counter_ssbo,
+                                   GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                                   NULL));
+    GL_CALL(glDispatchCompute(params->persistent_workgroups, 1, 1));
+  } else {
+    const WindowResolution res = params->rendering_resolution;
+    GL_CALL(glDispatchCompute(
+        (res.width + params->tile_width - 1) / params->tile_width,
+        (res.height + params->tile_height - 1) / params->tile_height, 1));
+  }
+
+  // the next frame, the resolve pass and reading back the accumulation
+  // all have to see what was just stored, and the counter can't be cleared
+  // before the atomics are done with it
+  GL_CALL(glMemoryBarrier(
+      GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT |
+      GL_FRAMEBUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+}
+
+// renders how many samples each pixel should get in the frame, based on how
+// much their neighbourhoods have already converged
+static void prepare_adaptive_samples(const Renderer *self,
+                                     uint32_t frame_number) {
+  const GLuint program = self->_adaptive_shaders.program;
+  GL_CALL(glUseProgram(program));
+  GL_CALL(glUniform1i(glGetUniformLocation(program, "frame_number"),
+                      frame_number));
+  GL_CALL(glBindVertexArray(self->_buffers.internal.vao));
+
+  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, self->_buffers.back.adaptive_fbo));
+  bind_texture(program, "accumulationTexture", 0, self->_buffers.back.fboTex);
+  bind_texture(program, "momentsTexture", 1, self->_buffers.back.moments_tex);
+
+  // the previous frame's count is still needed for spreading out the samples
+  GL_CALL(glClearNamedBufferSubData(
+      self->_buffers.internal.sampled_pixels_ssbo, GL_R32UI,
+      (frame_number % 2) * sizeof(uint32_t), sizeof(uint32_t), GL_RED_INTEGER,
+      GL_UNSIGNED_INT, NULL));
+  GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+
+  // the count is read by the next frame's pass and by the host
+  GL_CALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+                          GL_BUFFER_UPDATE_BARRIER_BIT));
+}
+
+void Renderer_render_frame(const Renderer *self, uint32_t frame_number) {
+  if (self->_params.adaptive_threshold > 0)
+    prepare_adaptive_samples(self, frame_number);
+
+  switch ((RendererBackend)self->_params.backend) {
+  case RendererBackend_FRAGMENT:
+    render_frame_fragment(self, frame_number);
+    break;
+  case RendererBackend_COMPUTE:
+  case RendererBackend_PERSISTENT:
+    render_frame_compute(self, frame_number);
+    break;
+  case RendererBackend__COUNT:
+    UNREACHABLE();
+  }
+}
+
+uint32_t Renderer_get_sampled_pixels(const Renderer *self,
+                                     uint32_t frame_number) {
+  uint32_t sampled_pixels;
+  GL_CALL(glGetNamedBufferSubData(self->_buffers.internal.sampled_pixels_ssbo,
+                                  (frame_number % 2) * sizeof(uint32_t),
+                                  sizeof(uint32_t), &sampled_pixels));
+  return sampled_pixels;
+}
+
+void Renderer_begin_measuring(Renderer *self) {
+  RendererGpuTimer_begin(&self->_gpu_timer);
+}
+
+void Renderer_end_measuring(Renderer *self, uint32_t frames) {
+  const WindowResolution res = self->_params.rendering_resolution;
+  RendererGpuTimer_end(&self->_gpu_timer, frames, res.width * res.height);
+}
+
+bool Renderer_poll_measurement(Renderer *self, RendererGpuMeasurement *out) {
+  return RendererGpuTimer_poll(&self->_gpu_timer, out);
+}
+
+void Renderer_resolve(const Renderer *self) {
+  GL_CALL(glUseProgram(self->_resolve_shaders.program));
+  GL_CALL(glBindVertexArray(self->_buffers.internal.vao));
+
+  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, self->_buffers.back.resolve_fbo));
   GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glUniform1i(
-      glGetUniformLocation(self->_shaders.program, "BackBufferTexture"), 0));
+  GL_CALL(glBindTexture(GL_TEXTURE_2D, self->_buffers.back.fboTex));
+  GL_CALL(glUniform1i(glGetUniformLocation(self->_resolve_shaders.program,
+                                           "accumulationTexture"),
+                      0));
   GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
 }
 
 void Renderer_delete(Renderer *self) {
   RendererShaders_delete(&self->_shaders);
+  RendererShaders_delete(&self->_resolve_shaders);
+  RendererShaders_delete(&self->_adaptive_shaders);
+  RendererShaders_delete(&self->_reproject_shaders);
+  if (self->_compute_shaders.program != 0)
+    RendererShaders_delete(&self->_compute_shaders);
   RendererBuffers_delete(&self->_buffers);
+  RendererGpuTimer_delete(&self->_gpu_timer);
 }
@@ -3,18 +3,17 @@
 #include "window/resolution.h"
 #include <stddef.h>
 
-RendererBuffersBack RendererBuffersBack_new(void) {
-  RendererBuffersBack self = {0};
-
-  GL_CALL(glGenFramebuffers(1, &self.fbo));
-  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, self.fbo));
+static void create_framebuffer(GLuint *fbo, GLuint *tex,
+                               GLint internal_format) {
+  GL_CALL(glGenFramebuffers(1, fbo));
+  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, *fbo));
 
   // create the texture for the framebuffer
-  GL_CALL(glGenTextures(1, &self.fboTex));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, self.fboTex));
+  GL_CALL(glGenTextures(1, tex));
+  GL_CALL(glBindTexture(GL_TEXTURE_2D, *tex));
   // NOTE: resolution has to be set with the resize function, which is assumed
   // to happen before drawing to this framebuffer
-  GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 1, 1, 0, GL_RGB,
+  GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, internal_format, 1, 1, 0, GL_RGBA,
                        GL_FLOAT, NULL));
   GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
   GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
@@ -22,21 +21,119 @@ RendererBuffersBack RendererBuffersBack_new(void) {
 
   // attach the texture to our framebuffer
   GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                 GL_TEXTURE_2D, self.fboTex, 0));
+                                 GL_TEXTURE_2D, *tex, 0));
+  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+// textures attached to fbo after fboTex, which get accumulated
+// in the same pass, NOTE: in the order of their attachments
+#define ACCUMULATED_TEXTURES_COUNT 3
+static const GLint accumulated_formats[ACCUMULATED_TEXTURES_COUNT] = {
+    GL_RG32F, GL_RGBA32F, GL_RGBA32F};
+static GLuint *accumulated_textures(RendererBuffersBack *self, int i) {
+  GLuint *textures[ACCUMULATED_TEXTURES_COUNT] = {
+      &self->moments_tex, &self->albedo_tex, &self->normal_tex};
+  return textures[i];
+}
+
+RendererBuffersBack RendererBuffersBack_new(void) {
+  RendererBuffersBack self = {0};
+  create_framebuffer(&self.fbo, &self.fboTex, GL_RGBA32F);
+
+  GLenum draw_buffers[1 + ACCUMULATED_TEXTURES_COUNT] = {GL_COLOR_ATTACHMENT0};
+  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, self.fbo));
+  for (int i = 0; i < ACCUMULATED_TEXTURES_COUNT; ++i) {
+    GLuint *tex = accumulated_textures(&self, i);
+    GL_CALL(glGenTextures(1, tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, *tex));
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, accumulated_formats[i], 1, 1, 0,
+                         GL_RGBA, GL_FLOAT, NULL));
+    // NOTE: without mipmaps the default filter would make the texture
+    // incomplete, reading back only zeros
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+
+    draw_buffers[i + 1] = GL_COLOR_ATTACHMENT1 + i;
+    GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, draw_buffers[i + 1],
+                                   GL_TEXTURE_2D, *tex, 0));
+  }
+  GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+  GL_CALL(glDrawBuffers(1 + ACCUMULATED_TEXTURES_COUNT, draw_buffers));
   GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
+  create_framebuffer(&self.resolve_fbo, &self.resolve_tex, GL_RGBA8);
+  create_framebuffer(&self.adaptive_fbo, &self.adaptive_tex, GL_R32F);
   return self;
 }
 
 void RendererBuffersBack_resize(RendererBuffersBack *self,
                                 WindowResolution res) {
   GL_CALL(glBindTexture(GL_TEXTURE_2D, self->fboTex));
-  GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, res.width, res.height, 0,
-                       GL_RGB, GL_FLOAT, NULL));
+  GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, res.width, res.height, 0,
+                       GL_RGBA, GL_FLOAT, NULL));
+  for (int i = 0; i < ACCUMULATED_TEXTURES_COUNT; ++i) {
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, *accumulated_textures(self, i)));
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, accumulated_formats[i], res.width,
+                         res.height, 0, GL_RGBA, GL_FLOAT, NULL));
+  }
+  GL_CALL(glBindTexture(GL_TEXTURE_2D, self->resolve_tex));
+  GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, res.width, res.height, 0,
+                       GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+  GL_CALL(glBindTexture(GL_TEXTURE_2D, self->adaptive_tex));
+  GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, res.width, res.height, 0,
+                       GL_RED, GL_FLOAT, NULL));
   GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+
+  // the accumulated sums must start from zero
+  GL_CALL(glClearTexImage(self->fboTex, 0, GL_RGBA, GL_FLOAT, NULL));
+  for (int i = 0; i < ACCUMULATED_TEXTURES_COUNT; ++i)
+    GL_CALL(glClearTexImage(*accumulated_textures(self, i), 0, GL_RGBA,
+                            GL_FLOAT, NULL));
+}
+
+// all textures attached to fbo, NOTE: in the order of their attachments
+static GLuint fbo_texture(RendererBuffersBack *self, int i) {
+  return i == 0 ? self->fboTex : *accumulated_textures(self, i - 1);
+}
+static GLint fbo_texture_format(int i) {
+  return i == 0 ? GL_RGBA32F : accumulated_formats[i - 1];
+}
+
+void RendererBuffersBack_copy_to_history(RendererBuffersBack *self,
+                                         WindowResolution res) {
+  if (self->history_textures[0] == 0 ||
+      !WindowResolution_eq(self->history_resolution, res)) {
+    if (self->history_textures[0] != 0)
+      GL_CALL(glDeleteTextures(1 + ACCUMULATED_TEXTURES_COUNT,
+                               self->history_textures));
+    GL_CALL(glCreateTextures(GL_TEXTURE_2D, 1 + ACCUMULATED_TEXTURES_COUNT,
+                             self->history_textures));
+    for (int i = 0; i < 1 + ACCUMULATED_TEXTURES_COUNT; ++i) {
+      const GLuint tex = self->history_textures[i];
+      GL_CALL(glTextureStorage2D(tex, 1, fbo_texture_format(i), res.width,
+                                 res.height));
+      GL_CALL(glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+      GL_CALL(glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    }
+    self->history_resolution = res;
+  }
+
+  for (int i = 0; i < 1 + ACCUMULATED_TEXTURES_COUNT; ++i)
+    GL_CALL(glCopyImageSubData(fbo_texture(self, i), GL_TEXTURE_2D, 0, 0, 0, 0,
+                               self->history_textures[i], GL_TEXTURE_2D, 0, 0,
+                               0, 0, res.width, res.height, 1));
 }
 
 void RendererBuffersBack_delete(RendererBuffersBack *self) {
   GL_CALL(glDeleteFramebuffers(1, &self->fbo));
   GL_CALL(glDeleteTextures(1, &self->fboTex));
+  for (int i = 0; i < ACCUMULATED_TEXTURES_COUNT; ++i)
+    GL_CALL(glDeleteTextures(1, accumulated_textures(self, i)));
+  GL_CALL(glDeleteFramebuffers(1, &self->resolve_fbo));
+  GL_CALL(glDeleteTextures(1, &self->resolve_tex));
+  GL_CALL(glDeleteFramebuffers(1, &self->adaptive_fbo));
+  GL_CALL(glDeleteTextures(1, &self->adaptive_tex));
+  if (self->history_textures[0] != 0)
+    GL_CALL(glDeleteTextures(1 + ACCUMULATED_TEXTURES_COUNT,
+                             self->history_textures));
 }
@@ -1,5 +1,7 @@
 #include "renderer/buffers/internal.h"
+#include "opengl/generate_ssbo.h"
 #include "opengl/gl_call.h"
+#include <stdint.h>
 #include <stddef.h>
 
 RendererBuffersInternal RendererBuffersInternal_new(void) {
@@ -41,10 +43,18 @@ RendererBuffersInternal RendererBuffersInternal_new(void) {
   // unbind the vao
   GL_CALL(glBindVertexArray(0));
 
+  uint32_t tile_counter = 0;
+  generate_ssbo(&self.tile_counter_ssbo, &tile_counter, sizeof(tile_counter), 7);
+  uint32_t sampled_pixels[2] = {0};
+  generate_ssbo(&self.sampled_pixels_ssbo, sampled_pixels,
+                sizeof(sampled_pixels), 11);
+
   return self;
 }
 
 void RendererBuffersInternal_delete(RendererBuffersInternal *self) {
   GL_CALL(glDeleteVertexArrays(1, &self->vao));
   GL_CALL(glDeleteBuffers(1, &self->vbo));
+  GL_CALL(glDeleteBuffers(1, &self->tile_counter_ssbo));
+  GL_CALL(glDeleteBuffers(1, &self->sampled_pixels_ssbo));
 }
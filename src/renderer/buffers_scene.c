@@ -1,9 +1,11 @@
 #include "renderer/buffers_scene.h"
 #include "opengl/generate_ssbo.h"
 #include "opengl/gl_call.h"
+#include "utils/timer.h"
 #include <stddef.h>
 
 RendererBuffersScene RendererBuffersScene_new(const Scene *scene) {
+  Timer_begin("RendererBuffersScene_new");
   RendererBuffersScene self = {0};
 
   generate_ssbo(&self.triangles_ssbo, scene->triangles,
@@ -16,6 +18,28 @@ RendererBuffersScene RendererBuffersScene_new(const Scene *scene) {
                 scene->triangles_count * sizeof(TriangleEx), 4);
   generate_ssbo(&self.camera_ssbo, &scene->camera, sizeof(Camera), 5);
 
+  // the lights are preceded by their count and total power
+  const LightsHeader lights_header = {.count = scene->lights_count,
+                                      .total_power = scene->lights_total_power};
+  generate_ssbo(&self.lights_ssbo, NULL,
+                sizeof(LightsHeader) + scene->lights_count * sizeof(Light), 8);
+  GL_CALL(glNamedBufferSubData(self.lights_ssbo, 0, sizeof(LightsHeader),
+                               &lights_header));
+  if (scene->lights_count > 0)
+    GL_CALL(glNamedBufferSubData(self.lights_ssbo, sizeof(LightsHeader),
+                                 scene->lights_count * sizeof(Light),
+                                 scene->lights));
+
+  // NOTE: buffers can't be empty, so there's always at least one node,
+  // which isn't accessed without any lights anyway
+  const uint32_t light_bvh_nodes_count =
+      scene->light_bvh_nodes_count > 0 ? scene->light_bvh_nodes_count : 1;
+  generate_ssbo(&self.light_bvh_nodes_ssbo, scene->light_bvh_nodes,
+                light_bvh_nodes_count * sizeof(LightBVHnode), 9);
+  generate_ssbo(&self.triangles_lights_ssbo, scene->triangles_lights,
+                scene->triangles_count * sizeof(uint32_t), 10);
+
+  Timer_end();
   return self;
 }
 
@@ -24,10 +48,39 @@ void RendererBuffersScene_set_camera(RendererBuffersScene *self,
   GL_CALL(glNamedBufferSubData(self->camera_ssbo, 0, sizeof(Camera), &camera));
 }
 
+void RendererBuffersScene_update_geometry(RendererBuffersScene *self,
+                                          const Scene *scene) {
+  Timer_begin("RendererBuffersScene_update_geometry");
+  GL_CALL(glNamedBufferSubData(self->triangles_ssbo, 0,
+                               scene->triangles_count * sizeof(Triangle),
+                               scene->triangles));
+  GL_CALL(glNamedBufferSubData(self->bvh_nodes_ssbo, 0,
+                               scene->bvh_nodes_count * sizeof(BVHnode),
+                               scene->bvh_nodes));
+
+  const LightsHeader lights_header = {.count = scene->lights_count,
+                                      .total_power = scene->lights_total_power};
+  GL_CALL(glNamedBufferSubData(self->lights_ssbo, 0, sizeof(LightsHeader),
+                               &lights_header));
+  if (scene->lights_count > 0) {
+    GL_CALL(glNamedBufferSubData(self->lights_ssbo, sizeof(LightsHeader),
+                                 scene->lights_count * sizeof(Light),
+                                 scene->lights));
+    GL_CALL(glNamedBufferSubData(
+        self->light_bvh_nodes_ssbo, 0,
+        scene->light_bvh_nodes_count * sizeof(LightBVHnode),
+        scene->light_bvh_nodes));
+  }
+  Timer_end();
+}
+
 void RendererBuffersScene_delete(RendererBuffersScene *self) {
   GL_CALL(glDeleteBuffers(1, &self->bvh_nodes_ssbo));
   GL_CALL(glDeleteBuffers(1, &self->triangles_ssbo));
   GL_CALL(glDeleteBuffers(1, &self->mats_ssbo));
   GL_CALL(glDeleteBuffers(1, &self->triangles_data_ssbo));
   GL_CALL(glDeleteBuffers(1, &self->camera_ssbo));
+  GL_CALL(glDeleteBuffers(1, &self->lights_ssbo));
+  GL_CALL(glDeleteBuffers(1, &self->light_bvh_nodes_ssbo));
+  GL_CALL(glDeleteBuffers(1, &self->triangles_lights_ssbo));
 }
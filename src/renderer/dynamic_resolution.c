@@ -0,0 +1,58 @@
+#include "renderer/dynamic_resolution.h"
+#include <math.h>
+
+// how much the scale can change in a single frame, as a single slow frame
+// (e.g. one that had to reload the scene) shouldn't drop it to the minimum
+#define MAX_SCALE_CHANGE 2.0f
+
+DynamicResolution DynamicResolution_new(void) {
+  return (DynamicResolution){.scale = 0.5f, .active = false, .still_frames = 0};
+}
+
+static float clamp(float v, float min, float max) {
+  return v < min ? min : v > max ? max : v;
+}
+
+bool DynamicResolution_update(DynamicResolution *self, bool camera_moving,
+                              double last_frame_time,
+                              double target_frame_time) {
+  if (!camera_moving) {
+    if (!self->active || ++self->still_frames < DYNAMIC_RESOLUTION_STILL_FRAMES)
+      return false;
+    self->active = false;
+    return true;
+  }
+  self->still_frames = 0;
+  // the last frame was rendered at the full resolution, so it tells nothing
+  // about the current scale, which is the one used the last time instead
+  if (!self->active) {
+    self->active = true;
+    return true;
+  }
+  if (last_frame_time <= 0)
+    return false;
+
+  // time to render a frame grows with the number of pixels,
+  // so with the square of the scale
+  float wanted = self->scale * sqrtf(target_frame_time / last_frame_time);
+  wanted = clamp(wanted, self->scale / MAX_SCALE_CHANGE,
+                 self->scale * MAX_SCALE_CHANGE);
+  wanted = clamp(wanted, DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f);
+  if (fabsf(wanted - self->scale) < DYNAMIC_RESOLUTION_SCALE_STEP)
+    return false;
+
+  self->scale = clamp(roundf(wanted / DYNAMIC_RESOLUTION_SCALE_STEP) *
+                          DYNAMIC_RESOLUTION_SCALE_STEP,
+                      DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f);
+  return true;
+}
+
+WindowResolution DynamicResolution_apply(const DynamicResolution *self,
+                                         WindowResolution resolution) {
+  if (!self->active)
+    return resolution;
+
+  const unsigned int width = roundf(resolution.width * self->scale);
+  const unsigned int height = roundf(resolution.height * self->scale);
+  return WindowResolution_new(width > 0 ? width : 1, height > 0 ? height : 1);
+}
@@ -0,0 +1,81 @@
+#include "renderer/gpu_timer.h"
+#include "opengl/generate_ssbo.h"
+#include "opengl/gl_call.h"
+#include <stddef.h>
+
+// where pathtracer.glsl adds the rays and samples it traced
+#define COUNTERS_BINDING 12
+
+RendererGpuTimer RendererGpuTimer_new(void) {
+  RendererGpuTimer self = {0};
+  GL_CALL(glCreateQueries(GL_TIME_ELAPSED, RENDERER_GPU_TIMER_BATCHES,
+                          self._queries));
+  const uint32_t counters[4] = {0};
+  for (uint32_t i = 0; i < RENDERER_GPU_TIMER_BATCHES; ++i)
+    generate_ssbo(&self._counters_ssbos[i], counters, sizeof(counters),
+                  COUNTERS_BINDING);
+  return self;
+}
+
+void RendererGpuTimer_begin(RendererGpuTimer *self) {
+  const uint32_t i = self->_current;
+  // NOTE: if the batch which used them last didn't get read back yet, it
+  // never will, as the GPU is still busy with it
+  self->_pending[i] = false;
+  GL_CALL(glClearNamedBufferData(self->_counters_ssbos[i], GL_R32UI,
+                                 GL_RED_INTEGER, GL_UNSIGNED_INT, NULL));
+  GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTERS_BINDING,
+                           self->_counters_ssbos[i]));
+  GL_CALL(glBeginQuery(GL_TIME_ELAPSED, self->_queries[i]));
+  self->measuring = true;
+}
+
+void RendererGpuTimer_end(RendererGpuTimer *self, uint32_t frames,
+                          uint32_t pixels) {
+  const uint32_t i = self->_current;
+  GL_CALL(glEndQuery(GL_TIME_ELAPSED));
+  // the counters get read back by the host
+  GL_CALL(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+  self->_pending[i] = true;
+  self->_frames[i] = frames;
+  self->_pixels[i] = pixels;
+  self->_current = (i + 1) % RENDERER_GPU_TIMER_BATCHES;
+  self->measuring = false;
+}
+
+bool RendererGpuTimer_poll(RendererGpuTimer *self,
+                           RendererGpuMeasurement *out) {
+  bool polled = false;
+  // from the oldest batch to the latest one
+  for (uint32_t n = 0; n < RENDERER_GPU_TIMER_BATCHES; ++n) {
+    const uint32_t i = (self->_current + n) % RENDERER_GPU_TIMER_BATCHES;
+    if (!self->_pending[i])
+      continue;
+    GLint available = 0;
+    GL_CALL(glGetQueryObjectiv(self->_queries[i], GL_QUERY_RESULT_AVAILABLE,
+                               &available));
+    if (!available)
+      continue;
+
+    GLuint64 time_ns = 0;
+    GL_CALL(glGetQueryObjectui64v(self->_queries[i], GL_QUERY_RESULT, &time_ns));
+    uint32_t counters[4];
+    GL_CALL(glGetNamedBufferSubData(self->_counters_ssbos[i], 0,
+                                    sizeof(counters), counters));
+    *out = (RendererGpuMeasurement){
+        .time_ns = time_ns,
+        .rays = (uint64_t)counters[1] << 32 | counters[0],
+        .samples = (uint64_t)counters[3] << 32 | counters[2],
+        .frames = self->_frames[i],
+        .pixels = self->_pixels[i],
+    };
+    self->_pending[i] = false;
+    polled = true;
+  }
+  return polled;
+}
+
+void RendererGpuTimer_delete(RendererGpuTimer *self) {
+  GL_CALL(glDeleteQueries(RENDERER_GPU_TIMER_BATCHES, self->_queries));
+  GL_CALL(glDeleteBuffers(RENDERER_GPU_TIMER_BATCHES, self->_counters_ssbos));
+}
@@ -1,5 +1,6 @@
 #include "renderer/parameters.h"
 #include "asserts.h"
+#include "renderer/backend.h"
 #include "window/resolution.h"
 #include <stdio.h>
 
@@ -9,16 +10,29 @@ RendererParameters RendererParameters_default(void) {
                               .diverge_strength = 0.001,
                               .frames_to_render = -1,
                               .rendering_resolution =
-                                  WindowResolution_new(1280, 720)};
+                                  WindowResolution_new(1280, 720),
+                              .backend = RendererBackend_FRAGMENT,
+                              .tile_width = 8,
+                              .tile_height = 8,
+                              .persistent_workgroups = 64,
+                              .russian_roulette_depth = 3};
 }
 
 SmallString RendererParameters_str(const RendererParameters *self) {
   SmallString str = {0};
   int written = snprintf(str.str, sizeof(str.str),
                          "max_bounce_count: %d\nsamples_per_pixel: %d\n"
-                         "diverge_strength: %.5f\nframes_to_render: %d\n",
+                         "diverge_strength: %.5f\nframes_to_render: %d\n"
+                         "backend: %s\ntile_size: %ux%u\n"
+                         "persistent_workgroups: %u\n"
+                         "russian_roulette_depth: %d\n"
+                         "adaptive_threshold: %.4f\n",
                          self->max_bounce_count, self->samples_per_pixel,
-                         self->diverge_strength, self->frames_to_render);
+                         self->diverge_strength, self->frames_to_render,
+                         RendererBackend_str[self->backend], self->tile_width,
+                         self->tile_height, self->persistent_workgroups,
+                         self->russian_roulette_depth,
+                         self->adaptive_threshold);
   ASSERTQ_CUSTOM(written < (int)sizeof(str.str),
                  "SmallString too small to store RendererParameters!");
   return str;
@@ -1,11 +1,14 @@
 #include "renderer/shaders.h"
 #include "arena.h"
+#include "asserts.h"
 #include "opengl/gl_call.h"
 #include "utils.h"
 #include "utils/file_watcher.h"
+#include "utils/timer.h"
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // renders just pure white
 #define DEFAULT_FRAGMENT_SHADER                                                \
@@ -13,13 +16,29 @@
 #define DEFAULT_VERTEX_SHADER                                                  \
   "#version 330 core\nlayout(location = 0) in vec3 aPos;\nvoid "               \
   "main(){gl_Position=vec4(aPos,1.0);}"
+// does nothing, leaving the accumulated image as it was
+#define DEFAULT_COMPUTE_SHADER                                                 \
+  "#version 430 core\nlayout(local_size_x = 1) in;\nvoid main(){}"
 
-static GLuint create_shader_program(const char *vertex_shader_filename,
-                                    const char *fragment_shader_filename,
-                                    Arena *arena);
-static GLuint
-create_shader_program_from_source(const char *vertex_shader_src,
-                                  const char *fragment_shader_src);
+#define INCLUDE_DIRECTIVE "#include \""
+
+// NOTE: every include splits the source into 3 more parts,
+// with the 2 extra for the #line directives around it
+#define SHADER_SOURCE_MAX_PARTS (4 + 5 * RENDERER_SHADERS_MAX_INCLUDES)
+
+// a shader's source split into parts, as accepted by glShaderSource
+typedef struct {
+  const GLchar *strings[SHADER_SOURCE_MAX_PARTS];
+  GLint lengths[SHADER_SOURCE_MAX_PARTS];
+  GLsizei count;
+} ShaderSource;
+
+static ShaderSource ShaderSource_from_string(const char *src);
+static ShaderSource read_shader_source(RendererShaders *self, const char *path,
+                                       const char *defines, Arena *arena);
+static GLuint create_shader_program(const ShaderSource *vertex_shader_src,
+                                    const ShaderSource *fragment_shader_src);
+static GLuint create_compute_program(const ShaderSource *compute_shader_src);
 
 RendererShaders RendererShaders_new(const char *vertex_shader_path,
                                     const char *fragment_shader_path,
@@ -33,9 +52,28 @@ RendererShaders RendererShaders_new(const char *vertex_shader_path,
   return self;
 }
 
+RendererShaders RendererShaders_new_compute(const char *compute_shader_path,
+                                            const char *defines, Arena *arena) {
+  RendererShaders self = {.is_compute = true};
+
+  self.fragment_shader = FileWatcher_new(compute_shader_path);
+  ASSERTQ_CUSTOM(strlen(defines) < sizeof(self.defines),
+                 "Too many defines for a shader!");
+  strcpy(self.defines, defines);
+  RendererShaders_force_update(&self, arena);
+
+  return self;
+}
+
 bool RendererShaders_update(RendererShaders *self, Arena *arena) {
-  if (FileWatcher_did_change(&self->vertex_shader) ||
-      FileWatcher_did_change(&self->fragment_shader)) {
+  // NOTE: all watchers have to be checked, so no short-circuiting
+  bool changed = FileWatcher_did_change(&self->fragment_shader);
+  if (!self->is_compute)
+    changed |= FileWatcher_did_change(&self->vertex_shader);
+  for (uint32_t i = 0; i < self->includes_count; ++i)
+    changed |= FileWatcher_did_change(&self->includes[i]);
+
+  if (changed) {
     printf("Shaders have changed, reloading...\n");
     RendererShaders_force_update(self, arena);
     return true;
@@ -44,86 +82,218 @@ bool RendererShaders_update(RendererShaders *self, Arena *arena) {
 }
 
 void RendererShaders_force_update(RendererShaders *self, Arena *arena) {
-  GLuint new_program = create_shader_program(self->vertex_shader.path,
-                                             self->fragment_shader.path, arena);
+  Timer_begin("shaders");
+  ArenaMark am = Arena_mark(arena);
+  // the includes will be found again, in case they've changed
+  self->includes_count = 0;
+
+  GLuint new_program;
+  if (self->is_compute) {
+    ShaderSource compute_src =
+        read_shader_source(self, self->fragment_shader.path, self->defines, arena);
+    new_program = create_compute_program(&compute_src);
+  } else {
+    ShaderSource vertex_src =
+        read_shader_source(self, self->vertex_shader.path, "", arena);
+    ShaderSource fragment_src =
+        read_shader_source(self, self->fragment_shader.path, self->defines, arena);
+    new_program = create_shader_program(&vertex_src, &fragment_src);
+  }
+  Arena_rewind(am);
 
   if (new_program == (GLuint)-1) {
     fprintf(stderr,
             "Failed to create a shader program, loading the default...\n");
-    new_program = create_shader_program_from_source(DEFAULT_VERTEX_SHADER,
-                                                    DEFAULT_FRAGMENT_SHADER);
+    if (self->is_compute) {
+      ShaderSource compute_src = ShaderSource_from_string(DEFAULT_COMPUTE_SHADER);
+      new_program = create_compute_program(&compute_src);
+    } else {
+      ShaderSource vertex_src = ShaderSource_from_string(DEFAULT_VERTEX_SHADER);
+      ShaderSource fragment_src =
+          ShaderSource_from_string(DEFAULT_FRAGMENT_SHADER);
+      new_program = create_shader_program(&vertex_src, &fragment_src);
+    }
   }
 
   if (self->program != 0 && self->program != (GLuint)-1)
     GL_CALL(glDeleteProgram(self->program));
 
   self->program = new_program;
+  Timer_end();
 }
 
 void RendererShaders_delete(RendererShaders *self) {
   FileWatcher_delete(&self->vertex_shader);
   FileWatcher_delete(&self->fragment_shader);
+  for (uint32_t i = 0; i < self->includes_count; ++i)
+    FileWatcher_delete(&self->includes[i]);
   GL_CALL(glDeleteProgram(self->program));
 }
 
-static GLuint compile_shader(const char *shader_source, GLenum shader_type) {
+static void ShaderSource_push(ShaderSource *self, const char *str, size_t len) {
+  ASSERTQ_CUSTOM(self->count < SHADER_SOURCE_MAX_PARTS,
+                 "Shader source has too many parts!");
+  self->strings[self->count] = str;
+  self->lengths[self->count] = len;
+  self->count++;
+}
+
+static ShaderSource ShaderSource_from_string(const char *src) {
+  ShaderSource self = {0};
+  ShaderSource_push(&self, src, strlen(src));
+  return self;
+}
+
+// makes the line numbers in compilation errors refer to the original files,
+// the source string number being 0 for the shader itself and i+1 for its
+// i-th include
+static void ShaderSource_push_line_directive(ShaderSource *self, int line,
+                                             int source_string, Arena *arena) {
+  char *directive = Arena_alloc(arena, 32);
+  int len = snprintf(directive, 32, "\n#line %d %d\n", line, source_string);
+  ShaderSource_push(self, directive, len);
+}
+
+static int count_lines(const char *begin, const char *end) {
+  int lines = 0;
+  for (const char *c = begin; c < end; ++c)
+    lines += *c == '\n';
+  return lines;
+}
+
+static void RendererShaders_watch_include(RendererShaders *self,
+                                          const char *path) {
+  for (uint32_t i = 0; i < self->includes_count; ++i)
+    if (strcmp(self->includes[i].path, path) == 0)
+      return;
+
+  ASSERTQ_CUSTOM_FMT(self->includes_count < RENDERER_SHADERS_MAX_INCLUDES,
+                     "Too many includes, can't include '%s'", path);
+  self->includes[self->includes_count++] = FileWatcher_new(path);
+}
+
+// Reads the shader at path replacing every `#include "file"` (relative to
+// path) with the contents of that file and putting defines right after the
+// #version line.
+// NOTE: included files can't include other files
+static ShaderSource read_shader_source(RendererShaders *self, const char *path,
+                                       const char *defines, Arena *arena) {
+  ShaderSource source = {0};
+  const char *src = File_read(path, arena);
+  const char *const file_start = src;
+  const size_t dir_len = FilePath_get_file_name(path) - path;
+
+  if (defines[0] != '\0') {
+    // NOTE: #version has to be the first thing in a shader
+    const char *version_line_end = strchr(src, '\n');
+    if (strncmp(src, "#version", strlen("#version")) != 0 ||
+        version_line_end == NULL)
+      ERROR_FMT("Shader '%s' has to start with a #version line", path);
+
+    ShaderSource_push(&source, src, version_line_end + 1 - src);
+    ShaderSource_push(&source, defines, strlen(defines));
+    src = version_line_end + 1;
+    ShaderSource_push_line_directive(&source, 2, 0, arena);
+  }
+
+  const char *include;
+  while ((include = strstr(src, INCLUDE_DIRECTIVE)) != NULL) {
+    const char *name = include + strlen(INCLUDE_DIRECTIVE);
+    const char *name_end = strchr(name, '"');
+    if (name_end == NULL)
+      ERROR_FMT("Unterminated #include in '%s'", path);
+
+    char include_path[sizeof(self->includes[0].path)];
+    const int include_path_len =
+        snprintf(include_path, sizeof(include_path), "%.*s%.*s", (int)dir_len,
+                 path, (int)(name_end - name), name);
+    ASSERTQ_CUSTOM_FMT(include_path_len < (int)sizeof(include_path),
+                       "Include path in '%s' is too long", path);
+    RendererShaders_watch_include(self, include_path);
+
+    ShaderSource_push(&source, src, include - src);
+    ShaderSource_push_line_directive(&source, 1, self->includes_count, arena);
+    const char *included = File_read(include_path, arena);
+    ShaderSource_push(&source, included, strlen(included));
+    ShaderSource_push_line_directive(
+        &source, count_lines(file_start, name_end) + 2, 0, arena);
+
+    // skip the rest of the #include line
+    src = name_end + 1;
+    src += strcspn(src, "\n");
+    if (*src == '\n')
+      ++src;
+  }
+  ShaderSource_push(&source, src, strlen(src));
+
+  return source;
+}
+
+static GLuint compile_shader(const ShaderSource *shader_source,
+                             GLenum shader_type) {
+  Timer_begin("compile");
   GLuint shader = glCreateShader(shader_type);
-  GL_CALL(glShaderSource(shader, 1, &shader_source, NULL));
+  GL_CALL(glShaderSource(shader, shader_source->count, shader_source->strings,
+                         shader_source->lengths));
   GL_CALL(glCompileShader(shader));
-
+  // NOTE: with drivers which compile lazily, this is what waits for it
   GLint success;
   GL_CALL(glGetShaderiv(shader, GL_COMPILE_STATUS, &success));
+  Timer_end();
   if (!success) {
     GLchar infoLog[512];
     GL_CALL(glGetShaderInfoLog(shader, 512, NULL, infoLog));
     fprintf(stderr, "Error: Shader compilation failed\n%s", infoLog);
+    GL_CALL(glDeleteShader(shader));
     return -1;
   }
 
   return shader;
 }
 
-static GLuint
-create_shader_program_from_source(const char *vertex_shader_src,
-                                  const char *fragment_shader_src) {
-
-  GLuint vertex_shader = compile_shader(vertex_shader_src, GL_VERTEX_SHADER);
-  GLuint fragment_shader =
-      compile_shader(fragment_shader_src, GL_FRAGMENT_SHADER);
-
-  if (vertex_shader == (GLuint)-1 || fragment_shader == (GLuint)-1)
-    return -1;
-
+// NOTE: deletes the shaders
+static GLuint link_program(const GLuint *shaders, int shaders_count) {
+  Timer_begin("link");
   GLuint shaderProgram = glCreateProgram();
-  GL_CALL(glAttachShader(shaderProgram, vertex_shader));
-  GL_CALL(glAttachShader(shaderProgram, fragment_shader));
+  for (int i = 0; i < shaders_count; ++i)
+    GL_CALL(glAttachShader(shaderProgram, shaders[i]));
   GL_CALL(glLinkProgram(shaderProgram));
 
-  GL_CALL(glDeleteShader(vertex_shader));
-  GL_CALL(glDeleteShader(fragment_shader));
+  for (int i = 0; i < shaders_count; ++i)
+    GL_CALL(glDeleteShader(shaders[i]));
 
   GLint success;
   GL_CALL(glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success));
+  Timer_end();
   if (!success) {
     GLchar infoLog[512];
     GL_CALL(glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog));
     fprintf(stderr, "Error: Shader program linking failed\n%s\n", infoLog);
+    GL_CALL(glDeleteProgram(shaderProgram));
     return -1;
   }
 
   return shaderProgram;
 }
 
-static GLuint create_shader_program(const char *vertex_shader_filename,
-                                    const char *fragment_shader_filename,
-                                    Arena *arena) {
-  ArenaMark am = Arena_mark(arena);
-  char *vertex_shader_src = File_read(vertex_shader_filename, arena);
-  char *fragment_shader_src = File_read(fragment_shader_filename, arena);
+static GLuint create_shader_program(const ShaderSource *vertex_shader_src,
+                                    const ShaderSource *fragment_shader_src) {
+  GLuint vertex_shader = compile_shader(vertex_shader_src, GL_VERTEX_SHADER);
+  GLuint fragment_shader =
+      compile_shader(fragment_shader_src, GL_FRAGMENT_SHADER);
 
-  GLuint shader_program =
-      create_shader_program_from_source(vertex_shader_src, fragment_shader_src);
+  if (vertex_shader == (GLuint)-1 || fragment_shader == (GLuint)-1)
+    return -1;
 
-  Arena_rewind(am);
-  return shader_program;
+  GLuint shaders[] = {vertex_shader, fragment_shader};
+  return link_program(shaders, 2);
+}
+
+static GLuint create_compute_program(const ShaderSource *compute_shader_src) {
+  GLuint compute_shader =
+      compile_shader(compute_shader_src, GL_COMPUTE_SHADER);
+  if (compute_shader == (GLuint)-1)
+    return -1;
+
+  return link_program(&compute_shader, 1);
 }
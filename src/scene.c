@@ -2,9 +2,30 @@
 #include "arena.h"
 #include "scene/bvh.h"
 #include "scene/bvh/strategies.h"
+#include "asserts.h"
+#include "utils/timer.h"
 #include <stddef.h>
 #include <stdlib.h>
 
+// the lights were found before building the BVH, so their triangle indices
+// have to be updated to where those triangles were moved
+static void remap_lights(Scene *scene, const BVHSwapsLUTElement *swaps_lut,
+                         Arena *tmp_arena) {
+  ArenaMark am = Arena_mark(tmp_arena);
+  BVHTriCount *new_indices =
+      Arena_alloc(tmp_arena, scene->triangles_count * sizeof(BVHTriCount));
+  for (BVHTriCount i = 0; i < scene->triangles_count; ++i)
+    new_indices[swaps_lut[i]] = i;
+
+  for (uint32_t i = 0; i < scene->triangles_count; ++i)
+    scene->triangles_lights[i] = NO_LIGHT;
+  for (uint32_t i = 0; i < scene->lights_count; ++i) {
+    scene->lights[i].triangle = new_indices[scene->lights[i].triangle];
+    scene->triangles_lights[scene->lights[i].triangle] = i;
+  }
+  Arena_rewind(am);
+}
+
 // NOTE: assuming that scene->bvh_nodes has enough memory already allocated
 // NOTE: assuming that scene->bvh_nodes_count is 0
 void Scene_build_bvh(Scene *scene, BVHStrategy find_best_split_fn_strat,
@@ -15,15 +36,97 @@ void Scene_build_bvh(Scene *scene, BVHStrategy find_best_split_fn_strat,
       tmp_arena, scene->triangles_count * sizeof(BVHSwapsLUTElement));
 
   scene->bvh_nodes_count = 0;
+  Timer_begin("nodes");
   BVH_build(scene->bvh_nodes, &scene->bvh_nodes_count, swaps_lut,
             scene->triangles, 0, scene->triangles_count,
             BVHStrategy_get[find_best_split_fn_strat], tmp_arena);
+  Timer_end();
 
+  Timer_begin("reorder");
   BVH_apply_swaps_lut(swaps_lut, scene->triangles_data, TriangleEx,
                       scene->triangles_count, tmp_arena);
+  if (scene->triangles_sources != NULL)
+    BVH_apply_swaps_lut(swaps_lut, scene->triangles_sources, uint32_t,
+                        scene->triangles_count, tmp_arena);
+  scene->bvh_built_cost = BVH_cost(scene->bvh_nodes, scene->bvh_nodes_count);
+  remap_lights(scene, swaps_lut, tmp_arena);
+  Timer_end();
+
+  Timer_begin("lights");
+  LightBVH_build(scene->light_bvh_nodes, &scene->light_bvh_nodes_count,
+                 scene->lights, scene->lights_count, scene->triangles,
+                 tmp_arena);
+  Timer_end();
   Arena_rewind(am);
 }
 
+// relative luminance of linear sRGB
+static float luminance(const float rgb[3]) {
+  return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+}
+
+static float triangle_power(const Scene *scene, uint32_t triangle) {
+  const Material *mat = &scene->mats[scene->triangles_data[triangle].mat];
+  const Triangle *t = &scene->triangles[triangle];
+  const float area =
+      0.5f * vec3_mag(vec3_cross(vec3_sub(t->b, t->a), vec3_sub(t->c, t->a)));
+  return luminance(mat->emissive_factor) * area;
+}
+
+void Scene_build_lights(Scene *scene) {
+  uint32_t lights_count = 0;
+  for (uint32_t i = 0; i < scene->triangles_count; ++i)
+    lights_count += triangle_power(scene, i) > 0;
+
+  if (lights_count > scene->lights_capacity) {
+    free(scene->lights);
+    free(scene->light_bvh_nodes);
+    scene->lights = malloc(lights_count * sizeof(Light));
+    scene->light_bvh_nodes = malloc(2 * lights_count * sizeof(LightBVHnode));
+    ASSERTQ_CUSTOM(scene->lights != NULL && scene->light_bvh_nodes != NULL,
+                   "Failed to allocate the lights");
+    scene->lights_capacity = lights_count;
+  }
+  if (scene->triangles_count > scene->triangles_lights_capacity) {
+    free(scene->triangles_lights);
+    scene->triangles_lights = malloc(scene->triangles_count * sizeof(uint32_t));
+    ASSERTQ_CUSTOM(scene->triangles_lights != NULL,
+                   "Failed to allocate the lights");
+    scene->triangles_lights_capacity = scene->triangles_count;
+  }
+
+  scene->lights_count = 0;
+  scene->lights_total_power = 0;
+  scene->light_bvh_nodes_count = 0;
+  for (uint32_t i = 0; i < scene->triangles_count; ++i) {
+    const float power = triangle_power(scene, i);
+    scene->triangles_lights[i] = power > 0 ? scene->lights_count : NO_LIGHT;
+    if (power <= 0)
+      continue;
+    scene->lights_total_power += power;
+    scene->lights[scene->lights_count++] =
+        (Light){.triangle = i, .power = power};
+  }
+}
+
+bool Scene_refit_bvh(Scene *scene, Arena *tmp_arena) {
+  BVH_refit(scene->bvh_nodes, scene->bvh_nodes_count, scene->triangles);
+
+  // NOTE: the emissive triangles stay the same, only their areas change
+  scene->lights_total_power = 0;
+  for (uint32_t i = 0; i < scene->lights_count; ++i) {
+    Light *light = &scene->lights[i];
+    light->power = triangle_power(scene, light->triangle);
+    scene->lights_total_power += light->power;
+  }
+  LightBVH_build(scene->light_bvh_nodes, &scene->light_bvh_nodes_count,
+                 scene->lights, scene->lights_count, scene->triangles,
+                 tmp_arena);
+
+  return BVH_cost(scene->bvh_nodes, scene->bvh_nodes_count) <=
+         SCENE_MAX_REFIT_COST_GROWTH * scene->bvh_built_cost;
+}
+
 bool Scene_is_empty(const Scene *scene) { return scene->triangles_count == 0; }
 
 void Scene_delete(Scene *self) {
@@ -31,4 +134,8 @@ void Scene_delete(Scene *self) {
   free(self->mats);
   free(self->triangles_data);
   free(self->bvh_nodes);
+  free(self->lights);
+  free(self->light_bvh_nodes);
+  free(self->triangles_lights);
+  free(self->triangles_sources);
 }
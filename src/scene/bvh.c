@@ -38,6 +38,41 @@ void BVH_build(BVHnode *nodes, BVHNodeCount *nodes_offset,
   Arena_rewind(am);
 }
 
+void BVH_refit(BVHnode *nodes, BVHNodeCount nodes_count,
+               const Triangle triangles[]) {
+  // NOTE: children are always created after their parents, so going
+  // backwards every node's children already have their new bounds
+  for (BVHNodeCount i = nodes_count; i-- > 0;) {
+    BVHnode *node = &nodes[i];
+    if (node->count > 0) {
+      set_node_bounds(node, triangles);
+      continue;
+    }
+    const BVHnode *left = &nodes[node->first], *right = &nodes[node->first + 1];
+    node->bound_min = vec3_min(left->bound_min, right->bound_min);
+    node->bound_max = vec3_max(left->bound_max, right->bound_max);
+  }
+}
+
+float BVH_cost(const BVHnode *nodes, BVHNodeCount nodes_count) {
+  if (nodes_count == 0)
+    return 0;
+  // a ray hitting the root hits a node with the probability of the ratio of
+  // their surface areas, after which either both of its children or all of
+  // its triangles get tested
+  const AABB root = AABB_from(nodes[0].bound_min, nodes[0].bound_max);
+  const float root_area = AABB_area(&root);
+  if (root_area <= 0)
+    return 0;
+  float cost = 0;
+  for (BVHNodeCount i = 0; i < nodes_count; ++i) {
+    const AABB aabb = AABB_from(nodes[i].bound_min, nodes[i].bound_max);
+    cost += AABB_area(&aabb) / root_area *
+            (nodes[i].count > 0 ? nodes[i].count : 2);
+  }
+  return cost;
+}
+
 // recursively subdivide a node until there are 2 primitives left
 void subdivide(BVHnode nodes[], int node_idx, Triangle tris[], vec3 centroids[],
                BVHNodeCount *created_nodes, BVHTriCount swaps_lut[],
@@ -0,0 +1,238 @@
+#include "scene/bvh/analysis.h"
+#include "asserts.h"
+#include "scene/aabb.h"
+#include "scene/bvh/traversal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// how far from the triangles the rays start, relative to the size of the
+// whole scene, so that they don't hit the triangle they start at
+#define RAY_OFFSET 1e-4f
+
+static bool bounds_empty(const BVHnode *node) {
+  return node->bound_min.x > node->bound_max.x ||
+         node->bound_min.y > node->bound_max.y ||
+         node->bound_min.z > node->bound_max.z;
+}
+
+// surface area of the intersection of the two nodes' bounds
+static float overlap_area(const BVHnode *a, const BVHnode *b) {
+  const vec3 min = vec3_max(a->bound_min, b->bound_min);
+  const vec3 max = vec3_min(a->bound_max, b->bound_max);
+  if (min.x > max.x || min.y > max.y || min.z > max.z)
+    return 0;
+  const AABB overlap = AABB_from(min, max);
+  return AABB_area(&overlap);
+}
+
+// visits every node reachable from the root, counting the ones that are
+// branches in the overlap of their children's bounds
+static void walk_nodes(BVHAnalysis *self, const BVHnode *nodes) {
+  typedef struct {
+    BVHNodeCount node;
+    uint32_t depth;
+  } StackEntry;
+  // NOTE: children are always after their parents, so the walk ends even on
+  // a broken BVH, and can't be deeper than the number of nodes
+  StackEntry *stack = malloc(sizeof(StackEntry) * (self->nodes_count + 1));
+  ASSERTQ_CUSTOM(stack != NULL, "Failed to allocate the BVH analysis' stack");
+
+  uint64_t leaf_depths = 0;
+  double overlap_sum = 0;
+  uint32_t branches = 0;
+  uint32_t stack_size = 0;
+  stack[stack_size++] = (StackEntry){.node = 0, .depth = 0};
+  while (stack_size > 0) {
+    const StackEntry entry = stack[--stack_size];
+    const BVHnode *node = &nodes[entry.node];
+    self->reached_nodes++;
+    if (entry.depth > self->max_depth)
+      self->max_depth = entry.depth;
+
+    if (bounds_empty(node)) {
+      self->empty_nodes++;
+    } else {
+      const AABB aabb = AABB_from(node->bound_min, node->bound_max);
+      if (AABB_area(&aabb) <= 0)
+        self->degenerate_nodes++;
+    }
+
+    if (node->count > 0) {
+      self->leaves_count++;
+      leaf_depths += entry.depth;
+      self->leaves_per_depth[entry.depth < BVH_ANALYSIS_MAX_DEPTH
+                                 ? entry.depth
+                                 : BVH_ANALYSIS_MAX_DEPTH - 1]++;
+      self->leaves_per_size[node->count < BVH_ANALYSIS_MAX_LEAF_SIZE
+                                ? node->count
+                                : BVH_ANALYSIS_MAX_LEAF_SIZE]++;
+      continue;
+    }
+    if (node->first <= entry.node || node->first + 1 >= self->nodes_count)
+      continue;
+
+    const BVHnode *left = &nodes[node->first], *right = &nodes[node->first + 1];
+    const AABB aabb = AABB_from(node->bound_min, node->bound_max);
+    const float area = bounds_empty(node) ? 0 : AABB_area(&aabb);
+    if (area > 0) {
+      overlap_sum += overlap_area(left, right) / area;
+      branches++;
+    }
+    stack[stack_size++] =
+        (StackEntry){.node = node->first, .depth = entry.depth + 1};
+    stack[stack_size++] =
+        (StackEntry){.node = node->first + 1, .depth = entry.depth + 1};
+  }
+  free(stack);
+
+  self->mean_leaf_depth =
+      self->leaves_count > 0 ? (float)leaf_depths / self->leaves_count : 0;
+  self->sibling_overlap = branches > 0 ? (float)(overlap_sum / branches) : 0;
+}
+
+// same as pcg32_step in shaders/pathtracer.glsl
+static uint32_t pcg32_step(uint32_t *state) {
+  const uint32_t old_state = *state;
+  *state = *state * 747796405u + 2891336453u;
+  const uint32_t word =
+      ((old_state >> ((old_state >> 28u) + 4u)) ^ old_state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+static float random_float(uint32_t *state) {
+  return ldexpf((float)pcg32_step(state), -32);
+}
+
+static vec3 random_unit_vector(uint32_t *state) {
+  const float z = random_float(state) * 2.0f - 1.0f;
+  const float a = random_float(state) * 2.0f * (float)M_PI;
+  const float r = sqrtf(fmaxf(1.0f - z * z, 0.0f));
+  return vec3_new(r * cosf(a), r * sinf(a), z);
+}
+
+// a random point of a random triangle, going away from it in a random
+// direction
+static Ray random_ray(const Triangle *triangles, BVHTriCount triangles_count,
+                      float offset, uint32_t *state) {
+  const Triangle *t = &triangles[pcg32_step(state) % triangles_count];
+  float u = random_float(state), v = random_float(state);
+  if (u + v > 1) {
+    u = 1 - u;
+    v = 1 - v;
+  }
+  const vec3 ab = vec3_sub(t->b, t->a), ac = vec3_sub(t->c, t->a);
+  const vec3 point =
+      vec3_add(t->a, vec3_add(vec3_mult(ab, u), vec3_mult(ac, v)));
+
+  const vec3 normal = vec3_cross(ab, ac);
+  vec3 dir = random_unit_vector(state);
+  if (vec3_dot(dir, normal) < 0)
+    dir = vec3_mult(dir, -1);
+  return Ray_new(vec3_add(point, vec3_mult(dir, offset)), dir);
+}
+
+static void trace_rays(BVHAnalysis *self, const BVHnode *nodes,
+                       const Triangle *triangles, uint32_t rays_count) {
+  const vec3 extent = vec3_sub(nodes[0].bound_max, nodes[0].bound_min);
+  const float offset = RAY_OFFSET * vec3_mag(extent);
+
+  BVHTraversalStats stats = {0};
+  uint32_t state = 1;
+  for (uint32_t i = 0; i < rays_count; ++i) {
+    const Ray ray = random_ray(triangles, self->triangles_count, offset, &state);
+    BVH_intersect(nodes, triangles, &ray, &stats);
+  }
+  self->rays_count = rays_count;
+  self->nodes_per_ray = (float)stats.nodes_visited / rays_count;
+  self->triangles_per_ray = (float)stats.triangles_tested / rays_count;
+}
+
+BVHAnalysis BVH_analyze(const BVHnode *nodes, BVHNodeCount nodes_count,
+                        const Triangle *triangles, BVHTriCount triangles_count,
+                        uint32_t rays_count) {
+  BVHAnalysis self = {
+      .nodes_count = nodes_count,
+      .triangles_count = triangles_count,
+      .sah_cost = BVH_cost(nodes, nodes_count),
+      .nodes_bytes = sizeof(BVHnode) * nodes_count,
+      .triangles_bytes = sizeof(Triangle) * triangles_count,
+  };
+  if (nodes_count == 0)
+    return self;
+
+  walk_nodes(&self, nodes);
+  if (rays_count > 0 && triangles_count > 0 && !bounds_empty(&nodes[0]))
+    trace_rays(&self, nodes, triangles, rays_count);
+  return self;
+}
+
+// appends the non-zero counts of a histogram as "value:count" pairs
+static int append_histogram(char *out, size_t size, const uint32_t *counts,
+                            uint32_t counts_count, bool last_is_more) {
+  int written = 0;
+  for (uint32_t i = 0; i < counts_count && written < (int)size; ++i) {
+    if (counts[i] == 0)
+      continue;
+    const bool more = last_is_more && i == counts_count - 1;
+    written += snprintf(out + written, size - written, " %u%s:%u", i,
+                        more ? "+" : "", counts[i]);
+  }
+  if (written < (int)size)
+    written += snprintf(out + written, size - written, "\n");
+  return written;
+}
+
+// in KB or MB, whichever is more readable
+static void fmt_bytes(char out[32], size_t bytes) {
+  if (bytes < 1024 * 1024)
+    snprintf(out, 32, "%.1f KB", bytes / 1024.0);
+  else
+    snprintf(out, 32, "%.1f MB", bytes / (1024.0 * 1024.0));
+}
+
+// NOTE: a very deep BVH's histogram gets cut off if it doesn't fit
+SmallString BVHAnalysis_str(const BVHAnalysis *self) {
+  SmallString out = {0};
+  const size_t size = sizeof(out.str);
+  char nodes_bytes[32], triangles_bytes[32];
+  fmt_bytes(nodes_bytes, self->nodes_bytes);
+  fmt_bytes(triangles_bytes, self->triangles_bytes);
+  int written = snprintf(
+      out.str, size,
+      "nodes: %u (%u leaves, %u unreachable), triangles: %u\n"
+      "SAH cost: %.2f\n"
+      "max depth: %u, mean leaf depth: %.2f\n"
+      "empty nodes: %u, degenerate nodes: %u\n"
+      "sibling overlap: %.2f%%\n"
+      "memory: %s of nodes, %s of triangles\n",
+      self->nodes_count, self->leaves_count,
+      self->nodes_count - self->reached_nodes, self->triangles_count,
+      self->sah_cost, self->max_depth, self->mean_leaf_depth,
+      self->empty_nodes, self->degenerate_nodes, 100 * self->sibling_overlap,
+      nodes_bytes, triangles_bytes);
+  if (self->rays_count > 0 && written < (int)size)
+    written += snprintf(out.str + written, size - written,
+                        "per ray (of %u): %.2f nodes visited, %.2f triangles "
+                        "tested\n",
+                        self->rays_count, self->nodes_per_ray,
+                        self->triangles_per_ray);
+
+  if (written < (int)size)
+    written += snprintf(out.str + written, size - written, "leaves by depth:");
+  if (written < (int)size)
+    written += append_histogram(out.str + written, size - written,
+                                self->leaves_per_depth, BVH_ANALYSIS_MAX_DEPTH,
+                                true);
+  if (written < (int)size)
+    written += snprintf(out.str + written, size - written, "leaves by size:");
+  if (written < (int)size)
+    written += append_histogram(out.str + written, size - written,
+                                self->leaves_per_size,
+                                BVH_ANALYSIS_MAX_LEAF_SIZE + 1, true);
+  return out;
+}
@@ -0,0 +1,161 @@
+#include "scene/bvh/traversal.h"
+#include "asserts.h"
+#include <math.h>
+
+// same as in shaders/pathtracer.glsl
+#define EPSILON 0.00001f
+
+Ray Ray_new(vec3 origin, vec3 dir) {
+  return (Ray){.origin = origin,
+               .dir = dir,
+               .inv_dir = vec3_new(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z)};
+}
+
+// NOTE: see RayBVHnodeIntersection in shaders/pathtracer.glsl for the
+// explanation of the slab method
+float BVHnode_intersect(const BVHnode *node, const Ray *ray) {
+  float tmin = -INFINITY, tmax = INFINITY;
+  for (int axis = 0; axis < 3; ++axis) {
+    const float origin = vec3_get_by_axis(&ray->origin, axis);
+    const float inv_dir = vec3_get_by_axis(&ray->inv_dir, axis);
+    const float t1 = (vec3_get_by_axis(&node->bound_min, axis) - origin) * inv_dir;
+    const float t2 = (vec3_get_by_axis(&node->bound_max, axis) - origin) * inv_dir;
+    tmin = fmaxf(tmin, fminf(t1, t2));
+    tmax = fminf(tmax, fmaxf(t1, t2));
+  }
+  return (tmax >= tmin && tmax > 0) ? tmin : INFINITY;
+}
+
+// NOTE: see RayTriangleIntersection in shaders/pathtracer.glsl for the
+// explanation of the Möller-Trumbore algorithm
+bool Triangle_intersect(const Triangle *t, const Ray *ray, float *dst) {
+  const vec3 e1 = vec3_sub(t->b, t->a);
+  const vec3 e2 = vec3_sub(t->c, t->a);
+  const vec3 De2 = vec3_cross(ray->dir, e2);
+  const float det = vec3_dot(e1, De2);
+  if (fabsf(det) < EPSILON)
+    return false;
+
+  const float inv_det = 1.0f / det;
+  const vec3 T = vec3_sub(ray->origin, t->a);
+  const vec3 Te1 = vec3_cross(T, e1);
+
+  const float u = vec3_dot(T, De2) * inv_det;
+  if ((u < 0 && fabsf(u) > EPSILON) || (u > 1 && fabsf(u - 1) > EPSILON))
+    return false;
+
+  const float v = vec3_dot(ray->dir, Te1) * inv_det;
+  if ((v < 0 && fabsf(v) > EPSILON) ||
+      (u + v > 1 && fabsf(u + v - 1) > EPSILON))
+    return false;
+
+  const float dist = vec3_dot(Te1, e2) * inv_det;
+  if (dist <= EPSILON)
+    return false;
+
+  *dst = dist;
+  return true;
+}
+
+BVHHit BVH_intersect(const BVHnode *nodes, const Triangle *triangles,
+                     const Ray *ray, BVHTraversalStats *stats) {
+  BVHHit closest_hit = {.did_hit = false, .dst = INFINITY};
+  BVHTraversalStats work = {0};
+
+  // nodes to visit along with the distances at which the ray enters them,
+  // so that the ones behind the closest hit found so far can be skipped
+  BVHNodeCount stack[BVH_TRAVERSAL_STACK_SIZE];
+  float stack_dst[BVH_TRAVERSAL_STACK_SIZE];
+  uint32_t stack_ptr = 0;
+
+  const float root_dst = BVHnode_intersect(&nodes[0], ray);
+  if (root_dst != INFINITY) {
+    stack_dst[stack_ptr] = root_dst;
+    stack[stack_ptr++] = 0;
+  }
+
+  while (stack_ptr > 0) {
+    --stack_ptr;
+    if (stack_dst[stack_ptr] >= closest_hit.dst)
+      continue;
+    const BVHnode *node = &nodes[stack[stack_ptr]];
+    ++work.nodes_visited;
+
+    // if node is a leaf
+    if (node->count > 0) {
+      for (BVHTriCount i = node->first; i < node->first + node->count; ++i) {
+        float dst;
+        ++work.triangles_tested;
+        if (Triangle_intersect(&triangles[i], ray, &dst) &&
+            dst < closest_hit.dst)
+          closest_hit = (BVHHit){.did_hit = true, .dst = dst, .triangle = i};
+      }
+      continue;
+    }
+
+    BVHNodeCount near_child = node->first, far_child = node->first + 1;
+    float near_dst = BVHnode_intersect(&nodes[near_child], ray);
+    float far_dst = BVHnode_intersect(&nodes[far_child], ray);
+    if (far_dst < near_dst) {
+      SWAP(near_child, far_child, BVHNodeCount);
+      SWAP(near_dst, far_dst, float);
+    }
+
+    ASSERTQ_CUSTOM(stack_ptr + 2 <= BVH_TRAVERSAL_STACK_SIZE,
+                   "BVH is too deep to be traversed!");
+    // the nearer child will be checked first, so must push the farther one first
+    if (far_dst < closest_hit.dst) {
+      stack_dst[stack_ptr] = far_dst;
+      stack[stack_ptr++] = far_child;
+    }
+    if (near_dst < closest_hit.dst) {
+      stack_dst[stack_ptr] = near_dst;
+      stack[stack_ptr++] = near_child;
+    }
+  }
+
+  if (stats != NULL) {
+    stats->nodes_visited += work.nodes_visited;
+    stats->triangles_tested += work.triangles_tested;
+  }
+  return closest_hit;
+}
+
+bool BVH_is_occluded(const BVHnode *nodes, const Triangle *triangles,
+                     const Ray *ray, float max_dst, BVHTraversalStats *stats) {
+  bool occluded = false;
+  BVHTraversalStats work = {0};
+
+  BVHNodeCount stack[BVH_TRAVERSAL_STACK_SIZE];
+  uint32_t stack_ptr = 0;
+  stack[stack_ptr++] = 0;
+
+  while (stack_ptr > 0 && !occluded) {
+    const BVHnode *node = &nodes[stack[--stack_ptr]];
+    if (BVHnode_intersect(node, ray) >= max_dst)
+      continue;
+    ++work.nodes_visited;
+
+    // if node is a leaf
+    if (node->count > 0) {
+      for (BVHTriCount i = node->first;
+           i < node->first + node->count && !occluded; ++i) {
+        float dst;
+        ++work.triangles_tested;
+        occluded = Triangle_intersect(&triangles[i], ray, &dst) && dst < max_dst;
+      }
+      continue;
+    }
+
+    ASSERTQ_CUSTOM(stack_ptr + 2 <= BVH_TRAVERSAL_STACK_SIZE,
+                   "BVH is too deep to be traversed!");
+    stack[stack_ptr++] = node->first;
+    stack[stack_ptr++] = node->first + 1;
+  }
+
+  if (stats != NULL) {
+    stats->nodes_visited += work.nodes_visited;
+    stats->triangles_tested += work.triangles_tested;
+  }
+  return occluded;
+}
@@ -1,21 +1,34 @@
 #include "scene/file_formats/gltf.h"
+#include "asserts.h"
 #include "cgltf.h"
 #include "scene.h"
 #include "scene/file_formats/gltf_utils.h"
 #include "scene/material.h"
+#include "utils/timer.h"
 
+#include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-void load_gltf_scene(Scene *scene, const char *path) {
+static cgltf_data *parse_file(const char *path) {
   cgltf_options options = {0};
   cgltf_data *data = NULL;
 
+  Timer_begin("cgltf_parse_file");
   cgltf_result res = cgltf_parse_file(&options, path, &data);
+  Timer_end();
   gltf_assert(res == cgltf_result_success, path, "%s\n", cgltf_result_str(res));
 
+  Timer_begin("cgltf_load_buffers");
   res = cgltf_load_buffers(&options, data, path);
+  Timer_end();
   gltf_assert(res == cgltf_result_success, path, "%s\n", cgltf_result_str(res));
+  return data;
+}
+
+static void load_scene(Scene *scene, const cgltf_data *data, const char *path) {
 
   // === Required capacity calculation ===
   // there will always be a default material at index 0
@@ -56,8 +69,227 @@ void load_gltf_scene(Scene *scene, const char *path) {
   scene->mats[0] = Material_default();
   scene->mats_count = 1;
 
+  free(scene->triangles_sources);
+  scene->triangles_sources = NULL;
+
   // === glTF data loading ===
+  Timer_begin("traverse_nodes");
   traverse_nodes(path, data, scene, handle_node);
+  Timer_end();
+  Timer_begin("lights");
+  Scene_build_lights(scene);
+  Timer_end();
+}
+
+// parses the file and loads its scene's triangles, materials and camera
+static cgltf_data *parse_and_load_scene(Scene *scene, const char *path) {
+  Timer_begin("parse");
+  cgltf_data *data = parse_file(path);
+  Timer_end();
+  Timer_begin("triangles");
+  load_scene(scene, data, path);
+  Timer_end();
+  return data;
+}
+
+void load_gltf_scene(Scene *scene, const char *path) {
+  cgltf_free(parse_and_load_scene(scene, path));
+}
+
+void load_gltf_animated_scene(Scene *scene, GltfAnimation *animation,
+                              const char *path) {
+  cgltf_data *data = parse_and_load_scene(scene, path);
+  Timer_begin("animation");
+  const bool animated = GltfAnimation_new(animation, data, path, scene);
+  Timer_end();
+  if (!animated)
+    cgltf_free(data);
+}
+
+// returns why the primitive can't be loaded by handle_node or load_scene, or
+// NULL if it can
+static const char *validate_primitive(const cgltf_primitive *prim) {
+  if (prim->type == cgltf_primitive_type_triangles && prim->indices == NULL)
+    return "NOT YET IMPLEMENTED: primitive is not indexed";
+  if (prim->material != NULL && !prim->material->has_pbr_metallic_roughness)
+    return "Material doesn't have a PBR metallic roughness model defined!";
+
+  const cgltf_accessor *pos_accessor = NULL, *norm_accessor = NULL;
+  for (cgltf_size a = 0; a < prim->attributes_count; ++a) {
+    if (prim->attributes[a].type == cgltf_attribute_type_position)
+      pos_accessor = prim->attributes[a].data;
+    else if (prim->attributes[a].type == cgltf_attribute_type_normal)
+      norm_accessor = prim->attributes[a].data;
+  }
+  // such primitives are skipped
+  if (pos_accessor == NULL || norm_accessor == NULL)
+    return NULL;
+  if (pos_accessor->type != cgltf_type_vec3)
+    return "POSITION attribute should have type vec3";
+  if (norm_accessor->type != cgltf_type_vec3)
+    return "NORMAL attribute should have type vec3";
+  if (prim->indices == NULL)
+    return "NOT YET IMPLEMENTED: primitive is not indexed";
+  return NULL;
+}
+
+bool validate_gltf_scene(const char *path, SmallString *error) {
+  cgltf_options options = {0};
+  cgltf_data *data = NULL;
+  cgltf_result res = cgltf_parse_file(&options, path, &data);
+  if (res == cgltf_result_success)
+    res = cgltf_load_buffers(&options, data, path);
+  if (res == cgltf_result_success)
+    res = cgltf_validate(data);
+  const char *msg = res == cgltf_result_success ? NULL : cgltf_result_str(res);
+
+  for (cgltf_size m = 0; msg == NULL && m < data->meshes_count; ++m)
+    for (cgltf_size p = 0; msg == NULL && p < data->meshes[m].primitives_count;
+         ++p)
+      msg = validate_primitive(&data->meshes[m].primitives[p]);
+  for (cgltf_size c = 0; msg == NULL && c < data->cameras_count; ++c)
+    if (data->cameras[c].type != cgltf_camera_type_perspective)
+      msg = "Only perspective camera type is supported!";
+
+  // NOTE: data is NULL if parsing failed, which cgltf_free handles
+  cgltf_free(data);
+  if (msg != NULL)
+    snprintf(error->str, sizeof(error->str), "Failed to load %s: %s", path,
+             msg);
+  return msg == NULL;
+}
+
+// the last camera in the order the nodes get traversed, which is the one
+// handle_node leaves the scene with
+static cgltf_node *find_camera_node(cgltf_node *node) {
+  cgltf_node *camera_node = node->camera ? node : NULL;
+  for (cgltf_size c = 0; c < node->children_count; ++c) {
+    cgltf_node *child_camera_node = find_camera_node(node->children[c]);
+    if (child_camera_node)
+      camera_node = child_camera_node;
+  }
+  return camera_node;
+}
+
+// whether the channel moves the camera, by animating it or one of its parents
+static bool moves_camera(const cgltf_animation_channel *channel,
+                         const cgltf_node *camera_node) {
+  if (channel->target_path != cgltf_animation_path_type_translation &&
+      channel->target_path != cgltf_animation_path_type_rotation &&
+      channel->target_path != cgltf_animation_path_type_scale)
+    return false;
+  for (const cgltf_node *node = camera_node; node; node = node->parent)
+    if (channel->target_node == node)
+      return true;
+  return false;
+}
+
+static int compare_floats(const void *a, const void *b) {
+  const float x = *(const float *)a, y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+// sets the animated nodes' transforms to their ones at time_s
+static void apply_animation(const cgltf_animation *animation,
+                            const cgltf_node *camera_node, float time_s) {
+  for (cgltf_size c = 0; c < animation->channels_count; ++c) {
+    const cgltf_animation_channel *channel = &animation->channels[c];
+    if (!moves_camera(channel, camera_node))
+      continue;
+    cgltf_node *node = channel->target_node;
+    switch (channel->target_path) {
+    case cgltf_animation_path_type_translation:
+      gltf_sample_animation(channel, time_s, node->translation, 3);
+      node->has_translation = true;
+      break;
+    case cgltf_animation_path_type_rotation:
+      gltf_sample_animation(channel, time_s, node->rotation, 4);
+      node->has_rotation = true;
+      break;
+    default:
+      gltf_sample_animation(channel, time_s, node->scale, 3);
+      node->has_scale = true;
+      break;
+    }
+  }
+}
+
+CameraPath load_gltf_camera_path(const char *path) {
+  cgltf_data *data = parse_file(path);
+
+  cgltf_node *camera_node = NULL;
+  for (cgltf_size s = 0; s < data->scenes_count; ++s) {
+    for (cgltf_size n = 0; n < data->scenes[s].nodes_count; ++n) {
+      cgltf_node *node = find_camera_node(data->scenes[s].nodes[n]);
+      if (node)
+        camera_node = node;
+    }
+  }
+  gltf_assert(camera_node != NULL, path, "There is no camera to animate\n");
+  gltf_assert(camera_node->camera->type == cgltf_camera_type_perspective, path,
+              "Only perspective camera type is supported! Got type %d\n",
+              camera_node->camera->type);
+
+  const cgltf_animation *animation = NULL;
+  size_t times_count = 0;
+  for (cgltf_size a = 0; a < data->animations_count && !animation; ++a) {
+    for (cgltf_size c = 0; c < data->animations[a].channels_count; ++c) {
+      const cgltf_animation_channel *channel = &data->animations[a].channels[c];
+      if (moves_camera(channel, camera_node)) {
+        animation = &data->animations[a];
+        times_count += channel->sampler->input->count;
+      }
+    }
+  }
+  gltf_assert(animation != NULL, path, "No animation moves the camera\n");
+
+  // the times of all of the keys, sorted and without duplicates
+  float *times = malloc(sizeof(float) * times_count);
+  ASSERTQ_CUSTOM(times != NULL, "Failed to allocate the keys' times");
+  times_count = 0;
+  for (cgltf_size c = 0; c < animation->channels_count; ++c) {
+    const cgltf_animation_channel *channel = &animation->channels[c];
+    if (!moves_camera(channel, camera_node))
+      continue;
+    const cgltf_accessor *input = channel->sampler->input;
+    for (cgltf_size k = 0; k < input->count; ++k)
+      cgltf_accessor_read_float(input, k, &times[times_count++], 1);
+  }
+  qsort(times, times_count, sizeof(float), compare_floats);
+
+  CameraPath self = {.keyframes = malloc(sizeof(CameraKeyframe) * times_count)};
+  ASSERTQ_CUSTOM(self.keyframes != NULL, "Failed to allocate the keyframes");
+  for (size_t i = 0; i < times_count; ++i) {
+    if (i > 0 && times[i] <= times[i - 1])
+      continue;
+    apply_animation(animation, camera_node, times[i]);
+    vec3 pos, dir;
+    gltf_camera_transform(camera_node, &pos, &dir);
+
+    // see YawPitch_to_dir
+    const float dir_xz_len = sqrtf(dir.x * dir.x + dir.z * dir.z);
+    double yaw = self.keyframes_count > 0
+                     ? self.keyframes[self.keyframes_count - 1].rotation.yaw_rad
+                     : 0;
+    // NOTE: looking straight up or down the yaw can't be known
+    if (dir_xz_len > 1e-6f) {
+      yaw = atan2(dir.x, -dir.z);
+      if (yaw < 0)
+        yaw += 2 * M_PI;
+    }
+    double pitch = atan2(dir.y, dir_xz_len);
+    pitch = pitch > CAMERA_PITCH_MAX_RAD ? CAMERA_PITCH_MAX_RAD : pitch;
+    pitch = pitch < CAMERA_PITCH_MIN_RAD ? CAMERA_PITCH_MIN_RAD : pitch;
+
+    self.keyframes[self.keyframes_count++] = (CameraKeyframe){
+        .time_s = times[i],
+        .pos = pos,
+        .rotation = YawPitch_new(yaw, pitch),
+        .fov_rad = camera_node->camera->data.perspective.yfov,
+    };
+  }
 
+  free(times);
   cgltf_free(data);
+  return self;
 }
@@ -0,0 +1,417 @@
+#include "scene/file_formats/gltf_animation.h"
+#include "asserts.h"
+#include "scene/file_formats/gltf_utils.h"
+#include "utils/thread.h"
+#include "utils/timer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool is_ancestor_or_self(const cgltf_node *ancestor,
+                                const cgltf_node *node) {
+  for (; node; node = node->parent)
+    if (node == ancestor)
+      return true;
+  return false;
+}
+
+// whether the channel moves any of the primitive's triangles
+static bool moves_primitive(const cgltf_animation_channel *channel,
+                            const GltfAnimatedPrimitive *p) {
+  if (channel->target_path == cgltf_animation_path_type_weights)
+    return channel->target_node == p->node && p->targets_count > 0;
+  if (channel->target_path != cgltf_animation_path_type_translation &&
+      channel->target_path != cgltf_animation_path_type_rotation &&
+      channel->target_path != cgltf_animation_path_type_scale)
+    return false;
+
+  // NOTE: skinned meshes are only moved by their joints
+  const cgltf_skin *skin = p->node->skin;
+  if (skin == NULL)
+    return is_ancestor_or_self(channel->target_node, p->node);
+  for (cgltf_size j = 0; j < skin->joints_count; ++j)
+    if (is_ancestor_or_self(channel->target_node, skin->joints[j]))
+      return true;
+  return false;
+}
+
+static const cgltf_accessor *find_attribute(const cgltf_attribute *attrs,
+                                            cgltf_size attrs_count,
+                                            cgltf_attribute_type type) {
+  for (cgltf_size a = 0; a < attrs_count; ++a)
+    if (attrs[a].type == type && attrs[a].index == 0)
+      return attrs[a].data;
+  return NULL;
+}
+
+typedef struct {
+  GltfAnimatedPrimitive *primitives;
+  uint32_t count, capacity;
+} Primitives;
+
+// the same primitives in the same order as handle_mesh_instance loads them
+static void collect_primitives(Primitives *primitives, const cgltf_node *node) {
+  for (cgltf_size p = 0; node->mesh && p < node->mesh->primitives_count; ++p) {
+    const cgltf_primitive *prim = &node->mesh->primitives[p];
+    const cgltf_accessor *pos_accessor = find_attribute(
+        prim->attributes, prim->attributes_count, cgltf_attribute_type_position);
+    if (pos_accessor == NULL ||
+        find_attribute(prim->attributes, prim->attributes_count,
+                       cgltf_attribute_type_normal) == NULL)
+      continue;
+
+    if (primitives->count == primitives->capacity) {
+      primitives->capacity =
+          primitives->capacity == 0 ? 16 : primitives->capacity * 2;
+      primitives->primitives =
+          realloc(primitives->primitives,
+                  sizeof(GltfAnimatedPrimitive) * primitives->capacity);
+      ASSERTQ_CUSTOM(primitives->primitives != NULL,
+                     "Failed to allocate the animated primitives");
+    }
+    primitives->primitives[primitives->count++] = (GltfAnimatedPrimitive){
+        .node = node,
+        .prim = prim,
+        .vertices_count = pos_accessor->count,
+        .targets_count = prim->targets_count,
+    };
+  }
+
+  for (cgltf_size c = 0; c < node->children_count; ++c)
+    collect_primitives(primitives, node->children[c]);
+}
+
+static void *alloc(size_t size) {
+  // NOTE: malloc(0) may return NULL
+  void *ptr = calloc(size > 0 ? size : 1, 1);
+  ASSERTQ_CUSTOM(ptr != NULL, "Failed to allocate the animation");
+  return ptr;
+}
+
+static void read_vec3s(const cgltf_accessor *accessor, vec3 *out,
+                       uint32_t count) {
+  for (uint32_t v = 0; v < count; ++v) {
+    float f[3] = {0};
+    cgltf_accessor_read_float(accessor, v, f, 3);
+    vec3_copy_from_float3(&out[v], f);
+  }
+}
+
+// reads everything about the primitive's vertices that the animation needs
+static void read_vertices(GltfAnimation *self, const char *path,
+                          const GltfAnimatedPrimitive *p) {
+  const cgltf_primitive *prim = p->prim;
+  read_vec3s(find_attribute(prim->attributes, prim->attributes_count,
+                            cgltf_attribute_type_position),
+             &self->_positions[p->first_vertex], p->vertices_count);
+  read_vec3s(find_attribute(prim->attributes, prim->attributes_count,
+                            cgltf_attribute_type_normal),
+             &self->_normals[p->first_vertex], p->vertices_count);
+
+  for (uint32_t t = 0; t < p->targets_count; ++t) {
+    const cgltf_morph_target *target = &prim->targets[t];
+    const uint32_t first = p->first_offset + t * p->vertices_count;
+    const cgltf_accessor *positions = find_attribute(
+        target->attributes, target->attributes_count,
+        cgltf_attribute_type_position);
+    const cgltf_accessor *normals =
+        find_attribute(target->attributes, target->attributes_count,
+                       cgltf_attribute_type_normal);
+    // NOTE: the offsets which are missing were zeroed
+    if (positions)
+      read_vec3s(positions, &self->_position_offsets[first], p->vertices_count);
+    if (normals)
+      read_vec3s(normals, &self->_normal_offsets[first], p->vertices_count);
+  }
+
+  const cgltf_skin *skin = p->node->skin;
+  if (skin == NULL)
+    return;
+  const cgltf_accessor *joints = find_attribute(
+      prim->attributes, prim->attributes_count, cgltf_attribute_type_joints);
+  const cgltf_accessor *weights = find_attribute(
+      prim->attributes, prim->attributes_count, cgltf_attribute_type_weights);
+  gltf_assert(joints != NULL && weights != NULL, path,
+              "A skinned mesh requires JOINTS_0 and WEIGHTS_0 attributes\n");
+  for (uint32_t v = 0; v < p->vertices_count; ++v) {
+    const uint32_t i = 4 * (p->first_vertex + v);
+    cgltf_accessor_read_uint(joints, v, &self->_joints[i], 4);
+    cgltf_accessor_read_float(weights, v, &self->_joint_weights[i], 4);
+    for (int j = 0; j < 4; ++j)
+      gltf_assert(self->_joints[i + j] < skin->joints_count, path,
+                  "A vertex uses joint %u of a skin with %zu joints\n",
+                  self->_joints[i + j], skin->joints_count);
+  }
+}
+
+// the weights the primitive's morph targets have when they aren't animated
+static void default_weights(const GltfAnimatedPrimitive *p, float *weights) {
+  const cgltf_node *node = p->node;
+  for (uint32_t t = 0; t < p->targets_count; ++t) {
+    if (node->weights_count == p->targets_count)
+      weights[t] = node->weights[t];
+    else if (node->mesh->weights_count == p->targets_count)
+      weights[t] = node->mesh->weights[t];
+    else
+      weights[t] = 0;
+  }
+}
+
+bool GltfAnimation_new(GltfAnimation *self, cgltf_data *data, const char *path,
+                       Scene *scene) {
+  *self = (GltfAnimation){0};
+  if (data->animations_count == 0)
+    return false;
+  const cgltf_animation *animation = &data->animations[0];
+
+  Primitives primitives = {0};
+  for (cgltf_size s = 0; s < data->scenes_count; ++s)
+    for (cgltf_size n = 0; n < data->scenes[s].nodes_count; ++n)
+      collect_primitives(&primitives, data->scenes[s].nodes[n]);
+
+  bool moves_triangles = false;
+  for (cgltf_size c = 0; c < animation->channels_count; ++c)
+    for (uint32_t p = 0; p < primitives.count && !moves_triangles; ++p)
+      moves_triangles =
+          moves_primitive(&animation->channels[c], &primitives.primitives[p]);
+  if (!moves_triangles) {
+    free(primitives.primitives);
+    return false;
+  }
+
+  self->_data = data;
+  self->_animation = animation;
+  self->_primitives = primitives.primitives;
+  self->_primitives_count = primitives.count;
+
+  // where every primitive's data starts
+  uint32_t vertices_count = 0, joint_matrices_count = 0, weights_count = 0,
+           offsets_count = 0, triangles_count = 0;
+  for (uint32_t i = 0; i < self->_primitives_count; ++i) {
+    GltfAnimatedPrimitive *p = &self->_primitives[i];
+    gltf_assert(p->targets_count <= GLTF_MAX_SAMPLED_COMPONENTS, path,
+                "Only up to %d morph targets are supported, got %u\n",
+                GLTF_MAX_SAMPLED_COMPONENTS, p->targets_count);
+    p->first_vertex = vertices_count;
+    vertices_count += p->vertices_count;
+    p->first_joint_matrix = joint_matrices_count;
+    joint_matrices_count += p->node->skin ? p->node->skin->joints_count : 0;
+    p->first_weight = weights_count;
+    weights_count += p->targets_count;
+    p->first_offset = offsets_count;
+    offsets_count += p->targets_count * p->vertices_count;
+    triangles_count += p->prim->indices->count / 3;
+
+    for (cgltf_size c = 0; c < animation->channels_count; ++c) {
+      const cgltf_animation_channel *channel = &animation->channels[c];
+      if (channel->target_path == cgltf_animation_path_type_weights &&
+          channel->target_node == p->node)
+        p->weights_channel = channel;
+    }
+  }
+  gltf_assert(triangles_count == scene->triangles_count, path,
+              "The animation found %u triangles instead of %u\n",
+              triangles_count, scene->triangles_count);
+
+  self->vertices_count = vertices_count;
+  self->_positions = alloc(sizeof(vec3) * vertices_count);
+  self->_normals = alloc(sizeof(vec3) * vertices_count);
+  self->_animated_positions = alloc(sizeof(vec3) * vertices_count);
+  self->_animated_normals = alloc(sizeof(vec3) * vertices_count);
+  self->_joints = alloc(sizeof(uint32_t) * 4 * vertices_count);
+  self->_joint_weights = alloc(sizeof(float) * 4 * vertices_count);
+  self->_position_offsets = alloc(sizeof(vec3) * offsets_count);
+  self->_normal_offsets = alloc(sizeof(vec3) * offsets_count);
+  self->_joint_matrices = alloc(sizeof(Mat4) * joint_matrices_count);
+  self->_weights = alloc(sizeof(float) * weights_count);
+  self->_triangles_vertices = alloc(sizeof(uint32_t) * 3 * triangles_count);
+
+  uint32_t triangle = 0;
+  for (uint32_t i = 0; i < self->_primitives_count; ++i) {
+    const GltfAnimatedPrimitive *p = &self->_primitives[i];
+    read_vertices(self, path, p);
+    default_weights(p, &self->_weights[p->first_weight]);
+
+    const cgltf_accessor *indices = p->prim->indices;
+    for (cgltf_size v = 0; v < indices->count / 3 * 3; ++v)
+      self->_triangles_vertices[3 * triangle + v] =
+          p->first_vertex + cgltf_accessor_read_index(indices, v);
+    triangle += indices->count / 3;
+  }
+
+  self->start_s = INFINITY;
+  self->end_s = -INFINITY;
+  for (cgltf_size c = 0; c < animation->channels_count; ++c) {
+    const cgltf_accessor *input = animation->channels[c].sampler->input;
+    float first = 0, last = 0;
+    cgltf_accessor_read_float(input, 0, &first, 1);
+    cgltf_accessor_read_float(input, input->count - 1, &last, 1);
+    self->start_s = first < self->start_s ? first : self->start_s;
+    self->end_s = last > self->end_s ? last : self->end_s;
+  }
+
+  // the triangles are still in the order they were loaded in
+  free(scene->triangles_sources);
+  scene->triangles_sources = alloc(sizeof(uint32_t) * scene->triangles_count);
+  for (uint32_t i = 0; i < scene->triangles_count; ++i)
+    scene->triangles_sources[i] = i;
+  return true;
+}
+
+bool GltfAnimation_is_loaded(const GltfAnimation *self) {
+  return self->_data != NULL;
+}
+
+// sets the animated nodes' transforms and the primitives' matrices and
+// morph target weights to their ones at time_s
+static void pose(GltfAnimation *self, float time_s) {
+  const cgltf_animation *animation = self->_animation;
+  for (cgltf_size c = 0; c < animation->channels_count; ++c) {
+    const cgltf_animation_channel *channel = &animation->channels[c];
+    cgltf_node *node = channel->target_node;
+    switch (channel->target_path) {
+    case cgltf_animation_path_type_translation:
+      gltf_sample_animation(channel, time_s, node->translation, 3);
+      node->has_translation = true;
+      break;
+    case cgltf_animation_path_type_rotation:
+      gltf_sample_animation(channel, time_s, node->rotation, 4);
+      node->has_rotation = true;
+      break;
+    case cgltf_animation_path_type_scale:
+      gltf_sample_animation(channel, time_s, node->scale, 3);
+      node->has_scale = true;
+      break;
+    default:
+      break;
+    }
+  }
+
+  for (uint32_t i = 0; i < self->_primitives_count; ++i) {
+    GltfAnimatedPrimitive *p = &self->_primitives[i];
+    if (p->weights_channel)
+      gltf_sample_animation(p->weights_channel, time_s,
+                            &self->_weights[p->first_weight], p->targets_count);
+
+    const cgltf_skin *skin = p->node->skin;
+    if (skin == NULL) {
+      cgltf_node_transform_world(p->node, p->world);
+      continue;
+    }
+    // glTF's skinned vertices are only transformed by their joints,
+    // from the space of the skin's bind pose to where the joint is now
+    for (cgltf_size j = 0; j < skin->joints_count; ++j) {
+      Mat4 joint_world;
+      Mat4 inverse_bind = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+      cgltf_node_transform_world(skin->joints[j], joint_world);
+      if (skin->inverse_bind_matrices)
+        cgltf_accessor_read_float(skin->inverse_bind_matrices, j, inverse_bind,
+                                  16);
+      Mat4_mul(self->_joint_matrices[p->first_joint_matrix + j], joint_world,
+               inverse_bind);
+    }
+  }
+}
+
+static void deform_vertex(GltfAnimation *self, const GltfAnimatedPrimitive *p,
+                          uint32_t v) {
+  vec3 pos = self->_positions[v], normal = self->_normals[v];
+  const uint32_t i = v - p->first_vertex;
+  for (uint32_t t = 0; t < p->targets_count; ++t) {
+    const float weight = self->_weights[p->first_weight + t];
+    const uint32_t offset = p->first_offset + t * p->vertices_count + i;
+    pos = vec3_add(pos, vec3_mult(self->_position_offsets[offset], weight));
+    normal = vec3_add(normal, vec3_mult(self->_normal_offsets[offset], weight));
+  }
+
+  const float *transform = p->world;
+  Mat4 skin_transform = {0};
+  if (p->node->skin) {
+    for (int j = 0; j < 4; ++j) {
+      const float weight = self->_joint_weights[4 * v + j];
+      const float *joint =
+          self->_joint_matrices[p->first_joint_matrix + self->_joints[4 * v + j]];
+      for (int k = 0; k < 16; ++k)
+        skin_transform[k] += weight * joint[k];
+    }
+    transform = skin_transform;
+  }
+
+  self->_animated_positions[v] = Mat4_mul_vec3(transform, pos);
+  // NOTE: correct as long as the scaling is uniform
+  self->_animated_normals[v] = vec3_norm(Mat4_mul_dir(transform, normal));
+}
+
+typedef struct {
+  GltfAnimation *self;
+  Scene *scene;
+} DeformCtx;
+
+static void deform_vertices(void *ctx, uint32_t begin, uint32_t end) {
+  GltfAnimation *self = ((DeformCtx *)ctx)->self;
+  // the primitive of the first vertex
+  uint32_t lo = 0, hi = self->_primitives_count;
+  while (hi - lo > 1) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    if (self->_primitives[mid].first_vertex <= begin)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  Timer_begin("deform vertices");
+  const GltfAnimatedPrimitive *p = &self->_primitives[lo];
+  for (uint32_t v = begin; v < end; ++v) {
+    while (v >= p->first_vertex + p->vertices_count)
+      ++p;
+    deform_vertex(self, p, v);
+  }
+  Timer_end();
+}
+
+static void update_triangles(void *ctx, uint32_t begin, uint32_t end) {
+  const GltfAnimation *self = ((DeformCtx *)ctx)->self;
+  Scene *scene = ((DeformCtx *)ctx)->scene;
+  for (uint32_t t = begin; t < end; ++t) {
+    const uint32_t *vertices =
+        &self->_triangles_vertices[3 * scene->triangles_sources[t]];
+    Triangle *triangle = &scene->triangles[t];
+    for (int v = 0; v < 3; ++v) {
+      *Triangle_get_vertex(triangle, v) =
+          self->_animated_positions[vertices[v]];
+      *Triangle_get_vertex(triangle, v + 3) =
+          self->_animated_normals[vertices[v]];
+    }
+  }
+}
+
+void GltfAnimation_apply(GltfAnimation *self, Scene *scene, float time_s) {
+  ASSERTQ_CUSTOM(GltfAnimation_is_loaded(self), "No animation to apply");
+  Timer_begin("pose");
+  pose(self, time_s);
+  Timer_end();
+  DeformCtx ctx = {.self = self, .scene = scene};
+  Timer_begin("deform");
+  Thread_parallel_for(self->vertices_count, deform_vertices, &ctx);
+  Thread_parallel_for(scene->triangles_count, update_triangles, &ctx);
+  Timer_end();
+}
+
+void GltfAnimation_delete(GltfAnimation *self) {
+  if (!GltfAnimation_is_loaded(self))
+    return;
+  free(self->_primitives);
+  free(self->_joint_matrices);
+  free(self->_weights);
+  free(self->_positions);
+  free(self->_normals);
+  free(self->_animated_positions);
+  free(self->_animated_normals);
+  free(self->_joints);
+  free(self->_joint_weights);
+  free(self->_position_offsets);
+  free(self->_normal_offsets);
+  free(self->_triangles_vertices);
+  cgltf_free(self->_data);
+  *self = (GltfAnimation){0};
+}
@@ -5,6 +5,7 @@
 #include "utils.h"
 #include "vec3.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -204,28 +205,29 @@ void traverse_nodes(const char *path, const cgltf_data *data, Scene *scene,
   }
 }
 
-static void handle_camera(const char *path, const cgltf_node *node,
-                          Scene *scene) {
-  gltf_assert(node->camera->type == cgltf_camera_type_perspective, path,
-              "Only perspective camera type is supported! Got type %d\n",
-              node->camera->type);
+void gltf_camera_transform(const cgltf_node *node, vec3 *pos, vec3 *dir) {
   // From glTF 2.0 Specification
   // (https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#cameras-overview):
   // "A camera object defines the projection matrix that transforms scene
   // coordinates from the view space to the clip space.
   // A node containing the camera instance defines the view matrix that
   // transforms scene coordinates from the global space to the view space."
-
-  cgltf_camera_perspective cam = node->camera->data.perspective;
   Mat4 view_matrix;
   cgltf_node_transform_world(node, view_matrix);
-  vec3 pos = Mat4_mul_vec3(view_matrix, DEFAULT_CAM_POS);
+  *pos = Mat4_mul_vec3(view_matrix, DEFAULT_CAM_POS);
   vec3 lookat =
       Mat4_mul_vec3(view_matrix, vec3_add(DEFAULT_CAM_POS, DEFAULT_CAM_DIR));
-  vec3 dir = vec3_sub(lookat, pos);
+  *dir = vec3_sub(lookat, *pos);
+}
 
-  scene->camera.pos = pos;
-  scene->camera.dir = dir;
+static void handle_camera(const char *path, const cgltf_node *node,
+                          Scene *scene) {
+  gltf_assert(node->camera->type == cgltf_camera_type_perspective, path,
+              "Only perspective camera type is supported! Got type %d\n",
+              node->camera->type);
+
+  cgltf_camera_perspective cam = node->camera->data.perspective;
+  gltf_camera_transform(node, &scene->camera.pos, &scene->camera.dir);
   scene->camera.fov_rad = cam.yfov;
 }
 
@@ -236,3 +238,111 @@ void handle_node(const char *path, const cgltf_data *data,
   if (node->camera)
     handle_camera(path, node, scene);
 }
+
+// reads the sampler output's value_idx-th value, which for cubic splines is
+// one of the keys' in-tangent, value or out-tangent
+static void read_output(const cgltf_accessor *output, cgltf_size value_idx,
+                        float *out, cgltf_size components) {
+  if (cgltf_num_components(output->type) == components) {
+    cgltf_accessor_read_float(output, value_idx, out, components);
+    return;
+  }
+  // NOTE: morph target weights are scalars, with a value being all of them
+  for (cgltf_size c = 0; c < components; ++c)
+    cgltf_accessor_read_float(output, value_idx * components + c, &out[c], 1);
+}
+
+static float read_time(const cgltf_accessor *input, cgltf_size key) {
+  float time_s = 0;
+  cgltf_accessor_read_float(input, key, &time_s, 1);
+  return time_s;
+}
+
+// spherical linear interpolation of unit quaternions, into a
+static void slerp(float a[4], const float b[4], float t) {
+  float cos_theta = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  // q and -q are the same rotation, going the shorter way around
+  const float sign = cos_theta < 0 ? -1 : 1;
+  cos_theta *= sign;
+
+  float wa = 1 - t, wb = t * sign;
+  // NOTE: sin(theta) gets too close to 0 for nearly equal rotations, in which
+  // case linear interpolation is just as good
+  if (cos_theta < 0.9995f) {
+    const float theta = acosf(cos_theta);
+    wa = sinf((1 - t) * theta) / sinf(theta);
+    wb = sinf(t * theta) / sinf(theta) * sign;
+  }
+  for (int i = 0; i < 4; ++i)
+    a[i] = wa * a[i] + wb * b[i];
+}
+
+static void normalize(float *v, cgltf_size components) {
+  float len = 0;
+  for (cgltf_size i = 0; i < components; ++i)
+    len += v[i] * v[i];
+  len = sqrtf(len);
+  if (len > 0)
+    for (cgltf_size i = 0; i < components; ++i)
+      v[i] /= len;
+}
+
+void gltf_sample_animation(const cgltf_animation_channel *channel,
+                           float time_s, float *out, cgltf_size components) {
+  ASSERTQ_CUSTOM(components <= GLTF_MAX_SAMPLED_COMPONENTS,
+                 "Too many components to sample");
+  const cgltf_animation_sampler *sampler = channel->sampler;
+  const cgltf_accessor *input = sampler->input;
+  const bool cubic =
+      sampler->interpolation == cgltf_interpolation_type_cubic_spline;
+  // cubic splines store each key's in-tangent, value and out-tangent
+  const cgltf_size stride = cubic ? 3 : 1, offset = cubic ? 1 : 0;
+
+  // the last key at or before time_s
+  cgltf_size lo = 0, hi = input->count;
+  while (hi - lo > 1) {
+    const cgltf_size mid = lo + (hi - lo) / 2;
+    if (read_time(input, mid) <= time_s)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  const cgltf_size key = lo;
+  const float t0 = read_time(input, key);
+  if (key + 1 >= input->count || time_s <= t0 ||
+      sampler->interpolation == cgltf_interpolation_type_step) {
+    read_output(sampler->output, key * stride + offset, out, components);
+    return;
+  }
+
+  const float dt = read_time(input, key + 1) - t0;
+  const float t = (time_s - t0) / dt;
+  const bool rotation =
+      channel->target_path == cgltf_animation_path_type_rotation;
+  float next[GLTF_MAX_SAMPLED_COMPONENTS];
+  read_output(sampler->output, key * stride + offset, out, components);
+  read_output(sampler->output, (key + 1) * stride + offset, next, components);
+
+  if (!cubic) {
+    if (rotation) {
+      slerp(out, next, t);
+    } else {
+      for (cgltf_size i = 0; i < components; ++i)
+        out[i] += (next[i] - out[i]) * t;
+    }
+    return;
+  }
+
+  // Hermite spline, with the tangents scaled by the keys' time difference
+  float out_tangent[GLTF_MAX_SAMPLED_COMPONENTS];
+  float in_tangent[GLTF_MAX_SAMPLED_COMPONENTS];
+  read_output(sampler->output, key * stride + 2, out_tangent, components);
+  read_output(sampler->output, (key + 1) * stride, in_tangent, components);
+  const float t2 = t * t, t3 = t2 * t;
+  for (cgltf_size i = 0; i < components; ++i)
+    out[i] = (2 * t3 - 3 * t2 + 1) * out[i] +
+             (t3 - 2 * t2 + t) * dt * out_tangent[i] +
+             (-2 * t3 + 3 * t2) * next[i] + (t3 - t2) * dt * in_tangent[i];
+  if (rotation)
+    normalize(out, components);
+}
@@ -0,0 +1,324 @@
+#include "scene/light_bvh.h"
+#include "asserts.h"
+#include "scene/aabb.h"
+#include "scene/bvh.h"
+#include <math.h>
+
+// https://pbr-book.org/4ed/Light_Sources/Light_Sampling#BVHLightSampling
+
+#define BUCKETS_COUNT 12
+#define PI 3.14159265358979f
+
+// the lights are triangles, which emit over the whole hemisphere around
+// their normals, so theta_e (the spread of the emission) is always PI / 2
+#define COS_THETA_E 0.0f
+
+static float safe_sqrt(float x) { return sqrtf(fmaxf(x, 0)); }
+
+// angle between two normalized vectors, precise even for the small ones
+static float angle_between(vec3 a, vec3 b) {
+  if (vec3_dot(a, b) < 0)
+    return PI - 2 * asinf(fminf(vec3_mag(vec3_add(a, b)) / 2, 1));
+  return 2 * asinf(fminf(vec3_mag(vec3_sub(b, a)) / 2, 1));
+}
+
+// Rodrigues' rotation of v around the normalized axis k
+static vec3 rotate(vec3 v, vec3 k, float angle) {
+  const float c = cosf(angle), s = sinf(angle);
+  return vec3_add(vec3_add(vec3_mult(v, c), vec3_mult(vec3_cross(k, v), s)),
+                  vec3_mult(k, vec3_dot(k, v) * (1 - c)));
+}
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) given the sines and cosines
+static float cos_sub_clamped(float sin_a, float cos_a, float sin_b,
+                             float cos_b) {
+  if (cos_a > cos_b)
+    return 1;
+  return cos_a * cos_b + sin_a * sin_b;
+}
+static float sin_sub_clamped(float sin_a, float cos_a, float sin_b,
+                             float cos_b) {
+  if (cos_a > cos_b)
+    return 0;
+  return sin_a * cos_b - cos_a * sin_b;
+}
+
+// NOTE: nodes with no power are empty
+static LightBVHnode LightBVHnode_union(const LightBVHnode *a,
+                                       const LightBVHnode *b) {
+  if (a->power == 0)
+    return *b;
+  if (b->power == 0)
+    return *a;
+
+  LightBVHnode u = {.bound_min = vec3_min(a->bound_min, b->bound_min),
+                    .bound_max = vec3_max(a->bound_max, b->bound_max),
+                    .power = a->power + b->power};
+
+  // the smallest cone containing both cones
+  const float theta_a = acosf(a->cos_theta_o), theta_b = acosf(b->cos_theta_o);
+  const float theta_d = angle_between(a->axis, b->axis);
+  if (fminf(theta_d + theta_b, PI) <= theta_a) {
+    u.axis = a->axis;
+    u.cos_theta_o = a->cos_theta_o;
+    return u;
+  }
+  if (fminf(theta_d + theta_a, PI) <= theta_b) {
+    u.axis = b->axis;
+    u.cos_theta_o = b->cos_theta_o;
+    return u;
+  }
+
+  const float theta_o = (theta_a + theta_d + theta_b) / 2;
+  const vec3 rotation_axis = vec3_cross(a->axis, b->axis);
+  if (theta_o >= PI || vec3_dot(rotation_axis, rotation_axis) == 0) {
+    // every direction
+    u.axis = a->axis;
+    u.cos_theta_o = -1;
+    return u;
+  }
+  u.axis = rotate(a->axis, vec3_norm(rotation_axis), theta_o - theta_a);
+  u.cos_theta_o = cosf(theta_o);
+  return u;
+}
+
+static LightBVHnode LightBVHnode_from_light(const Light *light,
+                                            const Triangle *t) {
+  AABB aabb = AABB_new();
+  AABB_grow_tri(&aabb, t);
+  return (LightBVHnode){
+      .bound_min = aabb.min,
+      .bound_max = aabb.max,
+      .axis =
+          vec3_norm(vec3_cross(vec3_sub(t->b, t->a), vec3_sub(t->c, t->a))),
+      .power = light->power,
+      .cos_theta_o = 1,
+  };
+}
+
+static vec3 LightBVHnode_centroid(const LightBVHnode *node) {
+  return vec3_mult(vec3_add(node->bound_min, node->bound_max), 0.5f);
+}
+
+// surface area orientation heuristic, lower is better
+static float SAOH_cost(const LightBVHnode *node, float max_extent,
+                       float axis_extent) {
+  const float theta_o = acosf(node->cos_theta_o);
+  const float theta_w = fminf(theta_o + PI / 2, PI);
+  const float sin_theta_o =
+      safe_sqrt(1 - node->cos_theta_o * node->cos_theta_o);
+  // solid angle measure of the directions in which the node emits light
+  const float M_omega =
+      2 * PI * (1 - node->cos_theta_o) +
+      PI / 2 *
+          (2 * theta_w * sin_theta_o - cosf(theta_o - 2 * theta_w) -
+           2 * theta_o * sin_theta_o + node->cos_theta_o);
+  // penalizes thin nodes, which would be split along their shorter axis
+  const float K_r = axis_extent > 0 ? max_extent / axis_extent : 0;
+  const AABB aabb = AABB_from(node->bound_min, node->bound_max);
+  return node->power * M_omega * K_r * AABB_area(&aabb);
+}
+
+typedef struct {
+  LightBVHnode *nodes;
+  uint32_t *nodes_count;
+  Light *lights;
+  // leaf nodes of every light
+  const LightBVHnode *leaves;
+  // indices of the lights, getting reordered as the nodes are split
+  uint32_t *order;
+} LightBVHBuild;
+
+// returns the index of the first light that goes to the second child
+static uint32_t split(const LightBVHBuild *b, const LightBVHnode *node,
+                      uint32_t begin, uint32_t end) {
+  AABB centroids = AABB_new();
+  for (uint32_t i = begin; i < end; ++i)
+    AABB_grow(&centroids, LightBVHnode_centroid(&b->leaves[b->order[i]]));
+  const vec3 node_extent = vec3_sub(node->bound_max, node->bound_min);
+  const float max_extent =
+      fmaxf(node_extent.x, fmaxf(node_extent.y, node_extent.z));
+
+  float best_cost = INFINITY;
+  int best_axis = -1, best_bucket = 0;
+  for (int axis = 0; axis < 3; ++axis) {
+    const float min = vec3_get_by_axis(&centroids.min, axis);
+    const float extent = vec3_get_by_axis(&centroids.max, axis) - min;
+    if (extent <= 0)
+      continue;
+
+    LightBVHnode buckets[BUCKETS_COUNT] = {0};
+    for (uint32_t i = begin; i < end; ++i) {
+      const LightBVHnode *leaf = &b->leaves[b->order[i]];
+      const vec3 centroid = LightBVHnode_centroid(leaf);
+      int bucket = BUCKETS_COUNT * (vec3_get_by_axis(&centroid, axis) - min) /
+                   extent;
+      bucket = bucket < BUCKETS_COUNT ? bucket : BUCKETS_COUNT - 1;
+      buckets[bucket] = LightBVHnode_union(&buckets[bucket], leaf);
+    }
+
+    // splitting after bucket i
+    for (int i = 0; i < BUCKETS_COUNT - 1; ++i) {
+      LightBVHnode below = {0}, above = {0};
+      for (int j = 0; j <= i; ++j)
+        below = LightBVHnode_union(&below, &buckets[j]);
+      for (int j = i + 1; j < BUCKETS_COUNT; ++j)
+        above = LightBVHnode_union(&above, &buckets[j]);
+      if (below.power == 0 || above.power == 0)
+        continue;
+
+      const float axis_extent = vec3_get_by_axis(&node_extent, axis);
+      const float cost = SAOH_cost(&below, max_extent, axis_extent) +
+                         SAOH_cost(&above, max_extent, axis_extent);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bucket = i;
+      }
+    }
+  }
+
+  // all the centroids are in the same place, so it doesn't matter
+  if (best_axis == -1)
+    return begin + (end - begin) / 2;
+
+  const float min = vec3_get_by_axis(&centroids.min, best_axis);
+  const float extent = vec3_get_by_axis(&centroids.max, best_axis) - min;
+  uint32_t mid = begin;
+  for (uint32_t i = begin; i < end; ++i) {
+    const vec3 centroid = LightBVHnode_centroid(&b->leaves[b->order[i]]);
+    int bucket = BUCKETS_COUNT *
+                 (vec3_get_by_axis(&centroid, best_axis) - min) / extent;
+    bucket = bucket < BUCKETS_COUNT ? bucket : BUCKETS_COUNT - 1;
+    if (bucket <= best_bucket) {
+      SWAP(b->order[i], b->order[mid], uint32_t);
+      ++mid;
+    }
+  }
+  return mid;
+}
+
+static void subdivide(const LightBVHBuild *b, uint32_t node_idx,
+                      uint32_t begin, uint32_t end, uint32_t depth,
+                      uint64_t bit_trail) {
+  ASSERTQ_CUSTOM(depth < LIGHT_BVH_MAX_DEPTH, "Light BVH is too deep!");
+  LightBVHnode *node = &b->nodes[node_idx];
+
+  if (end - begin == 1) {
+    const uint32_t light = b->order[begin];
+    *node = b->leaves[light];
+    node->first = light;
+    node->count = 1;
+    b->lights[light].bit_trail = bit_trail;
+    return;
+  }
+
+  *node = (LightBVHnode){0};
+  for (uint32_t i = begin; i < end; ++i)
+    *node = LightBVHnode_union(node, &b->leaves[b->order[i]]);
+  const uint32_t mid = split(b, node, begin, end);
+
+  const uint32_t left_idx = (*b->nodes_count)++;
+  const uint32_t right_idx = (*b->nodes_count)++;
+  node->first = left_idx;
+  node->count = 0;
+
+  subdivide(b, left_idx, begin, mid, depth + 1, bit_trail);
+  subdivide(b, right_idx, mid, end, depth + 1,
+            bit_trail | ((uint64_t)1 << depth));
+}
+
+void LightBVH_build(LightBVHnode *nodes, uint32_t *nodes_count, Light *lights,
+                    uint32_t lights_count, const Triangle *triangles,
+                    Arena *arena) {
+  *nodes_count = 0;
+  if (lights_count == 0)
+    return;
+
+  ArenaMark am = Arena_mark(arena);
+  LightBVHnode *leaves =
+      Arena_alloc(arena, lights_count * sizeof(LightBVHnode));
+  uint32_t *order = Arena_alloc(arena, lights_count * sizeof(uint32_t));
+  for (uint32_t i = 0; i < lights_count; ++i) {
+    leaves[i] =
+        LightBVHnode_from_light(&lights[i], &triangles[lights[i].triangle]);
+    order[i] = i;
+  }
+
+  const LightBVHBuild build = {.nodes = nodes,
+                               .nodes_count = nodes_count,
+                               .lights = lights,
+                               .leaves = leaves,
+                               .order = order};
+  *nodes_count = 1;
+  subdivide(&build, 0, 0, lights_count, 0, 0);
+  Arena_rewind(am);
+}
+
+float LightBVHnode_importance(const LightBVHnode *node, vec3 point,
+                              vec3 normal) {
+  const vec3 center = LightBVHnode_centroid(node);
+  const vec3 to_point = vec3_sub(point, center);
+  const float dst2 = vec3_dot(to_point, to_point);
+  const float radius = vec3_mag(vec3_sub(node->bound_max, node->bound_min)) / 2;
+  // NOTE: clamped so that points close to the node don't get importance
+  // approaching infinity
+  const float clamped_dst2 = fmaxf(dst2, radius);
+  const vec3 wi = vec3_mult(to_point, 1 / sqrtf(dst2));
+
+  // angle between the cone's axis and the direction towards the point,
+  // which can be on either side of the lights
+  const float cos_theta_w = fabsf(vec3_dot(node->axis, wi));
+  const float sin_theta_w = safe_sqrt(1 - cos_theta_w * cos_theta_w);
+
+  // angle which the node's bounding sphere takes up when seen from the point
+  float cos_theta_b = -1;
+  if (dst2 > radius * radius)
+    cos_theta_b = safe_sqrt(1 - radius * radius / dst2);
+  const float sin_theta_b = safe_sqrt(1 - cos_theta_b * cos_theta_b);
+
+  // the smallest possible angle between any light's normal and the direction
+  // from it towards the point
+  const float sin_theta_o =
+      safe_sqrt(1 - node->cos_theta_o * node->cos_theta_o);
+  const float cos_theta_x = cos_sub_clamped(sin_theta_w, cos_theta_w,
+                                            sin_theta_o, node->cos_theta_o);
+  const float sin_theta_x = sin_sub_clamped(sin_theta_w, cos_theta_w,
+                                            sin_theta_o, node->cos_theta_o);
+  const float cos_theta_p =
+      cos_sub_clamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+  if (cos_theta_p <= COS_THETA_E)
+    return 0;
+
+  // the smallest possible angle between the normal and any of the lights
+  const float cos_theta_i = -vec3_dot(normal, wi);
+  const float sin_theta_i = safe_sqrt(1 - cos_theta_i * cos_theta_i);
+  const float cos_theta_pi =
+      cos_sub_clamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+
+  return fmaxf(node->power * cos_theta_p * cos_theta_pi / clamped_dst2, 0);
+}
+
+float LightBVH_pmf(const LightBVHnode *nodes, const Light *light, vec3 point,
+                   vec3 normal) {
+  // same as in PickLight in shaders/pathtracer.glsl, which never picks a light
+  // when the root can't light the point
+  if (LightBVHnode_importance(&nodes[0], point, normal) == 0)
+    return 0;
+
+  float pmf = 1;
+  uint32_t node_idx = 0;
+  for (uint32_t depth = 0; nodes[node_idx].count == 0; ++depth) {
+    const LightBVHnode *node = &nodes[node_idx];
+    const float importances[2] = {
+        LightBVHnode_importance(&nodes[node->first], point, normal),
+        LightBVHnode_importance(&nodes[node->first + 1], point, normal)};
+    if (importances[0] + importances[1] == 0)
+      return 0;
+
+    const uint32_t child = (light->bit_trail >> depth) & 1;
+    pmf *= importances[child] / (importances[0] + importances[1]);
+    node_idx = node->first + child;
+  }
+  return pmf;
+}
@@ -1,11 +1,13 @@
 #include "stats.h"
-#include "GLFW/glfw3.h"
 #include "asserts.h"
+#include "utils/timer.h"
 #include <stdio.h>
 
+static double now_s(void) { return Timer_now_ns() * 1e-9; }
+
 StatsTimer StatsTimer_new(void) { return (StatsTimer){0}; }
 void StatsTimer_start(StatsTimer *self) {
-  self->_start_time = glfwGetTime();
+  self->_start_time = now_s();
   self->_end_time = 0;
   self->total_time = 0;
 }
@@ -13,18 +15,19 @@ void StatsTimer_stop(StatsTimer *self) {
   // if the timer wasn't started or already was stopped
   if (self->_start_time == 0 || self->total_time != 0)
     return;
-  self->_end_time = glfwGetTime();
+  self->_end_time = now_s();
   self->total_time = self->_end_time - self->_start_time;
 }
 double StatsTimer_elapsed(const StatsTimer *self) {
   // if the timer wasn't started
   if (self->_start_time == 0)
     return 0;
-  return glfwGetTime() - self->_start_time;
+  return now_s() - self->_start_time;
 }
 
 Stats Stats_default(void) {
   Stats stats = {0};
+  stats.frames_per_display = 1;
   return stats;
 }
 
@@ -32,6 +35,8 @@ void Stats_reset_rendering(Stats *self) {
   self->last_frame_rendering = StatsTimer_new();
   self->rendering = StatsTimer_new();
   self->frame_number = 0;
+  self->sampled_pixels = 0;
+  self->frames_per_display = 1;
 }
 
 TinyString Stats_fmt_time(double time_in_s) {
@@ -56,6 +61,22 @@ SmallString Stats_str(const Stats *self) {
                Stats_fmt_time(self->scene_load.total_time).str,
                Stats_fmt_time(self->bvh_build.total_time).str,
                Stats_fmt_time(self->rendering.total_time).str);
+  // only for animated scenes
+  if (written >= 0 && written < (int)sizeof(out.str) &&
+      self->animation._start_time != 0)
+    written += snprintf(out.str + written, sizeof(out.str) - written,
+                        "animation update time: %s\nbvh update time: %s\n",
+                        Stats_fmt_time(self->animation.total_time).str,
+                        Stats_fmt_time(self->bvh_update.total_time).str);
+  // only once the GPU's measurements got read back
+  if (written >= 0 && written < (int)sizeof(out.str) &&
+      self->gpu_frame_time > 0)
+    written += snprintf(out.str + written, sizeof(out.str) - written,
+                        "gpu time per frame: %s\nMrays/s: %.2f\n"
+                        "time per sample: %s\n",
+                        Stats_fmt_time(self->gpu_frame_time).str,
+                        self->rays_per_s * 1e-6,
+                        Stats_fmt_time(self->sample_time).str);
   ASSERTQ_CUSTOM(written < (int)sizeof(out.str),
                  "SmallString turned out to be too small for Stats");
 
@@ -1,8 +1,10 @@
 #include "utils.h"
 #include "arena.h"
 #include "asserts.h"
+#include "stb_image_write.h"
 
 #include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +41,15 @@ const char *FilePath_get_file_name(const char *path) {
   return last_path_sep ? last_path_sep + 1 : path;
 }
 
+bool FilePath_with_number(char *out, size_t out_size, const char *path,
+                          uint32_t number) {
+  const char *ext = strrchr(FilePath_get_file_name(path), '.');
+  const int stem_len = ext ? (int)(ext - path) : (int)strlen(path);
+  const int len = snprintf(out, out_size, "%.*s_%04u%s", stem_len, path,
+                           number, ext ? ext : "");
+  return len >= 0 && (size_t)len < out_size;
+}
+
 size_t StringArray_join_len(const char *arr[], size_t arr_len,
                             const char *sep) {
   size_t total_written = 0;
@@ -89,24 +100,84 @@ int StringArray_find_closest_match(const char *s, size_t s_len, //
   return match;
 }
 
-// NOTE: works only if exiftool is in PATH
-void Image_add_metadata(const char *image_path, const char *description) {
-  bool exiftool_available = false;
-#ifdef __linux__
-  exiftool_available = (system("exiftool -ver > /dev/null") == 0);
-#elif defined(_WIN32)
-  exiftool_available = (system("exiftool -ver >nul") == 0);
-#endif
-  if (exiftool_available) {
-    char cmd[2048];
-
-    int to_write = snprintf(
-        cmd, sizeof(cmd), "exiftool -overwrite_original -Description='%s' '%s'",
-        description, image_path);
-    ASSERTQ_CUSTOM(to_write < (int)sizeof(cmd), "Buffer 'cmd' too small!");
-    int cmd_result = system(cmd);
-    ASSERTQ_EQ(cmd_result, 0);
+// the signature and the IHDR chunk, which must come first
+#define PNG_HEADER_SIZE (8 + 4 + 4 + 13 + 4)
+
+typedef struct {
+  FILE *file;
+  const char *description;
+  size_t written;
+  bool ok;
+} PngWriter;
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+  }
+  return crc;
+}
+
+static bool write_u32_be(FILE *file, uint32_t value) {
+  const uint8_t bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+  return fwrite(bytes, sizeof(bytes), 1, file) == 1;
+}
+
+// uncompressed UTF-8 text, without a language or a translated keyword
+static bool write_itxt_chunk(FILE *file, const char *keyword,
+                             const char *text) {
+  const uint8_t type[4] = {'i', 'T', 'X', 't'};
+  // keyword's terminator, compression flag and method and 2 empty strings
+  const uint8_t separators[5] = {0};
+  const size_t keyword_len = strlen(keyword), text_len = strlen(text);
+
+  uint32_t crc = crc32_update(0xffffffff, type, sizeof(type));
+  crc = crc32_update(crc, (const uint8_t *)keyword, keyword_len);
+  crc = crc32_update(crc, separators, sizeof(separators));
+  crc = crc32_update(crc, (const uint8_t *)text, text_len);
+
+  return write_u32_be(file, keyword_len + sizeof(separators) + text_len) &&
+         fwrite(type, sizeof(type), 1, file) == 1 &&
+         fwrite(keyword, keyword_len, 1, file) == 1 &&
+         fwrite(separators, sizeof(separators), 1, file) == 1 &&
+         (text_len == 0 || fwrite(text, text_len, 1, file) == 1) &&
+         write_u32_be(file, ~crc);
+}
+
+// passes stb's output through to the file, putting the description's chunk
+// right after the header
+static void png_write_fn(void *ctx, void *data, int size) {
+  PngWriter *writer = ctx;
+  const uint8_t *bytes = data;
+  size_t len = size;
+
+  if (writer->written < PNG_HEADER_SIZE &&
+      writer->written + len >= PNG_HEADER_SIZE) {
+    const size_t header_rest = PNG_HEADER_SIZE - writer->written;
+    writer->ok &= fwrite(bytes, header_rest, 1, writer->file) == 1;
+    writer->ok &= write_itxt_chunk(writer->file, "Description",
+                                   writer->description);
+    writer->written += header_rest;
+    bytes += header_rest;
+    len -= header_rest;
   }
+  writer->ok &= len == 0 || fwrite(bytes, len, 1, writer->file) == 1;
+  writer->written += len;
+}
+
+bool Image_write_png(const char *path, const uint8_t *rgb, uint32_t width,
+                     uint32_t height, const char *description) {
+  PngWriter writer = {
+      .file = fopen(path, "wb"), .description = description, .ok = true};
+  if (writer.file == NULL)
+    return false;
+
+  stbi_flip_vertically_on_write(true);
+  writer.ok &= stbi_write_png_to_func(png_write_fn, &writer, width, height, 3,
+                                      rgb, width * 3) != 0;
+  writer.ok &= fclose(writer.file) == 0;
+  return writer.ok;
 }
 
 // https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
@@ -121,3 +192,9 @@ uint32_t next_power_of_2(uint32_t x) {
   ++x;
   return x;
 }
+
+// NOTE: clamps the input to [0, 1], same as shaders/resolve.glsl does
+float linear_to_srgb(float c) {
+  c = c < 0 ? 0 : c > 1 ? 1 : c;
+  return c < 0.0031308f ? c * 12.92f : powf(c, 1.0f / 2.4f) * 1.055f - 0.055f;
+}
@@ -0,0 +1,239 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "utils/thread.h"
+#include "asserts.h"
+#include "utils/timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define THREAD_MAX_COUNT 64
+
+typedef struct {
+  ParallelForFn *fn;
+  void *ctx;
+  uint32_t begin, end;
+  // which of Thread_parallel_for's threads runs it, 0 if it isn't one of them
+  uint32_t worker;
+} ThreadRange;
+
+static void ThreadRange_call(ThreadRange *range) {
+  // NOTE: threads get spawned on every call, the ones doing the same part of
+  // the work share a track in the trace instead of each having its own
+  if (range->worker > 0) {
+    char track[TIMER_MAX_TRACK_NAME_LEN];
+    snprintf(track, sizeof(track), "worker %u", range->worker);
+    Timer_set_thread_track(track);
+  }
+  range->fn(range->ctx, range->begin, range->end);
+}
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+uint32_t Thread_cpu_count(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+static DWORD WINAPI ThreadRange_run(LPVOID arg) {
+  ThreadRange_call(arg);
+  return 0;
+}
+
+typedef HANDLE Thread;
+
+static void Thread_spawn(Thread *thread, ThreadRange *range) {
+  *thread = CreateThread(NULL, 0, ThreadRange_run, range, 0, NULL);
+  if (*thread == NULL)
+    ERROR("Failed to create a thread");
+}
+
+static void Thread_join(Thread thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+
+static void Mutex_init(Mutex *mutex) { InitializeCriticalSection(mutex); }
+static void Mutex_lock(Mutex *mutex) { EnterCriticalSection(mutex); }
+static void Mutex_unlock(Mutex *mutex) { LeaveCriticalSection(mutex); }
+static void Mutex_delete(Mutex *mutex) { DeleteCriticalSection(mutex); }
+
+static void Condition_init(Condition *cond) {
+  InitializeConditionVariable(cond);
+}
+static void Condition_wait(Condition *cond, Mutex *mutex) {
+  SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+static void Condition_broadcast(Condition *cond) {
+  WakeAllConditionVariable(cond);
+}
+static void Condition_delete(Condition *cond) { UNUSED(cond); }
+
+#else
+
+#include <pthread.h>
+#include <unistd.h>
+
+uint32_t Thread_cpu_count(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+}
+
+static void *ThreadRange_run(void *arg) {
+  ThreadRange_call(arg);
+  return NULL;
+}
+
+typedef pthread_t Thread;
+
+static void Thread_spawn(Thread *thread, ThreadRange *range) {
+  if (pthread_create(thread, NULL, ThreadRange_run, range) != 0)
+    ERROR("Failed to create a thread");
+}
+
+static void Thread_join(Thread thread) { pthread_join(thread, NULL); }
+
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+
+static void Mutex_init(Mutex *mutex) { pthread_mutex_init(mutex, NULL); }
+static void Mutex_lock(Mutex *mutex) { pthread_mutex_lock(mutex); }
+static void Mutex_unlock(Mutex *mutex) { pthread_mutex_unlock(mutex); }
+static void Mutex_delete(Mutex *mutex) { pthread_mutex_destroy(mutex); }
+
+static void Condition_init(Condition *cond) { pthread_cond_init(cond, NULL); }
+static void Condition_wait(Condition *cond, Mutex *mutex) {
+  pthread_cond_wait(cond, mutex);
+}
+static void Condition_broadcast(Condition *cond) {
+  pthread_cond_broadcast(cond);
+}
+static void Condition_delete(Condition *cond) { pthread_cond_destroy(cond); }
+
+#endif // _WIN32
+
+void Thread_parallel_for(uint32_t count, ParallelForFn *fn, void *ctx) {
+  if (count == 0)
+    return;
+
+  uint32_t threads_count = Thread_cpu_count();
+  if (threads_count > THREAD_MAX_COUNT)
+    threads_count = THREAD_MAX_COUNT;
+  if (threads_count > count)
+    threads_count = count;
+  if (threads_count <= 1) {
+    fn(ctx, 0, count);
+    return;
+  }
+
+  ThreadRange ranges[THREAD_MAX_COUNT];
+  Thread threads[THREAD_MAX_COUNT];
+  for (uint32_t i = 0; i < threads_count; ++i) {
+    // NOTE: 64 bit so that count * (i + 1) can't overflow
+    ranges[i] = (ThreadRange){
+        .fn = fn,
+        .ctx = ctx,
+        .begin = (uint64_t)count * i / threads_count,
+        .end = (uint64_t)count * (i + 1) / threads_count,
+        .worker = i,
+    };
+  }
+  // the calling thread takes the first range instead of just waiting
+  for (uint32_t i = 1; i < threads_count; ++i)
+    Thread_spawn(&threads[i], &ranges[i]);
+  fn(ctx, ranges[0].begin, ranges[0].end);
+  for (uint32_t i = 1; i < threads_count; ++i)
+    Thread_join(threads[i]);
+}
+
+typedef struct {
+  WorkFn *fn;
+  void *ctx;
+} Work;
+
+struct WorkQueue {
+  Thread thread;
+  ThreadRange range;
+  // guards everything below, changed is signaled whenever any of it changes
+  Mutex mutex;
+  Condition changed;
+  // ring buffer of the work waiting to be run
+  Work *work;
+  uint32_t capacity, first, count;
+  bool stopping;
+};
+
+// NOTE: run through a ThreadRange, so that it can be spawned just like
+// Thread_parallel_for's threads
+static void WorkQueue_run(void *ctx, uint32_t begin, uint32_t end) {
+  UNUSED(begin, end);
+  WorkQueue *self = ctx;
+
+  Mutex_lock(&self->mutex);
+  while (true) {
+    while (self->count == 0 && !self->stopping)
+      Condition_wait(&self->changed, &self->mutex);
+    // only stops once everything queued before was run
+    if (self->count == 0)
+      break;
+
+    const Work work = self->work[self->first];
+    self->first = (self->first + 1) % self->capacity;
+    self->count--;
+    Condition_broadcast(&self->changed);
+
+    Mutex_unlock(&self->mutex);
+    work.fn(work.ctx);
+    Mutex_lock(&self->mutex);
+  }
+  Mutex_unlock(&self->mutex);
+}
+
+WorkQueue *WorkQueue_new(uint32_t capacity) {
+  ASSERTQ_CUSTOM(capacity > 0, "WorkQueue must be able to hold some work");
+  WorkQueue *self = calloc(1, sizeof(WorkQueue));
+  Work *work = malloc(sizeof(Work) * capacity);
+  if (self == NULL || work == NULL)
+    ERROR("Failed to allocate a WorkQueue");
+
+  self->work = work;
+  self->capacity = capacity;
+  self->range = (ThreadRange){.fn = WorkQueue_run, .ctx = self};
+  Mutex_init(&self->mutex);
+  Condition_init(&self->changed);
+  Thread_spawn(&self->thread, &self->range);
+  return self;
+}
+
+void WorkQueue_push(WorkQueue *self, WorkFn *fn, void *ctx) {
+  Mutex_lock(&self->mutex);
+  while (self->count == self->capacity)
+    Condition_wait(&self->changed, &self->mutex);
+
+  self->work[(self->first + self->count) % self->capacity] =
+      (Work){.fn = fn, .ctx = ctx};
+  self->count++;
+  Condition_broadcast(&self->changed);
+  Mutex_unlock(&self->mutex);
+}
+
+void WorkQueue_delete(WorkQueue *self) {
+  Mutex_lock(&self->mutex);
+  self->stopping = true;
+  Condition_broadcast(&self->changed);
+  Mutex_unlock(&self->mutex);
+
+  Thread_join(self->thread);
+  Condition_delete(&self->changed);
+  Mutex_delete(&self->mutex);
+  free(self->work);
+  free(self);
+}
@@ -0,0 +1,367 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "utils/timer.h"
+#include "asserts.h"
+#include "stats.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+uint64_t Timer_now_ns(void) {
+  LARGE_INTEGER counter, frequency;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  // NOTE: split so that multiplying by 1e9 can't overflow
+  const uint64_t c = counter.QuadPart, f = frequency.QuadPart;
+  return c / f * 1000000000ull + c % f * 1000000000ull / f;
+}
+
+static SRWLOCK g_TIMER_LOCK = SRWLOCK_INIT;
+static void Timer_lock(void) { AcquireSRWLockExclusive(&g_TIMER_LOCK); }
+static void Timer_unlock(void) { ReleaseSRWLockExclusive(&g_TIMER_LOCK); }
+
+#else
+
+#include <pthread.h>
+#include <time.h>
+
+uint64_t Timer_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static pthread_mutex_t g_TIMER_LOCK = PTHREAD_MUTEX_INITIALIZER;
+static void Timer_lock(void) { pthread_mutex_lock(&g_TIMER_LOCK); }
+static void Timer_unlock(void) { pthread_mutex_unlock(&g_TIMER_LOCK); }
+
+#endif // _WIN32
+
+#define NO_SCOPE UINT32_MAX
+
+typedef struct {
+  const char *name;
+  // the scope it's nested in or NO_SCOPE
+  uint32_t parent;
+  uint64_t count, total_ns, min_ns;
+  // ring buffer of the latest durations, the next one is at count % its size
+  uint64_t samples_ns[TIMER_SCOPE_SAMPLES];
+} TimerScope;
+
+// guarded by g_TIMER_LOCK
+static TimerScope g_TIMER_SCOPES[TIMER_MAX_SCOPES];
+static uint32_t g_TIMER_SCOPES_COUNT;
+static bool g_TIMER_SCOPES_FULL;
+// incremented by Timer_reset, so that scopes begun before it are ignored
+static uint32_t g_TIMER_GENERATION;
+
+typedef struct {
+  const char *name;
+  // NO_SCOPE if there was no space left for it
+  uint32_t scope, generation;
+  uint64_t start_ns;
+} TimerFrame;
+
+// the scopes the thread is in, the innermost one last
+static _Thread_local TimerFrame g_TIMER_STACK[TIMER_MAX_DEPTH];
+static _Thread_local uint32_t g_TIMER_DEPTH;
+
+typedef struct {
+  const char *name;
+  uint32_t track;
+  uint64_t start_ns, duration_ns;
+} TimerTraceEvent;
+
+// guarded by g_TIMER_LOCK
+static bool g_TIMER_TRACING;
+static uint64_t g_TIMER_TRACE_START_NS;
+static TimerTraceEvent *g_TIMER_TRACE_EVENTS;
+static uint32_t g_TIMER_TRACE_EVENTS_COUNT, g_TIMER_TRACE_EVENTS_CAPACITY;
+static char g_TIMER_TRACKS[TIMER_MAX_TRACKS][TIMER_MAX_TRACK_NAME_LEN];
+static uint32_t g_TIMER_TRACKS_COUNT;
+
+// the calling thread's track + 1, 0 until it's given one
+static _Thread_local uint32_t g_TIMER_TRACK;
+
+// NOTE: has to be called with g_TIMER_LOCK held
+static uint32_t find_or_add_scope(const char *name, uint32_t parent) {
+  for (uint32_t i = 0; i < g_TIMER_SCOPES_COUNT; ++i)
+    if (g_TIMER_SCOPES[i].parent == parent &&
+        strcmp(g_TIMER_SCOPES[i].name, name) == 0)
+      return i;
+
+  if (g_TIMER_SCOPES_COUNT == TIMER_MAX_SCOPES) {
+    if (!g_TIMER_SCOPES_FULL)
+      fprintf(stderr,
+              YELLOW("WARNING:") " Only %d scopes can be timed, '%s' won't be\n",
+              TIMER_MAX_SCOPES, name);
+    g_TIMER_SCOPES_FULL = true;
+    return NO_SCOPE;
+  }
+  g_TIMER_SCOPES[g_TIMER_SCOPES_COUNT] =
+      (TimerScope){.name = name, .parent = parent, .min_ns = UINT64_MAX};
+  return g_TIMER_SCOPES_COUNT++;
+}
+
+void Timer_begin(const char *name) {
+  ASSERTQ_CUSTOM(g_TIMER_DEPTH < TIMER_MAX_DEPTH,
+                 "Timer scopes are nested too deep");
+  const uint32_t parent =
+      g_TIMER_DEPTH > 0 ? g_TIMER_STACK[g_TIMER_DEPTH - 1].scope : NO_SCOPE;
+  uint32_t scope = NO_SCOPE, generation = 0;
+  Timer_lock();
+  // NOTE: the scopes nested in one that couldn't be added can't be either
+  if (g_TIMER_DEPTH == 0 ||
+      (parent != NO_SCOPE &&
+       g_TIMER_STACK[g_TIMER_DEPTH - 1].generation == g_TIMER_GENERATION))
+    scope = find_or_add_scope(name, parent);
+  generation = g_TIMER_GENERATION;
+  Timer_unlock();
+  g_TIMER_STACK[g_TIMER_DEPTH++] = (TimerFrame){.name = name,
+                                                .scope = scope,
+                                                .generation = generation,
+                                                .start_ns = Timer_now_ns()};
+}
+
+// NOTE: has to be called with g_TIMER_LOCK held
+static uint32_t find_or_add_track(const char *name) {
+  for (uint32_t i = 0; i < g_TIMER_TRACKS_COUNT; ++i)
+    if (strcmp(g_TIMER_TRACKS[i], name) == 0)
+      return i;
+  if (g_TIMER_TRACKS_COUNT == TIMER_MAX_TRACKS)
+    return TIMER_MAX_TRACKS - 1;
+  snprintf(g_TIMER_TRACKS[g_TIMER_TRACKS_COUNT],
+           sizeof(g_TIMER_TRACKS[g_TIMER_TRACKS_COUNT]), "%s", name);
+  return g_TIMER_TRACKS_COUNT++;
+}
+
+// NOTE: has to be called with g_TIMER_LOCK held
+static void add_trace_event(const TimerFrame *frame, uint64_t duration_ns) {
+  if (g_TIMER_TRACE_EVENTS_COUNT == TIMER_MAX_TRACE_EVENTS)
+    return;
+  if (g_TIMER_TRACE_EVENTS_COUNT == g_TIMER_TRACE_EVENTS_CAPACITY) {
+    g_TIMER_TRACE_EVENTS_CAPACITY = g_TIMER_TRACE_EVENTS_CAPACITY == 0
+                                        ? 1024
+                                        : 2 * g_TIMER_TRACE_EVENTS_CAPACITY;
+    g_TIMER_TRACE_EVENTS =
+        realloc(g_TIMER_TRACE_EVENTS,
+                sizeof(TimerTraceEvent) * g_TIMER_TRACE_EVENTS_CAPACITY);
+    ASSERTQ_CUSTOM(g_TIMER_TRACE_EVENTS != NULL,
+                   "Failed to allocate the trace's events");
+  }
+  if (g_TIMER_TRACK == 0) {
+    char name[TIMER_MAX_TRACK_NAME_LEN];
+    snprintf(name, sizeof(name), "thread %u", g_TIMER_TRACKS_COUNT + 1);
+    g_TIMER_TRACK = find_or_add_track(name) + 1;
+  }
+  g_TIMER_TRACE_EVENTS[g_TIMER_TRACE_EVENTS_COUNT++] = (TimerTraceEvent){
+      .name = frame->name,
+      .track = g_TIMER_TRACK - 1,
+      .start_ns = frame->start_ns,
+      .duration_ns = duration_ns,
+  };
+  if (g_TIMER_TRACE_EVENTS_COUNT == TIMER_MAX_TRACE_EVENTS)
+    fprintf(stderr,
+            YELLOW("WARNING:") " The trace is full, no more scopes will be "
+                               "recorded\n");
+}
+
+void Timer_end(void) {
+  const uint64_t end_ns = Timer_now_ns();
+  ASSERTQ_CUSTOM(g_TIMER_DEPTH > 0, "Timer_end without a Timer_begin");
+  const TimerFrame frame = g_TIMER_STACK[--g_TIMER_DEPTH];
+  const uint64_t duration_ns = end_ns - frame.start_ns;
+
+  Timer_lock();
+  if (frame.scope != NO_SCOPE && frame.generation == g_TIMER_GENERATION) {
+    TimerScope *scope = &g_TIMER_SCOPES[frame.scope];
+    scope->samples_ns[scope->count % TIMER_SCOPE_SAMPLES] = duration_ns;
+    scope->count++;
+    scope->total_ns += duration_ns;
+    if (duration_ns < scope->min_ns)
+      scope->min_ns = duration_ns;
+  }
+  // NOTE: the scopes begun before the trace started aren't a part of it
+  if (g_TIMER_TRACING && frame.start_ns >= g_TIMER_TRACE_START_NS)
+    add_trace_event(&frame, duration_ns);
+  Timer_unlock();
+}
+
+static int compare_u64(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of the sorted samples
+static uint64_t percentile(const uint64_t *sorted, uint32_t count,
+                           uint32_t percent) {
+  const uint32_t rank = (count * percent + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// NOTE: has to be called with g_TIMER_LOCK held
+static TimerScopeStats scope_stats(uint32_t idx, uint32_t depth) {
+  const TimerScope *scope = &g_TIMER_SCOPES[idx];
+  TimerScopeStats stats = {
+      .depth = depth,
+      .count = scope->count,
+      .min_ns = scope->count > 0 ? scope->min_ns : 0,
+      .mean_ns = scope->count > 0 ? scope->total_ns / scope->count : 0,
+  };
+
+  // the name is built from the innermost scope outwards
+  const char *names[TIMER_MAX_DEPTH];
+  uint32_t names_count = 0;
+  for (uint32_t i = idx; i != NO_SCOPE && names_count < TIMER_MAX_DEPTH;
+       i = g_TIMER_SCOPES[i].parent)
+    names[names_count++] = g_TIMER_SCOPES[i].name;
+  size_t len = 0;
+  for (uint32_t i = names_count; i-- > 0 && len < sizeof(stats.name);)
+    len += snprintf(stats.name + len, sizeof(stats.name) - len, "%s%s",
+                    names[i], i > 0 ? "/" : "");
+
+  const uint32_t samples_count = scope->count < TIMER_SCOPE_SAMPLES
+                                     ? (uint32_t)scope->count
+                                     : TIMER_SCOPE_SAMPLES;
+  if (samples_count > 0) {
+    uint64_t sorted[TIMER_SCOPE_SAMPLES];
+    memcpy(sorted, scope->samples_ns, sizeof(uint64_t) * samples_count);
+    qsort(sorted, samples_count, sizeof(uint64_t), compare_u64);
+    stats.p50_ns = percentile(sorted, samples_count, 50);
+    stats.p99_ns = percentile(sorted, samples_count, 99);
+  }
+  return stats;
+}
+
+// NOTE: has to be called with g_TIMER_LOCK held
+static void get_stats(uint32_t parent, uint32_t depth, TimerScopeStats *out,
+                      uint32_t max_count, uint32_t *count) {
+  for (uint32_t i = 0; i < g_TIMER_SCOPES_COUNT && *count < max_count; ++i) {
+    if (g_TIMER_SCOPES[i].parent != parent)
+      continue;
+    out[(*count)++] = scope_stats(i, depth);
+    get_stats(i, depth + 1, out, max_count, count);
+  }
+}
+
+uint32_t Timer_get_stats(TimerScopeStats *out, uint32_t max_count) {
+  uint32_t count = 0;
+  Timer_lock();
+  get_stats(NO_SCOPE, 0, out, max_count, &count);
+  Timer_unlock();
+  return count;
+}
+
+void Timer_reset(void) {
+  Timer_lock();
+  g_TIMER_SCOPES_COUNT = 0;
+  g_TIMER_SCOPES_FULL = false;
+  g_TIMER_GENERATION++;
+  Timer_unlock();
+}
+
+SmallString Timer_str(void) {
+  SmallString out = {0};
+  TimerScopeStats scopes[TIMER_MAX_SCOPES];
+  const uint32_t scopes_count = Timer_get_stats(scopes, TIMER_MAX_SCOPES);
+  if (scopes_count == 0)
+    return out;
+
+  // space left for the line with the count
+  const int reserved = 32;
+  int written = snprintf(out.str, sizeof(out.str),
+                         "timed scopes (count, min, mean, p50, p99):\n");
+  uint32_t i = 0;
+  for (; i < scopes_count; ++i) {
+    const TimerScopeStats *scope = &scopes[i];
+    const char *name = strrchr(scope->name, '/');
+    name = name != NULL ? name + 1 : scope->name;
+    char line[256];
+    const int len = snprintf(
+        line, sizeof(line), "%*s%s: %llu, %s, %s, %s, %s\n",
+        (int)(2 * scope->depth), "", name, (unsigned long long)scope->count,
+        Stats_fmt_time(scope->min_ns * 1e-9).str,
+        Stats_fmt_time(scope->mean_ns * 1e-9).str,
+        Stats_fmt_time(scope->p50_ns * 1e-9).str,
+        Stats_fmt_time(scope->p99_ns * 1e-9).str);
+    if (written + len >= (int)sizeof(out.str) - reserved)
+      break;
+    memcpy(out.str + written, line, len + 1);
+    written += len;
+  }
+  if (i < scopes_count)
+    snprintf(out.str + written, sizeof(out.str) - written,
+             "(%u more scopes)\n", scopes_count - i);
+  return out;
+}
+
+void Timer_start_trace(void) {
+  Timer_lock();
+  g_TIMER_TRACING = true;
+  g_TIMER_TRACE_START_NS = Timer_now_ns();
+  g_TIMER_TRACE_EVENTS_COUNT = 0;
+  Timer_unlock();
+}
+
+// NOTE: the names are ours, but they still shouldn't be able to break the JSON
+static void write_json_string(FILE *f, const char *str) {
+  fputc('"', f);
+  for (; *str; ++str) {
+    if (*str == '"' || *str == '\\')
+      fputc('\\', f);
+    if ((unsigned char)*str >= 0x20)
+      fputc(*str, f);
+  }
+  fputc('"', f);
+}
+
+bool Timer_write_trace(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (f == NULL)
+    return false;
+
+  Timer_lock();
+  // in the Trace Event Format, with a complete ("X") event per scope
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  for (uint32_t i = 0; i < g_TIMER_TRACKS_COUNT; ++i) {
+    fprintf(f, "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, "
+               "\"tid\": %u, \"args\": {\"name\": ",
+            i + 1);
+    write_json_string(f, g_TIMER_TRACKS[i]);
+    fprintf(f, "}},\n");
+  }
+  // NOTE: in microseconds
+  for (uint32_t i = 0; i < g_TIMER_TRACE_EVENTS_COUNT; ++i) {
+    const TimerTraceEvent *event = &g_TIMER_TRACE_EVENTS[i];
+    fprintf(f, "{\"ph\": \"X\", \"name\": ");
+    write_json_string(f, event->name);
+    fprintf(f, ", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f},\n",
+            event->track + 1,
+            (event->start_ns - g_TIMER_TRACE_START_NS) / 1000.0,
+            event->duration_ns / 1000.0);
+  }
+  // NOTE: JSON doesn't allow a trailing comma, so the process ends the array
+  fprintf(f, "{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": 1, "
+             "\"args\": {\"name\": \"Path Tracing Renderer\"}}\n]}\n");
+  const uint32_t events_count = g_TIMER_TRACE_EVENTS_COUNT;
+  Timer_unlock();
+
+  const bool ok = ferror(f) == 0;
+  if (fclose(f) != 0 || !ok)
+    return false;
+  printf("Wrote %u traced scopes to '%s'\n", events_count, path);
+  return true;
+}
+
+void Timer_set_thread_track(const char *name) {
+  Timer_lock();
+  g_TIMER_TRACK = find_or_add_track(name) + 1;
+  Timer_unlock();
+}
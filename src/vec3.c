@@ -65,13 +65,14 @@ bool vec3_eq(vec3 v, vec3 expected, float epsilon) {
          float_equal_expected(v.z, expected.z, epsilon);
 }
 
+float vec3_dot(vec3 a, vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
 float vec3_mag(vec3 v) { return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z); }
 vec3 vec3_norm(vec3 v) { return vec3_mult(v, 1.0f / vec3_mag(v)); }
 
 vec3 vec3_cross(vec3 a, vec3 b) {
   vec3 r = {0};
   r.x = a.y * b.z - a.z * b.y;
-  r.y = a.x * b.z - a.z * b.x;
+  r.y = a.z * b.x - a.x * b.z;
   r.z = a.x * b.y - a.y * b.x;
   return r;
 }
@@ -77,7 +77,7 @@ Vec3d Vec3d_norm(Vec3d v) { return Vec3d_mult(v, 1.0 / Vec3d_mag(v)); }
 Vec3d Vec3d_cross(Vec3d a, Vec3d b) {
   Vec3d r = {0};
   r.x = a.y * b.z - a.z * b.y;
-  r.y = a.x * b.z - a.z * b.x;
+  r.y = a.z * b.x - a.x * b.z;
   r.z = a.x * b.y - a.y * b.x;
   return r;
 }
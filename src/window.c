@@ -13,6 +13,43 @@ void glfw_error_callback(int error, const char *description) {
   fprintf(stderr, "Error (%d): %s\n", error, description);
 }
 
+// requests the same OpenGL context for all windows
+static void context_hints(void) {
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+#ifndef NDEBUG
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+}
+
+// makes the window's context current and loads OpenGL functions for it
+static void load_opengl(Window *self) {
+  if (!self->glfw_window) {
+    fprintf(stderr, "Failed to create a glfw window!\n");
+    glfwTerminate();
+    exit(EXIT_FAILURE);
+  }
+
+  glfwMakeContextCurrent(self->glfw_window);
+  int version = gladLoadGL(glfwGetProcAddress);
+  if (version == 0) {
+    fprintf(stderr, "Failed to initialize OpenGL context!\n");
+    exit(EXIT_FAILURE);
+  }
+  void *userDataPtr = calloc(1, sizeof(GLFWUserData));
+  glfwSetWindowUserPointer(self->glfw_window, userDataPtr);
+  if (!self->headless)
+    glfwSwapInterval(0); // disable vsync
+
+  // HACK: do initial poll to avoid having huge mouse delta
+  Window_poll_events(self);
+
+  // Successfully loaded OpenGL
+  printf("Loaded OpenGL %d.%d\n", GLAD_VERSION_MAJOR(version),
+         GLAD_VERSION_MINOR(version));
+}
+
 Window Window_new(const char *window_title, int desired_width,
                   int desired_height) {
   Window self = {0};
@@ -22,12 +59,7 @@ Window Window_new(const char *window_title, int desired_width,
   if (!glfwInit())
     exit(EXIT_FAILURE);
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-#ifndef NDEBUG
-  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
-#endif
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  context_hints();
 
   if (glfwPlatformSupported(GLFW_PLATFORM_WIN32))
     glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WIN32);
@@ -40,29 +72,28 @@ Window Window_new(const char *window_title, int desired_width,
 
   self.glfw_window =
       glfwCreateWindow(desired_width, desired_height, window_title, NULL, NULL);
+  load_opengl(&self);
 
-  if (!self.glfw_window) {
-    fprintf(stderr, "Failed to create a glfw window!\n");
-    glfwTerminate();
-    exit(EXIT_FAILURE);
-  }
+  return self;
+}
 
-  glfwMakeContextCurrent(self.glfw_window);
-  int version = gladLoadGL(glfwGetProcAddress);
-  if (version == 0) {
-    fprintf(stderr, "Failed to initialize OpenGL context!\n");
+Window Window_new_headless(void) {
+  Window self = {.headless = true};
+
+  glfwSetErrorCallback(glfw_error_callback);
+
+  // NOTE: the null platform doesn't need a display server and with EGL it
+  // creates a surfaceless context, so there's no default framebuffer at all
+  glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  if (!glfwInit())
     exit(EXIT_FAILURE);
-  }
-  void *userDataPtr = calloc(1, sizeof(GLFWUserData));
-  glfwSetWindowUserPointer(self.glfw_window, userDataPtr);
-  glfwSwapInterval(0); // disable vsync
 
-  // HACK: do initial poll to avoid having huge mouse delta
-  Window_poll_events(&self);
+  context_hints();
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
-  // Successfully loaded OpenGL
-  printf("Loaded OpenGL %d.%d\n", GLAD_VERSION_MAJOR(version),
-         GLAD_VERSION_MINOR(version));
+  self.glfw_window = glfwCreateWindow(1, 1, "", NULL, NULL);
+  load_opengl(&self);
 
   return self;
 }
@@ -151,7 +182,12 @@ WindowEventsData Window_poll_events(Window *self) {
   return events;
 }
 
-void Window_swap_buffers(Window *self) { glfwSwapBuffers(self->glfw_window); }
+void Window_swap_buffers(Window *self) {
+  // there's nothing to swap without a default framebuffer
+  if (self->headless)
+    return;
+  glfwSwapBuffers(self->glfw_window);
+}
 
 void Window_delete(Window *self) {
   (void)(self);
@@ -0,0 +1,70 @@
+#include "tests_batch.h"
+#include "asserts.h"
+#include "batch.h"
+#include "tests_macros.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ASSERT_ARG(_argv, _i, _expected)                                       \
+  ASSERT_CUSTOM_FMT(strcmp(_argv[_i], _expected) == 0,                         \
+                    "Expected argument %d to be '%s', got '%s'", _i,           \
+                    _expected, _argv[_i])
+
+bool test_BatchJob_parse(void) {
+  BatchJob job;
+  ASSERT_CUSTOM(BatchJob_parse(&job, "  \"a scene.glb\"\t-F 16  -o out.png\n"),
+                "Failed to parse the job");
+  const char *argv[BATCH_JOB_MAX_ARGS];
+  ASSERT_EQ(BatchJob_argv(&job, argv), 5);
+  ASSERT_ARG(argv, 0, "a scene.glb");
+  ASSERT_ARG(argv, 1, "-F");
+  ASSERT_ARG(argv, 2, "16");
+  ASSERT_ARG(argv, 3, "-o");
+  ASSERT_ARG(argv, 4, "out.png");
+
+  ASSERT_CUSTOM(BatchJob_parse(&job, "\"\" x"), "Failed to parse the job");
+  ASSERT_EQ(BatchJob_argv(&job, argv), 2);
+  ASSERT_ARG(argv, 0, "");
+  ASSERT_ARG(argv, 1, "x");
+
+  ASSERT_CUSTOM(!BatchJob_parse(&job, "scene.glb -o \"out.png"),
+                "Parsed an unterminated quote");
+  char line[2 * BATCH_JOB_MAX_ARGS + 2] = {0};
+  for (int i = 0; i <= BATCH_JOB_MAX_ARGS; ++i)
+    strcat(line, "a ");
+  ASSERT_CUSTOM(!BatchJob_parse(&job, line), "Parsed too many arguments");
+  return true;
+}
+
+bool test_Batch_read(void) {
+  const char *path = "test_Batch_read.txt";
+  FILE *f = fopen(path, "w");
+  ASSERT_CUSTOM(f != NULL, "Failed to create the test file");
+  fputs("# renders a.png\n"
+        "a.glb -F 8 -o a.png\n"
+        "\n"
+        "  b.glb -F 16 -R 64x32 -o b.png",
+        f);
+  fclose(f);
+
+  const Settings settings = Settings_default();
+  Batch batch = Batch_read(path, &settings);
+  ASSERT_EQ(batch.jobs_count, 2u);
+  ASSERT_EQ(batch.jobs[0].line_number, 2u);
+  ASSERT_EQ(batch.jobs[1].line_number, 4u);
+  const char *argv[BATCH_JOB_MAX_ARGS];
+  ASSERT_EQ(BatchJob_argv(&batch.jobs[1], argv), 7);
+  ASSERT_ARG(argv, 0, "b.glb");
+  Batch_delete(&batch);
+
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+bool all_batch_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_BatchJob_parse, &ok);
+  TEST_RUN(test_Batch_read, &ok);
+  return ok;
+}
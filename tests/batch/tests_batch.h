@@ -0,0 +1,7 @@
+#ifndef TESTS_BATCH_H_
+#define TESTS_BATCH_H_
+
+#include <stdbool.h>
+bool all_batch_tests(void);
+
+#endif // TESTS_BATCH_H_
@@ -0,0 +1,105 @@
+#include "tests_analysis.h"
+#include "asserts.h"
+#include "scene.h"
+#include "scene/bvh/analysis.h"
+#include "scene/file_formats/gltf.h"
+#include "tests_macros.h"
+
+static Arena tmp_arena = {0};
+
+// every node and triangle of the scene gets accounted for
+static bool test_analysis__counts(BVHStrategy strat) {
+  Scene scene = Scene_default();
+  load_gltf_scene(&scene, "tests/gltf/scenes/cornell box.glb");
+  Scene_build_bvh(&scene, strat, &tmp_arena);
+  const BVHAnalysis analysis =
+      BVH_analyze(scene.bvh_nodes, scene.bvh_nodes_count, scene.triangles,
+                  scene.triangles_count, 256);
+
+  ASSERT_EQ(analysis.reached_nodes, scene.bvh_nodes_count);
+  // a binary tree has one more leaf than it has branches
+  ASSERT_EQ(2 * analysis.leaves_count - 1, scene.bvh_nodes_count);
+  uint32_t leaves = 0, leaves_triangles = 0;
+  for (uint32_t i = 0; i < BVH_ANALYSIS_MAX_DEPTH; ++i)
+    leaves += analysis.leaves_per_depth[i];
+  for (uint32_t i = 0; i <= BVH_ANALYSIS_MAX_LEAF_SIZE; ++i)
+    leaves_triangles += i * analysis.leaves_per_size[i];
+  ASSERT_EQ(leaves, analysis.leaves_count);
+  // NOTE: the largest leaves are counted as having the maximum size
+  if (analysis.leaves_per_size[BVH_ANALYSIS_MAX_LEAF_SIZE] == 0)
+    ASSERT_EQ(leaves_triangles, scene.triangles_count);
+  ASSERT_COND(leaves_triangles <= scene.triangles_count, leaves_triangles);
+  ASSERT_EQF(analysis.sah_cost,
+             BVH_cost(scene.bvh_nodes, scene.bvh_nodes_count), 1e-6f);
+  ASSERT_EQ(analysis.empty_nodes, 0u);
+  ASSERT_RANGE_IN(analysis.sibling_overlap, 0.0f, 1.0f);
+
+  // every ray visits at least the root, but not all of the triangles
+  ASSERT_EQ(analysis.rays_count, 256u);
+  ASSERT_COND(analysis.nodes_per_ray >= 1, analysis.nodes_per_ray);
+  ASSERT_COND(analysis.triangles_per_ray < scene.triangles_count,
+              analysis.triangles_per_ray);
+  Scene_delete(&scene);
+  return true;
+}
+
+bool test_analysis__midpoint(void) {
+  return test_analysis__counts(BVHStrategy_Midpoint);
+}
+
+bool test_analysis__SAH(void) {
+  return test_analysis__counts(BVHStrategy_SAH);
+}
+
+// two leaves next to each other, whose bounds then get changed
+bool test_analysis__overlap_and_degenerate(void) {
+  // two stacks of 9 triangles, one at x = 0 and one at x = 10, each of them
+  // covering the unit square of the yz plane, so that their leaves' bounds
+  // are flat and the root has to split them along x
+  Triangle triangles[18] = {0};
+  for (int i = 0; i < 18; ++i) {
+    const float x = i < 9 ? 0.0f : 10.0f;
+    triangles[i] = (Triangle){.a = vec3_new(x, 0, 0),
+                              .b = vec3_new(x, 1, 0),
+                              .c = vec3_new(x, 0, 1)};
+  }
+  BVHnode nodes[2 * 18] = {0};
+  BVHNodeCount nodes_count = 0;
+  BVHSwapsLUTElement swaps_lut[18];
+  BVH_build(nodes, &nodes_count, swaps_lut, triangles, 0, 18,
+            FindBestSplitFn_midpoint, &tmp_arena);
+  ASSERT_EQ(nodes_count, 3u);
+
+  const BVHAnalysis analysis =
+      BVH_analyze(nodes, nodes_count, triangles, 18, 0);
+  ASSERT_EQ(analysis.max_depth, 1u);
+  ASSERT_EQ(analysis.leaves_per_depth[1], 2u);
+  ASSERT_EQ(analysis.leaves_per_size[9], 2u);
+  // the leaves are apart, and flat but still have an area
+  ASSERT_EQF(analysis.sibling_overlap, 0.0f, 1e-6f);
+  ASSERT_EQ(analysis.degenerate_nodes, 0u);
+  ASSERT_EQ(analysis.rays_count, 0u);
+
+  // making one of the leaves cover the whole root makes them overlap
+  nodes[2].bound_min = nodes[0].bound_min;
+  const BVHAnalysis overlapping =
+      BVH_analyze(nodes, nodes_count, triangles, 18, 0);
+  ASSERT_COND(overlapping.sibling_overlap > 0, overlapping.sibling_overlap);
+
+  // a leaf collapsed to a line has no area
+  nodes[1].bound_max.z = nodes[1].bound_min.z;
+  const BVHAnalysis collapsed =
+      BVH_analyze(nodes, nodes_count, triangles, 18, 0);
+  ASSERT_EQ(collapsed.degenerate_nodes, 1u);
+  return true;
+}
+
+bool all_bvh_analysis_tests(void) {
+  tmp_arena = Arena_new(1024 * 1024);
+  bool ok = true;
+  TEST_RUN(test_analysis__midpoint, &ok);
+  TEST_RUN(test_analysis__SAH, &ok);
+  TEST_RUN(test_analysis__overlap_and_degenerate, &ok);
+  Arena_delete(&tmp_arena);
+  return ok;
+}
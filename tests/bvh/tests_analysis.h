@@ -0,0 +1,8 @@
+#ifndef TESTS_ANALYSIS_H_
+#define TESTS_ANALYSIS_H_
+
+#include <stdbool.h>
+
+bool all_bvh_analysis_tests(void);
+
+#endif // TESTS_ANALYSIS_H_
@@ -0,0 +1,179 @@
+#include "tests_traversal.h"
+#include "asserts.h"
+#include "scene.h"
+#include "scene/bvh/traversal.h"
+#include "scene/file_formats/gltf.h"
+#include "tests_macros.h"
+#include <math.h>
+
+#define RAYS_GRID_SIZE 16
+
+static Arena tmp_arena = {0};
+
+static BVHHit brute_force_intersect(const Scene *scene, const Ray *ray) {
+  BVHHit closest_hit = {.did_hit = false, .dst = INFINITY};
+  for (BVHTriCount i = 0; i < scene->triangles_count; ++i) {
+    float dst;
+    if (Triangle_intersect(&scene->triangles[i], ray, &dst) &&
+        dst < closest_hit.dst)
+      closest_hit = (BVHHit){.did_hit = true, .dst = dst, .triangle = i};
+  }
+  return closest_hit;
+}
+
+// rays going from the scene's camera through a grid spanning its view
+static Ray grid_ray(const Scene *scene, int x, int y) {
+  const vec3 right = vec3_norm(vec3_cross(scene->camera.dir, vec3_new(0, 1, 0)));
+  const vec3 up = vec3_cross(right, scene->camera.dir);
+  const float u = 2.0f * (x + 0.5f) / RAYS_GRID_SIZE - 1.0f;
+  const float v = 2.0f * (y + 0.5f) / RAYS_GRID_SIZE - 1.0f;
+  const vec3 dir = vec3_add(scene->camera.dir,
+                            vec3_add(vec3_mult(right, 0.5f * u),
+                                     vec3_mult(up, 0.5f * v)));
+  return Ray_new(scene->camera.pos, dir);
+}
+
+// every ray of the grid hits the same as when testing all of the triangles
+static bool matches_brute_force(const Scene *scene) {
+  BVHTraversalStats stats = {0};
+  for (int y = 0; y < RAYS_GRID_SIZE; ++y) {
+    for (int x = 0; x < RAYS_GRID_SIZE; ++x) {
+      const Ray ray = grid_ray(scene, x, y);
+      const BVHHit hit =
+          BVH_intersect(scene->bvh_nodes, scene->triangles, &ray, &stats);
+      const BVHHit expected = brute_force_intersect(scene, &ray);
+
+      ASSERT_EQ(hit.did_hit, expected.did_hit);
+      if (expected.did_hit)
+        ASSERT_EQF(hit.dst, expected.dst, 1e-6f);
+
+      // nothing is in front of the closest hit, but it itself occludes
+      ASSERT_EQ(BVH_is_occluded(scene->bvh_nodes, scene->triangles, &ray,
+                                INFINITY, NULL),
+                expected.did_hit);
+      if (expected.did_hit)
+        ASSERT_EQ(BVH_is_occluded(scene->bvh_nodes, scene->triangles, &ray,
+                                  0.99f * expected.dst, NULL),
+                  false);
+    }
+  }
+
+  // the whole point of the BVH
+  const uint64_t rays_count = RAYS_GRID_SIZE * RAYS_GRID_SIZE;
+  // NOTE: casting as uint64_t may not be an unsigned long on every platform
+  const unsigned long triangles_tested = stats.triangles_tested;
+  ASSERT_COND(triangles_tested < rays_count * scene->triangles_count,
+              triangles_tested);
+  return true;
+}
+
+static bool test_traversal__matches_brute_force(BVHStrategy strat) {
+  Scene scene = Scene_default();
+  load_gltf_scene(&scene, "tests/gltf/scenes/cornell box.glb");
+  Scene_build_bvh(&scene, strat, &tmp_arena);
+  const bool ok = matches_brute_force(&scene);
+  Scene_delete(&scene);
+  return ok;
+}
+
+bool test_traversal__midpoint(void) {
+  return test_traversal__matches_brute_force(BVHStrategy_Midpoint);
+}
+
+bool test_traversal__SAH(void) {
+  return test_traversal__matches_brute_force(BVHStrategy_SAH);
+}
+
+// triangles moved after building the BVH are still found once it's refit
+bool test_traversal__refit(void) {
+  Scene scene = Scene_default();
+  load_gltf_scene(&scene, "tests/gltf/scenes/cornell box.glb");
+  Scene_build_bvh(&scene, BVHStrategy_SAH, &tmp_arena);
+
+  // every triangle gets pushed away from the camera by a different amount
+  for (BVHTriCount i = 0; i < scene.triangles_count; ++i) {
+    const vec3 offset = vec3_mult(scene.camera.dir, 0.05f * (i % 7));
+    Triangle *tri = &scene.triangles[i];
+    tri->a = vec3_add(tri->a, offset);
+    tri->b = vec3_add(tri->b, offset);
+    tri->c = vec3_add(tri->c, offset);
+  }
+  BVH_refit(scene.bvh_nodes, scene.bvh_nodes_count, scene.triangles);
+
+  const bool ok = matches_brute_force(&scene);
+  Scene_delete(&scene);
+  return ok;
+}
+
+// two leaves one behind the other, the one behind should never be visited
+bool test_traversal__skips_occluded(void) {
+  Triangle triangles[16] = {0};
+  for (int i = 0; i < 16; ++i) {
+    // 9 triangles facing the ray at z = 1 and 7 at z = 5, so that there are
+    // more than 8 (max leaf size) in total and z is the longest axis
+    const float z = i < 9 ? 1.0f : 5.0f;
+    triangles[i] = (Triangle){.a = vec3_new(-1, -1, z),
+                              .b = vec3_new(1, -1, z),
+                              .c = vec3_new(0, 1, z)};
+  }
+
+  BVHnode nodes[2 * 16] = {0};
+  BVHNodeCount nodes_count = 0;
+  BVHSwapsLUTElement swaps_lut[16];
+  BVH_build(nodes, &nodes_count, swaps_lut, triangles, 0, 16,
+            FindBestSplitFn_midpoint, &tmp_arena);
+  ASSERT_EQ(nodes_count, 3);
+
+  BVHTraversalStats stats = {0};
+  const Ray ray = Ray_new(vec3_new(0, 0, 0), vec3_new(0, 0, 1));
+  const BVHHit hit = BVH_intersect(nodes, triangles, &ray, &stats);
+
+  ASSERT_EQ(hit.did_hit, true);
+  ASSERT_EQF(hit.dst, 1.0f, 1e-6f);
+  // NOTE: the root and the leaf in front
+  ASSERT_EQ((unsigned long)stats.nodes_visited, 2ul);
+  ASSERT_EQ((unsigned long)stats.triangles_tested, 9ul);
+  return true;
+}
+
+// any of the triangles occludes the ray, so only one of them should be tested
+bool test_traversal__occluded_stops_at_first_hit(void) {
+  Triangle triangles[16] = {0};
+  for (int i = 0; i < 16; ++i) {
+    const float z = i < 9 ? 1.0f : 5.0f;
+    triangles[i] = (Triangle){.a = vec3_new(-1, -1, z),
+                              .b = vec3_new(1, -1, z),
+                              .c = vec3_new(0, 1, z)};
+  }
+
+  BVHnode nodes[2 * 16] = {0};
+  BVHNodeCount nodes_count = 0;
+  BVHSwapsLUTElement swaps_lut[16];
+  BVH_build(nodes, &nodes_count, swaps_lut, triangles, 0, 16,
+            FindBestSplitFn_midpoint, &tmp_arena);
+
+  const Ray ray = Ray_new(vec3_new(0, 0, 0), vec3_new(0, 0, 1));
+  BVHTraversalStats stats = {0};
+  bool occluded = BVH_is_occluded(nodes, triangles, &ray, INFINITY, &stats);
+  ASSERT_EQ(occluded, true);
+  ASSERT_EQ((unsigned long)stats.triangles_tested, 1ul);
+
+  // everything is behind max_dst, so even the root shouldn't be visited
+  stats = (BVHTraversalStats){0};
+  occluded = BVH_is_occluded(nodes, triangles, &ray, 0.5f, &stats);
+  ASSERT_EQ(occluded, false);
+  ASSERT_EQ((unsigned long)stats.nodes_visited, 0ul);
+  return true;
+}
+
+bool all_bvh_traversal_tests(void) {
+  tmp_arena = Arena_new(1024 * 1024);
+  bool ok = true;
+  TEST_RUN(test_traversal__midpoint, &ok);
+  TEST_RUN(test_traversal__SAH, &ok);
+  TEST_RUN(test_traversal__refit, &ok);
+  TEST_RUN(test_traversal__skips_occluded, &ok);
+  TEST_RUN(test_traversal__occluded_stops_at_first_hit, &ok);
+  Arena_delete(&tmp_arena);
+  return ok;
+}
@@ -0,0 +1,8 @@
+#ifndef TESTS_TRAVERSAL_H_
+#define TESTS_TRAVERSAL_H_
+
+#include <stdbool.h>
+
+bool all_bvh_traversal_tests(void);
+
+#endif // TESTS_TRAVERSAL_H_
@@ -0,0 +1,95 @@
+#include "tests_camera_animation.h"
+#include "asserts.h"
+#include "camera_animation.h"
+#include "rad_deg.h"
+#include "tests_macros.h"
+#include <float.h>
+#include <stdio.h>
+
+#define EPS 1e-5
+
+bool test_CameraKeyframe_parse(void) {
+  CameraKeyframe keyframe;
+  ASSERT_CUSTOM(CameraKeyframe_parse(&keyframe, "1.5 0,1,4 -90,10 60\n"),
+                "Failed to parse the keyframe");
+  ASSERT_EQF(keyframe.time_s, 1.5, EPS);
+  ASSERT_EQ_VEC3(keyframe.pos, vec3_new(0, 1, 4), EPS);
+  // yaw gets wrapped to [0, 2*PI)
+  ASSERT_EQF(keyframe.rotation.yaw_rad, deg_to_rad(270), EPS);
+  ASSERT_EQF(keyframe.rotation.pitch_rad, deg_to_rad(10), EPS);
+  ASSERT_EQF(keyframe.fov_rad, deg_to_rad(60), EPS);
+
+  ASSERT_CUSTOM(CameraKeyframe_parse(&keyframe, "0 0,0,0 0,0"),
+                "Failed to parse a keyframe without a fov");
+  ASSERT_EQF(keyframe.fov_rad, 0, EPS);
+
+  ASSERT_CUSTOM(!CameraKeyframe_parse(&keyframe, "0 0,0 0,0"),
+                "Parsed a position without z");
+  ASSERT_CUSTOM(!CameraKeyframe_parse(&keyframe, "0 0,0,0 0,90"),
+                "Parsed a pitch which can't be looked at");
+  ASSERT_CUSTOM(!CameraKeyframe_parse(&keyframe, "0 0,0,0 0,0 60 x"),
+                "Parsed a keyframe with trailing garbage");
+  return true;
+}
+
+bool test_CameraPath_sample(void) {
+  CameraKeyframe keyframes[] = {
+      {.time_s = 1, .pos = vec3_new(0, 0, 0),
+       .rotation = YawPitch_new(deg_to_rad(350), 0)},
+      {.time_s = 3, .pos = vec3_new(2, 4, 0),
+       .rotation = YawPitch_new(deg_to_rad(30), deg_to_rad(20)),
+       .fov_rad = deg_to_rad(90)},
+  };
+  const CameraPath path = {.keyframes = keyframes, .keyframes_count = 2};
+  Camera base = Camera_default();
+  base.fov_rad = deg_to_rad(50);
+  ASSERT_EQF(CameraPath_duration(&path), 2, EPS);
+
+  Camera cam = CameraPath_sample(&path, 2, base);
+  ASSERT_EQ_VEC3(cam.pos, vec3_new(1, 2, 0), EPS);
+  // the shorter way around from 350 to 30 degrees goes through 0
+  YawPitch yp = YawPitch_from_dir(Vec3d_from_vec3(cam.dir));
+  ASSERT_EQF(yp.yaw_rad, deg_to_rad(10), EPS);
+  ASSERT_EQF(yp.pitch_rad, deg_to_rad(10), EPS);
+  // the first keyframe has the base camera's fov
+  ASSERT_EQF(cam.fov_rad, deg_to_rad(70), EPS);
+
+  // clamped to the keyframes
+  cam = CameraPath_sample(&path, 0, base);
+  ASSERT_EQ_VEC3(cam.pos, vec3_new(0, 0, 0), EPS);
+  ASSERT_EQF(cam.fov_rad, deg_to_rad(50), EPS);
+  cam = CameraPath_sample(&path, 10, base);
+  ASSERT_EQ_VEC3(cam.pos, vec3_new(2, 4, 0), EPS);
+  ASSERT_EQF(cam.fov_rad, deg_to_rad(90), EPS);
+  return true;
+}
+
+bool test_CameraPath_read(void) {
+  const char *path = "test_CameraPath_read.txt";
+  FILE *f = fopen(path, "w");
+  ASSERT_CUSTOM(f != NULL, "Failed to create the keyframe file");
+  fprintf(f, "# time pos yaw,pitch [fov]\n"
+             "0 0,1,4 0,0 40\n"
+             "\n"
+             "2 4,1,0 90,-10\n");
+  fclose(f);
+
+  CameraPath camera_path = CameraPath_read(path);
+  ASSERT_EQ(camera_path.keyframes_count, 2);
+  ASSERT_EQF(CameraPath_duration(&camera_path), 2, EPS);
+  // keeps the fov of the keyframe before it
+  ASSERT_EQF(camera_path.keyframes[1].fov_rad, deg_to_rad(40), EPS);
+  CameraPath_delete(&camera_path);
+
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+bool all_camera_animation_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_CameraKeyframe_parse, &ok);
+  TEST_RUN(test_CameraPath_sample, &ok);
+  TEST_RUN(test_CameraPath_read, &ok);
+  return ok;
+}
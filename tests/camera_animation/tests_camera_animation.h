@@ -0,0 +1,7 @@
+#ifndef TESTS_CAMERA_ANIMATION_H_
+#define TESTS_CAMERA_ANIMATION_H_
+
+#include <stdbool.h>
+bool all_camera_animation_tests(void);
+
+#endif // TESTS_CAMERA_ANIMATION_H_
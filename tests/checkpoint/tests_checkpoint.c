@@ -0,0 +1,92 @@
+#include "tests_checkpoint.h"
+#include "asserts.h"
+#include "checkpoint.h"
+#include "tests_macros.h"
+#include "utils.h"
+#include <stdio.h>
+
+bool test_checkpoint__write_read(void) {
+  const char *path = "test_checkpoint__write_read.ckpt";
+  Checkpoint written = Checkpoint_new(WindowResolution_new(3, 2));
+  written.frame_number = 123;
+  written.seed_offset = 45;
+  written.settings_hash = 0x0123456789abcdefull;
+  for (uint32_t i = 0; i < 3 * 2 * 4; ++i) {
+    written.accumulation[i] = i;
+    written.albedo[i] = -(float)i;
+    written.normal[i] = i * 0.5f;
+  }
+  for (uint32_t i = 0; i < 3 * 2 * 2; ++i)
+    written.moments[i] = i * 2.0f;
+  ASSERT_CUSTOM(Checkpoint_write(&written, path), "Failed to write checkpoint");
+  ASSERT_CUSTOM(!FilePath_exists("test_checkpoint__write_read.ckpt.tmp"),
+                "The temporary file was left behind");
+
+  Checkpoint read;
+  ASSERT_CUSTOM(Checkpoint_read(&read, path), "Failed to read checkpoint");
+  ASSERT_EQ(read.resolution.width, 3u);
+  ASSERT_EQ(read.resolution.height, 2u);
+  ASSERT_EQ(read.frame_number, 123u);
+  ASSERT_EQ(read.seed_offset, 45u);
+  ASSERT_CUSTOM(read.settings_hash == written.settings_hash,
+                "The settings hash differs");
+  ASSERT_EQF(read.accumulation[23], 23.0f, 0.0f);
+  ASSERT_EQF(read.moments[11], 22.0f, 0.0f);
+  ASSERT_EQF(read.albedo[5], -5.0f, 0.0f);
+  ASSERT_EQF(read.normal[23], 11.5f, 0.0f);
+
+  Checkpoint_delete(&written);
+  Checkpoint_delete(&read);
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+bool test_checkpoint__read_rejects_other_files(void) {
+  const char *path = "test_checkpoint__read_rejects_other_files.ckpt";
+  Checkpoint checkpoint;
+  ASSERT_CUSTOM(!Checkpoint_read(&checkpoint, path),
+                "Read a checkpoint that doesn't exist");
+
+  FILE *f = fopen(path, "wb");
+  ASSERT_CUSTOM(f != NULL, "Failed to create the test file");
+  fputs("definitely not a checkpoint, but long enough for a header", f);
+  fclose(f);
+  ASSERT_CUSTOM(!Checkpoint_read(&checkpoint, path),
+                "Read a file that isn't a checkpoint");
+
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+bool test_checkpoint__settings_hash(void) {
+  Settings settings = Settings_default();
+  const uint64_t hash = Checkpoint_settings_hash(&settings);
+
+  // rendering more frames continues the same render
+  settings.rendering_params.frames_to_render = 1000;
+  ASSERT_CUSTOM(Checkpoint_settings_hash(&settings) == hash,
+                "frames_to_render changed the hash");
+
+  settings.cam.pos.x += 1;
+  ASSERT_CUSTOM(Checkpoint_settings_hash(&settings) != hash,
+                "The camera didn't change the hash");
+  settings = Settings_default();
+  settings.rendering_params.samples_per_pixel += 1;
+  ASSERT_CUSTOM(Checkpoint_settings_hash(&settings) != hash,
+                "samples_per_pixel didn't change the hash");
+  settings = Settings_default();
+  settings.scene_path = SmallString_new("other.glb");
+  ASSERT_CUSTOM(Checkpoint_settings_hash(&settings) != hash,
+                "The scene didn't change the hash");
+  return true;
+}
+
+bool all_checkpoint_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_checkpoint__write_read, &ok);
+  TEST_RUN(test_checkpoint__read_rejects_other_files, &ok);
+  TEST_RUN(test_checkpoint__settings_hash, &ok);
+  return ok;
+}
@@ -0,0 +1,7 @@
+#ifndef TESTS_CHECKPOINT_H_
+#define TESTS_CHECKPOINT_H_
+
+#include <stdbool.h>
+bool all_checkpoint_tests(void);
+
+#endif // TESTS_CHECKPOINT_H_
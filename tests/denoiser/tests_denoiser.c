@@ -0,0 +1,100 @@
+#include "tests_denoiser.h"
+#include "asserts.h"
+#include "denoiser.h"
+#include "tests_macros.h"
+#include <math.h>
+#include <stdint.h>
+
+#define SIZE 32
+#define SAMPLES 16.0f
+
+// sets the pixel as if all of its samples were gray, with the given average
+// and spread around it, having hit a surface with the given normal
+static void set_pixel(Denoiser *d, uint32_t pixel, float value, float spread,
+                      const float normal[3]) {
+  for (int c = 0; c < 3; ++c) {
+    d->accumulation[pixel * 4 + c] = value * SAMPLES;
+    d->albedo[pixel * 4 + c] = 0.8f * SAMPLES;
+    d->normal[pixel * 4 + c] = normal[c] * SAMPLES;
+  }
+  d->accumulation[pixel * 4 + 3] = SAMPLES;
+  d->moments[pixel * 2] = value * SAMPLES;
+  d->moments[pixel * 2 + 1] = (value * value + spread * spread) * SAMPLES;
+}
+
+// deterministic noise in [-1, 1]
+static float noise(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return (float)(*state >> 8) / (float)(1u << 23) - 1.0f;
+}
+
+static float mean_abs_error(const float *rgb, uint32_t begin, uint32_t end,
+                            uint32_t stride, float expected) {
+  float error = 0;
+  for (uint32_t i = begin; i < end; ++i)
+    error += fabsf(rgb[i * stride] - expected);
+  return error / (end - begin);
+}
+
+bool test_denoiser__constant_image_unchanged(void) {
+  Denoiser d = Denoiser_new(WindowResolution_new(SIZE, SIZE));
+  const float up[3] = {0, 1, 0};
+  for (uint32_t i = 0; i < SIZE * SIZE; ++i)
+    set_pixel(&d, i, 0.25f, 0.1f, up);
+
+  Denoiser_run(&d);
+
+  for (uint32_t i = 0; i < SIZE * SIZE * 3; ++i)
+    ASSERT_EQF(d.color[i], 0.25f, 1e-5f);
+  Denoiser_delete(&d);
+  return true;
+}
+
+bool test_denoiser__reduces_noise(void) {
+  Denoiser d = Denoiser_new(WindowResolution_new(SIZE, SIZE));
+  const float up[3] = {0, 1, 0};
+  uint32_t rng = 1;
+  for (uint32_t i = 0; i < SIZE * SIZE; ++i)
+    set_pixel(&d, i, 0.5f + 0.1f * noise(&rng), 0.4f, up);
+
+  const float noisy =
+      mean_abs_error(d.accumulation, 0, SIZE * SIZE, 4, 0.5f * SAMPLES) /
+      SAMPLES;
+  Denoiser_run(&d);
+  const float denoised = mean_abs_error(d.color, 0, SIZE * SIZE, 3, 0.5f);
+
+  ASSERT_CUSTOM(denoised < noisy / 2, "Noise wasn't reduced enough");
+  Denoiser_delete(&d);
+  return true;
+}
+
+bool test_denoiser__keeps_normal_edges(void) {
+  Denoiser d = Denoiser_new(WindowResolution_new(SIZE, SIZE));
+  const float left[3] = {1, 0, 0}, up[3] = {0, 1, 0};
+  // NOTE: the spread is large enough that luminance alone wouldn't stop
+  // the halves from blending
+  for (uint32_t y = 0; y < SIZE; ++y)
+    for (uint32_t x = 0; x < SIZE; ++x)
+      set_pixel(&d, y * SIZE + x, x < SIZE / 2 ? 0.0f : 1.0f, 2.0f,
+                x < SIZE / 2 ? left : up);
+
+  Denoiser_run(&d);
+
+  for (uint32_t y = 0; y < SIZE; ++y) {
+    const uint32_t row = y * SIZE;
+    ASSERT_EQF(mean_abs_error(d.color, row, row + SIZE / 2, 3, 0.0f), 0.0f,
+               1e-5f);
+    ASSERT_EQF(mean_abs_error(d.color, row + SIZE / 2, row + SIZE, 3, 1.0f),
+               0.0f, 1e-5f);
+  }
+  Denoiser_delete(&d);
+  return true;
+}
+
+bool all_denoiser_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_denoiser__constant_image_unchanged, &ok);
+  TEST_RUN(test_denoiser__reduces_noise, &ok);
+  TEST_RUN(test_denoiser__keeps_normal_edges, &ok);
+  return ok;
+}
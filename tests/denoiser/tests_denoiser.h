@@ -0,0 +1,7 @@
+#ifndef TESTS_DENOISER_H_
+#define TESTS_DENOISER_H_
+
+#include <stdbool.h>
+bool all_denoiser_tests(void);
+
+#endif // TESTS_DENOISER_H_
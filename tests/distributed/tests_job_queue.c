@@ -0,0 +1,80 @@
+#include "tests_job_queue.h"
+#include "asserts.h"
+#include "distributed/job_queue.h"
+#include "tests_macros.h"
+
+// NOTE: ASSERT_EQ evaluates its arguments more than once,
+// so popping has to happen outside of it
+
+bool test_job_queue__splits_all_frames(void) {
+  DistributedJobQueue queue = DistributedJobQueue_new(10, 4);
+  DistributedFrameRange job;
+  bool popped;
+
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, true);
+  ASSERT_EQ(job.first_frame, 0u);
+  ASSERT_EQ(job.frames_count, 4u);
+
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, true);
+  ASSERT_EQ(job.first_frame, 4u);
+  ASSERT_EQ(job.frames_count, 4u);
+
+  // the last job gets whatever is left
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, true);
+  ASSERT_EQ(job.first_frame, 8u);
+  ASSERT_EQ(job.frames_count, 2u);
+
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, false);
+  return true;
+}
+
+bool test_job_queue__requeued_first(void) {
+  DistributedJobQueue queue = DistributedJobQueue_new(10, 4);
+  DistributedFrameRange lost, job;
+  bool popped;
+
+  DistributedJobQueue_pop(&queue, &lost);
+  DistributedJobQueue_requeue(&queue, lost);
+
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, true);
+  ASSERT_EQ(job.first_frame, lost.first_frame);
+  ASSERT_EQ(job.frames_count, lost.frames_count);
+
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, true);
+  ASSERT_EQ(job.first_frame, 4u);
+  return true;
+}
+
+bool test_job_queue__requeued_after_exhausted(void) {
+  DistributedJobQueue queue = DistributedJobQueue_new(3, 4);
+  DistributedFrameRange lost, job;
+  bool popped;
+
+  DistributedJobQueue_pop(&queue, &lost);
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, false);
+
+  DistributedJobQueue_requeue(&queue, lost);
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, true);
+  ASSERT_EQ(job.first_frame, 0u);
+  ASSERT_EQ(job.frames_count, 3u);
+
+  popped = DistributedJobQueue_pop(&queue, &job);
+  ASSERT_EQ(popped, false);
+  return true;
+}
+
+bool all_job_queue_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_job_queue__splits_all_frames, &ok);
+  TEST_RUN(test_job_queue__requeued_first, &ok);
+  TEST_RUN(test_job_queue__requeued_after_exhausted, &ok);
+  return ok;
+}
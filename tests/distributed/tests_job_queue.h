@@ -0,0 +1,7 @@
+#ifndef TESTS_JOB_QUEUE_H_
+#define TESTS_JOB_QUEUE_H_
+
+#include <stdbool.h>
+bool all_job_queue_tests(void);
+
+#endif // TESTS_JOB_QUEUE_H_
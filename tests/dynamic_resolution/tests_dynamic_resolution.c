@@ -0,0 +1,112 @@
+#include "tests_dynamic_resolution.h"
+#include "asserts.h"
+#include "renderer/dynamic_resolution.h"
+#include "tests_macros.h"
+
+// NOTE: ASSERT_EQ evaluates its arguments more than once,
+// so updating has to happen outside of it
+
+#define TARGET 0.02
+
+bool test_dynamic_resolution__full_while_still(void) {
+  DynamicResolution dr = DynamicResolution_new();
+  const WindowResolution full = WindowResolution_new(640, 480);
+
+  bool changed = DynamicResolution_update(&dr, false, 1.0, TARGET);
+  ASSERT_EQ(changed, false);
+  const WindowResolution res = DynamicResolution_apply(&dr, full);
+  ASSERT_EQ(WindowResolution_eq(res, full), true);
+  return true;
+}
+
+bool test_dynamic_resolution__follows_frame_time(void) {
+  DynamicResolution dr = DynamicResolution_new();
+  bool changed;
+
+  changed = DynamicResolution_update(&dr, true, 1.0, TARGET);
+  ASSERT_EQ(changed, true);
+  ASSERT_EQF(dr.scale, 0.5f, 1e-6f);
+
+  // 4 times too slow, so half as many pixels along each axis
+  changed = DynamicResolution_update(&dr, true, TARGET * 4, TARGET);
+  ASSERT_EQ(changed, true);
+  ASSERT_EQF(dr.scale, 0.25f, 1e-6f);
+
+  // close enough to the target to stay as it is
+  changed = DynamicResolution_update(&dr, true, TARGET * 1.1, TARGET);
+  ASSERT_EQ(changed, false);
+
+  // way too fast, but the scale can only double in a single frame
+  changed = DynamicResolution_update(&dr, true, TARGET / 100, TARGET);
+  ASSERT_EQ(changed, true);
+  ASSERT_EQF(dr.scale, 0.5f, 1e-6f);
+
+  const WindowResolution res =
+      DynamicResolution_apply(&dr, WindowResolution_new(640, 480));
+  ASSERT_EQ(res.width, 320u);
+  ASSERT_EQ(res.height, 240u);
+  return true;
+}
+
+bool test_dynamic_resolution__clamped(void) {
+  DynamicResolution dr = DynamicResolution_new();
+  DynamicResolution_update(&dr, true, 0, TARGET);
+  for (int i = 0; i < 10; ++i)
+    DynamicResolution_update(&dr, true, TARGET * 100, TARGET);
+  ASSERT_EQF(dr.scale, DYNAMIC_RESOLUTION_MIN_SCALE, 1e-6f);
+
+  for (int i = 0; i < 10; ++i)
+    DynamicResolution_update(&dr, true, TARGET / 100, TARGET);
+  ASSERT_EQF(dr.scale, 1.0f, 1e-6f);
+  return true;
+}
+
+bool test_dynamic_resolution__full_after_stopping(void) {
+  DynamicResolution dr = DynamicResolution_new();
+  const WindowResolution full = WindowResolution_new(640, 480);
+  bool changed;
+
+  DynamicResolution_update(&dr, true, 0, TARGET);
+  for (int i = 1; i < DYNAMIC_RESOLUTION_STILL_FRAMES; ++i) {
+    changed = DynamicResolution_update(&dr, false, TARGET, TARGET);
+    ASSERT_EQ(changed, false);
+  }
+  changed = DynamicResolution_update(&dr, false, TARGET, TARGET);
+  ASSERT_EQ(changed, true);
+  const WindowResolution res = DynamicResolution_apply(&dr, full);
+  ASSERT_EQ(WindowResolution_eq(res, full), true);
+
+  // the scale is kept for the next time the camera moves
+  changed = DynamicResolution_update(&dr, true, TARGET, TARGET);
+  ASSERT_EQ(changed, true);
+  ASSERT_EQF(dr.scale, 0.5f, 1e-6f);
+  return true;
+}
+
+bool test_dynamic_resolution__stays_reduced_between_moves(void) {
+  DynamicResolution dr = DynamicResolution_new();
+  const WindowResolution full = WindowResolution_new(640, 480);
+  bool changed;
+
+  DynamicResolution_update(&dr, true, 0, TARGET);
+  // a few still frames in between ones that move the camera
+  for (int i = 0; i < 3 * DYNAMIC_RESOLUTION_STILL_FRAMES; ++i) {
+    const bool moving = i % (DYNAMIC_RESOLUTION_STILL_FRAMES / 2) == 0;
+    changed = DynamicResolution_update(&dr, moving, TARGET, TARGET);
+    ASSERT_EQ(changed, false);
+  }
+  const WindowResolution res = DynamicResolution_apply(&dr, full);
+  ASSERT_EQ(res.width, 320u);
+  ASSERT_EQ(res.height, 240u);
+  return true;
+}
+
+bool all_dynamic_resolution_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_dynamic_resolution__full_while_still, &ok);
+  TEST_RUN(test_dynamic_resolution__follows_frame_time, &ok);
+  TEST_RUN(test_dynamic_resolution__clamped, &ok);
+  TEST_RUN(test_dynamic_resolution__full_after_stopping, &ok);
+  TEST_RUN(test_dynamic_resolution__stays_reduced_between_moves, &ok);
+  return ok;
+}
@@ -0,0 +1,7 @@
+#ifndef TESTS_DYNAMIC_RESOLUTION_H_
+#define TESTS_DYNAMIC_RESOLUTION_H_
+
+#include <stdbool.h>
+bool all_dynamic_resolution_tests(void);
+
+#endif // TESTS_DYNAMIC_RESOLUTION_H_
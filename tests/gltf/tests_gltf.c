@@ -1,6 +1,7 @@
 #include "tests_gltf.h"
 #include "asserts.h"
 #include "rad_deg.h"
+#include "arena.h"
 #include "scene/file_formats/gltf.h"
 #include "tests_macros.h"
 #include <float.h>
@@ -19,8 +20,86 @@ bool test_load_gltf_scene__cube_camera(void) {
   return true;
 }
 
+bool test_load_gltf_camera_path(void) {
+  CameraPath path =
+      load_gltf_camera_path("tests/gltf/scenes/camera-animation.gltf");
+
+  // keyed at the times of both the translation's and the rotation's keys
+  ASSERT_EQ(path.keyframes_count, 3);
+  ASSERT_EQF(path.keyframes[1].time_s, 1, FLT_EPSILON);
+  ASSERT_EQ_VEC3(path.keyframes[1].pos, vec3_new(0, 0, -2), 1e-5);
+  // halfway through the rotation by 90 degrees to the left
+  ASSERT_EQF(path.keyframes[1].rotation.yaw_rad, deg_to_rad(315), 1e-5);
+  ASSERT_EQF(path.keyframes[1].rotation.pitch_rad, 0, 1e-5);
+  ASSERT_EQF(path.keyframes[2].rotation.yaw_rad, deg_to_rad(270), 1e-5);
+  ASSERT_EQF(path.keyframes[2].fov_rad, 0.5, FLT_EPSILON);
+
+  CameraPath_delete(&path);
+  return true;
+}
+
+// the scene has a triangle moved by its node, one by its morph target and one
+// by the joint of its skin, all of them animated from 0s to 1s
+bool test_load_gltf_animated_scene(void) {
+  Scene scene = Scene_default();
+  GltfAnimation animation = {0};
+  load_gltf_animated_scene(&scene, &animation,
+                           "tests/gltf/scenes/animated-triangles.gltf");
+  ASSERT_EQ(GltfAnimation_is_loaded(&animation), true);
+  ASSERT_EQ(scene.triangles_count, 3);
+  ASSERT_EQF(animation.start_s, 0, FLT_EPSILON);
+  ASSERT_EQF(animation.end_s, 1, FLT_EPSILON);
+
+  GltfAnimation_apply(&animation, &scene, 0.5);
+  ASSERT_EQ_VEC3(scene.triangles[0].a, vec3_new(1, 0, 0), 1e-5);
+  ASSERT_EQ_VEC3(scene.triangles[0].c, vec3_new(1, 1, 0), 1e-5);
+  ASSERT_EQ_VEC3(scene.triangles[1].a, vec3_new(0, 0.5, -2), 1e-5);
+  ASSERT_EQ_VEC3(scene.triangles[1].b, vec3_new(1, 0, -2), 1e-5);
+  // NOTE: the skinned mesh's own node doesn't move it
+  ASSERT_EQ_VEC3(scene.triangles[2].b, vec3_new(1, 1.5, 0), 1e-5);
+  ASSERT_EQ_VEC3(scene.triangles[2].nb, vec3_new(0, 0, 1), 1e-5);
+
+  // building the BVH reorders the triangles, which the animation has to follow
+  Arena arena = Arena_new(1024 * 1024);
+  Scene_build_bvh(&scene, BVHStrategy_SAH, &arena);
+  GltfAnimation_apply(&animation, &scene, 2);
+  for (uint32_t i = 0; i < scene.triangles_count; ++i) {
+    const vec3 expected[] = {vec3_new(2, 0, 0), vec3_new(0, 1, -2),
+                             vec3_new(0, 3, 0)};
+    ASSERT_EQ_VEC3(scene.triangles[i].a,
+                   expected[scene.triangles_sources[i]], 1e-5);
+  }
+
+  Arena_delete(&arena);
+  GltfAnimation_delete(&animation);
+  Scene_delete(&scene);
+  return true;
+}
+
+bool test_validate_gltf_scene(void) {
+  const char *valid[] = {"tests/gltf/scenes/cube-camera.glb",
+                         "tests/gltf/scenes/cornell box.glb",
+                         "tests/gltf/scenes/animated-triangles.gltf",
+                         "tests/gltf/scenes/camera-animation.gltf"};
+  for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i) {
+    SmallString error = {0};
+    const bool ok = validate_gltf_scene(valid[i], &error);
+    ASSERT_CUSTOM_FMT(ok, "%s: %s", valid[i], error.str);
+  }
+
+  // a file which exists, but isn't glTF
+  SmallString error = {0};
+  const bool ok = validate_gltf_scene("tests/gltf/tests_gltf.c", &error);
+  ASSERT_EQ(ok, false);
+  ASSERT_EQ(SmallString_is_empty(&error), false);
+  return true;
+}
+
 bool all_gltf_tests(void) {
   bool ok = true;
   TEST_RUN(test_load_gltf_scene__cube_camera, &ok);
+  TEST_RUN(test_load_gltf_camera_path, &ok);
+  TEST_RUN(test_load_gltf_animated_scene, &ok);
+  TEST_RUN(test_validate_gltf_scene, &ok);
   return ok;
 }
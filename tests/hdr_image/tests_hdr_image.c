@@ -0,0 +1,110 @@
+#include "tests_hdr_image.h"
+#include "asserts.h"
+#include "hdr_image.h"
+#include "tests_macros.h"
+#include <stdio.h>
+#include <string.h>
+
+// NOTE: the asserts can't print uint16_t
+#define HALF(_f) ((uint32_t)float_to_half(_f))
+
+bool test_float_to_half(void) {
+  ASSERT_EQ(HALF(0.0f), 0x0000u);
+  ASSERT_EQ(HALF(-0.0f), 0x8000u);
+  ASSERT_EQ(HALF(1.0f), 0x3c00u);
+  ASSERT_EQ(HALF(-2.0f), 0xc000u);
+  ASSERT_EQ(HALF(0.5f), 0x3800u);
+  ASSERT_EQ(HALF(65504.0f), 0x7bffu);
+  ASSERT_EQ(HALF(1e6f), 0x7c00u);
+  // the smallest subnormal and half of it, which is a tie rounding to 0
+  ASSERT_EQ(HALF(5.9604645e-8f), 0x0001u);
+  ASSERT_EQ(HALF(2.9802322e-8f), 0x0000u);
+  // 1 + 2^-11 is a tie between 1 and the next half, which is odd
+  ASSERT_EQ(HALF(1.00048828125f), 0x3c00u);
+  ASSERT_EQ(HALF(1.00146484375f), 0x3c02u);
+  return true;
+}
+
+// reads the whole file into buf, returns its size
+static size_t read_file(const char *path, uint8_t *buf, size_t capacity) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return 0;
+  const size_t size = fread(buf, 1, capacity, f);
+  fclose(f);
+  return size;
+}
+
+// 2x2 image with 2 floats per pixel, bottom row first
+static const float pixels[] = {1, 10, 2, 20, 3, 30, 4, 40};
+
+bool test_hdr_image__pfm(void) {
+  const char *path = "test_hdr_image__pfm.pfm";
+  HdrImage image = HdrImage_new(WindowResolution_new(2, 2));
+  HdrImage_add_channel(&image, "R", pixels, 2);
+  HdrImage_add_channel(&image, "G", pixels + 1, 2);
+  HdrImage_add_channel(&image, "B", pixels, 2);
+  ASSERT_CUSTOM(HdrImage_write_pfm(&image, path), "Failed to write PFM");
+
+  uint8_t buf[256];
+  const size_t size = read_file(path, buf, sizeof(buf));
+  const char *header = "PF\n2 2\n-1.0\n";
+  ASSERT_EQ(size, strlen(header) + 4 * 3 * sizeof(float));
+  ASSERT_CUSTOM(memcmp(buf, header, strlen(header)) == 0, "Wrong PFM header");
+  // the last pixel, of the top row as PFM is stored bottom row first as well
+  float last[3];
+  memcpy(last, buf + size - sizeof(last), sizeof(last));
+  ASSERT_EQF(last[0], 4.0f, 0.0f);
+  ASSERT_EQF(last[1], 40.0f, 0.0f);
+  ASSERT_EQF(last[2], 4.0f, 0.0f);
+
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool test_hdr_image__exr(void) {
+  const char *path = "test_hdr_image__exr.exr";
+  HdrImage image = HdrImage_new(WindowResolution_new(2, 2));
+  HdrImage_add_channel(&image, "Z", pixels + 1, 2);
+  HdrImage_add_channel(&image, "R", pixels, 2);
+  ASSERT_CUSTOM(HdrImage_write_exr(&image, path, "", true),
+                "Failed to write EXR");
+
+  uint8_t buf[1024];
+  const size_t size = read_file(path, buf, sizeof(buf));
+  ASSERT_EQ(get_u32(buf), 0x01312f76u);
+  // channels are listed sorted by their names
+  const uint8_t *chlist = buf + 8 + sizeof("channels") + sizeof("chlist") + 4;
+  ASSERT_CUSTOM(strcmp((const char *)chlist, "R") == 0,
+                "Channels weren't sorted");
+
+  // 2 lines of y, size and 2 channels of 2 halfs after a table of 2 offsets
+  const size_t line_size = 4 + 4 + 2 * 2 * 2;
+  const size_t first_line = size - 2 * line_size;
+  ASSERT_EQ(get_u32(buf + first_line - 16), (uint32_t)first_line);
+  ASSERT_EQ(get_u32(buf + first_line - 8), (uint32_t)(first_line + line_size));
+
+  // the top row comes first, with R before Z
+  const uint8_t *line = buf + first_line;
+  ASSERT_EQ(get_u32(line), 0u);
+  ASSERT_EQ(get_u32(line + 4), 8u);
+  ASSERT_EQ((uint32_t)(line[8] | line[9] << 8), HALF(3.0f));
+  ASSERT_EQ((uint32_t)(line[12] | line[13] << 8), HALF(30.0f));
+
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+bool all_hdr_image_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_float_to_half, &ok);
+  TEST_RUN(test_hdr_image__pfm, &ok);
+  TEST_RUN(test_hdr_image__exr, &ok);
+  return ok;
+}
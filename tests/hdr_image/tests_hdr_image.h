@@ -0,0 +1,7 @@
+#ifndef TESTS_HDR_IMAGE_H_
+#define TESTS_HDR_IMAGE_H_
+
+#include <stdbool.h>
+bool all_hdr_image_tests(void);
+
+#endif // TESTS_HDR_IMAGE_H_
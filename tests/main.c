@@ -1,8 +1,20 @@
+#include "batch/tests_batch.h"
+#include "bvh/tests_analysis.h"
 #include "bvh/tests_apply_lut.h"
+#include "bvh/tests_traversal.h"
 #include "camera/tests_camera.h"
+#include "camera_animation/tests_camera_animation.h"
+#include "checkpoint/tests_checkpoint.h"
+#include "denoiser/tests_denoiser.h"
+#include "distributed/tests_job_queue.h"
+#include "dynamic_resolution/tests_dynamic_resolution.h"
+#include "hdr_image/tests_hdr_image.h"
 #include "file_watcher/tests_file_watcher.h"
 #include "gltf/tests_gltf.h"
+#include "scene/tests_lights.h"
 #include "tests_macros.h"
+#include "utils/tests_thread.h"
+#include "utils/tests_timer.h"
 #include "utils/tests_utils.h"
 #include "yaw_pitch/tests_yawpitch.h"
 
@@ -11,7 +23,19 @@ int main(void) {
   TESTS_RUN(all_yawpitch_tests);
   TESTS_RUN(all_gltf_tests);
   TESTS_RUN(all_bvh_lut_tests);
+  TESTS_RUN(all_bvh_traversal_tests);
+  TESTS_RUN(all_bvh_analysis_tests);
+  TESTS_RUN(all_lights_tests);
   TESTS_RUN(all_camera_tests);
   TESTS_RUN(all_filewatcher_tests);
+  TESTS_RUN(all_job_queue_tests);
+  TESTS_RUN(all_thread_tests);
+  TESTS_RUN(all_timer_tests);
+  TESTS_RUN(all_denoiser_tests);
+  TESTS_RUN(all_dynamic_resolution_tests);
+  TESTS_RUN(all_hdr_image_tests);
+  TESTS_RUN(all_checkpoint_tests);
+  TESTS_RUN(all_batch_tests);
+  TESTS_RUN(all_camera_animation_tests);
   return 0;
 }
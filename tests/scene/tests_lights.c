@@ -0,0 +1,81 @@
+#include "tests_lights.h"
+#include "asserts.h"
+#include "scene.h"
+#include "scene/file_formats/gltf.h"
+#include "tests_macros.h"
+
+#define POINTS_COUNT 16
+
+static Arena tmp_arena = {0};
+
+static bool is_emissive(const Scene *scene, uint32_t triangle) {
+  const Material *mat = &scene->mats[scene->triangles_data[triangle].mat];
+  return mat->emissive_factor[0] > 0 || mat->emissive_factor[1] > 0 ||
+         mat->emissive_factor[2] > 0;
+}
+
+static bool test_lights__cornell_box(BVHStrategy strat) {
+  Scene scene = Scene_default();
+  load_gltf_scene(&scene, "tests/gltf/scenes/cornell box.glb");
+  Scene_build_bvh(&scene, strat, &tmp_arena);
+
+  ASSERT_COND(scene.lights_count > 0, scene.lights_count);
+
+  uint32_t emissive_count = 0;
+  for (uint32_t i = 0; i < scene.triangles_count; ++i)
+    emissive_count += is_emissive(&scene, i);
+  ASSERT_EQ(scene.lights_count, emissive_count);
+
+  float total_power = 0;
+  for (uint32_t i = 0; i < scene.lights_count; ++i) {
+    const Light *light = &scene.lights[i];
+    // the triangles got reordered by the BVH, the lights must've followed
+    ASSERT_EQ(is_emissive(&scene, light->triangle), true);
+    ASSERT_EQ(scene.triangles_lights[light->triangle], i);
+    total_power += light->power;
+
+    // the bit trail must lead to the light's leaf
+    uint32_t node_idx = 0;
+    for (uint32_t depth = 0; scene.light_bvh_nodes[node_idx].count == 0;
+         ++depth)
+      node_idx = scene.light_bvh_nodes[node_idx].first +
+                 ((light->bit_trail >> depth) & 1);
+    ASSERT_EQ(scene.light_bvh_nodes[node_idx].first, i);
+  }
+  ASSERT_EQ(scene.light_bvh_nodes_count, 2 * scene.lights_count - 1);
+  ASSERT_EQF(total_power, scene.light_bvh_nodes[0].power, 1e-4f);
+  ASSERT_EQF(total_power, scene.lights_total_power, 1e-4f);
+
+  // some light is picked from every point that any light can reach
+  for (int i = 0; i < POINTS_COUNT; ++i) {
+    const vec3 point = vec3_new(-0.8f + 1.6f * i / POINTS_COUNT, 0.5f, 0.3f);
+    const vec3 normal = vec3_norm(vec3_new(0.1f, 1.0f - 2.0f * (i % 2), 0.2f));
+    float pmf_sum = 0;
+    for (uint32_t l = 0; l < scene.lights_count; ++l)
+      pmf_sum +=
+          LightBVH_pmf(scene.light_bvh_nodes, &scene.lights[l], point, normal);
+    const float importance =
+        LightBVHnode_importance(&scene.light_bvh_nodes[0], point, normal);
+    ASSERT_EQF(pmf_sum, importance > 0 ? 1.0f : 0.0f, 1e-5f);
+  }
+
+  Scene_delete(&scene);
+  return true;
+}
+
+bool test_lights__midpoint(void) {
+  return test_lights__cornell_box(BVHStrategy_Midpoint);
+}
+
+bool test_lights__SAH(void) {
+  return test_lights__cornell_box(BVHStrategy_SAH);
+}
+
+bool all_lights_tests(void) {
+  tmp_arena = Arena_new(1024 * 1024);
+  bool ok = true;
+  TEST_RUN(test_lights__midpoint, &ok);
+  TEST_RUN(test_lights__SAH, &ok);
+  Arena_delete(&tmp_arena);
+  return ok;
+}
@@ -0,0 +1,8 @@
+#ifndef TESTS_LIGHTS_H_
+#define TESTS_LIGHTS_H_
+
+#include <stdbool.h>
+
+bool all_lights_tests(void);
+
+#endif // TESTS_LIGHTS_H_
@@ -0,0 +1,88 @@
+#include "tests_thread.h"
+#include "asserts.h"
+#include "tests_macros.h"
+#include "utils/thread.h"
+#include <string.h>
+
+#define ITEMS_COUNT 1000
+
+static void mark_items(void *ctx, uint32_t begin, uint32_t end) {
+  uint32_t *items = ctx;
+  for (uint32_t i = begin; i < end; ++i)
+    items[i]++;
+}
+
+static bool all_marked_once(const uint32_t *items, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i)
+    if (items[i] != 1)
+      return false;
+  return true;
+}
+
+bool test_parallel_for__visits_all_once(void) {
+  uint32_t items[ITEMS_COUNT];
+  memset(items, 0, sizeof(items));
+  Thread_parallel_for(ITEMS_COUNT, mark_items, items);
+  ASSERT_CUSTOM(all_marked_once(items, ITEMS_COUNT),
+                "Not every item was visited exactly once");
+  return true;
+}
+
+bool test_parallel_for__fewer_items_than_threads(void) {
+  uint32_t items[ITEMS_COUNT];
+  memset(items, 0, sizeof(items));
+  Thread_parallel_for(1, mark_items, items);
+  ASSERT_EQ(items[0], 1u);
+  ASSERT_EQ(items[1], 0u);
+
+  // nothing to do, so fn shouldn't even be called
+  Thread_parallel_for(0, mark_items, NULL);
+  return true;
+}
+
+typedef struct {
+  uint32_t *log;
+  uint32_t *log_len;
+  uint32_t index;
+} LoggedWork;
+
+// NOTE: only ever run on the queue's single thread
+static void log_work(void *ctx) {
+  LoggedWork *work = ctx;
+  work->log[(*work->log_len)++] = work->index;
+}
+
+static bool work_queue_runs_in_order(uint32_t capacity) {
+  uint32_t log[ITEMS_COUNT], log_len = 0;
+  LoggedWork works[ITEMS_COUNT];
+  WorkQueue *queue = WorkQueue_new(capacity);
+  for (uint32_t i = 0; i < ITEMS_COUNT; ++i) {
+    works[i] = (LoggedWork){.log = log, .log_len = &log_len, .index = i};
+    WorkQueue_push(queue, log_work, &works[i]);
+  }
+  WorkQueue_delete(queue);
+
+  if (log_len != ITEMS_COUNT)
+    return false;
+  for (uint32_t i = 0; i < ITEMS_COUNT; ++i)
+    if (log[i] != i)
+      return false;
+  return true;
+}
+
+bool test_work_queue__runs_everything_in_order(void) {
+  ASSERT_CUSTOM(work_queue_runs_in_order(16),
+                "Not all work was run or not in the order it was pushed");
+  // pushing has to wait for the thread almost every time
+  ASSERT_CUSTOM(work_queue_runs_in_order(1),
+                "Not all work was run or not in the order it was pushed");
+  return true;
+}
+
+bool all_thread_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_parallel_for__visits_all_once, &ok);
+  TEST_RUN(test_parallel_for__fewer_items_than_threads, &ok);
+  TEST_RUN(test_work_queue__runs_everything_in_order, &ok);
+  return ok;
+}
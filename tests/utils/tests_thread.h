@@ -0,0 +1,7 @@
+#ifndef TESTS_THREAD_H_
+#define TESTS_THREAD_H_
+
+#include <stdbool.h>
+bool all_thread_tests(void);
+
+#endif // TESTS_THREAD_H_
@@ -0,0 +1,150 @@
+#include "tests_timer.h"
+#include "asserts.h"
+#include "stats.h"
+#include "tests_macros.h"
+#include "utils/thread.h"
+#include "utils/timer.h"
+#include <stdio.h>
+#include <string.h>
+
+static void busy_wait_ns(uint64_t ns) {
+  const uint64_t start = Timer_now_ns();
+  while (Timer_now_ns() - start < ns)
+    ;
+}
+
+// NOTE: without GLFW ever being initialized
+bool test_StatsTimer__without_glfw(void) {
+  StatsTimer timer = StatsTimer_new();
+  StatsTimer_start(&timer);
+  busy_wait_ns(1000000);
+  StatsTimer_stop(&timer);
+  ASSERT_RANGE_IN(timer.total_time, 1e-3, 1.0);
+  return true;
+}
+
+bool test_Timer__nested_scopes(void) {
+  Timer_reset();
+  Timer_begin("outer");
+  Timer_begin("inner");
+  Timer_end();
+  Timer_begin("inner");
+  Timer_end();
+  Timer_end();
+  // the same name outside of outer is another scope
+  Timer_begin("inner");
+  Timer_end();
+
+  TimerScopeStats scopes[TIMER_MAX_SCOPES];
+  ASSERT_EQ(Timer_get_stats(scopes, TIMER_MAX_SCOPES), 3u);
+  ASSERT_CUSTOM(strcmp(scopes[0].name, "outer") == 0, "outer is first");
+  ASSERT_CUSTOM(strcmp(scopes[1].name, "outer/inner") == 0,
+                "followed by the scope nested in it");
+  ASSERT_CUSTOM(strcmp(scopes[2].name, "inner") == 0, "inner is last");
+  ASSERT_EQ(scopes[1].depth, 1u);
+  ASSERT_EQ(scopes[2].depth, 0u);
+  ASSERT_EQ((unsigned long)scopes[0].count, 1ul);
+  ASSERT_EQ((unsigned long)scopes[1].count, 2ul);
+  ASSERT_EQ((unsigned long)scopes[2].count, 1ul);
+  // the outer scope contains both of the inner ones
+  ASSERT_CUSTOM(scopes[0].min_ns >= 2 * scopes[1].min_ns,
+                "outer took less than what's nested in it");
+  return true;
+}
+
+bool test_Timer_str(void) {
+  Timer_reset();
+  const SmallString empty = Timer_str();
+  ASSERT_EQ(SmallString_is_empty(&empty), true);
+
+  Timer_begin("outer");
+  Timer_begin("inner");
+  Timer_end();
+  Timer_end();
+  const SmallString str = Timer_str();
+  ASSERT_CUSTOM(strstr(str.str, "\nouter: 1, ") != NULL, "outer is listed");
+  ASSERT_CUSTOM(strstr(str.str, "\n  inner: 1, ") != NULL,
+                "inner is indented under it");
+  return true;
+}
+
+bool test_Timer__percentiles(void) {
+  Timer_reset();
+  // 9 short ones and a long one, which is only slower than 90% of them
+  for (int i = 0; i < 10; ++i) {
+    Timer_begin("scope");
+    if (i == 5)
+      busy_wait_ns(2000000);
+    Timer_end();
+  }
+
+  TimerScopeStats stats;
+  ASSERT_EQ(Timer_get_stats(&stats, 1), 1u);
+  ASSERT_CUSTOM(stats.p50_ns < 1000000, "p50 is one of the short ones");
+  ASSERT_CUSTOM(stats.p99_ns >= 2000000, "p99 is the long one");
+  ASSERT_CUSTOM(stats.min_ns <= stats.p50_ns, "min is the smallest");
+  ASSERT_CUSTOM(stats.mean_ns >= 200000, "mean includes the long one");
+  return true;
+}
+
+static void time_items(void *ctx, uint32_t begin, uint32_t end) {
+  UNUSED(ctx);
+  for (uint32_t i = begin; i < end; ++i) {
+    Timer_begin("item");
+    Timer_end();
+  }
+}
+
+bool test_Timer__threads(void) {
+  Timer_reset();
+  Thread_parallel_for(1000, time_items, NULL);
+
+  TimerScopeStats stats;
+  ASSERT_EQ(Timer_get_stats(&stats, 1), 1u);
+  ASSERT_EQ((unsigned long)stats.count, 1000ul);
+  return true;
+}
+
+#define TRACE_PATH "tests_timer_trace.json"
+
+bool test_Timer__trace(void) {
+  Timer_start_trace();
+  Timer_set_thread_track("main");
+  Timer_begin("traced \"outer\"");
+  Thread_parallel_for(1000, time_items, NULL);
+  Timer_end();
+  ASSERT_CUSTOM(Timer_write_trace(TRACE_PATH), "Failed to write the trace");
+
+  static char trace[1 << 20];
+  FILE *f = fopen(TRACE_PATH, "r");
+  ASSERT_CUSTOM(f != NULL, "Failed to open the trace");
+  const size_t len = fread(trace, 1, sizeof(trace) - 1, f);
+  fclose(f);
+  remove(TRACE_PATH);
+  trace[len] = '\0';
+
+  ASSERT_CUSTOM(strstr(trace, "\"traceEvents\"") != NULL, "has the events");
+  ASSERT_CUSTOM(strstr(trace, "\"name\": \"main\"") != NULL,
+                "names the main thread's track");
+  // NOTE: with a single CPU, the main thread does all of the work itself
+  ASSERT_CUSTOM(Thread_cpu_count() == 1 ||
+                    strstr(trace, "\"name\": \"worker 1\"") != NULL,
+                "names the workers' tracks");
+  ASSERT_CUSTOM(strstr(trace, "\"name\": \"traced \\\"outer\\\"\"") != NULL,
+                "escapes the scopes' names");
+  ASSERT_CUSTOM(strstr(trace, "\"name\": \"item\"") != NULL,
+                "has the workers' scopes");
+  return true;
+}
+
+bool all_timer_tests(void) {
+  bool ok = true;
+  TEST_RUN(test_StatsTimer__without_glfw, &ok);
+  TEST_RUN(test_Timer__nested_scopes, &ok);
+  TEST_RUN(test_Timer_str, &ok);
+  TEST_RUN(test_Timer__percentiles, &ok);
+  TEST_RUN(test_Timer__threads, &ok);
+  TEST_RUN(test_Timer__trace, &ok);
+  Timer_reset();
+  return ok;
+}
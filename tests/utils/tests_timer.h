@@ -0,0 +1,7 @@
+#ifndef TESTS_TIMER_H_
+#define TESTS_TIMER_H_
+
+#include <stdbool.h>
+bool all_timer_tests(void);
+
+#endif // TESTS_TIMER_H_
@@ -2,6 +2,7 @@
 #include "asserts.h"
 #include "tests_macros.h"
 #include "utils.h"
+#include <stdio.h>
 #include <string.h>
 
 
@@ -14,9 +15,51 @@ bool test_StringArray_join(void) {
   return true;
 }
 
+bool test_Image_write_png__description(void) {
+  const char *path = "test_Image_write_png__description.png";
+  const uint8_t rgb[] = {255, 0, 0, 0, 0, 255};
+  ASSERT_CUSTOM(Image_write_png(path, rgb, 2, 1, "spp: 1"),
+                "Failed to write the image");
+
+  uint8_t buf[256];
+  FILE *f = fopen(path, "rb");
+  ASSERT_CUSTOM(f != NULL, "Failed to open the image");
+  const size_t size = fread(buf, 1, sizeof(buf), f);
+  fclose(f);
+
+  // right after the signature and IHDR
+  const uint8_t chunk[] = {0, 0, 0, 22, 'i', 'T', 'X', 't', 'D', 'e', 's',
+                           'c', 'r', 'i', 'p', 't', 'i', 'o', 'n', 0, 0, 0,
+                           0, 0, 's', 'p', 'p', ':', ' ', '1'};
+  ASSERT_CUSTOM(size > 33 + sizeof(chunk), "The image is too short");
+  ASSERT_CUSTOM(memcmp(buf + 12, "IHDR", 4) == 0, "IHDR isn't first");
+  ASSERT_CUSTOM(memcmp(buf + 33, chunk, sizeof(chunk)) == 0,
+                "The description's chunk isn't right after IHDR");
+
+  ASSERT_CUSTOM_FMT(remove(path) == 0,
+                    "[cleanup] Failed to delete the test file: %s", path);
+  return true;
+}
+
+bool test_FilePath_with_number(void) {
+  char buf[32];
+  ASSERT_CUSTOM(FilePath_with_number(buf, sizeof(buf), "out/frame.png", 7),
+                "The path should fit");
+  ASSERT_EQ(strcmp(buf, "out/frame_0007.png"), 0);
+  // only the file name's dot starts the extension
+  ASSERT_CUSTOM(FilePath_with_number(buf, sizeof(buf), "out.d/frame", 12345),
+                "The path should fit");
+  ASSERT_EQ(strcmp(buf, "out.d/frame_12345"), 0);
+  ASSERT_CUSTOM(!FilePath_with_number(buf, 8, "frame.png", 0),
+                "The path shouldn't fit");
+  return true;
+}
+
 bool all_utils_tests(void) {
   bool ok = true;
   TEST_RUN(test_StringArray_join, &ok);
+  TEST_RUN(test_Image_write_png__description, &ok);
+  TEST_RUN(test_FilePath_with_number, &ok);
 
   return ok;
 }